@@ -0,0 +1,105 @@
+#include "AllocationCounter.h"
+
+#if defined(LOOPBACK_RECORDER_COUNT_ALLOCATIONS)
+
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+#if defined(_WIN32)
+#include <malloc.h>
+#endif
+
+namespace {
+
+thread_local uint64_t t_allocations = 0;
+std::atomic<uint64_t> g_allocations{0};
+std::atomic<uint64_t> g_allocatedBytes{0};
+
+void Count(std::size_t size) {
+    ++t_allocations;
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    g_allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+}
+
+} // namespace
+
+// The array and nothrow forms forward to these in the standard library.
+void* operator new(std::size_t size) {
+    Count(size);
+    if (void* block = std::malloc(size ? size : 1)) {
+        return block;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment) {
+    Count(size);
+    const auto align = static_cast<std::size_t>(alignment);
+#if defined(_WIN32)
+    void* block = _aligned_malloc(size ? size : 1, align);
+#else
+    void* block = std::aligned_alloc(align, (size + align - 1) / align * align);
+#endif
+    if (block) {
+        return block;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* block) noexcept {
+    std::free(block);
+}
+
+void operator delete(void* block, std::size_t) noexcept {
+    std::free(block);
+}
+
+void operator delete(void* block, std::align_val_t) noexcept {
+#if defined(_WIN32)
+    _aligned_free(block);
+#else
+    std::free(block);
+#endif
+}
+
+void operator delete(void* block, std::size_t, std::align_val_t alignment) noexcept {
+    operator delete(block, alignment);
+}
+
+bool AllocationCounter::Enabled() {
+    return true;
+}
+
+uint64_t AllocationCounter::ThreadAllocations() {
+    return t_allocations;
+}
+
+uint64_t AllocationCounter::ProcessAllocations() {
+    return g_allocations.load(std::memory_order_relaxed);
+}
+
+uint64_t AllocationCounter::ProcessAllocatedBytes() {
+    return g_allocatedBytes.load(std::memory_order_relaxed);
+}
+
+#else
+
+bool AllocationCounter::Enabled() {
+    return false;
+}
+
+uint64_t AllocationCounter::ThreadAllocations() {
+    return 0;
+}
+
+uint64_t AllocationCounter::ProcessAllocations() {
+    return 0;
+}
+
+uint64_t AllocationCounter::ProcessAllocatedBytes() {
+    return 0;
+}
+
+#endif
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstdint>
+
+// Heap allocations through the global operator new, per thread and per process. The counters
+// only move in the allocation-counting build (LOOPBACK_RECORDER_COUNT_ALLOCATIONS), where
+// AllocationCounter.cpp replaces operator new; elsewhere they read zero and cost nothing.
+namespace AllocationCounter {
+
+bool Enabled();
+// Allocations made by the calling thread so far.
+uint64_t ThreadAllocations();
+uint64_t ProcessAllocations();
+uint64_t ProcessAllocatedBytes();
+
+} // namespace AllocationCounter
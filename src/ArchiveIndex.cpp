@@ -0,0 +1,599 @@
+#include "ArchiveIndex.h"
+
+#include "Mp3Converter.h"
+#include "RecordingUtils.h"
+#include "WavWriter.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <cwctype>
+#include <ctime>
+#include <iterator>
+#include <limits>
+#include <stdexcept>
+#include <unordered_set>
+
+namespace {
+
+constexpr char kMagic[8] = {'L', 'R', 'A', 'R', 'C', 'I', 'D', 'X'};
+constexpr uint32_t kVersion = 1;
+constexpr size_t kHeaderSize = 16;
+constexpr size_t kRecordSize = 32;
+constexpr int64_t kMicrosPerSecond = 1000000;
+
+std::string ToUtf8(const std::filesystem::path& path) {
+    const auto text = path.u8string();
+    return std::string(text.begin(), text.end());
+}
+
+std::filesystem::path FromUtf8(const std::string& text) {
+    return std::filesystem::path(std::u8string(text.begin(), text.end()));
+}
+
+int64_t ToUnixMicros(std::chrono::system_clock::time_point time) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(time.time_since_epoch()).count();
+}
+
+// Frames between two instants at `sampleRate`, rounded towards negative infinity.
+int64_t MicrosToFrames(int64_t micros, uint32_t sampleRate) {
+    const int64_t whole = micros / kMicrosPerSecond;
+    int64_t rest = micros % kMicrosPerSecond;
+    int64_t frames = whole * sampleRate + rest * sampleRate / kMicrosPerSecond;
+    if (rest < 0 && (rest * sampleRate) % kMicrosPerSecond != 0) {
+        --frames;
+    }
+    return frames;
+}
+
+template <typename T>
+void PutValue(unsigned char*& cursor, T value) {
+    std::memcpy(cursor, &value, sizeof(T));
+    cursor += sizeof(T);
+}
+
+template <typename T>
+T GetValue(const unsigned char*& cursor) {
+    T value{};
+    std::memcpy(&value, cursor, sizeof(T));
+    cursor += sizeof(T);
+    return value;
+}
+
+} // namespace
+
+int64_t ArchiveIndexRecord::EndUnixMicros() const {
+    if (sampleRate == 0) {
+        return startUnixMicros;
+    }
+    const auto whole = static_cast<int64_t>(frameCount / sampleRate);
+    const auto rest = static_cast<int64_t>(frameCount % sampleRate);
+    return startUnixMicros + whole * kMicrosPerSecond + rest * kMicrosPerSecond / sampleRate;
+}
+
+std::filesystem::path BuildArchiveIndexPath(const std::filesystem::path& basePath) {
+    std::wstring stem = basePath.stem().wstring();
+    if (stem.empty()) {
+        stem = L"segment";
+    }
+    return basePath.parent_path() / (stem + L".index");
+}
+
+ArchiveIndexWriter::ArchiveIndexWriter(const std::filesystem::path& indexPath)
+    : indexPath_(indexPath), pathsPath_(std::filesystem::path(indexPath) += L".paths") {
+    {
+        std::ifstream existing(pathsPath_, std::ios::binary);
+        std::string line;
+        uint32_t id = 0;
+        while (std::getline(existing, line)) {
+            if (!line.empty() && line.back() == '\r') {
+                line.pop_back();
+            }
+            fileIds_.emplace(line, id++);
+        }
+    }
+    std::error_code ec;
+    const bool fresh = !std::filesystem::exists(indexPath_, ec) || std::filesystem::file_size(indexPath_, ec) == 0;
+    if (!fresh) {
+        // Drop a torn record left by a crash so new records stay aligned.
+        const uint64_t size = std::filesystem::file_size(indexPath_, ec);
+        if (!ec && size > kHeaderSize && (size - kHeaderSize) % kRecordSize != 0) {
+            std::filesystem::resize_file(indexPath_, size - (size - kHeaderSize) % kRecordSize, ec);
+        }
+    }
+    records_.open(indexPath_, std::ios::binary | std::ios::app);
+    paths_.open(pathsPath_, std::ios::binary | std::ios::app);
+    if (!records_ || !paths_) {
+        throw std::runtime_error("打开归档时间索引失败：" + indexPath_.string());
+    }
+    if (fresh) {
+        unsigned char header[kHeaderSize] = {};
+        unsigned char* cursor = header;
+        std::memcpy(cursor, kMagic, sizeof(kMagic));
+        cursor += sizeof(kMagic);
+        PutValue<uint32_t>(cursor, kVersion);
+        PutValue<uint32_t>(cursor, static_cast<uint32_t>(kRecordSize));
+        records_.write(reinterpret_cast<const char*>(header), sizeof(header));
+        records_.flush();
+    }
+}
+
+void ArchiveIndexWriter::Append(const std::filesystem::path& fileName,
+                                std::chrono::system_clock::time_point start,
+                                uint64_t frameCount,
+                                uint32_t sampleRate,
+                                uint32_t gaps,
+                                uint64_t droppedFrames) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const std::string name = ToUtf8(fileName);
+    auto [it, inserted] = fileIds_.emplace(name, static_cast<uint32_t>(fileIds_.size()));
+    if (inserted) {
+        // The path line goes first so a record never refers to an id the sidecar lacks.
+        paths_ << name << '\n';
+        paths_.flush();
+    }
+
+    unsigned char record[kRecordSize] = {};
+    unsigned char* cursor = record;
+    PutValue<int64_t>(cursor, ToUnixMicros(start));
+    PutValue<uint64_t>(cursor, frameCount);
+    PutValue<uint32_t>(cursor, sampleRate);
+    PutValue<uint32_t>(cursor, it->second);
+    PutValue<uint32_t>(cursor, gaps);
+    PutValue<uint32_t>(cursor, static_cast<uint32_t>(std::min<uint64_t>(droppedFrames, std::numeric_limits<uint32_t>::max())));
+    records_.write(reinterpret_cast<const char*>(record), sizeof(record));
+    records_.flush();
+    if (!records_ || !paths_) {
+        throw std::runtime_error("写入归档时间索引失败：" + indexPath_.string());
+    }
+}
+
+ArchiveIndex ArchiveIndex::Load(const std::filesystem::path& indexPath) {
+    std::ifstream stream(indexPath, std::ios::binary);
+    if (!stream) {
+        throw std::runtime_error("打开归档时间索引失败：" + indexPath.string());
+    }
+    const std::vector<unsigned char> data((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+    if (data.size() < kHeaderSize || std::memcmp(data.data(), kMagic, sizeof(kMagic)) != 0) {
+        throw std::runtime_error("不是有效的归档时间索引：" + indexPath.string());
+    }
+    const unsigned char* cursor = data.data() + sizeof(kMagic);
+    const auto version = GetValue<uint32_t>(cursor);
+    const auto recordSize = GetValue<uint32_t>(cursor);
+    if (version != kVersion || recordSize != kRecordSize) {
+        throw std::runtime_error("不支持的归档时间索引版本：" + indexPath.string());
+    }
+
+    ArchiveIndex index;
+    index.directory_ = indexPath.parent_path();
+    {
+        std::ifstream paths(std::filesystem::path(indexPath) += L".paths", std::ios::binary);
+        std::string line;
+        while (std::getline(paths, line)) {
+            if (!line.empty() && line.back() == '\r') {
+                line.pop_back();
+            }
+            index.fileNames_.push_back(FromUtf8(line));
+        }
+    }
+
+    // A torn trailing record (crash mid-append) is ignored.
+    const size_t count = (data.size() - kHeaderSize) / kRecordSize;
+    std::vector<ArchiveIndexRecord> records;
+    records.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        cursor = data.data() + kHeaderSize + i * kRecordSize;
+        ArchiveIndexRecord record;
+        record.startUnixMicros = GetValue<int64_t>(cursor);
+        record.frameCount = GetValue<uint64_t>(cursor);
+        record.sampleRate = GetValue<uint32_t>(cursor);
+        record.fileId = GetValue<uint32_t>(cursor);
+        record.gaps = GetValue<uint32_t>(cursor);
+        record.droppedFrames = GetValue<uint32_t>(cursor);
+        if (record.sampleRate == 0 || record.fileId >= index.fileNames_.size()) {
+            continue;
+        }
+        records.push_back(record);
+    }
+
+    // Only the newest record of a reused file name describes what is on disk now.
+    std::unordered_set<uint32_t> seen;
+    for (auto it = records.rbegin(); it != records.rend(); ++it) {
+        if (seen.insert(it->fileId).second) {
+            index.records_.push_back(*it);
+        }
+    }
+    std::stable_sort(index.records_.begin(), index.records_.end(),
+                     [](const ArchiveIndexRecord& a, const ArchiveIndexRecord& b) {
+                         return a.startUnixMicros < b.startUnixMicros;
+                     });
+    return index;
+}
+
+std::filesystem::path ArchiveIndex::FilePath(uint32_t fileId) const {
+    return directory_ / fileNames_.at(fileId);
+}
+
+std::optional<ArchiveLocation> ArchiveIndex::Find(std::chrono::system_clock::time_point time) const {
+    const int64_t micros = ToUnixMicros(time);
+    auto it = std::upper_bound(records_.begin(), records_.end(), micros,
+                               [](int64_t value, const ArchiveIndexRecord& record) {
+                                   return value < record.startUnixMicros;
+                               });
+    if (it == records_.begin()) {
+        return std::nullopt;
+    }
+    const ArchiveIndexRecord& record = *std::prev(it);
+    if (micros >= record.EndUnixMicros()) {
+        return std::nullopt;
+    }
+    ArchiveLocation location;
+    location.file = FilePath(record.fileId);
+    location.frameOffset = static_cast<uint64_t>(MicrosToFrames(micros - record.startUnixMicros, record.sampleRate));
+    location.record = record;
+    return location;
+}
+
+std::vector<ArchiveIndexRecord> ArchiveIndex::Overlapping(std::chrono::system_clock::time_point from,
+                                                          std::chrono::system_clock::time_point to) const {
+    const int64_t fromMicros = ToUnixMicros(from);
+    const int64_t toMicros = ToUnixMicros(to);
+    auto it = std::upper_bound(records_.begin(), records_.end(), fromMicros,
+                               [](int64_t value, const ArchiveIndexRecord& record) {
+                                   return value < record.startUnixMicros;
+                               });
+    if (it != records_.begin()) {
+        --it;
+    }
+    std::vector<ArchiveIndexRecord> result;
+    for (; it != records_.end() && it->startUnixMicros < toMicros; ++it) {
+        if (it->EndUnixMicros() > fromMicros) {
+            result.push_back(*it);
+        }
+    }
+    return result;
+}
+
+namespace {
+
+std::wstring LowerExtension(const std::filesystem::path& file) {
+    std::wstring extension = file.extension().wstring();
+    for (auto& ch : extension) {
+        ch = static_cast<wchar_t>(towlower(ch));
+    }
+    return extension;
+}
+
+ArchiveExtractResult ExtractWavRange(const ArchiveIndex& index,
+                                     const std::vector<ArchiveIndexRecord>& records,
+                                     std::chrono::system_clock::time_point from,
+                                     std::chrono::system_clock::time_point to,
+                                     const std::filesystem::path& outputPath,
+                                     Logger& logger) {
+    struct Source {
+        ArchiveIndexRecord record;
+        std::filesystem::path path;
+        WavFileLayout layout;
+    };
+    std::vector<Source> sources;
+    for (const auto& record : records) {
+        Source source{record, index.FilePath(record.fileId), {}};
+        try {
+            source.layout = ReadWavFileLayout(source.path);
+        } catch (const std::exception& ex) {
+            logger.Warn(L"[导出] 跳过无法读取的分段（以静音填充）：" + source.path.wstring() + L"（" + Utf8ToWide(ex.what()) + L"）");
+            continue;
+        }
+        if (!sources.empty() && !(source.layout.format == sources.front().layout.format)) {
+            logger.Warn(L"[导出] 分段格式与首个分段不同，以静音填充：" + source.path.wstring());
+            continue;
+        }
+        sources.push_back(std::move(source));
+    }
+    if (sources.empty()) {
+        throw std::runtime_error("所选时间段内没有可读取的 WAV 分段");
+    }
+
+    const AudioFormat& format = sources.front().layout.format;
+    const uint32_t sampleRate = format.sampleRate;
+    const uint32_t blockAlign = format.BytesPerFrame();
+    const int64_t fromMicros = ToUnixMicros(from);
+    const auto totalFrames = static_cast<uint64_t>(MicrosToFrames(ToUnixMicros(to) - fromMicros, sampleRate));
+    if (totalFrames * blockAlign > std::numeric_limits<uint32_t>::max() - 1024) {
+        throw std::runtime_error("导出范围超过 WAV 4 GiB 上限");
+    }
+
+    ArchiveExtractResult result;
+    WavWriter writer(outputPath, format);
+    std::vector<uint8_t> buffer(static_cast<size_t>(blockAlign) * 16384);
+    uint64_t written = 0;
+    auto writeSilence = [&](uint64_t frames) {
+        std::fill(buffer.begin(), buffer.end(), uint8_t{0});
+        while (frames > 0) {
+            const uint64_t chunk = std::min<uint64_t>(frames, buffer.size() / blockAlign);
+            writer.Write(buffer.data(), static_cast<size_t>(chunk * blockAlign));
+            frames -= chunk;
+            written += chunk;
+            result.silenceFrames += chunk;
+        }
+    };
+
+    for (const auto& source : sources) {
+        // Output frame at which this segment's first frame belongs.
+        const int64_t segmentStart = MicrosToFrames(source.record.startUnixMicros - fromMicros, sampleRate);
+        const uint64_t segmentFrames = source.layout.dataBytes / blockAlign;
+        if (segmentStart > static_cast<int64_t>(written)) {
+            writeSilence(std::min<uint64_t>(static_cast<uint64_t>(segmentStart), totalFrames) - written);
+        }
+        const int64_t firstFrame = static_cast<int64_t>(written) - segmentStart;
+        const int64_t lastFrame = std::min<int64_t>(static_cast<int64_t>(segmentFrames),
+                                                    static_cast<int64_t>(totalFrames) - segmentStart);
+        if (firstFrame >= lastFrame) {
+            continue;
+        }
+        std::ifstream input(source.path, std::ios::binary);
+        input.seekg(static_cast<std::streamoff>(source.layout.dataOffset + static_cast<uint64_t>(firstFrame) * blockAlign));
+        uint64_t remaining = static_cast<uint64_t>(lastFrame - firstFrame);
+        while (remaining > 0 && input) {
+            const uint64_t chunk = std::min<uint64_t>(remaining, buffer.size() / blockAlign);
+            input.read(reinterpret_cast<char*>(buffer.data()), static_cast<std::streamsize>(chunk * blockAlign));
+            const uint64_t framesRead = static_cast<uint64_t>(input.gcount()) / blockAlign;
+            if (framesRead == 0) {
+                break;
+            }
+            writer.Write(buffer.data(), static_cast<size_t>(framesRead * blockAlign));
+            remaining -= framesRead;
+            written += framesRead;
+            result.framesWritten += framesRead;
+        }
+        ++result.segmentsUsed;
+    }
+    if (written < totalFrames) {
+        writeSilence(totalFrames - written);
+    }
+    writer.Close();
+    logger.Info(L"[导出] 已写入 " + outputPath.wstring() + L"：" + std::to_wstring(result.segmentsUsed) + L" 个分段，" +
+                std::to_wstring(result.framesWritten) + L" 帧音频，" + std::to_wstring(result.silenceFrames) + L" 帧静音填充。");
+    return result;
+}
+
+// Samples LAME's encoder and a standard decoder put in front of the first input sample.
+constexpr int64_t kMp3CodecDelay = 576 + 529;
+
+// Lowest-bitrate frame with zeroed side info, which every decoder plays as silence. The
+// header keeps the reference frame's version, sample rate and channel mode.
+std::vector<char> BuildSilentMp3Frame(const unsigned char reference[4], uint32_t samplesPerFrame, uint32_t sampleRate) {
+    const bool mpeg1 = ((reference[1] >> 3) & 0x03) == 3;
+    const uint32_t bitrate = mpeg1 ? 32000 : 8000;   // bitrate index 1
+    std::vector<char> frame((samplesPerFrame / 8) * bitrate / sampleRate, 0);
+    frame[0] = static_cast<char>(0xFF);
+    frame[1] = static_cast<char>(reference[1] | 0x01);   // no CRC
+    frame[2] = static_cast<char>(0x10 | (reference[2] & 0x0C));
+    frame[3] = static_cast<char>(reference[3]);
+    return frame;
+}
+
+ArchiveExtractResult ExtractMp3Range(const ArchiveIndex& index,
+                                     const std::vector<ArchiveIndexRecord>& records,
+                                     std::chrono::system_clock::time_point from,
+                                     std::chrono::system_clock::time_point to,
+                                     const std::filesystem::path& outputPath,
+                                     Logger& logger) {
+    struct Source {
+        ArchiveIndexRecord record;
+        std::filesystem::path path;
+        Mp3FrameMap map;
+        size_t firstAudioFrame = 0;
+    };
+    std::vector<Source> sources;
+    unsigned char reference[4] = {};
+    for (const auto& record : records) {
+        Source source{record, index.FilePath(record.fileId), Mp3Converter::MapMp3Frames(index.FilePath(record.fileId)), 0};
+        source.firstAudioFrame = source.map.leadingInfoFrame ? 1 : 0;
+        unsigned char header[4] = {};
+        std::ifstream input(source.path, std::ios::binary);
+        if (source.map.frames.size() > source.firstAudioFrame) {
+            input.seekg(static_cast<std::streamoff>(source.map.frames[source.firstAudioFrame].offset));
+            input.read(reinterpret_cast<char*>(header), sizeof(header));
+        }
+        if (!input || source.map.frames.size() <= source.firstAudioFrame) {
+            logger.Warn(L"[导出] 跳过无法读取的分段（以静音帧填充）：" + source.path.wstring());
+            continue;
+        }
+        // Frames can only be spliced when version, sample rate and channel count agree.
+        const bool compatible = sources.empty() ||
+            ((header[1] & 0xFE) == (reference[1] & 0xFE) && (header[2] & 0x0C) == (reference[2] & 0x0C) &&
+             ((header[3] >> 6) == 3) == ((reference[3] >> 6) == 3));
+        if (!compatible) {
+            logger.Warn(L"[导出] 分段格式与首个分段不同，以静音帧填充：" + source.path.wstring());
+            continue;
+        }
+        if (sources.empty()) {
+            std::memcpy(reference, header, sizeof(reference));
+        }
+        sources.push_back(std::move(source));
+    }
+    if (sources.empty()) {
+        throw std::runtime_error("所选时间段内没有可读取的 MP3 分段");
+    }
+
+    const uint32_t sampleRate = sources.front().map.info.sampleRate;
+    const uint32_t samplesPerFrame = sources.front().map.samplesPerFrame;
+    const int64_t fromMicros = ToUnixMicros(from);
+    const auto totalSamples = static_cast<uint64_t>(MicrosToFrames(ToUnixMicros(to) - fromMicros, sampleRate));
+    const uint64_t totalSlots = (totalSamples + samplesPerFrame - 1) / samplesPerFrame;
+    const std::vector<char> silentFrame = BuildSilentMp3Frame(reference, samplesPerFrame, sampleRate);
+
+    std::ofstream output(outputPath, std::ios::binary | std::ios::trunc);
+    if (!output) {
+        throw std::runtime_error("无法创建导出文件：" + outputPath.string());
+    }
+    ArchiveExtractResult result;
+    std::vector<char> buffer(1 << 20);
+    uint64_t written = 0;   // output frame slots, samplesPerFrame samples each
+    auto writeSilence = [&](uint64_t slots) {
+        for (; slots > 0; --slots) {
+            output.write(silentFrame.data(), static_cast<std::streamsize>(silentFrame.size()));
+            ++written;
+            result.silenceFrames += samplesPerFrame;
+        }
+    };
+
+    for (const auto& source : sources) {
+        // Output slot of this segment's first audio frame; the codec delay shifts the audio
+        // about one frame later than the capture time, so the splice is accurate to half a frame.
+        const int64_t segmentStart = MicrosToFrames(source.record.startUnixMicros - fromMicros, sampleRate);
+        const int64_t base = static_cast<int64_t>(std::llround(static_cast<double>(segmentStart - kMp3CodecDelay) / samplesPerFrame));
+        const auto audioFrames = static_cast<int64_t>(source.map.frames.size() - source.firstAudioFrame);
+        if (base > static_cast<int64_t>(written)) {
+            writeSilence(std::min<uint64_t>(static_cast<uint64_t>(base), totalSlots) - written);
+        }
+        const int64_t firstFrame = static_cast<int64_t>(written) - base;
+        const int64_t lastFrame = std::min<int64_t>(audioFrames, static_cast<int64_t>(totalSlots) - base);
+        if (firstFrame >= lastFrame) {
+            continue;
+        }
+        // Frames in the chain are contiguous, so the whole run is one byte range.
+        const Mp3FrameSpan& first = source.map.frames[source.firstAudioFrame + static_cast<size_t>(firstFrame)];
+        const Mp3FrameSpan& last = source.map.frames[source.firstAudioFrame + static_cast<size_t>(lastFrame) - 1];
+        std::ifstream input(source.path, std::ios::binary);
+        input.seekg(static_cast<std::streamoff>(first.offset));
+        uint64_t remaining = last.offset + last.bytes - first.offset;
+        while (remaining > 0 && input) {
+            input.read(buffer.data(), static_cast<std::streamsize>(std::min<uint64_t>(remaining, buffer.size())));
+            const auto bytesRead = static_cast<uint64_t>(input.gcount());
+            if (bytesRead == 0) {
+                break;
+            }
+            output.write(buffer.data(), static_cast<std::streamsize>(bytesRead));
+            remaining -= bytesRead;
+        }
+        if (remaining > 0) {
+            throw std::runtime_error("读取 MP3 分段失败：" + source.path.string());
+        }
+        const auto copied = static_cast<uint64_t>(lastFrame - firstFrame);
+        written += copied;
+        result.framesWritten += copied * samplesPerFrame;
+        ++result.segmentsUsed;
+    }
+    if (written < totalSlots) {
+        writeSilence(totalSlots - written);
+    }
+    output.close();
+    if (!output) {
+        throw std::runtime_error("写入导出文件失败：" + outputPath.string());
+    }
+    logger.Info(L"[导出] 已写入 " + outputPath.wstring() + L"：" + std::to_wstring(result.segmentsUsed) + L" 个分段，" +
+                std::to_wstring(result.framesWritten) + L" 帧音频，" + std::to_wstring(result.silenceFrames) + L" 帧静音填充。");
+    return result;
+}
+
+}  // namespace
+
+ArchiveExtractResult ExtractArchiveRange(const ArchiveIndex& index,
+                                         std::chrono::system_clock::time_point from,
+                                         std::chrono::system_clock::time_point to,
+                                         const std::filesystem::path& outputPath,
+                                         Logger& logger) {
+    if (to <= from) {
+        throw std::runtime_error("导出结束时间必须晚于开始时间");
+    }
+    const auto records = index.Overlapping(from, to);
+    bool anyWav = false;
+    bool anyMp3 = false;
+    for (const auto& record : records) {
+        const auto extension = LowerExtension(index.FilePath(record.fileId));
+        if (extension == L".wav") {
+            anyWav = true;
+        } else if (extension == L".mp3") {
+            anyMp3 = true;
+        } else {
+            throw std::runtime_error("所选时间段包含无法导出的分段：" + index.FilePath(record.fileId).filename().string());
+        }
+    }
+    if (anyWav && anyMp3) {
+        throw std::runtime_error("所选时间段同时包含 WAV 与 MP3 分段，无法合并为一个文件");
+    }
+    const bool mp3Output = LowerExtension(outputPath) == L".mp3";
+    if (anyMp3 && !mp3Output) {
+        throw std::runtime_error("MP3 分段只能导出为 .mp3 文件");
+    }
+    if (anyWav && mp3Output) {
+        throw std::runtime_error("WAV 分段只能导出为 .wav 文件");
+    }
+    return mp3Output ? ExtractMp3Range(index, records, from, to, outputPath, logger)
+                     : ExtractWavRange(index, records, from, to, outputPath, logger);
+}
+
+std::optional<std::chrono::system_clock::time_point> ParseTimestamp(const std::string& text) {
+    int year = 0, month = 0, day = 0, hour = 0, minute = 0, second = 0;
+    char separator = 0;
+    int consumed = 0;
+    if (std::sscanf(text.c_str(), "%4d-%2d-%2d%c%2d:%2d:%2d%n",
+                    &year, &month, &day, &separator, &hour, &minute, &second, &consumed) != 7 ||
+        (separator != 'T' && separator != ' ')) {
+        return std::nullopt;
+    }
+    std::string rest = text.substr(static_cast<size_t>(consumed));
+    int64_t fractionMicros = 0;
+    if (!rest.empty() && rest.front() == '.') {
+        int64_t scale = 100000;
+        size_t i = 1;
+        for (; i < rest.size() && rest[i] >= '0' && rest[i] <= '9'; ++i) {
+            fractionMicros += (rest[i] - '0') * scale;
+            scale /= 10;
+        }
+        rest = rest.substr(i);
+    }
+    const bool utc = rest == "Z";
+    if (!utc && !rest.empty()) {
+        return std::nullopt;
+    }
+
+    std::tm tm{};
+    tm.tm_year = year - 1900;
+    tm.tm_mon = month - 1;
+    tm.tm_mday = day;
+    tm.tm_hour = hour;
+    tm.tm_min = minute;
+    tm.tm_sec = second;
+    tm.tm_isdst = -1;
+    std::time_t seconds = 0;
+    if (utc) {
+#if defined(_WIN32)
+        seconds = _mkgmtime(&tm);
+#else
+        seconds = timegm(&tm);
+#endif
+    } else {
+        seconds = std::mktime(&tm);
+    }
+    if (seconds == static_cast<std::time_t>(-1)) {
+        return std::nullopt;
+    }
+    return std::chrono::system_clock::from_time_t(seconds) +
+           std::chrono::duration_cast<std::chrono::system_clock::duration>(std::chrono::microseconds(fractionMicros));
+}
+
+std::string FormatTimestampUtc(std::chrono::system_clock::time_point time) {
+    const int64_t micros = ToUnixMicros(time);
+    int64_t wholeSeconds = micros / kMicrosPerSecond;
+    int64_t fraction = micros % kMicrosPerSecond;
+    if (fraction < 0) {
+        fraction += kMicrosPerSecond;
+        --wholeSeconds;
+    }
+    const auto seconds = static_cast<std::time_t>(wholeSeconds);
+    std::tm tm{};
+#if defined(_WIN32)
+    gmtime_s(&tm, &seconds);
+#else
+    gmtime_r(&seconds, &tm);
+#endif
+    char buffer[64];
+    std::snprintf(buffer, sizeof(buffer), "%04d-%02d-%02dT%02d:%02d:%02d.%03dZ",
+                  tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec,
+                  static_cast<int>(fraction / 1000));
+    return buffer;
+}
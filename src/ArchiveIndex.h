@@ -0,0 +1,104 @@
+#pragma once
+
+#include "Logger.h"
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+// One segment in the archive time index. Stored as a fixed 32-byte little-endian record in
+// <name>.index; file names live in the <name>.index.paths sidecar (line N = file id N).
+struct ArchiveIndexRecord {
+    int64_t startUnixMicros = 0;   // wall-clock time the first frame was captured
+    uint64_t frameCount = 0;
+    uint32_t sampleRate = 0;
+    uint32_t fileId = 0;
+    uint32_t gaps = 0;             // discontinuities reported while the segment was open
+    uint32_t droppedFrames = 0;    // saturates at UINT32_MAX
+
+    int64_t EndUnixMicros() const;
+};
+
+std::filesystem::path BuildArchiveIndexPath(const std::filesystem::path& basePath);
+
+// Append-only writer shared by every session that records to the same base path. A file
+// name that is written again (e.g. _001 after a restart) keeps its id; readers then use
+// only the newest record for that id.
+class ArchiveIndexWriter {
+public:
+    explicit ArchiveIndexWriter(const std::filesystem::path& indexPath);
+
+    ArchiveIndexWriter(const ArchiveIndexWriter&) = delete;
+    ArchiveIndexWriter& operator=(const ArchiveIndexWriter&) = delete;
+
+    void Append(const std::filesystem::path& fileName,
+                std::chrono::system_clock::time_point start,
+                uint64_t frameCount,
+                uint32_t sampleRate,
+                uint32_t gaps,
+                uint64_t droppedFrames);
+
+private:
+    std::filesystem::path indexPath_;
+    std::filesystem::path pathsPath_;
+    std::ofstream records_;
+    std::ofstream paths_;
+    std::map<std::string, uint32_t> fileIds_;
+    std::mutex mutex_;
+};
+
+struct ArchiveLocation {
+    std::filesystem::path file;   // absolute, next to the index
+    uint64_t frameOffset = 0;
+    ArchiveIndexRecord record;
+};
+
+// Read-only view sorted by start time; lookups are a binary search over the records.
+class ArchiveIndex {
+public:
+    static ArchiveIndex Load(const std::filesystem::path& indexPath);
+
+    size_t Size() const { return records_.size(); }
+    const std::vector<ArchiveIndexRecord>& Records() const { return records_; }
+    std::filesystem::path FilePath(uint32_t fileId) const;
+
+    // Segment covering `time`, or nullopt if the time falls in a gap between recordings.
+    std::optional<ArchiveLocation> Find(std::chrono::system_clock::time_point time) const;
+    // Records overlapping [from, to), in time order.
+    std::vector<ArchiveIndexRecord> Overlapping(std::chrono::system_clock::time_point from,
+                                                std::chrono::system_clock::time_point to) const;
+
+private:
+    std::filesystem::path directory_;
+    std::vector<ArchiveIndexRecord> records_;
+    std::vector<std::filesystem::path> fileNames_;
+};
+
+struct ArchiveExtractResult {
+    uint64_t framesWritten = 0;
+    uint64_t silenceFrames = 0;   // time not covered by any readable segment
+    size_t segmentsUsed = 0;
+};
+
+// Copies [from, to) into one file, reading across segment boundaries. Uncovered time (between
+// sessions, deleted or compressed-only segments) is filled with silence so the output stays
+// aligned with the wall clock. WAV segments are cut to the frame into a .wav; MP3 segments are
+// cut at whole MPEG frames into a .mp3, with silent frames for gaps, so the ends round out to
+// the nearest frame and the first frame after a splice may decode as silence (its bit
+// reservoir lived in the frame before). Frame counts in the result are PCM frames. Throws if
+// the range mixes WAV and MP3 or the output extension does not match.
+ArchiveExtractResult ExtractArchiveRange(const ArchiveIndex& index,
+                                         std::chrono::system_clock::time_point from,
+                                         std::chrono::system_clock::time_point to,
+                                         const std::filesystem::path& outputPath,
+                                         Logger& logger);
+
+// Accepts "YYYY-MM-DDTHH:MM:SS[.fff][Z]" (a space may replace the T). Without Z the time is local.
+std::optional<std::chrono::system_clock::time_point> ParseTimestamp(const std::string& text);
+std::string FormatTimestampUtc(std::chrono::system_clock::time_point time);
@@ -0,0 +1,84 @@
+#include "AudioFormat.h"
+
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace {
+
+constexpr uint16_t kFormatPcm = 0x0001;
+constexpr uint16_t kFormatIeeeFloat = 0x0003;
+constexpr uint16_t kFormatExtensible = 0xFFFE;
+constexpr size_t kWaveFormatBytes = 18;
+constexpr size_t kExtensibleBytes = 40;
+// KSDATAFORMAT_SUBTYPE_PCM / _IEEE_FLOAT are this GUID with the format tag in its first two bytes.
+constexpr unsigned char kSubFormatTail[14] = {0x00, 0x00, 0x00, 0x00, 0x10, 0x00, 0x80,
+                                              0x00, 0x00, 0xAA, 0x00, 0x38, 0x9B, 0x71};
+
+void Put(std::vector<std::byte>& out, uint32_t value, size_t bytes) {
+    for (size_t i = 0; i < bytes; ++i) {
+        out.push_back(static_cast<std::byte>((value >> (8 * i)) & 0xFF));
+    }
+}
+
+uint32_t Get(const std::byte* data, size_t offset, size_t bytes) {
+    uint32_t value = 0;
+    for (size_t i = 0; i < bytes; ++i) {
+        value |= static_cast<uint32_t>(data[offset + i]) << (8 * i);
+    }
+    return value;
+}
+
+} // namespace
+
+std::vector<std::byte> EncodeWaveFormatChunk(const AudioFormat& format) {
+    const bool extensible = format.channelMask != 0;
+    const uint16_t tag = format.floatSamples ? kFormatIeeeFloat : kFormatPcm;
+    std::vector<std::byte> chunk;
+    chunk.reserve(extensible ? kExtensibleBytes : kWaveFormatBytes);
+    Put(chunk, extensible ? kFormatExtensible : tag, 2);
+    Put(chunk, format.channels, 2);
+    Put(chunk, format.sampleRate, 4);
+    Put(chunk, format.BytesPerSecond(), 4);
+    Put(chunk, format.BytesPerFrame(), 2);
+    Put(chunk, format.bitsPerSample, 2);
+    Put(chunk, extensible ? kExtensibleBytes - kWaveFormatBytes : 0, 2);
+    if (extensible) {
+        Put(chunk, format.bitsPerSample, 2);   // valid bits
+        Put(chunk, format.channelMask, 4);
+        Put(chunk, tag, 2);
+        for (const unsigned char value : kSubFormatTail) {
+            chunk.push_back(static_cast<std::byte>(value));
+        }
+    }
+    return chunk;
+}
+
+AudioFormat DecodeWaveFormatChunk(const std::byte* data, size_t size) {
+    // A plain PCM chunk may stop before cbSize.
+    if (size < 16) {
+        throw std::runtime_error("fmt 块过小");
+    }
+    AudioFormat format;
+    uint32_t tag = Get(data, 0, 2);
+    format.channels = static_cast<uint16_t>(Get(data, 2, 2));
+    format.sampleRate = Get(data, 4, 4);
+    const uint32_t blockAlign = Get(data, 12, 2);
+    format.bitsPerSample = static_cast<uint16_t>(Get(data, 14, 2));
+    if (tag == kFormatExtensible) {
+        if (size < kExtensibleBytes || std::memcmp(data + 26, kSubFormatTail, sizeof(kSubFormatTail)) != 0) {
+            throw std::runtime_error("不支持的 WAVE_FORMAT_EXTENSIBLE 子格式");
+        }
+        format.channelMask = Get(data, 20, 4);
+        tag = Get(data, 24, 2);
+    }
+    if (tag != kFormatPcm && tag != kFormatIeeeFloat) {
+        throw std::runtime_error("不支持的 WAV 编码（格式标记 " + std::to_string(tag) + "）");
+    }
+    format.floatSamples = tag == kFormatIeeeFloat;
+    if (format.channels == 0 || format.sampleRate == 0 || format.bitsPerSample == 0 || format.bitsPerSample % 8 != 0 ||
+        blockAlign != format.BytesPerFrame()) {
+        throw std::runtime_error("不支持的 WAV 格式");
+    }
+    return format;
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Interleaved PCM as the recorder core captures, converts and writes it. Platform descriptors
+// (the WAVEFORMATEX of a WASAPI mix format) are translated at the edge; files carry the
+// standard RIFF "fmt " chunk, which EncodeWaveFormatChunk/DecodeWaveFormatChunk produce and
+// parse without relying on the host's structure layout.
+struct AudioFormat {
+    uint32_t sampleRate = 0;
+    uint16_t channels = 0;
+    uint16_t bitsPerSample = 0;
+    bool floatSamples = false;
+    // Speaker positions of an extensible source format; nonzero keeps WAVE_FORMAT_EXTENSIBLE
+    // in the fmt chunk so segments are tagged the way the device reported them.
+    uint32_t channelMask = 0;
+
+    uint32_t BytesPerFrame() const { return static_cast<uint32_t>(channels) * bitsPerSample / 8; }
+    uint32_t BytesPerSecond() const { return sampleRate * BytesPerFrame(); }
+
+    bool operator==(const AudioFormat&) const = default;
+};
+
+// Interleaved 16-bit PCM or 32-bit float, as produced by the synthetic and pipe sources.
+inline AudioFormat MakeAudioFormat(uint32_t sampleRate, uint16_t channels, bool floatSamples) {
+    AudioFormat format;
+    format.sampleRate = sampleRate;
+    format.channels = channels;
+    format.bitsPerSample = floatSamples ? 32 : 16;
+    format.floatSamples = floatSamples;
+    return format;
+}
+
+// The "fmt " chunk payload: an 18-byte WAVEFORMATEX, or a 40-byte WAVEFORMATEXTENSIBLE when
+// the format has a channel mask. Little-endian.
+std::vector<std::byte> EncodeWaveFormatChunk(const AudioFormat& format);
+
+// Parses a "fmt " chunk payload (or an in-memory WAVEFORMATEX with its extension): integer
+// PCM, IEEE float, or extensible with either subtype. Throws std::runtime_error otherwise.
+AudioFormat DecodeWaveFormatChunk(const std::byte* data, size_t size);
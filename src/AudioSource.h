@@ -0,0 +1,53 @@
+#pragma once
+
+#include "AudioFormat.h"
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+enum class SourceWaitResult {
+    PacketsReady,
+    Timeout,
+    Interrupted,
+    Failed,
+};
+
+enum class SourceReadResult {
+    Packet,
+    Empty,        // nothing more until the next Wait()
+    EndOfStream,  // a finite source (pipe, file) has been consumed
+    DeviceLost,
+    Failed,
+};
+
+// One block of interleaved frames in the source format; `data` stays valid until Release().
+struct SourcePacket {
+    const uint8_t* data = nullptr;
+    uint32_t frames = 0;
+    bool silent = false;          // contents are zeros regardless of `data`
+    bool discontinuity = false;   // frames were lost upstream before this packet
+};
+
+// Where CapturePipeline gets its audio. The WASAPI loopback client is the production
+// source; the synthetic and PCM-pipe sources drive the same pipeline without a sound card.
+// Start/Wait/Read/Release/Stop are called from the capture thread only; Interrupt() may be
+// called from any thread and stays in effect until the next Start().
+class IAudioSource {
+public:
+    virtual ~IAudioSource() = default;
+
+    // Valid from construction on. The pipeline accepts 16-bit PCM and 32-bit float.
+    virtual const AudioFormat& Format() const = 0;
+    virtual std::wstring Describe() const = 0;
+
+    virtual void Start() = 0;
+    virtual void Stop() = 0;
+    virtual SourceWaitResult Wait(std::chrono::milliseconds timeout) = 0;
+    virtual void Interrupt() = 0;
+    virtual SourceReadResult Read(SourcePacket& packet) = 0;
+    virtual void Release(const SourcePacket& packet) = 0;
+
+    // Description of the last DeviceLost/Failed result, for the log.
+    virtual std::wstring LastError() const { return {}; }
+};
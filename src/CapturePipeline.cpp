@@ -0,0 +1,1136 @@
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include "CapturePipeline.h"
+#include "AllocationCounter.h"
+#include "CaptureTrace.h"
+#include "HdrHistogram.h"
+#include "PipelineScheduler.h"
+#include "RecorderMetrics.h"
+#include "RecordingUtils.h"
+#include "SharedStats.h"
+#include "SegmentedOutput.h"
+#include "SignalEvent.h"
+#include "Tracer.h"
+#include "ThreadUsage.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+#include <limits>
+#include <memory>
+#include <functional>
+#include <thread>
+#include <cstdio>
+#include <cmath>
+#include <cstring>
+#include <string>
+#include <filesystem>
+#include <cwctype>
+#include <cwchar>
+#include <string_view>
+
+namespace {
+// Level summaries in the event log; finer detail is available from --stats-shm.
+constexpr auto kEventLevelPeriod = std::chrono::seconds(10);
+// Audio after which the pipeline must stop allocating (device start-up, first segment, first
+// status line and lazily sized encoder buffers all happen before it).
+constexpr auto kSteadyStateWarmup = std::chrono::seconds(1);
+
+// Builds one log line in place; the status line is written every second from the capture
+// thread and must not allocate. Text past Logger::kMaxMessageChars is cut off.
+class StatusLine {
+public:
+    StatusLine& operator<<(std::wstring_view text) {
+        const size_t count = std::min(text.size(), kCapacity - length_);
+        std::wmemcpy(text_ + length_, text.data(), count);
+        length_ += count;
+        return *this;
+    }
+    StatusLine& operator<<(const char* ascii) {
+        while (*ascii && length_ < kCapacity) {
+            text_[length_++] = static_cast<wchar_t>(static_cast<unsigned char>(*ascii++));
+        }
+        return *this;
+    }
+    StatusLine& operator<<(uint64_t value) {
+        char digits[24];
+        std::snprintf(digits, sizeof(digits), "%llu", static_cast<unsigned long long>(value));
+        return *this << digits;
+    }
+    std::wstring_view View() const { return std::wstring_view(text_, length_); }
+
+private:
+    static constexpr size_t kCapacity = Logger::kMaxMessageChars;
+    wchar_t text_[kCapacity];
+    size_t length_ = 0;
+};
+
+// Ring byte offsets at which "segment" commands roll the output, oldest first; pushed by the
+// capture thread, popped by the writer. Every command queued before the writer reaches the
+// first offset keeps its own boundary. Commands at the same offset share one roll.
+class PendingRolls {
+public:
+    static constexpr uint64_t kCapacity = 16;   // power of two
+
+    bool Push(uint64_t offset) {
+        const uint64_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail != head_.load(std::memory_order_acquire) && offsets_[(tail - 1) & (kCapacity - 1)] == offset) {
+            return true;
+        }
+        if (tail - head_.load(std::memory_order_acquire) == kCapacity) {
+            return false;
+        }
+        offsets_[tail & (kCapacity - 1)] = offset;
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+    bool Full() const {
+        return tail_.load(std::memory_order_relaxed) - head_.load(std::memory_order_acquire) == kCapacity;
+    }
+    uint64_t Size() const {
+        return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire);
+    }
+
+    // Consumer side.
+    bool Front(uint64_t& offset) const {
+        const uint64_t head = head_.load(std::memory_order_relaxed);
+        if (head == tail_.load(std::memory_order_acquire)) {
+            return false;
+        }
+        offset = offsets_[head & (kCapacity - 1)];
+        return true;
+    }
+    void Pop() { head_.store(head_.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+
+private:
+    uint64_t offsets_[kCapacity]{};
+    std::atomic<uint64_t> head_{0};
+    std::atomic<uint64_t> tail_{0};
+};
+
+class ThreadGuard {
+public:
+    ThreadGuard(std::thread& thread, std::atomic<bool>& runningFlag, SignalEvent& wakeEvent, PipelineScheduler& scheduler)
+        : thread_(thread), runningFlag_(runningFlag), wakeEvent_(wakeEvent), scheduler_(scheduler) {}
+    ~ThreadGuard() {
+        runningFlag_.store(false, std::memory_order_release);
+        wakeEvent_.Set();
+        scheduler_.Join(thread_);
+    }
+private:
+    std::thread& thread_;
+    std::atomic<bool>& runningFlag_;
+    SignalEvent& wakeEvent_;
+    PipelineScheduler& scheduler_;
+};
+
+// Enables the tracer for one Record() call and writes the trace once it goes out of scope.
+// Declared before the recorder threads so it is destroyed after they have been joined.
+class TraceSession {
+public:
+    TraceSession(std::optional<std::filesystem::path> path, Logger& logger)
+        : path_(std::move(path)), logger_(logger) {
+        if (path_) {
+            Tracer::Start();
+            Tracer::SetThreadName("capture");
+        }
+    }
+    ~TraceSession() {
+        if (!path_) {
+            return;
+        }
+        Tracer::Stop();
+        try {
+            Tracer::WriteChromeTrace(*path_);
+            std::wstring message = L"[跟踪] 已写入 " + path_->wstring();
+            if (const uint64_t overwritten = Tracer::OverwrittenEvents()) {
+                message += L"（缓冲区回绕，最早的 " + std::to_wstring(overwritten) + L" 个事件被覆盖）";
+            }
+            logger_.Info(message);
+        } catch (const std::exception&) {
+            logger_.Error(L"[跟踪] 写入跟踪文件失败：" + path_->wstring());
+        }
+    }
+    TraceSession(const TraceSession&) = delete;
+    TraceSession& operator=(const TraceSession&) = delete;
+private:
+    std::optional<std::filesystem::path> path_;
+    Logger& logger_;
+};
+
+// Marks a Record() call in the process-wide metrics for as long as it runs.
+class MetricsSessionGuard {
+public:
+    MetricsSessionGuard(RecorderMetrics* metrics, uint32_t sampleRate, size_t ringCapacityBytes)
+        : metrics_(metrics) {
+        if (metrics_) {
+            metrics_->sessions.fetch_add(1, std::memory_order_relaxed);
+            metrics_->sampleRate.store(sampleRate, std::memory_order_relaxed);
+            metrics_->ringCapacityBytes.store(ringCapacityBytes, std::memory_order_relaxed);
+            metrics_->recording.store(1, std::memory_order_relaxed);
+        }
+    }
+    ~MetricsSessionGuard() {
+        if (metrics_) {
+            metrics_->ringBytes.store(0, std::memory_order_relaxed);
+            metrics_->recording.store(0, std::memory_order_relaxed);
+        }
+    }
+    MetricsSessionGuard(const MetricsSessionGuard&) = delete;
+    MetricsSessionGuard& operator=(const MetricsSessionGuard&) = delete;
+private:
+    RecorderMetrics* metrics_;
+};
+
+// Leaves a terminal state in the shared stats block and the status board however Record() exits.
+class StatusSessionGuard {
+public:
+    StatusSessionGuard(SharedStatsPublisher* publisher, SharedStatsPayload& payload,
+                       RecorderStatusBoard* board, RecorderCaptureStatus& captureStatus)
+        : publisher_(publisher), payload_(payload), board_(board), captureStatus_(captureStatus) {}
+    ~StatusSessionGuard() {
+        if (publisher_) {
+            payload_.state = static_cast<uint32_t>(finalState_);
+            payload_.ringBytes = 0;
+            publisher_->Publish(payload_);
+        }
+        if (board_) {
+            captureStatus_.state = static_cast<uint32_t>(finalState_);
+            board_->PublishCapture(captureStatus_);
+        }
+    }
+    void SetFinalState(SharedRecorderState state) { finalState_ = state; }
+    StatusSessionGuard(const StatusSessionGuard&) = delete;
+    StatusSessionGuard& operator=(const StatusSessionGuard&) = delete;
+private:
+    SharedStatsPublisher* publisher_;
+    SharedStatsPayload& payload_;
+    RecorderStatusBoard* board_;
+    RecorderCaptureStatus& captureStatus_;
+    SharedRecorderState finalState_ = SharedRecorderState::Failed;
+};
+
+bool IsSupportedFormat(const AudioFormat& format) {
+    if (format.channels == 0 || format.sampleRate == 0) {
+        return false;
+    }
+    return (format.floatSamples && format.bitsPerSample == 32) || (!format.floatSamples && format.bitsPerSample == 16);
+}
+
+std::wstring ToLower(std::wstring value) {
+    for (auto& ch : value) {
+        ch = static_cast<wchar_t>(towlower(ch));
+    }
+    return value;
+}
+
+bool IsMp3Path(const std::filesystem::path& path) {
+    auto ext = ToLower(path.extension().wstring());
+    return ext == L".mp3";
+}
+
+// Ring capacity for a session; Prepare() and Run() must agree so a prepared ring is reused.
+size_t RingCapacityBytes(const AudioFormat& format, const RecorderConfig& config) {
+    const auto ringMs = std::clamp(config.ringBufferSize, std::chrono::milliseconds(200), std::chrono::milliseconds(10000));
+    const uint64_t ringFrames = std::max<uint64_t>(static_cast<uint64_t>(format.sampleRate) * ringMs.count() / 1000, 1);
+    const uint64_t desiredCapacity = std::max<uint64_t>(ringFrames * format.BytesPerFrame(), static_cast<uint64_t>(format.BytesPerFrame()) * 2);
+    return static_cast<size_t>(std::min<uint64_t>(desiredCapacity, static_cast<uint64_t>(std::numeric_limits<size_t>::max())));
+}
+
+size_t WriterChunkBytes(size_t ringCapacity, uint32_t bytesPerFrame) {
+    return std::min<size_t>(ringCapacity, std::max<size_t>(static_cast<size_t>(bytesPerFrame) * 512, 16384));
+}
+
+size_t StagingBytes(size_t ringCapacity, uint32_t bytesPerFrame) {
+    return std::min<size_t>(ringCapacity, static_cast<size_t>(bytesPerFrame) * 4096);
+}
+
+void MixMicrophone(uint8_t* buffer, uint32_t frames, const AudioFormat& format) {
+    (void)buffer;
+    (void)frames;
+    (void)format;
+    // Placeholder: future work will route microphone input and mix at a matching format.
+}
+
+float DbToLinearGain(double gainDb) {
+    return static_cast<float>(std::pow(10.0, gainDb / 20.0));
+}
+
+// In place; 16-bit samples saturate, float samples are left unclipped for the encoder.
+void ApplyGain(uint8_t* buffer, uint32_t frames, const AudioFormat& format, float gain) {
+    const size_t samples = static_cast<size_t>(frames) * format.channels;
+    if (format.bitsPerSample == 32) {
+        auto* values = reinterpret_cast<float*>(buffer);
+        for (size_t i = 0; i < samples; ++i) {
+            values[i] *= gain;
+        }
+        return;
+    }
+    auto* values = reinterpret_cast<int16_t*>(buffer);
+    for (size_t i = 0; i < samples; ++i) {
+        const float scaled = static_cast<float>(values[i]) * gain;
+        values[i] = static_cast<int16_t>(std::clamp(scaled, -32768.0f, 32767.0f));
+    }
+}
+
+} // namespace
+
+CapturePipeline::CapturePipeline(Logger& logger) : logger_(logger) {}
+
+SpscByteRingBuffer& CapturePipeline::AcquireRing(size_t capacityBytes) {
+    // A session that ended on a writer failure can leave bytes behind; never replay them.
+    if (!ring_ || ring_->Capacity() != capacityBytes || ring_->AvailableToRead() != 0) {
+        ring_ = std::make_unique<SpscByteRingBuffer>(capacityBytes);
+    }
+    return *ring_;
+}
+
+void CapturePipeline::Prepare(const AudioFormat& format, const RecorderConfig& config) {
+    if (!IsSupportedFormat(format)) {
+        throw std::runtime_error("仅支持 16-bit PCM 或 32-bit float 格式");
+    }
+    SpscByteRingBuffer& ring = AcquireRing(RingCapacityBytes(format, config));
+    chunk_.resize(WriterChunkBytes(ring.Capacity(), format.BytesPerFrame()));
+    staging_.resize(std::max(staging_.size(), StagingBytes(ring.Capacity(), format.BytesPerFrame())));
+}
+
+RecorderStats CapturePipeline::Run(IAudioSource& input, const RecorderConfig& config, const RecorderControls& controls) {
+    RecorderStats stats;
+    std::optional<TracingAudioSource> tracingSource;
+    if (config.captureTracePath) {
+        tracingSource.emplace(input, *config.captureTracePath);
+    }
+    IAudioSource& source = tracingSource ? static_cast<IAudioSource&>(*tracingSource) : input;
+    const AudioFormat& format = source.Format();
+    if (!IsSupportedFormat(format)) {
+        throw std::runtime_error("仅支持 16-bit PCM 或 32-bit float 格式");
+    }
+
+    RecorderConfig localConfig = config;
+    TraceSession traceSession(localConfig.tracePath, logger_);
+    const std::wstring outputPathText = localConfig.outputPath.wstring();
+    const std::wstring outputExt = localConfig.outputPath.extension().wstring();
+    const std::wstring segmentSuffix = outputExt.empty() ? L"" : outputExt;
+    logger_.Info(L"录音基路径：" + outputPathText + L"（分段文件使用 _001" + segmentSuffix + L" 编号）。");
+
+    // Every wait, sleep and thread of the session goes through the scheduler, so a simulation
+    // can run the whole pipeline on a virtual clock.
+    PipelineScheduler& scheduler = controls.scheduler ? *controls.scheduler : SystemScheduler();
+    SignalEvent dataReady(false, controls.scheduler);
+    SignalEvent spaceAvailable(true, controls.scheduler);
+    const bool hasStopCallback = static_cast<bool>(controls.shouldStop);
+
+    const uint32_t bytesPerFrame = format.BytesPerFrame();
+    const uint32_t sampleRate = format.sampleRate;
+    const uint64_t frameLimit = localConfig.maxDuration
+        ? static_cast<uint64_t>(sampleRate) * localConfig.maxDuration->count()
+        : std::numeric_limits<uint64_t>::max();   // until stopped
+    const std::optional<uint64_t> segmentFrameTarget = localConfig.segmentDuration
+        ? std::optional<uint64_t>(static_cast<uint64_t>(sampleRate) * localConfig.segmentDuration->count())
+        : std::nullopt;
+    const std::optional<uint64_t> segmentByteTarget = localConfig.segmentBytes;
+    const bool manualSegmentsEnabled = static_cast<bool>(controls.requestNewSegment) || controls.commands != nullptr;
+    const bool segmentationEnabled = segmentFrameTarget.has_value() || segmentByteTarget.has_value() || manualSegmentsEnabled;
+
+    const size_t ringCapacityBytes = RingCapacityBytes(format, localConfig);
+    logger_.Info(L"音频源：" + source.Describe() + L"，环形缓冲 " +
+                 std::to_wstring(ringCapacityBytes / bytesPerFrame * 1000 / sampleRate) + L" ms（" +
+                 std::to_wstring(ringCapacityBytes / 1024) + L" KiB）。");
+    SpscByteRingBuffer& ring = AcquireRing(ringCapacityBytes);
+    RecorderMetrics* const metrics = controls.metrics;
+    MetricsSessionGuard metricsSession(metrics, sampleRate, ringCapacityBytes);
+
+    SharedStatsPublisher* const sharedStats = controls.sharedStats;
+    SharedStatsPayload sharedPayload;
+    std::optional<LevelMeter> levelMeter;
+    if (sharedStats) {
+        sharedPayload.sampleRate = sampleRate;
+        sharedPayload.channels = format.channels;
+        sharedPayload.ringCapacityBytes = ringCapacityBytes;
+        const auto pathText = localConfig.outputPath.u8string();
+        const size_t pathLength = std::min(pathText.size(), sizeof(sharedPayload.outputPath) - 1);
+        std::memcpy(sharedPayload.outputPath, pathText.data(), pathLength);
+        sharedStats->Publish(sharedPayload);
+    }
+    RecorderStatusBoard* const statusBoard = controls.status;
+    RecorderCaptureStatus captureStatus;
+    if (statusBoard) {
+        captureStatus.state = static_cast<uint32_t>(SharedRecorderState::Starting);
+        captureStatus.sampleRate = sampleRate;
+        captureStatus.channels = format.channels;
+        statusBoard->PublishCapture(captureStatus);
+    }
+    if (sharedStats || statusBoard) {
+        levelMeter.emplace(format.channels, format.bitsPerSample == 32);
+    }
+    StatusSessionGuard statusSession(sharedStats, sharedPayload, statusBoard, captureStatus);
+
+    EventLogWriter* const events = controls.events;
+    std::optional<LevelMeter> eventLevelMeter;
+    if (events) {
+        const auto pathText = localConfig.outputPath.u8string();
+        events->SessionStart(sampleRate, format.channels, format.bitsPerSample, format.bitsPerSample == 32,
+                             std::string_view(reinterpret_cast<const char*>(pathText.data()), pathText.size()));
+        eventLevelMeter.emplace(format.channels, format.bitsPerSample == 32);
+    }
+
+    // Always recorded: a few relaxed atomic adds per packet and per write.
+    auto latencies = std::make_unique<PipelineLatencies>();
+    if (metrics) {
+        latencies->AccumulateInto(metrics->latencies);
+    }
+    auto captureTimes = std::make_unique<CaptureTimestampQueue>();
+
+    // CPU time, context switches and page faults per pipeline thread. The capture thread is
+    // the caller, so it is measured against a baseline; the others get fresh probes.
+    const ThreadCpuUsage captureUsageStart = SampleCurrentThreadUsage();
+    const ThreadCpuUsage uiUsageStart = controls.uiThread ? controls.uiThread->Sample() : ThreadCpuUsage{};
+    ThreadUsageProbe writerUsage;
+    ThreadUsageProbe stopWatcherUsage;
+
+    std::atomic<bool> writerActive{true};
+    std::atomic<uint32_t> writerWaitTimeouts{0};
+    const uint64_t warmupFrames = static_cast<uint64_t>(sampleRate) * kSteadyStateWarmup.count();
+    uint64_t writerSteadyAllocations = 0;   // written by the writer thread, read after it is joined
+    std::atomic<bool> writerFailed{false};
+    std::string writerErrorMessage;
+    std::atomic<bool> fatalError{false};
+    std::atomic<bool> stopWatcherTerminate{false};
+    std::thread stopWatcher;
+    if (hasStopCallback) {
+        stopWatcher = scheduler.StartThread([&]() {
+            Tracer::SetThreadName("stop watcher");
+            ThreadUsageScope usageScope(stopWatcherUsage);
+            while (!stopWatcherTerminate.load(std::memory_order_acquire)) {
+                if (fatalError.load(std::memory_order_acquire)) {
+                    source.Interrupt();
+                    break;
+                }
+                if ((controls.shouldStop && controls.shouldStop()) || stopWatcherTerminate.load(std::memory_order_relaxed)) {
+                    source.Interrupt();
+                    break;
+                }
+                scheduler.SleepFor(std::chrono::milliseconds(5));
+            }
+        });
+    }
+
+    // "segment" commands roll the output at exactly these ring byte offsets.
+    PendingRolls controlRolls;
+
+    std::atomic<uint64_t> droppedFramesLive{0};
+    std::atomic<uint32_t> gapsLive{0};
+    SegmentedOutputOptions outputOptions;
+    outputOptions.basePath = localConfig.outputPath;
+    outputOptions.mp3Output = IsMp3Path(localConfig.outputPath);
+    if (localConfig.mp3BitrateKbps) {
+        outputOptions.mp3Options.bitrateKbps = *localConfig.mp3BitrateKbps;
+    }
+    outputOptions.mp3LadderKbps = localConfig.mp3LadderKbps;
+    outputOptions.segmentationEnabled = segmentationEnabled;
+    outputOptions.segmentFrameTarget = segmentFrameTarget;
+    outputOptions.segmentByteTarget = segmentByteTarget;
+    if (localConfig.alignSegments && localConfig.segmentDuration) {
+        outputOptions.alignPeriod = localConfig.segmentDuration;
+    }
+    outputOptions.writeManifest = localConfig.writeManifest;
+    outputOptions.writeIndex = localConfig.writeIndex;
+    outputOptions.retention = localConfig.retention;
+    outputOptions.diskGuard = localConfig.diskGuard;
+    if (localConfig.compression && !outputOptions.mp3Output) {
+        outputOptions.compression = localConfig.compression;
+        if (localConfig.mp3BitrateKbps) {
+            outputOptions.compression->mp3Options.bitrateKbps = *localConfig.mp3BitrateKbps;
+        }
+        outputOptions.compression->ladderKbps = localConfig.mp3LadderKbps;
+    }
+    outputOptions.droppedFrames = &droppedFramesLive;
+    outputOptions.gaps = &gapsLive;
+    outputOptions.latencies = latencies.get();
+    outputOptions.captureTimes = captureTimes.get();
+    outputOptions.events = events;
+    outputOptions.status = statusBoard;
+    outputOptions.wrapWriter = controls.wrapWriter;
+    SegmentedOutput output(std::move(outputOptions), format, logger_);
+
+    // "configure" commands: the capture thread keeps the desired output settings and
+    // publishes them whole; the writer picks them up between writes.
+    LiveOutputSettings liveSettings;
+    liveSettings.mp3BitrateKbps = localConfig.mp3BitrateKbps.value_or(0);
+    liveSettings.segmentFrameTarget = segmentFrameTarget.value_or(0);
+    liveSettings.segmentByteTarget = segmentByteTarget.value_or(0);
+    LiveOutputSettingsSlot liveSettingsSlot;
+
+    std::thread writerThread = scheduler.StartThread([&, manualSegmentCallback = controls.requestNewSegment]() mutable {
+        std::vector<uint8_t>& chunk = chunk_;
+        chunk.resize(WriterChunkBytes(ring.Capacity(), bytesPerFrame));
+        const auto writerWaitMs = std::chrono::milliseconds(std::clamp<int>(static_cast<int>(localConfig.watchdogTimeout.count() / 2), 5, 500));
+
+        auto consumeManualSegment = [&]() -> bool {
+            if (!manualSegmentCallback) {
+                return false;
+            }
+            return manualSegmentCallback();
+        };
+
+        LiveOutputSettings writerSettings;
+        auto applyLiveSettings = [&]() {
+            if (liveSettingsSlot.TakeNew(writerSettings)) {
+                output.ApplyLiveSettings(writerSettings);
+            }
+        };
+
+        Tracer::SetThreadName("writer");
+        ThreadUsageScope usageScope(writerUsage);
+        uint64_t bytesPopped = 0;
+        std::optional<uint64_t> steadyAllocationBase;
+        uint64_t publishedBytes = 0;
+        uint64_t publishedSegments = 0;
+        auto publishWriterMetrics = [&]() {
+            const uint64_t bytesNow = output.BytesWritten();
+            const uint64_t segmentsNow = output.SegmentsOpened();
+            metrics->bytesWritten.fetch_add(bytesNow - publishedBytes, std::memory_order_relaxed);
+            metrics->segmentsOpened.fetch_add(segmentsNow - publishedSegments, std::memory_order_relaxed);
+            publishedBytes = bytesNow;
+            publishedSegments = segmentsNow;
+        };
+
+        try {
+            output.Start();
+            while (writerActive.load(std::memory_order_acquire) || ring.AvailableToRead() > 0) {
+                applyLiveSettings();
+                if (consumeManualSegment()) {
+                    output.Roll(L"手动切段");
+                }
+                size_t bytes = 0;
+                {
+                    TraceScope scope("ring.pop");
+                    bytes = ring.Read(chunk.data(), chunk.size());
+                }
+                if (bytes == 0) {
+                    TraceScope scope("writer.wait");
+                    if (!dataReady.Wait(writerWaitMs)) {
+                        ++writerWaitTimeouts;
+                        if (metrics) {
+                            metrics->writerWaitTimeouts.fetch_add(1, std::memory_order_relaxed);
+                        }
+                    }
+                    continue;
+                }
+                const uint64_t chunkStart = bytesPopped;
+                bytesPopped += bytes;
+                if (!steadyAllocationBase && bytesPopped >= warmupFrames * bytesPerFrame) {
+                    steadyAllocationBase = AllocationCounter::ThreadAllocations();
+                }
+                captureTimes->ConsumeUpTo(bytesPopped, MonotonicNanos(), latencies->captureToPop);
+                spaceAvailable.Set();
+                const auto writeStart = metrics ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point{};
+                size_t written = 0;
+                uint64_t rollAt = 0;
+                while (controlRolls.Front(rollAt) && rollAt < bytesPopped) {
+                    const size_t rollOffset = static_cast<size_t>(rollAt > chunkStart ? rollAt - chunkStart : 0);
+                    if (rollOffset > written) {
+                        output.Write(chunk.data() + written, rollOffset - written);
+                        written = rollOffset;
+                    }
+                    // Settings sent with "apply":"now" were published before the roll offset.
+                    applyLiveSettings();
+                    output.Roll(L"控制命令切段");
+                    controlRolls.Pop();
+                }
+                output.Write(chunk.data() + written, bytes - written);
+                if (metrics) {
+                    const auto nanos = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        std::chrono::steady_clock::now() - writeStart).count());
+                    metrics->writerBusyNanos.fetch_add(nanos, std::memory_order_relaxed);
+                    metrics->framesWritten.fetch_add(bytes / bytesPerFrame, std::memory_order_relaxed);
+                    publishWriterMetrics();
+                }
+            }
+            if (steadyAllocationBase) {
+                writerSteadyAllocations = AllocationCounter::ThreadAllocations() - *steadyAllocationBase;
+            }
+            output.Finish();
+            if (metrics) {
+                publishWriterMetrics();
+            }
+        } catch (const std::exception& ex) {
+            writerFailed.store(true, std::memory_order_release);
+            writerErrorMessage = ex.what();
+            fatalError.store(true, std::memory_order_release);
+            spaceAvailable.Set();
+            dataReady.Set();
+            source.Interrupt();
+        }
+    });
+
+    ThreadGuard writerGuard(writerThread, writerActive, dataReady, scheduler);
+
+    const auto pauseCallback = controls.isPaused;
+    bool lastPauseState = false;
+    bool controlPaused = false;   // set by "pause"/"resume" commands, on top of the callback
+    if (pauseCallback) {
+        lastPauseState = pauseCallback();
+        if (lastPauseState) {
+            logger_.Info(L"录音开始时为暂停状态；将跳过音频数据直到恢复。");
+        }
+    }
+    auto queryPauseState = [&]() -> bool {
+        bool paused = controlPaused || (pauseCallback && pauseCallback());
+        if (paused != lastPauseState) {
+            lastPauseState = paused;
+            logger_.Info(paused ? L"录音已暂停。" : L"录音已继续。");
+        }
+        return paused;
+    };
+
+    uint64_t framesRecorded = 0;
+    uint64_t framesPerSecond = 0;
+    uint64_t lastReportedDropped = 0;
+    uint64_t bytesPushed = 0;
+    uint64_t lastPacketWakeupNanos = 0;
+    std::optional<uint64_t> steadyAllocationBase;
+    bool done = false;
+    std::vector<uint8_t>& staging = staging_;
+    // Sized once; a packet only grows it if it is larger than any seen before.
+    staging.resize(std::max(staging.size(), StagingBytes(ring.Capacity(), bytesPerFrame)));
+    const auto waitMs = std::chrono::milliseconds(std::clamp<int>(static_cast<int>(localConfig.watchdogTimeout.count()), 50, 60000));
+    bool dropWarningIssued = false;
+    auto lastStatusReport = scheduler.Now();
+    uint64_t lastCaptureCpuNanos = captureUsageStart.CpuNanos();
+    uint64_t lastWriterCpuNanos = 0;
+
+    auto maybeReportStatus = [&](bool force) {
+        if (localConfig.quietStatusUpdates) {
+            return;
+        }
+        auto now = scheduler.Now();
+        if (!force && now - lastStatusReport < std::chrono::seconds(1)) {
+            return;
+        }
+        size_t bytesInRing = ring.AvailableToRead();
+        size_t framesInRing = bytesInRing / bytesPerFrame;
+        uint64_t queueMs = framesInRing > 0 ? (framesInRing * 1000ull) / sampleRate : 0;
+        uint64_t droppedSince = stats.framesDropped - lastReportedDropped;
+        const uint64_t captureCpuNanos = SampleCurrentThreadUsage().CpuNanos();
+        const uint64_t writerCpuNanos = writerUsage.Sample().CpuNanos();
+        const auto elapsedNanos = static_cast<double>(std::max<int64_t>(1,
+            std::chrono::duration_cast<std::chrono::nanoseconds>(now - lastStatusReport).count()));
+        auto cpuPercent = [elapsedNanos](char* buffer, size_t size, uint64_t nowNanos, uint64_t lastNanos) {
+            const double busy = static_cast<double>(nowNanos > lastNanos ? nowNanos - lastNanos : 0);
+            std::snprintf(buffer, size, "%.1f%%", busy * 100.0 / elapsedNanos);
+            return buffer;
+        };
+        char captureToPop[32];
+        char writerWrite[32];
+        char captureCpu[16];
+        char writerCpu[16];
+        PipelineLatencies::FormatNanos(latencies->captureToPop.Percentile(0.99), captureToPop, sizeof(captureToPop));
+        PipelineLatencies::FormatNanos(latencies->writerWrite.Percentile(0.99), writerWrite, sizeof(writerWrite));
+        StatusLine message;
+        message << L"[状态] fps=" << framesPerSecond << L"/s, 队列=" << queueMs << L" ms, 丢弃=" << droppedSince
+                << L", 分段=" << static_cast<uint64_t>(output.SegmentsOpened())
+                << L", p99 采集→出队=" << captureToPop << L" 写入=" << writerWrite
+                << L", CPU 采集=" << cpuPercent(captureCpu, sizeof(captureCpu), captureCpuNanos, lastCaptureCpuNanos)
+                << L" 写入=" << cpuPercent(writerCpu, sizeof(writerCpu), writerCpuNanos, lastWriterCpuNanos);
+        if (lastPauseState) {
+            message << L"（已暂停）";
+        }
+        logger_.Info(message.View());
+        framesPerSecond = 0;
+        lastReportedDropped = stats.framesDropped;
+        lastStatusReport = now;
+        lastCaptureCpuNanos = captureCpuNanos;
+        lastWriterCpuNanos = writerCpuNanos;
+    };
+
+    // Capture-side counters are published as deltas once per wakeup rather than per update.
+    RecorderStats publishedStats;
+    uint64_t publishedFrames = 0;
+    auto publishCaptureMetrics = [&]() {
+        if (!metrics) {
+            return;
+        }
+        auto addDelta = [](std::atomic<uint64_t>& counter, uint64_t now, uint64_t published) {
+            if (now != published) {
+                counter.fetch_add(now - published, std::memory_order_relaxed);
+            }
+        };
+        addDelta(metrics->framesCaptured, framesRecorded, publishedFrames);
+        addDelta(metrics->silentFrames, stats.silentFrames, publishedStats.silentFrames);
+        addDelta(metrics->pausedFrames, stats.framesWhilePaused, publishedStats.framesWhilePaused);
+        addDelta(metrics->droppedFrames, stats.framesDropped, publishedStats.framesDropped);
+        addDelta(metrics->glitches, stats.glitchCount, publishedStats.glitchCount);
+        addDelta(metrics->watchdogTimeouts, stats.watchdogTimeouts, publishedStats.watchdogTimeouts);
+        addDelta(metrics->ringWaits, stats.ringBufferWaits, publishedStats.ringBufferWaits);
+        addDelta(metrics->ringTimeouts, stats.ringBufferTimeouts, publishedStats.ringBufferTimeouts);
+        metrics->ringBytes.store(ring.AvailableToRead(), std::memory_order_relaxed);
+        publishedStats = stats;
+        publishedFrames = framesRecorded;
+    };
+
+    // Both views take the same levels, so neither starves the other of the meter.
+    auto publishStatus = [&](SharedRecorderState state) {
+        if (!levelMeter) {
+            return;
+        }
+        levelMeter->Take(captureStatus.peakDbfs, captureStatus.rmsDbfs);
+        if (statusBoard) {
+            captureStatus.state = static_cast<uint32_t>(state);
+            captureStatus.framesCaptured = framesRecorded;
+            captureStatus.pausedFrames = stats.framesWhilePaused;
+            captureStatus.droppedFrames = stats.framesDropped;
+            captureStatus.glitches = stats.glitchCount;
+            statusBoard->PublishCapture(captureStatus);
+        }
+        if (!sharedStats) {
+            return;
+        }
+        sharedPayload.state = static_cast<uint32_t>(state);
+        sharedPayload.framesCaptured = framesRecorded;
+        sharedPayload.silentFrames = stats.silentFrames;
+        sharedPayload.pausedFrames = stats.framesWhilePaused;
+        sharedPayload.droppedFrames = stats.framesDropped;
+        sharedPayload.glitches = stats.glitchCount;
+        sharedPayload.watchdogTimeouts = stats.watchdogTimeouts;
+        sharedPayload.ringBytes = ring.AvailableToRead();
+        sharedPayload.segmentNumber = output.SegmentsOpened();
+        std::memcpy(sharedPayload.peakDbfs, captureStatus.peakDbfs, sizeof(sharedPayload.peakDbfs));
+        std::memcpy(sharedPayload.rmsDbfs, captureStatus.rmsDbfs, sizeof(sharedPayload.rmsDbfs));
+        sharedStats->Publish(sharedPayload);
+    };
+
+    auto lastEventLevels = scheduler.Now();
+    auto publishEventLevels = [&]() {
+        if (!events) {
+            return;
+        }
+        const auto now = scheduler.Now();
+        if (now - lastEventLevels < kEventLevelPeriod) {
+            return;
+        }
+        float peak[kSharedStatsMaxChannels];
+        float rms[kSharedStatsMaxChannels];
+        eventLevelMeter->Take(peak, rms);
+        events->Levels(framesRecorded, static_cast<uint16_t>(std::min<uint32_t>(format.channels, kSharedStatsMaxChannels)), peak, rms);
+        lastEventLevels = now;
+    };
+
+    // Control commands take effect between packets, so the frame position reported back is
+    // exactly where the pause, roll or marker lands in the recording.
+    ControlCommandQueue* const commandQueue = controls.commands;
+    bool controlStopRequested = false;
+    float gain = DbToLinearGain(localConfig.gainDb);
+    auto applyConfigure = [&](ControlCommand& command) {
+        std::wstring changes;
+        bool outputChanged = false;
+        if (command.mp3BitrateKbps) {
+            liveSettings.mp3BitrateKbps = *command.mp3BitrateKbps;
+            changes += L" 码率=" + std::to_wstring(*command.mp3BitrateKbps) + L"kbps";
+            outputChanged = true;
+        }
+        if (command.segmentSeconds) {
+            liveSettings.segmentFrameTarget = *command.segmentSeconds * sampleRate;
+            changes += L" 分段时长=" + std::to_wstring(*command.segmentSeconds) + L"s";
+            outputChanged = true;
+        }
+        if (command.segmentBytes) {
+            liveSettings.segmentByteTarget = *command.segmentBytes;
+            changes += L" 分段大小=" + std::to_wstring(*command.segmentBytes);
+            outputChanged = true;
+        }
+        if (command.gainDb) {
+            gain = DbToLinearGain(*command.gainDb);
+            char text[32];
+            std::snprintf(text, sizeof(text), " 增益=%.1fdB", *command.gainDb);
+            changes += Utf8ToWide(text);
+        }
+        if (outputChanged) {
+            liveSettingsSlot.Publish(liveSettings);
+        }
+        if (command.applyNow) {
+            controlRolls.Push(bytesPushed);
+            dataReady.Set();
+            command.segment = output.SegmentsOpened() + static_cast<uint32_t>(controlRolls.Size());
+        } else {
+            command.segment = output.SegmentsOpened();
+            if (outputChanged) {
+                dataReady.Set();
+            }
+        }
+        logger_.Info(L"[控制] 配置于帧 " + std::to_wstring(framesRecorded) + L"：" + changes +
+                     (command.applyNow ? L"（立即切段）" : L""));
+    };
+    auto applyControlCommand = [&](ControlCommand& command) {
+        command.framePosition = framesRecorded;
+        if (scheduler.Now() - command.enqueuedAt > kControlCommandTimeout) {
+            command.Fail("expired before the recorder applied it");
+            return;
+        }
+        switch (command.type) {
+        case ControlCommandType::Stop:
+            controlStopRequested = true;
+            logger_.Info(L"[控制] 停止于帧 " + std::to_wstring(framesRecorded) + L"。");
+            break;
+        case ControlCommandType::Pause:
+        case ControlCommandType::Resume:
+            controlPaused = command.type == ControlCommandType::Pause;
+            queryPauseState();
+            break;
+        case ControlCommandType::Segment:
+            if (controlStopRequested) {
+                command.Fail("recording is stopping");
+                return;
+            }
+            if (!controlRolls.Push(bytesPushed)) {
+                command.Fail("too many segment requests pending");
+                return;
+            }
+            dataReady.Set();
+            command.segment = output.SegmentsOpened() + static_cast<uint32_t>(controlRolls.Size());
+            break;
+        case ControlCommandType::Marker:
+            if (events) {
+                events->Marker(framesRecorded, command.label);
+            }
+            logger_.Info(L"[控制] 标记于帧 " + std::to_wstring(framesRecorded) + L"：" + Utf8ToWide(command.label));
+            break;
+        case ControlCommandType::Configure:
+            if (controlStopRequested) {
+                command.Fail("recording is stopping");
+                return;
+            }
+            if (command.applyNow && controlRolls.Full()) {
+                command.Fail("too many segment requests pending");
+                return;
+            }
+            applyConfigure(command);
+            break;
+        case ControlCommandType::Status:
+            command.segment = output.SegmentsOpened();
+            command.droppedFrames = stats.framesDropped;
+            command.ringBytes = ring.AvailableToRead();
+            break;
+        case ControlCommandType::Start:
+            command.Fail("already recording");
+            return;
+        }
+        command.state = controlStopRequested ? "stopping" : (lastPauseState ? "paused" : "recording");
+        command.Complete();
+    };
+    auto applyControlCommands = [&]() {
+        if (!commandQueue) {
+            return;
+        }
+        while (auto command = commandQueue->Pop()) {
+            applyControlCommand(*command);
+        }
+    };
+    struct ControlSessionGuard {
+        ControlCommandQueue* queue;
+        explicit ControlSessionGuard(ControlCommandQueue* q) : queue(q) {
+            if (queue) {
+                queue->SetConsumerActive(true);
+            }
+        }
+        ~ControlSessionGuard() {
+            if (queue) {
+                queue->SetConsumerActive(false);
+            }
+        }
+    } controlSession(commandQueue);
+
+    auto pushToRing = [&](const uint8_t* src, size_t bytes, size_t& acceptedBytes) -> bool {
+        TraceScope scope("ring.push");
+        acceptedBytes = 0;
+        while (acceptedBytes < bytes) {
+            size_t wrote = ring.Write(src + acceptedBytes, bytes - acceptedBytes);
+            if (wrote == 0) {
+                ++stats.ringBufferWaits;
+                if (fatalError.load(std::memory_order_acquire)) {
+                    return false;
+                }
+                if (spaceAvailable.Wait(waitMs)) {
+                    continue;
+                }
+                ++stats.ringBufferTimeouts;
+                const size_t remaining = bytes - acceptedBytes;
+                const uint64_t droppedFrames = remaining / bytesPerFrame;
+                if (droppedFrames > 0) {
+                    stats.framesDropped += droppedFrames;
+                    droppedFramesLive.fetch_add(droppedFrames, std::memory_order_release);
+                    if (events) {
+                        events->FramesDropped(framesRecorded, droppedFrames);
+                    }
+                    if (!dropWarningIssued) {
+                        logger_.Warn(L"写入线程慢于采集；为保持实时性将丢弃帧。");
+                        dropWarningIssued = true;
+                    }
+                }
+                if (localConfig.failOnGlitch) {
+                    logger_.Error(L"启用 --fail-on-glitch 时发生环形缓冲溢出；终止采集。");
+                    return false;
+                }
+                break;
+            }
+            acceptedBytes += wrote;
+            Tracer::Counter("ring.bytes", static_cast<int64_t>(ring.AvailableToRead()));
+            dataReady.Set();
+        }
+        return true;
+    };
+
+    source.Start();
+    struct SourceStopGuard {
+        IAudioSource& source;
+        ~SourceStopGuard() { source.Stop(); }
+    } sourceStop{source};
+
+    while (!done) {
+        if (fatalError.load(std::memory_order_acquire)) {
+            logger_.Error(L"写入线程报告致命错误；终止采集。");
+            break;
+        }
+        if (controls.shouldStop && controls.shouldStop()) {
+            source.Interrupt();
+            break;
+        }
+        applyControlCommands();
+        if (controlStopRequested) {
+            break;
+        }
+        SourceWaitResult wait = SourceWaitResult::Failed;
+        {
+            TraceScope scope("capture.wait");
+            wait = source.Wait(waitMs);
+        }
+        if (wait == SourceWaitResult::Interrupted) {
+            break;
+        }
+        if (wait == SourceWaitResult::Timeout) {
+            ++stats.watchdogTimeouts;
+            if (events) {
+                events->WatchdogTimeout(framesRecorded, static_cast<uint32_t>(waitMs.count()));
+            }
+            if (localConfig.failOnGlitch) {
+                logger_.Error(L"看门狗超时；终止采集。");
+                break;
+            }
+            logger_.Warn(L"采集看门狗超时；尝试继续。");
+            continue;
+        }
+        if (wait != SourceWaitResult::PacketsReady) {
+            logger_.Error(source.LastError().empty() ? L"等待音频源失败。" : source.LastError());
+            break;
+        }
+
+        Tracer::Instant("capture.wakeup");
+        const uint64_t wakeupNanos = MonotonicNanos();
+
+        bool packetIntervalRecorded = false;
+        for (;;) {
+            SourcePacket packet;
+            const SourceReadResult read = source.Read(packet);
+            if (read == SourceReadResult::Empty) {
+                break;
+            }
+            if (read == SourceReadResult::EndOfStream) {
+                logger_.Info(L"音频源已结束。");
+                done = true;
+                break;
+            }
+            if (read != SourceReadResult::Packet) {
+                if (read == SourceReadResult::DeviceLost) {
+                    stats.deviceInvalidated = true;
+                }
+                logger_.Error(source.LastError());
+                done = true;
+                break;
+            }
+            const uint32_t frames = packet.frames;
+            const uint64_t packetNanos = MonotonicNanos();
+            const int64_t packetWallNanos = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::system_clock::now().time_since_epoch()).count();
+            if (!packetIntervalRecorded) {
+                if (lastPacketWakeupNanos) {
+                    latencies->packetInterval.Record(wakeupNanos - lastPacketWakeupNanos);
+                }
+                lastPacketWakeupNanos = wakeupNanos;
+                packetIntervalRecorded = true;
+            }
+
+            const size_t bytesToWrite = static_cast<size_t>(frames) * bytesPerFrame;
+            if (packet.discontinuity) {
+                ++stats.glitchCount;
+                gapsLive.fetch_add(1, std::memory_order_release);
+                if (events) {
+                    events->Gap(framesRecorded);
+                }
+                if (localConfig.failOnGlitch) {
+                    logger_.Error(L"音频引擎报告数据不连续；终止采集。");
+                    source.Release(packet);
+                    done = true;
+                    break;
+                }
+                logger_.Warn(L"音频引擎报告数据不连续。");
+            }
+            const bool pausedNow = queryPauseState();
+            if (pausedNow) {
+                stats.framesWhilePaused += frames;
+                source.Release(packet);
+                continue;
+            }
+            if (staging.size() < bytesToWrite) {
+                staging.resize(bytesToWrite);
+            }
+            if (packet.silent) {
+                std::fill_n(staging.data(), bytesToWrite, uint8_t{0});
+                stats.silentFrames += frames;
+                if (levelMeter) {
+                    levelMeter->AccumulateSilence(frames);
+                }
+                if (eventLevelMeter) {
+                    eventLevelMeter->AccumulateSilence(frames);
+                }
+            } else {
+                std::memcpy(staging.data(), packet.data, bytesToWrite);
+                if (localConfig.enableMicMix) {
+                    MixMicrophone(staging.data(), frames, format);
+                }
+                if (gain != 1.0f) {
+                    ApplyGain(staging.data(), frames, format, gain);
+                }
+                if (levelMeter) {
+                    levelMeter->Accumulate(staging.data(), frames);
+                }
+                if (eventLevelMeter) {
+                    eventLevelMeter->Accumulate(staging.data(), frames);
+                }
+            }
+
+            source.Release(packet);
+
+            size_t acceptedBytes = 0;
+            const bool pushed = pushToRing(staging.data(), bytesToWrite, acceptedBytes);
+            // Bytes already in the ring reach the file even when the push gave up part way.
+            if (acceptedBytes > 0) {
+                bytesPushed += acceptedBytes;
+                captureTimes->Push(bytesPushed, packetNanos, packetWallNanos);
+            }
+
+            const uint64_t acceptedFrames = acceptedBytes / bytesPerFrame;
+            framesRecorded += acceptedFrames;
+            framesPerSecond += acceptedFrames;
+            if (!steadyAllocationBase && framesRecorded >= warmupFrames) {
+                steadyAllocationBase = AllocationCounter::ThreadAllocations();
+            }
+            if (!pushed) {
+                done = true;
+                break;
+            }
+
+            if (framesRecorded >= frameLimit) {
+                done = true;
+                break;
+            }
+        }
+        publishCaptureMetrics();
+        publishStatus(lastPauseState ? SharedRecorderState::Paused : SharedRecorderState::Recording);
+        publishEventLevels();
+        maybeReportStatus(false);
+    }
+
+    if (steadyAllocationBase) {
+        stats.captureSteadyAllocations = AllocationCounter::ThreadAllocations() - *steadyAllocationBase;
+    }
+
+    // Answer what arrived during the last wakeup; a late "stop" is simply confirmed.
+    controlStopRequested = true;
+    applyControlCommands();
+    if (commandQueue) {
+        commandQueue->SetConsumerActive(false);
+        applyControlCommands();
+    }
+
+    writerActive.store(false, std::memory_order_release);
+    dataReady.Set();
+    if (hasStopCallback) {
+        stopWatcherTerminate.store(true, std::memory_order_release);
+        source.Interrupt();
+        scheduler.Join(stopWatcher);
+    }
+    publishCaptureMetrics();
+    publishStatus(SharedRecorderState::Stopping);
+    maybeReportStatus(true);
+
+    source.Stop();
+    if (tracingSource) {
+        logger_.Info(L"[跟踪] 采集时序已写入 " + config.captureTracePath->wstring() + L"（" +
+                     std::to_wstring(tracingSource->Records()) + L" 条记录）。");
+    }
+    // Join here rather than in writerGuard so the writer's CPU totals are final.
+    scheduler.Join(writerThread);
+    stats.captureThread = SampleCurrentThreadUsage().Since(captureUsageStart);
+    stats.writerThread = writerUsage.Sample();
+    stats.stopWatcherThread = stopWatcherUsage.Sample();
+    if (controls.uiThread) {
+        stats.uiThread = controls.uiThread->Sample().Since(uiUsageStart);
+    }
+    stats.framesCaptured = framesRecorded;
+    stats.segmentsWritten = std::max<uint32_t>(output.SegmentsOpened(), 1);
+    logger_.Info(L"已采集帧数：" + std::to_wstring(stats.framesCaptured) +
+                 L"，静音帧：" + std::to_wstring(stats.silentFrames) +
+                 L"，暂停帧：" + std::to_wstring(stats.framesWhilePaused) +
+                 L"，断续：" + std::to_wstring(stats.glitchCount) +
+                 L"，丢弃：" + std::to_wstring(stats.framesDropped) +
+                 L"，分段：" + std::to_wstring(stats.segmentsWritten));
+    logger_.Info(L"[延迟] 采集包间隔 " + Utf8ToWide(latencies->packetInterval.Summary()));
+    logger_.Info(L"[延迟] 采集→出队 " + Utf8ToWide(latencies->captureToPop.Summary()));
+    logger_.Info(L"[延迟] Write " + Utf8ToWide(latencies->writerWrite.Summary()));
+    logger_.Info(L"[延迟] Flush " + Utf8ToWide(latencies->writerFlush.Summary()));
+    logger_.Info(L"[延迟] 分段切换 " + Utf8ToWide(latencies->segmentRoll.Summary()));
+    const double recordedHours = static_cast<double>(framesRecorded) / sampleRate / 3600.0;
+    logger_.Info(L"[CPU] 采集 " + Utf8ToWide(stats.captureThread.Format(recordedHours)));
+    logger_.Info(L"[CPU] 写入 " + Utf8ToWide(stats.writerThread.Format(recordedHours)));
+    if (hasStopCallback) {
+        logger_.Info(L"[CPU] 停止监视 " + Utf8ToWide(stats.stopWatcherThread.Format(recordedHours)));
+    }
+    if (controls.uiThread) {
+        logger_.Info(L"[CPU] 界面 " + Utf8ToWide(stats.uiThread.Format(recordedHours)));
+    }
+    stats.writerSteadyAllocations = writerSteadyAllocations;
+    if (AllocationCounter::Enabled()) {
+        logger_.Info(L"[分配] 稳态（首秒之后）堆分配：采集 " + std::to_wstring(stats.captureSteadyAllocations) +
+                     L" 次，写入 " + std::to_wstring(stats.writerSteadyAllocations) + L" 次。");
+    }
+    if (stats.framesCaptured > 0 && stats.framesCaptured == stats.silentFrames) {
+        logger_.Warn(L"所有采集帧均为静音。请确认所选播放设备正在输出音频（尝试 --list-devices / --device-index）。");
+    }
+    if (stats.deviceInvalidated) {
+        if (metrics) {
+            metrics->deviceInvalidations.fetch_add(1, std::memory_order_relaxed);
+        }
+        logger_.Warn(L"会话结束：播放设备断开或已更改。");
+    }
+    stats.writerWaitTimeouts = writerWaitTimeouts.load();
+    if (events) {
+        SessionEndCounters counters;
+        counters.framesCaptured = stats.framesCaptured;
+        counters.silentFrames = stats.silentFrames;
+        counters.pausedFrames = stats.framesWhilePaused;
+        counters.droppedFrames = stats.framesDropped;
+        counters.glitches = stats.glitchCount;
+        counters.watchdogTimeouts = stats.watchdogTimeouts;
+        counters.segments = stats.segmentsWritten;
+        counters.deviceInvalidated = stats.deviceInvalidated;
+        events->SessionEnd(counters);
+    }
+    if (!writerFailed.load()) {
+        statusSession.SetFinalState(stats.deviceInvalidated ? SharedRecorderState::DeviceLost : SharedRecorderState::Stopped);
+    }
+    if (writerFailed.load()) {
+        throw std::runtime_error("写入线程失败：" + writerErrorMessage);
+    }
+    return stats;
+}
\ No newline at end of file
@@ -0,0 +1,118 @@
+#pragma once
+
+#include "AudioSource.h"
+#include "WavWriter.h"
+#include "Logger.h"
+#include "ControlServer.h"
+#include "DiskSpaceGuard.h"
+#include "EventLog.h"
+#include "SegmentCompressor.h"
+#include "SegmentRetention.h"
+#include "RecorderMetrics.h"
+#include "RecorderStatus.h"
+#include "SharedStats.h"
+#include "SpscByteRing.h"
+#include "ThreadUsage.h"
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <cstdint>
+#include <vector>
+
+class IAudioWriter;
+class PipelineScheduler;
+
+struct RecorderConfig {
+    std::filesystem::path outputPath;
+    std::optional<std::chrono::seconds> maxDuration;
+    bool enableMicMix = false; // future extension
+    std::chrono::milliseconds latencyHint{200};
+    std::chrono::milliseconds watchdogTimeout{4000};
+    bool failOnGlitch = false;
+    std::chrono::milliseconds ringBufferSize{2000};
+    bool quietStatusUpdates = false;
+    std::optional<std::chrono::seconds> segmentDuration;
+    bool alignSegments = false; // cut segmentDuration on UTC multiples, name files by boundary
+    std::optional<uint64_t> segmentBytes;
+    std::optional<uint32_t> mp3BitrateKbps;
+    std::vector<uint32_t> mp3LadderKbps; // extra MP3 bitrates from the same pass, live or with compression
+    double gainDb = 0.0; // applied on the capture thread; "configure" commands can change it live
+    bool writeManifest = true;
+    bool writeIndex = true;
+    RetentionPolicy retention;
+    std::optional<CompressionOptions> compression; // WAV output: encode closed segments to MP3 in the background
+    std::optional<DiskGuardPolicy> diskGuard = DiskGuardPolicy{};
+    std::optional<std::filesystem::path> tracePath; // Chrome trace JSON of the capture/writer pipeline
+    std::optional<std::filesystem::path> captureTracePath; // timing of every source call, for TraceReplaySource
+};
+
+struct RecorderStats {
+    uint64_t framesCaptured = 0;
+    uint64_t silentFrames = 0;
+    uint32_t glitchCount = 0;          // discontinuities / flags
+    uint32_t watchdogTimeouts = 0;     // wait timeouts
+    uint32_t ringBufferWaits = 0;
+    uint32_t ringBufferTimeouts = 0;
+    uint32_t writerWaitTimeouts = 0;
+    uint64_t framesDropped = 0;
+    bool deviceInvalidated = false;
+    uint64_t framesWhilePaused = 0;
+    uint32_t segmentsWritten = 1;
+    // Heap allocations after the first second of audio (kSteadyStateWarmup), per thread. Only
+    // counted in the LOOPBACK_RECORDER_COUNT_ALLOCATIONS build; the steady state should be zero.
+    uint64_t captureSteadyAllocations = 0;
+    uint64_t writerSteadyAllocations = 0;
+    // Per-thread usage during this Record() call.
+    ThreadCpuUsage captureThread;
+    ThreadCpuUsage writerThread;
+    ThreadCpuUsage stopWatcherThread;   // only when a stop callback is set
+    ThreadCpuUsage uiThread;            // only when RecorderControls::uiThread is set
+};
+
+struct RecorderControls {
+    std::function<bool()> shouldStop;
+    std::function<bool()> isPaused;
+    std::function<bool()> requestNewSegment;
+    RecorderMetrics* metrics = nullptr; // optional, updated live and accumulated across calls
+    SharedStatsPublisher* sharedStats = nullptr; // optional shared-memory status block
+    RecorderStatusBoard* status = nullptr; // optional in-process status snapshot for front ends
+    const ThreadUsageProbe* uiThread = nullptr; // optional GUI thread, reported with the pipeline threads
+    EventLogWriter* events = nullptr; // optional binary event log, shared across calls
+    ControlCommandQueue* commands = nullptr; // optional control endpoint, drained by the capture thread
+    // Optional, wraps each segment's writer (fault injection in tools/recorder_soak).
+    std::function<std::unique_ptr<IAudioWriter>(std::unique_ptr<IAudioWriter>)> wrapWriter;
+    // Optional, runs the session's threads, waits and clock (VirtualScheduler in tools/pipeline_sim);
+    // the source must block through the same scheduler. Default: the OS and the steady clock.
+    PipelineScheduler* scheduler = nullptr;
+};
+
+// The capture/writer pipeline behind every recording: source packets go through a lock-free
+// ring to a writer thread that owns the segmented output. The ring and the capture/writer
+// buffers belong to the pipeline and survive across Run() calls, so a long-lived instance
+// (the scheduler daemon) records session after session without reallocating them.
+class CapturePipeline {
+public:
+    explicit CapturePipeline(Logger& logger);
+
+    CapturePipeline(const CapturePipeline&) = delete;
+    CapturePipeline& operator=(const CapturePipeline&) = delete;
+
+    // Optional: allocates the ring and buffers for this format/config ahead of Run().
+    void Prepare(const AudioFormat& format, const RecorderConfig& config);
+
+    // Records from `source` until the duration limit, a stop request, end of stream or a
+    // fatal error. Starts and stops the source.
+    RecorderStats Run(IAudioSource& source, const RecorderConfig& config, const RecorderControls& controls = {});
+
+private:
+    SpscByteRingBuffer& AcquireRing(size_t capacityBytes);
+
+    Logger& logger_;
+    std::unique_ptr<SpscByteRingBuffer> ring_;
+    std::vector<uint8_t> staging_;
+    std::vector<uint8_t> chunk_;
+};
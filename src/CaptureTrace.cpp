@@ -0,0 +1,216 @@
+#include "CaptureTrace.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <stdexcept>
+
+namespace {
+
+constexpr char kMagic[8] = {'L', 'R', 'C', 'T', 'R', 'A', 'C', 'E'};
+constexpr uint32_t kVersion = 1;
+constexpr size_t kFileHeaderSize = 16;
+constexpr size_t kRecordSize = 16;
+constexpr size_t kBlockRecords = 4096;
+
+template <typename T>
+void PutValue(unsigned char*& cursor, T value) {
+    std::memcpy(cursor, &value, sizeof(T));
+    cursor += sizeof(T);
+}
+
+template <typename T>
+T GetValue(const unsigned char*& cursor) {
+    T value{};
+    std::memcpy(&value, cursor, sizeof(T));
+    cursor += sizeof(T);
+    return value;
+}
+
+uint32_t Saturate32(uint64_t value) {
+    return static_cast<uint32_t>(std::min<uint64_t>(value, UINT32_MAX));
+}
+
+} // namespace
+
+CaptureTraceWriter::CaptureTraceWriter(const std::filesystem::path& path, const AudioFormat& format)
+    : block_(kBlockRecords * kRecordSize) {
+    if (path.has_parent_path() && !path.parent_path().empty()) {
+        std::filesystem::create_directories(path.parent_path());
+    }
+    const std::vector<std::byte> formatChunk = EncodeWaveFormatChunk(format);
+    const uint32_t formatBytes = static_cast<uint32_t>(formatChunk.size());
+    unsigned char header[kFileHeaderSize];
+    unsigned char* cursor = header;
+    std::memcpy(cursor, kMagic, sizeof(kMagic));
+    cursor += sizeof(kMagic);
+    PutValue(cursor, kVersion);
+    PutValue(cursor, formatBytes);
+
+    // Later sessions (reconnects, scheduled recordings) are appended to an existing trace of
+    // the same format; a record cut short by a crash is cut off first.
+    std::error_code ec;
+    const uint64_t existingBytes = std::filesystem::exists(path, ec) ? std::filesystem::file_size(path, ec) : 0;
+    if (existingBytes > 0) {
+        std::vector<unsigned char> expected(header, header + sizeof(header));
+        expected.insert(expected.end(), reinterpret_cast<const unsigned char*>(formatChunk.data()),
+                        reinterpret_cast<const unsigned char*>(formatChunk.data()) + formatBytes);
+        std::vector<unsigned char> existing(expected.size());
+        std::ifstream file(path, std::ios::binary);
+        file.read(reinterpret_cast<char*>(existing.data()), static_cast<std::streamsize>(existing.size()));
+        if (static_cast<size_t>(file.gcount()) != existing.size() || existing != expected) {
+            throw std::runtime_error("已有文件不是同一音频格式的采集时序跟踪，拒绝追加：" + path.string());
+        }
+        file.close();
+        const uint64_t recordBytes = (existingBytes - expected.size()) / kRecordSize * kRecordSize;
+        if (expected.size() + recordBytes < existingBytes) {
+            std::filesystem::resize_file(path, expected.size() + recordBytes);
+        }
+        file_.open(path, std::ios::binary | std::ios::app);
+    } else {
+        file_.open(path, std::ios::binary | std::ios::trunc);
+        file_.write(reinterpret_cast<const char*>(header), sizeof(header));
+        file_.write(reinterpret_cast<const char*>(formatChunk.data()), formatBytes);
+    }
+    if (!file_) {
+        throw std::runtime_error("无法写入采集时序跟踪文件：" + path.string());
+    }
+    file_.flush();
+}
+
+CaptureTraceWriter::~CaptureTraceWriter() {
+    try {
+        Flush();
+    } catch (...) {
+    }
+}
+
+void CaptureTraceWriter::Append(const CaptureTraceRecord& record) {
+    unsigned char* cursor = block_.data() + used_;
+    PutValue(cursor, record.nanos);
+    PutValue(cursor, record.value);
+    PutValue(cursor, static_cast<uint8_t>(record.kind));
+    PutValue(cursor, record.result);
+    PutValue(cursor, record.flags);
+    used_ += kRecordSize;
+    ++records_;
+    if (used_ == block_.size()) {
+        Flush();
+    }
+}
+
+void CaptureTraceWriter::Flush() {
+    if (used_ > 0) {
+        file_.write(reinterpret_cast<const char*>(block_.data()), static_cast<std::streamsize>(used_));
+        used_ = 0;
+    }
+    file_.flush();
+}
+
+CaptureTrace CaptureTrace::Load(const std::filesystem::path& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        throw std::runtime_error("无法打开采集时序跟踪文件：" + path.string());
+    }
+    const std::vector<unsigned char> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    if (bytes.size() < kFileHeaderSize || std::memcmp(bytes.data(), kMagic, sizeof(kMagic)) != 0) {
+        throw std::runtime_error("不是采集时序跟踪文件：" + path.string());
+    }
+    const unsigned char* cursor = bytes.data() + sizeof(kMagic);
+    const auto version = GetValue<uint32_t>(cursor);
+    const auto formatBytes = GetValue<uint32_t>(cursor);
+    if (version != kVersion) {
+        throw std::runtime_error("不支持的采集时序跟踪版本：" + std::to_string(version));
+    }
+    if (formatBytes < 16 || formatBytes > 4096 || bytes.size() < kFileHeaderSize + formatBytes) {
+        throw std::runtime_error("采集时序跟踪文件的格式块无效：" + path.string());
+    }
+
+    CaptureTrace trace;
+    try {
+        trace.format = DecodeWaveFormatChunk(reinterpret_cast<const std::byte*>(cursor), formatBytes);
+    } catch (const std::exception& ex) {
+        throw std::runtime_error(std::string(ex.what()) + "：" + path.string());
+    }
+    cursor += formatBytes;
+    const size_t recordCount = static_cast<size_t>(bytes.data() + bytes.size() - cursor) / kRecordSize;
+    trace.records.reserve(recordCount);
+    for (size_t i = 0; i < recordCount; ++i) {
+        CaptureTraceRecord record;
+        record.nanos = GetValue<uint64_t>(cursor);
+        record.value = GetValue<uint32_t>(cursor);
+        record.kind = static_cast<CaptureTraceKind>(GetValue<uint8_t>(cursor));
+        record.result = GetValue<uint8_t>(cursor);
+        record.flags = GetValue<uint16_t>(cursor);
+        trace.records.push_back(record);
+    }
+    return trace;
+}
+
+TracingAudioSource::TracingAudioSource(IAudioSource& inner, const std::filesystem::path& path)
+    : inner_(inner), writer_(path, inner.Format()) {}
+
+std::wstring TracingAudioSource::Describe() const {
+    return inner_.Describe() + L"（记录采集时序）";
+}
+
+uint64_t TracingAudioSource::SinceStart(std::chrono::steady_clock::time_point time) const {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(time - origin_).count());
+}
+
+void TracingAudioSource::Start() {
+    inner_.Start();
+    origin_ = std::chrono::steady_clock::now();
+    CaptureTraceRecord record;
+    record.kind = CaptureTraceKind::Start;
+    writer_.Append(record);
+}
+
+void TracingAudioSource::Stop() {
+    inner_.Stop();
+    CaptureTraceRecord record;
+    record.nanos = SinceStart(std::chrono::steady_clock::now());
+    record.kind = CaptureTraceKind::Stop;
+    writer_.Append(record);
+    writer_.Flush();
+}
+
+SourceWaitResult TracingAudioSource::Wait(std::chrono::milliseconds timeout) {
+    const auto entered = std::chrono::steady_clock::now();
+    const SourceWaitResult result = inner_.Wait(timeout);
+    const auto returned = std::chrono::steady_clock::now();
+    CaptureTraceRecord record;
+    record.nanos = SinceStart(returned);
+    record.value = Saturate32(static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::microseconds>(returned - entered).count()));
+    record.kind = CaptureTraceKind::Wait;
+    record.result = static_cast<uint8_t>(result);
+    record.flags = static_cast<uint16_t>(std::clamp<int64_t>(timeout.count(), 0, UINT16_MAX));
+    writer_.Append(record);
+    return result;
+}
+
+SourceReadResult TracingAudioSource::Read(SourcePacket& packet) {
+    const SourceReadResult result = inner_.Read(packet);
+    CaptureTraceRecord record;
+    record.nanos = SinceStart(std::chrono::steady_clock::now());
+    record.kind = CaptureTraceKind::Read;
+    record.result = static_cast<uint8_t>(result);
+    if (result == SourceReadResult::Packet) {
+        record.value = packet.frames;
+        record.flags = static_cast<uint16_t>((packet.silent ? kCaptureTraceSilent : 0) |
+                                             (packet.discontinuity ? kCaptureTraceDiscontinuity : 0));
+    }
+    writer_.Append(record);
+    return result;
+}
+
+const char* CaptureTraceKindName(CaptureTraceKind kind) {
+    switch (kind) {
+    case CaptureTraceKind::Start: return "start";
+    case CaptureTraceKind::Stop: return "stop";
+    case CaptureTraceKind::Wait: return "wait";
+    case CaptureTraceKind::Read: return "read";
+    }
+    return "unknown";
+}
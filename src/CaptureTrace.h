@@ -0,0 +1,97 @@
+#pragma once
+
+#include "AudioSource.h"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Record kinds of a capture timing trace. Values are part of the file format; never reuse one.
+enum class CaptureTraceKind : uint8_t {
+    Start = 1,
+    Stop = 2,
+    Wait = 3,
+    Read = 4,
+};
+
+constexpr uint16_t kCaptureTraceSilent = 1;
+constexpr uint16_t kCaptureTraceDiscontinuity = 2;
+
+// One source call, stamped with the monotonic time it returned (nanoseconds since Start()).
+//   Wait: value = microseconds spent waiting, flags = timeout in ms, result = SourceWaitResult
+//   Read: value = packet frames (0 with Empty: GetNextPacketSize returned 0),
+//         flags = kCaptureTrace* packet flags, result = SourceReadResult
+struct CaptureTraceRecord {
+    uint64_t nanos = 0;
+    uint32_t value = 0;
+    CaptureTraceKind kind = CaptureTraceKind::Start;
+    uint8_t result = 0;
+    uint16_t flags = 0;
+};
+
+// File layout: a 16-byte header (magic "LRCTRACE", version, format size), the source's
+// "fmt " chunk (a WAVEFORMATEX including its extension), then 16-byte little-endian records. No audio is kept.
+// An existing trace of the same format is appended to, one Start..Stop run per session.
+class CaptureTraceWriter {
+public:
+    CaptureTraceWriter(const std::filesystem::path& path, const AudioFormat& format);
+    ~CaptureTraceWriter();
+
+    CaptureTraceWriter(const CaptureTraceWriter&) = delete;
+    CaptureTraceWriter& operator=(const CaptureTraceWriter&) = delete;
+
+    // Capture thread. Records collect in a fixed block that is appended to the file when full
+    // (64 KiB, about 20 s of a 10 ms device period), so tracing never allocates.
+    void Append(const CaptureTraceRecord& record);
+    void Flush();
+    uint64_t Records() const { return records_; }
+
+private:
+    std::ofstream file_;
+    std::vector<unsigned char> block_;
+    size_t used_ = 0;
+    uint64_t records_ = 0;
+};
+
+struct CaptureTrace {
+    AudioFormat format;
+    std::vector<CaptureTraceRecord> records;
+
+    const AudioFormat& Format() const { return format; }
+
+    // A record cut short at the end of the file (crash while appending) is ignored. Throws
+    // std::runtime_error if the file is not a capture trace.
+    static CaptureTrace Load(const std::filesystem::path& path);
+};
+
+// Passes every call through to `inner` and records its timing and result.
+class TracingAudioSource : public IAudioSource {
+public:
+    TracingAudioSource(IAudioSource& inner, const std::filesystem::path& path);
+
+    const AudioFormat& Format() const override { return inner_.Format(); }
+    std::wstring Describe() const override;
+
+    void Start() override;
+    void Stop() override;
+    SourceWaitResult Wait(std::chrono::milliseconds timeout) override;
+    void Interrupt() override { inner_.Interrupt(); }
+    SourceReadResult Read(SourcePacket& packet) override;
+    void Release(const SourcePacket& packet) override { inner_.Release(packet); }
+    std::wstring LastError() const override { return inner_.LastError(); }
+
+    uint64_t Records() const { return writer_.Records(); }
+
+private:
+    uint64_t SinceStart(std::chrono::steady_clock::time_point time) const;
+
+    IAudioSource& inner_;
+    CaptureTraceWriter writer_;
+    std::chrono::steady_clock::time_point origin_{};
+};
+
+const char* CaptureTraceKindName(CaptureTraceKind kind);
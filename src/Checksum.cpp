@@ -0,0 +1,158 @@
+#include "Checksum.h"
+
+#include <array>
+#include <cstring>
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define RECORDER_CRC32C_X86 1
+#include <nmmintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#elif defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+#define RECORDER_CRC32C_ARM 1
+#include <arm_acle.h>
+#endif
+
+namespace {
+
+constexpr uint32_t kCastagnoliReflected = 0x82F63B78u;
+constexpr uint32_t kIeeeReflected = 0xEDB88320u;
+
+using SliceTables = std::array<std::array<uint32_t, 256>, 8>;
+
+SliceTables BuildTables(uint32_t polynomial) {
+    SliceTables tables{};
+    for (uint32_t i = 0; i < 256; ++i) {
+        uint32_t crc = i;
+        for (int bit = 0; bit < 8; ++bit) {
+            crc = (crc & 1u) ? (crc >> 1) ^ polynomial : crc >> 1;
+        }
+        tables[0][i] = crc;
+    }
+    for (uint32_t i = 0; i < 256; ++i) {
+        for (size_t slice = 1; slice < tables.size(); ++slice) {
+            const uint32_t prev = tables[slice - 1][i];
+            tables[slice][i] = (prev >> 8) ^ tables[0][prev & 0xFFu];
+        }
+    }
+    return tables;
+}
+
+const SliceTables& CastagnoliTables() {
+    static const SliceTables tables = BuildTables(kCastagnoliReflected);
+    return tables;
+}
+
+const SliceTables& IeeeTables() {
+    static const SliceTables tables = BuildTables(kIeeeReflected);
+    return tables;
+}
+
+uint32_t UpdateSoftware(const SliceTables& t, uint32_t crc, const uint8_t* data, size_t bytes) {
+    while (bytes >= 8) {
+        uint32_t lo = 0;
+        uint32_t hi = 0;
+        std::memcpy(&lo, data, 4);
+        std::memcpy(&hi, data + 4, 4);
+        lo ^= crc;
+        crc = t[7][lo & 0xFFu] ^ t[6][(lo >> 8) & 0xFFu] ^ t[5][(lo >> 16) & 0xFFu] ^ t[4][lo >> 24] ^
+              t[3][hi & 0xFFu] ^ t[2][(hi >> 8) & 0xFFu] ^ t[1][(hi >> 16) & 0xFFu] ^ t[0][hi >> 24];
+        data += 8;
+        bytes -= 8;
+    }
+    while (bytes-- > 0) {
+        crc = (crc >> 8) ^ t[0][(crc ^ *data++) & 0xFFu];
+    }
+    return crc;
+}
+
+#if defined(RECORDER_CRC32C_X86)
+#if defined(__GNUC__) || defined(__clang__)
+__attribute__((target("sse4.2")))
+#endif
+uint32_t UpdateHardware(uint32_t crc, const uint8_t* data, size_t bytes) {
+    uint64_t crc64 = crc;
+    while (bytes >= 8) {
+        uint64_t word = 0;
+        std::memcpy(&word, data, 8);
+        crc64 = _mm_crc32_u64(crc64, word);
+        data += 8;
+        bytes -= 8;
+    }
+    uint32_t crc32 = static_cast<uint32_t>(crc64);
+    while (bytes-- > 0) {
+        crc32 = _mm_crc32_u8(crc32, *data++);
+    }
+    return crc32;
+}
+
+bool DetectHardware() {
+#if defined(_MSC_VER)
+    int info[4] = {};
+    __cpuid(info, 1);
+    return (info[2] & (1 << 20)) != 0;
+#else
+    return __builtin_cpu_supports("sse4.2");
+#endif
+}
+#elif defined(RECORDER_CRC32C_ARM)
+uint32_t UpdateHardware(uint32_t crc, const uint8_t* data, size_t bytes) {
+    while (bytes >= 8) {
+        uint64_t word = 0;
+        std::memcpy(&word, data, 8);
+        crc = __crc32cd(crc, word);
+        data += 8;
+        bytes -= 8;
+    }
+    while (bytes-- > 0) {
+        crc = __crc32cb(crc, *data++);
+    }
+    return crc;
+}
+
+bool DetectHardware() {
+    return true;
+}
+#else
+uint32_t UpdateHardware(uint32_t crc, const uint8_t* data, size_t bytes) {
+    return UpdateSoftware(CastagnoliTables(), crc, data, bytes);
+}
+
+bool DetectHardware() {
+    return false;
+}
+#endif
+
+bool UseHardware() {
+    static const bool available = DetectHardware();
+    return available;
+}
+
+} // namespace
+
+void Crc32c::Update(const void* data, size_t bytes) {
+    if (bytes == 0) {
+        return;
+    }
+    const auto* bytesPtr = static_cast<const uint8_t*>(data);
+    state_ = UseHardware() ? UpdateHardware(state_, bytesPtr, bytes)
+                           : UpdateSoftware(CastagnoliTables(), state_, bytesPtr, bytes);
+}
+
+bool Crc32c::HardwareAccelerated() {
+    return UseHardware();
+}
+
+uint32_t ComputeCrc32c(const void* data, size_t bytes) {
+    Crc32c crc;
+    crc.Update(data, bytes);
+    return crc.Value();
+}
+
+void Crc32::Update(const void* data, size_t bytes) {
+    if (bytes == 0) {
+        return;
+    }
+    state_ = UpdateSoftware(IeeeTables(), state_, static_cast<const uint8_t*>(data), bytes);
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// CRC-32C (Castagnoli) computed incrementally while bytes are written, so
+// segment checksums never require re-reading the file.
+class Crc32c {
+public:
+    void Update(const void* data, size_t bytes);
+    uint32_t Value() const { return ~state_; }
+    void Reset() { state_ = 0xFFFFFFFFu; }
+
+    // True when SSE4.2 / ARMv8 CRC instructions are used instead of the table fallback.
+    static bool HardwareAccelerated();
+
+private:
+    uint32_t state_ = 0xFFFFFFFFu;
+};
+
+uint32_t ComputeCrc32c(const void* data, size_t bytes);
+
+// CRC-32 (IEEE 802.3, as used by gzip and zip); table-driven only.
+class Crc32 {
+public:
+    void Update(const void* data, size_t bytes);
+    uint32_t Value() const { return ~state_; }
+
+private:
+    uint32_t state_ = 0xFFFFFFFFu;
+};
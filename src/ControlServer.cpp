@@ -0,0 +1,556 @@
+#include "ControlServer.h"
+
+#include "JsonLines.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <cstring>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+
+namespace {
+
+constexpr size_t kMaxRequestBytes = 4096;
+constexpr size_t kMaxClients = 8;
+constexpr auto kPollSlice = std::chrono::milliseconds(200);
+constexpr auto kCompletionPoll = std::chrono::microseconds(200);
+
+std::wstring ToWideAscii(const std::string& text) {
+    return std::wstring(text.begin(), text.end());
+}
+
+std::optional<ControlCommandType> ParseCommandType(std::string_view name) {
+    static constexpr std::pair<std::string_view, ControlCommandType> kNames[] = {
+        {"start", ControlCommandType::Start},     {"stop", ControlCommandType::Stop},
+        {"pause", ControlCommandType::Pause},     {"resume", ControlCommandType::Resume},
+        {"segment", ControlCommandType::Segment}, {"marker", ControlCommandType::Marker},
+        {"status", ControlCommandType::Status},   {"configure", ControlCommandType::Configure},
+    };
+    for (const auto& [text, type] : kNames) {
+        if (text == name) {
+            return type;
+        }
+    }
+    return std::nullopt;
+}
+
+void AddRequestId(JsonObjectBuilder& response, const JsonObject& request) {
+    const auto it = request.find("id");
+    if (it == request.end()) {
+        return;
+    }
+    if (it->second.kind == JsonValue::Kind::Number) {
+        response.Add("id", it->second.AsInt64());
+    } else if (it->second.kind == JsonValue::Kind::String) {
+        response.Add("id", it->second.text);
+    }
+}
+
+// Fills the configure fields of `command`; returns an error message for the client, or an
+// empty string. Everything is validated here so the capture thread only copies values.
+std::string ParseConfigureFields(const JsonObject& request, ControlCommand& command) {
+    if (request.count("bitrate")) {
+        const auto bitrate = JsonGetUint64(request, "bitrate");
+        if (!bitrate || *bitrate < 32 || *bitrate > 320) {
+            return "bitrate must be 32-320 kbps";
+        }
+        command.mp3BitrateKbps = static_cast<uint32_t>(*bitrate);
+    }
+    if (request.count("segment_seconds")) {
+        command.segmentSeconds = JsonGetUint64(request, "segment_seconds");
+        if (!command.segmentSeconds || *command.segmentSeconds > 7 * 24 * 3600) {
+            return "segment_seconds must be 0 (off) to 604800";
+        }
+    }
+    if (request.count("segment_bytes")) {
+        command.segmentBytes = JsonGetUint64(request, "segment_bytes");
+        if (!command.segmentBytes || (*command.segmentBytes != 0 && *command.segmentBytes < 64 * 1024)) {
+            return "segment_bytes must be 0 (off) or at least 65536";
+        }
+    }
+    if (request.count("gain_db")) {
+        command.gainDb = JsonGetDouble(request, "gain_db");
+        if (!command.gainDb || !(*command.gainDb >= -60.0 && *command.gainDb <= 24.0)) {
+            return "gain_db must be -60 to 24";
+        }
+    }
+    const std::string apply = JsonGetString(request, "apply").value_or("next-segment");
+    if (apply != "now" && apply != "next-segment") {
+        return "apply must be \"now\" or \"next-segment\"";
+    }
+    command.applyNow = apply == "now";
+    if (!command.mp3BitrateKbps && !command.segmentSeconds && !command.segmentBytes && !command.gainDb &&
+        !command.applyNow) {
+        return "nothing to configure";
+    }
+    return {};
+}
+
+} // namespace
+
+// One connected client, read and written by its own thread. Reads return after at most
+// kPollSlice so the thread notices Stop(); 0 = nothing yet, -1 = closed.
+class ControlConnection {
+public:
+#if defined(_WIN32)
+    ControlConnection(HANDLE pipe, HANDLE stopEvent) : pipe_(pipe), stopEvent_(stopEvent) {
+        readEvent_ = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+        writeEvent_ = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+    }
+    ~ControlConnection() {
+        DisconnectNamedPipe(pipe_);
+        CloseHandle(pipe_);
+        if (readEvent_) {
+            CloseHandle(readEvent_);
+        }
+        if (writeEvent_) {
+            CloseHandle(writeEvent_);
+        }
+    }
+
+    int Read(char* buffer, size_t capacity) {
+        if (!readEvent_ || !writeEvent_) {
+            return -1;
+        }
+        OVERLAPPED overlapped{};
+        overlapped.hEvent = readEvent_;
+        ResetEvent(readEvent_);
+        DWORD bytes = 0;
+        if (ReadFile(pipe_, buffer, static_cast<DWORD>(capacity), &bytes, &overlapped)) {
+            return bytes > 0 ? static_cast<int>(bytes) : -1;
+        }
+        if (GetLastError() != ERROR_IO_PENDING) {
+            return -1;
+        }
+        HANDLE waits[2] = { readEvent_, stopEvent_ };
+        const DWORD wait = WaitForMultipleObjects(2, waits, FALSE, INFINITE);
+        if (wait != WAIT_OBJECT_0) {
+            CancelIo(pipe_);
+            GetOverlappedResult(pipe_, &overlapped, &bytes, TRUE);
+            return -1;
+        }
+        if (!GetOverlappedResult(pipe_, &overlapped, &bytes, FALSE) || bytes == 0) {
+            return -1;
+        }
+        return static_cast<int>(bytes);
+    }
+
+    bool WriteAll(const std::string& data) {
+        OVERLAPPED overlapped{};
+        overlapped.hEvent = writeEvent_;
+        ResetEvent(writeEvent_);
+        DWORD bytes = 0;
+        if (!WriteFile(pipe_, data.data(), static_cast<DWORD>(data.size()), &bytes, &overlapped) &&
+            GetLastError() != ERROR_IO_PENDING) {
+            return false;
+        }
+        return GetOverlappedResult(pipe_, &overlapped, &bytes, TRUE) && bytes == data.size();
+    }
+
+private:
+    HANDLE pipe_;
+    HANDLE stopEvent_;
+    HANDLE readEvent_ = nullptr;
+    HANDLE writeEvent_ = nullptr;
+#else
+    explicit ControlConnection(int socket) : socket_(socket) {}
+    ~ControlConnection() { close(socket_); }
+
+    int Read(char* buffer, size_t capacity) {
+        pollfd descriptor{socket_, POLLIN, 0};
+        const int ready = poll(&descriptor, 1, static_cast<int>(kPollSlice.count()));
+        if (ready <= 0) {
+            return ready == 0 ? 0 : -1;
+        }
+        const auto received = recv(socket_, buffer, capacity, 0);
+        return received > 0 ? static_cast<int>(received) : -1;
+    }
+
+    bool WriteAll(const std::string& data) {
+        size_t sent = 0;
+        while (sent < data.size()) {
+            const auto result = send(socket_, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+            if (result <= 0) {
+                return false;
+            }
+            sent += static_cast<size_t>(result);
+        }
+        return true;
+    }
+
+private:
+    int socket_;
+#endif
+};
+
+namespace {
+
+#if defined(_WIN32)
+HANDLE CreatePipeInstance(const std::wstring& path, bool first) {
+    DWORD openMode = PIPE_ACCESS_DUPLEX | FILE_FLAG_OVERLAPPED;
+    if (first) {
+        openMode |= FILE_FLAG_FIRST_PIPE_INSTANCE;
+    }
+    return CreateNamedPipeW(path.c_str(), openMode,
+                            PIPE_TYPE_BYTE | PIPE_READMODE_BYTE | PIPE_WAIT | PIPE_REJECT_REMOTE_CLIENTS,
+                            PIPE_UNLIMITED_INSTANCES, 4096, 4096, 0, nullptr);
+}
+#endif
+
+} // namespace
+
+ControlCommandQueue::ControlCommandQueue() {
+    for (size_t i = 0; i < kCapacity; ++i) {
+        slots_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+}
+
+bool ControlCommandQueue::Push(std::shared_ptr<ControlCommand> command) {
+    size_t position = enqueuePos_.load(std::memory_order_relaxed);
+    for (;;) {
+        Slot& slot = slots_[position & (kCapacity - 1)];
+        const size_t sequence = slot.sequence.load(std::memory_order_acquire);
+        const auto difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+        if (difference == 0) {
+            if (enqueuePos_.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                slot.command = std::move(command);
+                slot.sequence.store(position + 1, std::memory_order_release);
+                return true;
+            }
+        } else if (difference < 0) {
+            return false;
+        } else {
+            position = enqueuePos_.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+std::shared_ptr<ControlCommand> ControlCommandQueue::Pop() {
+    Slot& slot = slots_[dequeuePos_ & (kCapacity - 1)];
+    if (slot.sequence.load(std::memory_order_acquire) != dequeuePos_ + 1) {
+        return nullptr;
+    }
+    std::shared_ptr<ControlCommand> command = std::move(slot.command);
+    slot.sequence.store(dequeuePos_ + kCapacity, std::memory_order_release);
+    ++dequeuePos_;
+    return command;
+}
+
+std::string DefaultControlName() {
+    return "loopback_recorder";
+}
+
+ControlServer::ControlServer(ControlCommandQueue& queue, ControlServerOptions options, Logger& logger)
+    : queue_(queue), options_(std::move(options)), logger_(logger) {}
+
+ControlServer::~ControlServer() {
+    Stop();
+}
+
+std::string ControlServer::Endpoint() const {
+#if defined(_WIN32)
+    return "\\\\.\\pipe\\" + options_.name;
+#else
+    if (options_.name.find('/') != std::string::npos) {
+        return options_.name;
+    }
+    return "/tmp/" + options_.name + ".sock";
+#endif
+}
+
+void ControlServer::Start() {
+    const std::string endpoint = Endpoint();
+#if defined(_WIN32)
+    stopEvent_ = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+    if (!stopEvent_) {
+        throw std::runtime_error("创建控制服务停止事件失败");
+    }
+    // Creating the first instance here makes a name clash with another recorder fail now.
+    HANDLE first = CreatePipeInstance(ToWideAscii(endpoint), true);
+    if (first == INVALID_HANDLE_VALUE) {
+        CloseHandle(static_cast<HANDLE>(stopEvent_));
+        stopEvent_ = nullptr;
+        throw std::runtime_error("无法创建控制管道 " + endpoint);
+    }
+    firstPipe_ = first;
+    acceptThread_ = std::thread([this]() { AcceptLoop(); });
+#else
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (endpoint.size() >= sizeof(address.sun_path)) {
+        throw std::runtime_error("控制套接字路径过长：" + endpoint);
+    }
+    std::memcpy(address.sun_path, endpoint.c_str(), endpoint.size() + 1);
+
+    const int socketHandle = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (socketHandle < 0) {
+        throw std::runtime_error("创建控制套接字失败");
+    }
+    // A leftover socket file from a crashed run is replaced; a live one is not.
+    if (connect(socketHandle, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == 0) {
+        close(socketHandle);
+        throw std::runtime_error("控制套接字已被其他进程使用：" + endpoint);
+    }
+    close(socketHandle);
+    unlink(endpoint.c_str());
+
+    listenSocket_ = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listenSocket_ < 0) {
+        throw std::runtime_error("创建控制套接字失败");
+    }
+    if (bind(listenSocket_, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0 ||
+        listen(listenSocket_, 8) != 0) {
+        close(listenSocket_);
+        listenSocket_ = -1;
+        throw std::runtime_error("无法监听控制套接字 " + endpoint);
+    }
+    chmod(endpoint.c_str(), S_IRUSR | S_IWUSR);
+    acceptThread_ = std::thread([this]() { AcceptLoop(); });
+#endif
+    logger_.Info(L"[控制] 控制端点：" + ToWideAscii(endpoint));
+}
+
+void ControlServer::Stop() {
+    if (stopping_.exchange(true)) {
+        return;
+    }
+#if defined(_WIN32)
+    if (stopEvent_) {
+        SetEvent(static_cast<HANDLE>(stopEvent_));
+    }
+#endif
+    if (acceptThread_.joinable()) {
+        acceptThread_.join();
+    }
+    std::vector<ClientThread> clients;
+    {
+        std::lock_guard<std::mutex> lock(clientsMutex_);
+        clients.swap(clients_);
+    }
+    for (auto& client : clients) {
+        if (client.thread.joinable()) {
+            client.thread.join();
+        }
+    }
+#if defined(_WIN32)
+    if (stopEvent_) {
+        CloseHandle(static_cast<HANDLE>(stopEvent_));
+        stopEvent_ = nullptr;
+    }
+#else
+    if (listenSocket_ >= 0) {
+        close(listenSocket_);
+        listenSocket_ = -1;
+        unlink(Endpoint().c_str());
+    }
+#endif
+}
+
+void ControlServer::AcceptLoop() {
+    auto spawn = [this](std::unique_ptr<ControlConnection> connection) {
+        std::lock_guard<std::mutex> lock(clientsMutex_);
+        // Reap clients that have hung up before admitting another one.
+        for (auto it = clients_.begin(); it != clients_.end();) {
+            if (it->finished->load(std::memory_order_acquire)) {
+                it->thread.join();
+                it = clients_.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        if (clients_.size() >= kMaxClients) {
+            connection->WriteAll(R"({"ok":false,"error":"too many control clients"})" "\n");
+            return;
+        }
+        auto finished = std::make_shared<std::atomic<bool>>(false);
+        ClientThread client;
+        client.finished = finished;
+        client.thread = std::thread([this, finished, connection = std::move(connection)]() mutable {
+            ServeClient(*connection);
+            connection.reset();
+            finished->store(true, std::memory_order_release);
+        });
+        clients_.push_back(std::move(client));
+    };
+
+#if defined(_WIN32)
+    const std::wstring path = ToWideAscii(Endpoint());
+    const HANDLE stopEvent = static_cast<HANDLE>(stopEvent_);
+    HANDLE connectEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+    HANDLE pipe = static_cast<HANDLE>(firstPipe_);
+    firstPipe_ = nullptr;
+    while (!stopping_.load(std::memory_order_acquire) && connectEvent) {
+        if (pipe == INVALID_HANDLE_VALUE || pipe == nullptr) {
+            pipe = CreatePipeInstance(path, false);
+            if (pipe == INVALID_HANDLE_VALUE) {
+                logger_.Warn(L"[控制] 创建管道实例失败；稍后重试。");
+                if (WaitForSingleObject(stopEvent, 1000) == WAIT_OBJECT_0) {
+                    break;
+                }
+                continue;
+            }
+        }
+        OVERLAPPED overlapped{};
+        overlapped.hEvent = connectEvent;
+        ResetEvent(connectEvent);
+        bool connected = ConnectNamedPipe(pipe, &overlapped) != FALSE;
+        if (!connected) {
+            const DWORD error = GetLastError();
+            if (error == ERROR_PIPE_CONNECTED) {
+                connected = true;
+            } else if (error == ERROR_IO_PENDING) {
+                HANDLE waits[2] = { connectEvent, stopEvent };
+                if (WaitForMultipleObjects(2, waits, FALSE, INFINITE) == WAIT_OBJECT_0) {
+                    DWORD ignored = 0;
+                    connected = GetOverlappedResult(pipe, &overlapped, &ignored, FALSE) != FALSE;
+                } else {
+                    CancelIo(pipe);
+                    DWORD ignored = 0;
+                    GetOverlappedResult(pipe, &overlapped, &ignored, TRUE);
+                }
+            }
+        }
+        if (!connected) {
+            CloseHandle(pipe);
+            pipe = nullptr;
+            continue;
+        }
+        spawn(std::make_unique<ControlConnection>(pipe, stopEvent));
+        pipe = nullptr;
+    }
+    if (pipe && pipe != INVALID_HANDLE_VALUE) {
+        CloseHandle(pipe);
+    }
+    if (connectEvent) {
+        CloseHandle(connectEvent);
+    }
+#else
+    while (!stopping_.load(std::memory_order_acquire)) {
+        pollfd descriptor{listenSocket_, POLLIN, 0};
+        if (poll(&descriptor, 1, static_cast<int>(kPollSlice.count())) <= 0) {
+            continue;
+        }
+        const int client = accept(listenSocket_, nullptr, nullptr);
+        if (client < 0) {
+            continue;
+        }
+        spawn(std::make_unique<ControlConnection>(client));
+    }
+#endif
+}
+
+void ControlServer::ServeClient(ControlConnection& connection) {
+    std::string pending;
+    char buffer[1024];
+    while (!stopping_.load(std::memory_order_acquire)) {
+        const int received = connection.Read(buffer, sizeof(buffer));
+        if (received < 0) {
+            return;
+        }
+        pending.append(buffer, static_cast<size_t>(received));
+        size_t lineEnd;
+        while ((lineEnd = pending.find('\n')) != std::string::npos) {
+            std::string line = pending.substr(0, lineEnd);
+            pending.erase(0, lineEnd + 1);
+            if (!line.empty() && line.back() == '\r') {
+                line.pop_back();
+            }
+            if (line.empty()) {
+                continue;
+            }
+            if (!connection.WriteAll(HandleRequest(line) + "\n")) {
+                return;
+            }
+        }
+        if (pending.size() > kMaxRequestBytes) {
+            connection.WriteAll(R"({"ok":false,"error":"request too long"})" "\n");
+            return;
+        }
+    }
+}
+
+std::string ControlServer::HandleRequest(const std::string& line) {
+    JsonObjectBuilder response;
+    const auto request = ParseJsonObject(line);
+    if (!request) {
+        return response.Add("ok", false).Add("error", "invalid JSON").Str();
+    }
+    AddRequestId(response, *request);
+    const auto name = JsonGetString(*request, "cmd");
+    const auto type = name ? ParseCommandType(*name) : std::nullopt;
+    if (!type) {
+        return response.Add("ok", false).Add("error", "unknown command").Str();
+    }
+    response.Add("cmd", *name);
+
+    auto command = std::make_shared<ControlCommand>();
+    command->type = *type;
+    command->label = JsonGetString(*request, "label").value_or("");
+    if (*type == ControlCommandType::Configure) {
+        const std::string error = ParseConfigureFields(*request, *command);
+        if (!error.empty()) {
+            return response.Add("ok", false).Add("error", error).Str();
+        }
+    }
+
+    const bool active = queue_.ConsumerActive();
+    if (*type == ControlCommandType::Stop) {
+        queue_.RequestStop();
+    }
+    if (!active) {
+        // No pipeline is running, so there is no frame position to apply anything at.
+        switch (*type) {
+        case ControlCommandType::Start:
+            if (!options_.onStart || !options_.onStart()) {
+                return response.Add("ok", false).Add("error", "start is not available").Str();
+            }
+            logger_.Info(L"[控制] 收到开始命令。");
+            return response.Add("ok", true).Add("state", "starting").Str();
+        case ControlCommandType::Stop:
+            logger_.Info(L"[控制] 收到停止命令。");
+            return response.Add("ok", true).Add("state", "stopped").Str();
+        case ControlCommandType::Status:
+            return response.Add("ok", true).Add("state", "idle").Str();
+        default:
+            return response.Add("ok", false).Add("error", "not recording").Str();
+        }
+    }
+    if (*type == ControlCommandType::Start) {
+        return response.Add("ok", false).Add("error", "already recording").Str();
+    }
+
+    command->enqueuedAt = std::chrono::steady_clock::now();
+    if (!queue_.Push(command)) {
+        return response.Add("ok", false).Add("error", "command queue full").Str();
+    }
+    // The capture thread applies commands once per wakeup (one device period).
+    const auto deadline = command->enqueuedAt + kControlCommandTimeout;
+    while (!command->Completed()) {
+        if (std::chrono::steady_clock::now() >= deadline) {
+            return response.Add("ok", false).Add("error", "timed out waiting for the recorder").Str();
+        }
+        std::this_thread::sleep_for(kCompletionPoll);
+    }
+    if (!command->ok) {
+        return response.Add("ok", false).Add("error", command->error).Add("frame", command->framePosition).Str();
+    }
+    response.Add("ok", true).Add("frame", command->framePosition).Add("state", command->state);
+    if (*type == ControlCommandType::Segment || *type == ControlCommandType::Status ||
+        *type == ControlCommandType::Configure) {
+        response.Add("segment", command->segment);
+    }
+    if (*type == ControlCommandType::Status) {
+        response.Add("dropped_frames", command->droppedFrames).Add("ring_bytes", command->ringBytes);
+    }
+    return response.Str();
+}
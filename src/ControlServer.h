@@ -0,0 +1,146 @@
+#pragma once
+
+#include "Logger.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+enum class ControlCommandType {
+    Start,
+    Stop,
+    Pause,
+    Resume,
+    Segment,
+    Marker,
+    Status,
+    Configure,
+};
+
+// One request from a control client. The client thread fills the request half, hands the
+// command to the pipeline through ControlCommandQueue and polls Completed(); whoever applies
+// it fills the result half first. Shared ownership lets a client give up after a timeout
+// while the command is still queued.
+struct ControlCommand {
+    ControlCommandType type = ControlCommandType::Status;
+    std::string label;                                   // Marker
+    // Configure: empty fields keep their value; a zero segment limit turns that limit off.
+    std::optional<uint32_t> mp3BitrateKbps;
+    std::optional<uint64_t> segmentSeconds;
+    std::optional<uint64_t> segmentBytes;
+    std::optional<double> gainDb;
+    bool applyNow = false;                               // roll to a new segment right away
+    std::chrono::steady_clock::time_point enqueuedAt{};
+
+    bool ok = true;
+    std::string error;
+    std::string state;                                   // "recording", "paused", ...
+    uint64_t framePosition = 0;                          // capture frame at which it took effect
+    uint32_t segment = 0;
+    uint64_t droppedFrames = 0;
+    uint64_t ringBytes = 0;
+
+    void Complete() { completed_.store(true, std::memory_order_release); }
+    bool Completed() const { return completed_.load(std::memory_order_acquire); }
+    void Fail(std::string message) {
+        ok = false;
+        error = std::move(message);
+        Complete();
+    }
+
+private:
+    std::atomic<bool> completed_{false};
+};
+
+// Bounded MPSC queue of commands from client threads to the capture thread (the same
+// sequence-number scheme as Logger). Push never blocks; Pop is for the single consumer.
+class ControlCommandQueue {
+public:
+    static constexpr size_t kCapacity = 64;   // power of two
+
+    ControlCommandQueue();
+
+    bool Push(std::shared_ptr<ControlCommand> command);
+    std::shared_ptr<ControlCommand> Pop();
+
+    // Set by LoopbackRecorder::Record while it consumes the queue.
+    void SetConsumerActive(bool active) { consumerActive_.store(active, std::memory_order_release); }
+    bool ConsumerActive() const { return consumerActive_.load(std::memory_order_acquire); }
+    // Latched by any "stop" so the owner does not reconnect or keep waiting for "start".
+    void RequestStop() { stopRequested_.store(true, std::memory_order_release); }
+    bool StopRequested() const { return stopRequested_.load(std::memory_order_acquire); }
+
+private:
+    struct Slot {
+        std::atomic<size_t> sequence{0};
+        std::shared_ptr<ControlCommand> command;
+    };
+
+    std::array<Slot, kCapacity> slots_;
+    alignas(64) std::atomic<size_t> enqueuePos_{0};
+    alignas(64) size_t dequeuePos_ = 0;
+    std::atomic<bool> consumerActive_{false};
+    std::atomic<bool> stopRequested_{false};
+};
+
+// Commands older than this are answered with an error instead of being applied late.
+constexpr auto kControlCommandTimeout = std::chrono::milliseconds(2000);
+
+class ControlConnection;
+
+struct ControlServerOptions {
+    std::string name;                        // pipe name (Windows) or socket name/path (Linux)
+    std::function<bool()> onStart;           // "start" while idle; false = refused
+};
+
+// Local control endpoint speaking JSON lines: \\.\pipe\<name> on Windows, a Unix domain
+// socket on Linux (<name> if it contains '/', else /tmp/<name>.sock). Requests look like
+// {"id":7,"cmd":"marker","label":"take 2"}; every request gets one response line with
+// "ok", the applied "frame" and either the result fields or "error". Each client is served
+// by its own thread; nothing here runs on the audio threads.
+class ControlServer {
+public:
+    ControlServer(ControlCommandQueue& queue, ControlServerOptions options, Logger& logger);
+    ~ControlServer();
+
+    ControlServer(const ControlServer&) = delete;
+    ControlServer& operator=(const ControlServer&) = delete;
+
+    void Start();
+    void Stop();
+    std::string Endpoint() const;
+
+    // Parses one request line and produces the response line (without newline).
+    std::string HandleRequest(const std::string& line);
+
+private:
+    struct ClientThread {
+        std::thread thread;
+        std::shared_ptr<std::atomic<bool>> finished;
+    };
+
+    void AcceptLoop();
+    void ServeClient(ControlConnection& connection);
+
+    ControlCommandQueue& queue_;
+    const ControlServerOptions options_;
+    Logger& logger_;
+    std::atomic<bool> stopping_{false};
+    std::thread acceptThread_;
+    std::mutex clientsMutex_;
+    std::vector<ClientThread> clients_;
+    void* stopEvent_ = nullptr;   // Windows: wakes blocked pipe waits
+    void* firstPipe_ = nullptr;   // Windows: instance created by Start()
+    int listenSocket_ = -1;       // Linux
+};
+
+std::string DefaultControlName();
@@ -0,0 +1,167 @@
+#include "DiskSpaceGuard.h"
+
+#include <algorithm>
+#include <string>
+#include <system_error>
+
+namespace {
+
+std::optional<uint64_t> QueryAvailableBytes(const std::filesystem::path& directory) {
+    std::error_code ec;
+    const auto info = std::filesystem::space(directory, ec);
+    if (ec) {
+        return std::nullopt;
+    }
+    return static_cast<uint64_t>(info.available);
+}
+
+std::wstring FormatMiB(uint64_t bytes) {
+    return std::to_wstring(bytes / (1024 * 1024)) + L" MiB";
+}
+
+std::wstring FormatMinutes(double seconds) {
+    return std::to_wstring(static_cast<int64_t>(seconds / 60.0)) + L" 分钟";
+}
+
+} // namespace
+
+DiskSpaceGuard::DiskSpaceGuard(DiskGuardPolicy policy,
+                               std::filesystem::path directory,
+                               const std::atomic<uint64_t>& fileBytesWritten,
+                               bool canReduceBitrate,
+                               Logger& logger,
+                               FreeSpaceProbe probe)
+    : policy_(std::move(policy)),
+      fileBytesWritten_(fileBytesWritten),
+      canReduceBitrate_(canReduceBitrate),
+      logger_(logger),
+      probe_(probe ? std::move(probe) : FreeSpaceProbe(QueryAvailableBytes)),
+      directory_(directory.empty() ? std::filesystem::path(L".") : std::move(directory)) {}
+
+DiskSpaceGuard::~DiskSpaceGuard() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    if (worker_.joinable()) {
+        worker_.join();
+    }
+}
+
+void DiskSpaceGuard::Start() {
+    worker_ = std::thread([this]() { Run(); });
+}
+
+void DiskSpaceGuard::Run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stopping_) {
+        lock.unlock();
+        Evaluate(std::chrono::steady_clock::now());
+        lock.lock();
+        wake_.wait_for(lock, policy_.pollInterval, [this]() { return stopping_; });
+    }
+}
+
+std::optional<uint32_t> DiskSpaceGuard::BitrateOverride() const {
+    const uint32_t kbps = bitrateOverride_.load(std::memory_order_acquire);
+    return kbps ? std::optional<uint32_t>(kbps) : std::nullopt;
+}
+
+std::optional<std::filesystem::path> DiskSpaceGuard::FallbackDirectory() const {
+    std::lock_guard<std::mutex> lock(fallbackMutex_);
+    return activeFallback_;
+}
+
+void DiskSpaceGuard::Evaluate(std::chrono::steady_clock::time_point now) {
+    const auto freeBytes = probe_(directory_);
+    if (!freeBytes) {
+        if (!probeFailureLogged_) {
+            logger_.Warn(L"[磁盘] 无法查询可用空间：" + directory_.wstring());
+            probeFailureLogged_ = true;
+        }
+        return;
+    }
+    const uint64_t bytes = fileBytesWritten_.load(std::memory_order_relaxed);
+    const uint64_t usable = *freeBytes > policy_.reserveBytes ? *freeBytes - policy_.reserveBytes : 0;
+    if (!haveSample_) {
+        haveSample_ = true;
+        lastSampleTime_ = now;
+        lastBytes_ = bytes;
+        lastFree_ = *freeBytes;
+        if (usable == 0) {
+            Escalate(now, usable);
+        }
+        return;
+    }
+
+    const double elapsed = std::chrono::duration<double>(now - lastSampleTime_).count();
+    if (elapsed <= 0.0) {
+        return;
+    }
+    const double outputRate = static_cast<double>(bytes - lastBytes_) / elapsed;
+    const double freeDropRate = lastFree_ > *freeBytes ? static_cast<double>(lastFree_ - *freeBytes) / elapsed : 0.0;
+    const double rate = std::max(outputRate, freeDropRate);
+    bytesPerSecond_ = bytesPerSecond_ == 0.0 ? rate : 0.7 * bytesPerSecond_ + 0.3 * rate;
+    lastSampleTime_ = now;
+    lastBytes_ = bytes;
+    lastFree_ = *freeBytes;
+
+    if (bytesPerSecond_ <= 0.0) {
+        timeToFullSeconds_.store(-1, std::memory_order_relaxed);
+        if (usable == 0) {
+            Escalate(now, usable);
+        }
+        return;
+    }
+    const double timeToFull = static_cast<double>(usable) / bytesPerSecond_;
+    timeToFullSeconds_.store(static_cast<int64_t>(timeToFull), std::memory_order_relaxed);
+
+    if (usable == 0 || timeToFull < static_cast<double>(policy_.actHorizon.count())) {
+        Escalate(now, usable);
+    } else if (timeToFull < static_cast<double>(policy_.warnHorizon.count()) &&
+               stage_.load(std::memory_order_relaxed) == DiskGuardStage::Normal) {
+        stage_.store(DiskGuardStage::Warned, std::memory_order_release);
+        logger_.Warn(L"[磁盘] 按当前写入速度约 " + FormatMinutes(timeToFull) + L"后写满（可用 " +
+                     FormatMiB(usable) + L"，预留 " + FormatMiB(policy_.reserveBytes) + L"）：" + directory_.wstring());
+    }
+}
+
+void DiskSpaceGuard::Escalate(std::chrono::steady_clock::time_point now, uint64_t usableBytes) {
+    // Give the previous step a few polls to show its effect on the measured rate.
+    if (now < nextEscalation_) {
+        return;
+    }
+    nextEscalation_ = now + policy_.pollInterval * 12;
+    const DiskGuardStage stage = stage_.load(std::memory_order_relaxed);
+
+    if (stage < DiskGuardStage::ReducedBitrate && canReduceBitrate_ && policy_.fallbackBitrateKbps) {
+        bitrateOverride_.store(*policy_.fallbackBitrateKbps, std::memory_order_release);
+        stage_.store(DiskGuardStage::ReducedBitrate, std::memory_order_release);
+        rollRequested_.store(true, std::memory_order_release);
+        logger_.Warn(L"[磁盘] 空间即将耗尽（可用 " + FormatMiB(usableBytes) + L"），下一分段起降低比特率至 " +
+                     std::to_wstring(*policy_.fallbackBitrateKbps) + L" kbps。");
+        return;
+    }
+    if (stage < DiskGuardStage::Fallback && policy_.fallbackDirectory) {
+        std::error_code ec;
+        std::filesystem::create_directories(*policy_.fallbackDirectory, ec);
+        {
+            std::lock_guard<std::mutex> lock(fallbackMutex_);
+            activeFallback_ = *policy_.fallbackDirectory;
+        }
+        directory_ = *policy_.fallbackDirectory;
+        haveSample_ = false; // free space of the new volume starts a fresh projection
+        bytesPerSecond_ = 0.0;
+        stage_.store(DiskGuardStage::Fallback, std::memory_order_release);
+        rollRequested_.store(true, std::memory_order_release);
+        logger_.Warn(L"[磁盘] 空间即将耗尽（可用 " + FormatMiB(usableBytes) + L"），后续分段改写到备用目录：" +
+                     policy_.fallbackDirectory->wstring());
+        return;
+    }
+    if (stage != DiskGuardStage::Exhausted) {
+        stage_.store(DiskGuardStage::Exhausted, std::memory_order_release);
+        logger_.Error(L"[磁盘] 空间即将耗尽（可用 " + FormatMiB(usableBytes) + L"）且没有更多回退手段：" +
+                      directory_.wstring());
+    }
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include "Logger.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <thread>
+
+struct DiskGuardPolicy {
+    std::chrono::seconds warnHorizon{3600};     // warn once the projected time-to-full drops below this
+    std::chrono::seconds actHorizon{600};       // below this, take the next fallback step
+    uint64_t reserveBytes = 256ull * 1024 * 1024; // space treated as already full
+    std::optional<uint32_t> fallbackBitrateKbps = 96; // step 1 (MP3 output only)
+    std::optional<std::filesystem::path> fallbackDirectory; // step 2
+    std::chrono::milliseconds pollInterval{5000};
+};
+
+enum class DiskGuardStage {
+    Normal,
+    Warned,
+    ReducedBitrate,
+    Fallback,
+    Exhausted,
+};
+
+// Watches free space of the output volume on its own thread and projects time-to-full from
+// the bytes the recorder put in its files (encoded, so MP3 counts at its bitrate) and the
+// observed drop in free space (other writers count too).
+// Decisions are published through atomics and applied by the writer thread when it opens the
+// next segment, so the write path never waits on a filesystem query.
+class DiskSpaceGuard {
+public:
+    // Returns available bytes for the volume holding `directory`, or nullopt if unknown.
+    using FreeSpaceProbe = std::function<std::optional<uint64_t>(const std::filesystem::path& directory)>;
+
+    DiskSpaceGuard(DiskGuardPolicy policy,
+                   std::filesystem::path directory,
+                   const std::atomic<uint64_t>& fileBytesWritten,
+                   bool canReduceBitrate,
+                   Logger& logger,
+                   FreeSpaceProbe probe = {});
+    ~DiskSpaceGuard();
+
+    DiskSpaceGuard(const DiskSpaceGuard&) = delete;
+    DiskSpaceGuard& operator=(const DiskSpaceGuard&) = delete;
+
+    // Starts the polling thread. Without it, Evaluate() can be driven by the caller.
+    void Start();
+    void Evaluate(std::chrono::steady_clock::time_point now);
+
+    // Writer thread: true once per decision that needs a new segment.
+    bool ConsumeRollRequest() {
+        return rollRequested_.load(std::memory_order_relaxed) && rollRequested_.exchange(false, std::memory_order_acq_rel);
+    }
+    std::optional<uint32_t> BitrateOverride() const;
+    std::optional<std::filesystem::path> FallbackDirectory() const;
+    DiskGuardStage Stage() const { return stage_.load(std::memory_order_acquire); }
+    // Seconds until the reserve is reached at the current rate; negative when unknown.
+    int64_t TimeToFullSeconds() const { return timeToFullSeconds_.load(std::memory_order_relaxed); }
+
+private:
+    void Run();
+    void Escalate(std::chrono::steady_clock::time_point now, uint64_t usableBytes);
+
+    const DiskGuardPolicy policy_;
+    const std::atomic<uint64_t>& fileBytesWritten_;
+    const bool canReduceBitrate_;
+    Logger& logger_;
+    FreeSpaceProbe probe_;
+
+    // Evaluate() state, only touched by the evaluating thread.
+    std::filesystem::path directory_;
+    bool haveSample_ = false;
+    std::chrono::steady_clock::time_point lastSampleTime_{};
+    uint64_t lastBytes_ = 0;
+    uint64_t lastFree_ = 0;
+    double bytesPerSecond_ = 0.0;
+    std::chrono::steady_clock::time_point nextEscalation_{};
+    bool probeFailureLogged_ = false;
+
+    std::atomic<DiskGuardStage> stage_{DiskGuardStage::Normal};
+    std::atomic<bool> rollRequested_{false};
+    std::atomic<uint32_t> bitrateOverride_{0};
+    std::atomic<int64_t> timeToFullSeconds_{-1};
+    mutable std::mutex fallbackMutex_;
+    std::optional<std::filesystem::path> activeFallback_;
+
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    bool stopping_ = false;
+    std::thread worker_;
+};
@@ -0,0 +1,569 @@
+#include "EventLog.h"
+
+#include "JsonLines.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr char kMagic[8] = {'L', 'R', 'E', 'V', 'E', 'N', 'T', 'S'};
+constexpr uint32_t kVersion = 1;
+constexpr size_t kFileHeaderSize = 16;
+constexpr size_t kRecordHeaderSize = 16;   // type u16, payload size u16, sequence u32, unix micros i64
+constexpr auto kIdleWait = std::chrono::milliseconds(200);
+constexpr size_t kMaxBatch = 128;
+
+template <typename T>
+void PutValue(unsigned char*& cursor, T value) {
+    std::memcpy(cursor, &value, sizeof(T));
+    cursor += sizeof(T);
+}
+
+template <typename T>
+T GetValue(const unsigned char*& cursor) {
+    T value{};
+    std::memcpy(&value, cursor, sizeof(T));
+    cursor += sizeof(T);
+    return value;
+}
+
+// u16 length + bytes, truncated so the record fits its slot.
+void PutString(unsigned char*& cursor, const unsigned char* slotEnd, std::string_view text) {
+    const size_t room = static_cast<size_t>(slotEnd - cursor) - sizeof(uint16_t);
+    const auto length = static_cast<uint16_t>(std::min(text.size(), room));
+    PutValue(cursor, length);
+    std::memcpy(cursor, text.data(), length);
+    cursor += length;
+}
+
+std::string FormatUtcMicros(int64_t micros) {
+    const std::time_t seconds = static_cast<std::time_t>(micros / 1000000);
+    std::tm tm{};
+#if defined(_WIN32)
+    gmtime_s(&tm, &seconds);
+#else
+    gmtime_r(&seconds, &tm);
+#endif
+    char buffer[64];
+    std::snprintf(buffer, sizeof(buffer), "%04d-%02d-%02dT%02d:%02d:%02d.%06dZ",
+                  tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec,
+                  static_cast<int>(micros % 1000000));
+    return buffer;
+}
+
+// Offset just past the last complete record; a crash can leave a partial one at the end.
+uint64_t CompleteRecordsEnd(std::ifstream& file, uint64_t fileBytes) {
+    uint64_t offset = kFileHeaderSize;
+    while (offset + kRecordHeaderSize <= fileBytes) {
+        unsigned char recordHeader[kRecordHeaderSize];
+        file.seekg(static_cast<std::streamoff>(offset));
+        file.read(reinterpret_cast<char*>(recordHeader), sizeof(recordHeader));
+        if (!file) {
+            break;
+        }
+        const unsigned char* cursor = recordHeader + sizeof(uint16_t);
+        const auto payloadBytes = GetValue<uint16_t>(cursor);
+        if (offset + kRecordHeaderSize + payloadBytes > fileBytes) {
+            break;
+        }
+        offset += kRecordHeaderSize + payloadBytes;
+    }
+    return std::min(offset, fileBytes);
+}
+
+// Decodes the payload of one record; false when it is shorter than its type requires.
+bool AppendPayload(JsonObjectBuilder& json, RecorderEventType type, const unsigned char* payload, size_t size) {
+    const unsigned char* cursor = payload;
+    const unsigned char* end = payload + size;
+    auto has = [&](size_t bytes) { return static_cast<size_t>(end - cursor) >= bytes; };
+    auto getString = [&](std::string& text) {
+        if (!has(sizeof(uint16_t))) {
+            return false;
+        }
+        const auto length = GetValue<uint16_t>(cursor);
+        if (!has(length)) {
+            return false;
+        }
+        text.assign(reinterpret_cast<const char*>(cursor), length);
+        cursor += length;
+        return true;
+    };
+
+    switch (type) {
+    case RecorderEventType::SessionStart: {
+        if (!has(12)) {
+            return false;
+        }
+        json.Add("sample_rate", GetValue<uint32_t>(cursor));
+        json.Add("channels", static_cast<uint32_t>(GetValue<uint16_t>(cursor)));
+        json.Add("bits_per_sample", static_cast<uint32_t>(GetValue<uint16_t>(cursor)));
+        json.Add("float", (GetValue<uint32_t>(cursor) & 1u) != 0);
+        std::string path;
+        if (!getString(path)) {
+            return false;
+        }
+        json.Add("output", path);
+        return true;
+    }
+    case RecorderEventType::SessionEnd:
+        if (!has(48)) {
+            return false;
+        }
+        json.Add("frames_captured", GetValue<uint64_t>(cursor));
+        json.Add("silent_frames", GetValue<uint64_t>(cursor));
+        json.Add("paused_frames", GetValue<uint64_t>(cursor));
+        json.Add("dropped_frames", GetValue<uint64_t>(cursor));
+        json.Add("glitches", GetValue<uint32_t>(cursor));
+        json.Add("watchdog_timeouts", GetValue<uint32_t>(cursor));
+        json.Add("segments", GetValue<uint32_t>(cursor));
+        json.Add("device_invalidated", (GetValue<uint32_t>(cursor) & 1u) != 0);
+        return true;
+    case RecorderEventType::SegmentOpen: {
+        if (!has(16)) {
+            return false;
+        }
+        json.Add("segment", GetValue<uint32_t>(cursor));
+        cursor += sizeof(uint32_t);
+        json.Add("start_frame", GetValue<uint64_t>(cursor));
+        std::string name;
+        if (!getString(name)) {
+            return false;
+        }
+        json.Add("file", name);
+        return true;
+    }
+    case RecorderEventType::SegmentClose:
+        if (!has(40)) {
+            return false;
+        }
+        json.Add("segment", GetValue<uint32_t>(cursor));
+        json.Add("gaps", GetValue<uint32_t>(cursor));
+        json.Add("start_frame", GetValue<uint64_t>(cursor));
+        json.Add("end_frame", GetValue<uint64_t>(cursor));
+        json.Add("bytes", GetValue<uint64_t>(cursor));
+        json.Add("dropped_frames", GetValue<uint64_t>(cursor));
+        return true;
+    case RecorderEventType::FramesDropped:
+        if (!has(16)) {
+            return false;
+        }
+        json.Add("at_frame", GetValue<uint64_t>(cursor));
+        json.Add("frames", GetValue<uint64_t>(cursor));
+        return true;
+    case RecorderEventType::Gap:
+        if (!has(8)) {
+            return false;
+        }
+        json.Add("at_frame", GetValue<uint64_t>(cursor));
+        return true;
+    case RecorderEventType::WatchdogTimeout:
+        if (!has(12)) {
+            return false;
+        }
+        json.Add("at_frame", GetValue<uint64_t>(cursor));
+        json.Add("timeout_ms", GetValue<uint32_t>(cursor));
+        return true;
+    case RecorderEventType::Reconnect:
+        if (!has(8)) {
+            return false;
+        }
+        json.Add("attempt", GetValue<uint32_t>(cursor));
+        json.Add("delay_ms", GetValue<uint32_t>(cursor));
+        return true;
+    case RecorderEventType::Levels: {
+        if (!has(10)) {
+            return false;
+        }
+        json.Add("at_frame", GetValue<uint64_t>(cursor));
+        const auto channels = GetValue<uint16_t>(cursor);
+        if (channels > EventLogWriter::kMaxLevelChannels || !has(channels * 2 * sizeof(float))) {
+            return false;
+        }
+        json.Add("channels", static_cast<uint32_t>(channels));
+        for (uint16_t channel = 0; channel < channels; ++channel) {
+            const auto peak = GetValue<float>(cursor);
+            const auto rms = GetValue<float>(cursor);
+            json.Add("peak_dbfs_" + std::to_string(channel), static_cast<double>(peak));
+            json.Add("rms_dbfs_" + std::to_string(channel), static_cast<double>(rms));
+        }
+        return true;
+    }
+    case RecorderEventType::Marker: {
+        if (!has(8)) {
+            return false;
+        }
+        json.Add("at_frame", GetValue<uint64_t>(cursor));
+        std::string label;
+        if (!getString(label)) {
+            return false;
+        }
+        json.Add("label", label);
+        return true;
+    }
+    }
+    return true;   // unknown type: header fields only
+}
+
+} // namespace
+
+EventLogWriter::EventLogWriter(const std::filesystem::path& path)
+    : slots_(std::make_unique<Slot[]>(kQueueCapacity)) {
+    if (path.has_parent_path() && !path.parent_path().empty()) {
+        std::filesystem::create_directories(path.parent_path());
+    }
+    std::error_code ec;
+    uint64_t existingBytes = std::filesystem::exists(path, ec) ? std::filesystem::file_size(path, ec) : 0;
+    if (existingBytes > 0) {
+        std::ifstream existing(path, std::ios::binary);
+        char magic[sizeof(kMagic)] = {};
+        existing.read(magic, sizeof(magic));
+        const auto magicBytes = static_cast<size_t>(existing.gcount());
+        if (std::memcmp(magic, kMagic, magicBytes) != 0) {
+            throw std::runtime_error("不是事件日志文件，拒绝追加：" + path.string());
+        }
+        existing.clear();
+        // A file header cut short by a crash is rewritten.
+        const uint64_t validBytes = existingBytes < kFileHeaderSize ? 0 : CompleteRecordsEnd(existing, existingBytes);
+        existing.close();
+        if (validBytes < existingBytes) {
+            std::filesystem::resize_file(path, validBytes);
+            existingBytes = validBytes;
+        }
+    }
+    file_.open(path, std::ios::binary | std::ios::app);
+    if (!file_) {
+        throw std::runtime_error("无法打开事件日志：" + path.string());
+    }
+    if (existingBytes == 0) {
+        unsigned char header[kFileHeaderSize] = {};
+        unsigned char* cursor = header;
+        std::memcpy(cursor, kMagic, sizeof(kMagic));
+        cursor += sizeof(kMagic);
+        PutValue(cursor, kVersion);
+        PutValue(cursor, uint32_t{0});
+        file_.write(reinterpret_cast<const char*>(header), sizeof(header));
+        file_.flush();
+    }
+    for (size_t i = 0; i < kQueueCapacity; ++i) {
+        slots_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    worker_ = std::thread([this]() { Run(); });
+}
+
+EventLogWriter::~EventLogWriter() {
+    {
+        std::lock_guard<std::mutex> lock(wakeMutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    if (worker_.joinable()) {
+        worker_.join();
+    }
+}
+
+EventLogWriter::Slot* EventLogWriter::Begin(RecorderEventType type, size_t& position) {
+    // Same bounded MPSC scheme as Logger: a slot is free for position p when its sequence is p.
+    size_t pos = enqueuePos_.load(std::memory_order_relaxed);
+    Slot* slot = nullptr;
+    while (true) {
+        slot = &slots_[pos & (kQueueCapacity - 1)];
+        const size_t sequence = slot->sequence.load(std::memory_order_acquire);
+        const auto diff = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(pos);
+        if (diff == 0) {
+            if (enqueuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        } else {
+            pos = enqueuePos_.load(std::memory_order_relaxed);
+        }
+    }
+    position = pos;
+    unsigned char* cursor = slot->bytes;
+    PutValue(cursor, static_cast<uint16_t>(type));
+    PutValue(cursor, uint16_t{0});   // payload size, patched in Commit()
+    PutValue(cursor, static_cast<uint32_t>(pos));   // queue position: unique and ordered per writer
+    PutValue(cursor, static_cast<int64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count()));
+    return slot;
+}
+
+void EventLogWriter::Commit(Slot* slot, size_t position, unsigned char* end, bool urgent) {
+    slot->length = static_cast<uint16_t>(end - slot->bytes);
+    const auto payloadBytes = static_cast<uint16_t>(slot->length - kRecordHeaderSize);
+    std::memcpy(slot->bytes + sizeof(uint16_t), &payloadBytes, sizeof(payloadBytes));
+    slot->sequence.store(position + 1, std::memory_order_release);
+    // Bursts (e.g. a run of gaps) wake the writer early instead of waiting for the idle tick.
+    if (urgent || position - writtenPos_.load(std::memory_order_relaxed) >= kQueueCapacity / 2) {
+        wake_.notify_one();
+    }
+}
+
+void EventLogWriter::SessionStart(uint32_t sampleRate, uint16_t channels, uint16_t bitsPerSample, bool floatSamples,
+                                  std::string_view outputPathUtf8) {
+    size_t position = 0;
+    Slot* slot = Begin(RecorderEventType::SessionStart, position);
+    if (!slot) {
+        return;
+    }
+    unsigned char* cursor = slot->bytes + kRecordHeaderSize;
+    PutValue(cursor, sampleRate);
+    PutValue(cursor, channels);
+    PutValue(cursor, bitsPerSample);
+    PutValue(cursor, uint32_t{floatSamples ? 1u : 0u});
+    PutString(cursor, slot->bytes + kMaxRecordBytes, outputPathUtf8);
+    Commit(slot, position, cursor);
+}
+
+void EventLogWriter::SessionEnd(const SessionEndCounters& counters) {
+    size_t position = 0;
+    Slot* slot = Begin(RecorderEventType::SessionEnd, position);
+    if (!slot) {
+        return;
+    }
+    unsigned char* cursor = slot->bytes + kRecordHeaderSize;
+    PutValue(cursor, counters.framesCaptured);
+    PutValue(cursor, counters.silentFrames);
+    PutValue(cursor, counters.pausedFrames);
+    PutValue(cursor, counters.droppedFrames);
+    PutValue(cursor, counters.glitches);
+    PutValue(cursor, counters.watchdogTimeouts);
+    PutValue(cursor, counters.segments);
+    PutValue(cursor, uint32_t{counters.deviceInvalidated ? 1u : 0u});
+    Commit(slot, position, cursor, true);
+}
+
+void EventLogWriter::SegmentOpen(uint32_t segmentNumber, uint64_t startFrame, std::string_view fileNameUtf8) {
+    size_t position = 0;
+    Slot* slot = Begin(RecorderEventType::SegmentOpen, position);
+    if (!slot) {
+        return;
+    }
+    unsigned char* cursor = slot->bytes + kRecordHeaderSize;
+    PutValue(cursor, segmentNumber);
+    PutValue(cursor, uint32_t{0});
+    PutValue(cursor, startFrame);
+    PutString(cursor, slot->bytes + kMaxRecordBytes, fileNameUtf8);
+    Commit(slot, position, cursor);
+}
+
+void EventLogWriter::SegmentClose(uint32_t segmentNumber, uint64_t startFrame, uint64_t endFrame, uint64_t fileBytes,
+                                  uint32_t gaps, uint64_t droppedFrames) {
+    size_t position = 0;
+    Slot* slot = Begin(RecorderEventType::SegmentClose, position);
+    if (!slot) {
+        return;
+    }
+    unsigned char* cursor = slot->bytes + kRecordHeaderSize;
+    PutValue(cursor, segmentNumber);
+    PutValue(cursor, gaps);
+    PutValue(cursor, startFrame);
+    PutValue(cursor, endFrame);
+    PutValue(cursor, fileBytes);
+    PutValue(cursor, droppedFrames);
+    Commit(slot, position, cursor);
+}
+
+void EventLogWriter::FramesDropped(uint64_t atFrame, uint64_t frames) {
+    size_t position = 0;
+    Slot* slot = Begin(RecorderEventType::FramesDropped, position);
+    if (!slot) {
+        return;
+    }
+    unsigned char* cursor = slot->bytes + kRecordHeaderSize;
+    PutValue(cursor, atFrame);
+    PutValue(cursor, frames);
+    Commit(slot, position, cursor);
+}
+
+void EventLogWriter::Gap(uint64_t atFrame) {
+    size_t position = 0;
+    Slot* slot = Begin(RecorderEventType::Gap, position);
+    if (!slot) {
+        return;
+    }
+    unsigned char* cursor = slot->bytes + kRecordHeaderSize;
+    PutValue(cursor, atFrame);
+    Commit(slot, position, cursor);
+}
+
+void EventLogWriter::WatchdogTimeout(uint64_t atFrame, uint32_t timeoutMs) {
+    size_t position = 0;
+    Slot* slot = Begin(RecorderEventType::WatchdogTimeout, position);
+    if (!slot) {
+        return;
+    }
+    unsigned char* cursor = slot->bytes + kRecordHeaderSize;
+    PutValue(cursor, atFrame);
+    PutValue(cursor, timeoutMs);
+    Commit(slot, position, cursor);
+}
+
+void EventLogWriter::Reconnect(uint32_t attempt, uint32_t delayMs) {
+    size_t position = 0;
+    Slot* slot = Begin(RecorderEventType::Reconnect, position);
+    if (!slot) {
+        return;
+    }
+    unsigned char* cursor = slot->bytes + kRecordHeaderSize;
+    PutValue(cursor, attempt);
+    PutValue(cursor, delayMs);
+    Commit(slot, position, cursor);
+}
+
+void EventLogWriter::Levels(uint64_t atFrame, uint16_t channels, const float* peakDbfs, const float* rmsDbfs) {
+    size_t position = 0;
+    Slot* slot = Begin(RecorderEventType::Levels, position);
+    if (!slot) {
+        return;
+    }
+    const auto stored = static_cast<uint16_t>(std::min<size_t>(channels, kMaxLevelChannels));
+    unsigned char* cursor = slot->bytes + kRecordHeaderSize;
+    PutValue(cursor, atFrame);
+    PutValue(cursor, stored);
+    for (uint16_t channel = 0; channel < stored; ++channel) {
+        PutValue(cursor, peakDbfs[channel]);
+        PutValue(cursor, rmsDbfs[channel]);
+    }
+    Commit(slot, position, cursor);
+}
+
+void EventLogWriter::Marker(uint64_t atFrame, std::string_view labelUtf8) {
+    size_t position = 0;
+    Slot* slot = Begin(RecorderEventType::Marker, position);
+    if (!slot) {
+        return;
+    }
+    unsigned char* cursor = slot->bytes + kRecordHeaderSize;
+    PutValue(cursor, atFrame);
+    PutString(cursor, slot->bytes + kMaxRecordBytes, labelUtf8);
+    Commit(slot, position, cursor, true);
+}
+
+void EventLogWriter::Flush() {
+    const size_t target = enqueuePos_.load(std::memory_order_acquire);
+    std::unique_lock<std::mutex> lock(wakeMutex_);
+    wake_.notify_one();
+    flushed_.wait(lock, [this, target]() {
+        return stopping_ || writtenPos_.load(std::memory_order_acquire) >= target;
+    });
+}
+
+void EventLogWriter::Run() {
+    std::unique_lock<std::mutex> lock(wakeMutex_);
+    while (true) {
+        const bool stop = stopping_;
+        lock.unlock();
+        while (Drain() > 0) {
+        }
+        lock.lock();
+        flushed_.notify_all();
+        if (stop) {
+            break;
+        }
+        wake_.wait_for(lock, kIdleWait);
+    }
+}
+
+size_t EventLogWriter::Drain() {
+    size_t records = 0;
+    while (records < kMaxBatch) {
+        Slot& slot = slots_[dequeuePos_ & (kQueueCapacity - 1)];
+        if (slot.sequence.load(std::memory_order_acquire) != dequeuePos_ + 1) {
+            break;
+        }
+        file_.write(reinterpret_cast<const char*>(slot.bytes), slot.length);
+        slot.sequence.store(dequeuePos_ + kQueueCapacity, std::memory_order_release);
+        ++dequeuePos_;
+        ++records;
+    }
+    if (records > 0) {
+        file_.flush();
+        writtenPos_.store(dequeuePos_, std::memory_order_release);
+    }
+    return records;
+}
+
+size_t DecodeEventLogToJson(const std::filesystem::path& path, std::ostream& out) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        throw std::runtime_error("无法打开事件日志：" + path.string());
+    }
+    unsigned char header[kFileHeaderSize] = {};
+    file.read(reinterpret_cast<char*>(header), sizeof(header));
+    if (!file || std::memcmp(header, kMagic, sizeof(kMagic)) != 0) {
+        throw std::runtime_error("不是事件日志文件：" + path.string());
+    }
+    const unsigned char* headerCursor = header + sizeof(kMagic);
+    const auto version = GetValue<uint32_t>(headerCursor);
+    if (version != kVersion) {
+        throw std::runtime_error("不支持的事件日志版本：" + std::to_string(version));
+    }
+
+    size_t records = 0;
+    std::vector<unsigned char> payload;
+    while (true) {
+        unsigned char recordHeader[kRecordHeaderSize];
+        file.read(reinterpret_cast<char*>(recordHeader), sizeof(recordHeader));
+        if (file.gcount() != static_cast<std::streamsize>(sizeof(recordHeader))) {
+            break;
+        }
+        const unsigned char* cursor = recordHeader;
+        const auto type = static_cast<RecorderEventType>(GetValue<uint16_t>(cursor));
+        const auto payloadBytes = GetValue<uint16_t>(cursor);
+        const auto sequence = GetValue<uint32_t>(cursor);
+        const auto unixMicros = GetValue<int64_t>(cursor);
+        payload.resize(payloadBytes);
+        file.read(reinterpret_cast<char*>(payload.data()), payloadBytes);
+        if (file.gcount() != static_cast<std::streamsize>(payloadBytes)) {
+            break;
+        }
+
+        JsonObjectBuilder json;
+        json.Add("seq", sequence);
+        json.Add("time", FormatUtcMicros(unixMicros));
+        json.Add("unix_us", unixMicros);
+        json.Add("type", RecorderEventTypeName(type));
+        if (!AppendPayload(json, type, payload.data(), payload.size())) {
+            json.Add("truncated", true);
+        }
+        out << json.Str() << '\n';
+        ++records;
+    }
+    return records;
+}
+
+const char* RecorderEventTypeName(RecorderEventType type) {
+    switch (type) {
+    case RecorderEventType::SessionStart:
+        return "session_start";
+    case RecorderEventType::SessionEnd:
+        return "session_end";
+    case RecorderEventType::SegmentOpen:
+        return "segment_open";
+    case RecorderEventType::SegmentClose:
+        return "segment_close";
+    case RecorderEventType::FramesDropped:
+        return "frames_dropped";
+    case RecorderEventType::Gap:
+        return "gap";
+    case RecorderEventType::WatchdogTimeout:
+        return "watchdog_timeout";
+    case RecorderEventType::Reconnect:
+        return "reconnect";
+    case RecorderEventType::Levels:
+        return "levels";
+    case RecorderEventType::Marker:
+        return "marker";
+    }
+    return "unknown";
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string_view>
+#include <thread>
+
+// Record types of the binary event log. Values are part of the file format; never reuse one.
+enum class RecorderEventType : uint16_t {
+    SessionStart = 1,
+    SessionEnd = 2,
+    SegmentOpen = 3,
+    SegmentClose = 4,
+    FramesDropped = 5,
+    Gap = 6,
+    WatchdogTimeout = 7,
+    Reconnect = 8,
+    Levels = 9,
+    Marker = 10,
+};
+
+struct SessionEndCounters {
+    uint64_t framesCaptured = 0;
+    uint64_t silentFrames = 0;
+    uint64_t pausedFrames = 0;
+    uint64_t droppedFrames = 0;
+    uint32_t glitches = 0;
+    uint32_t watchdogTimeouts = 0;
+    uint32_t segments = 0;
+    bool deviceInvalidated = false;
+};
+
+// Append-only binary log of recorder events for fleet analytics. File layout: a 16-byte
+// header (magic "LREVENTS", version, reserved) followed by records of a 16-byte header
+// (type, payload size, sequence, Unix microseconds) and a fixed little-endian payload per
+// type; readers skip unknown types by size. Each call packs its fields into a slot of a
+// bounded lock-free MPSC queue and returns; a background thread appends the slots to the
+// file. When the queue is full the event is dropped and counted, never waited for.
+class EventLogWriter {
+public:
+    explicit EventLogWriter(const std::filesystem::path& path);
+    ~EventLogWriter();
+
+    EventLogWriter(const EventLogWriter&) = delete;
+    EventLogWriter& operator=(const EventLogWriter&) = delete;
+
+    void SessionStart(uint32_t sampleRate, uint16_t channels, uint16_t bitsPerSample, bool floatSamples,
+                      std::string_view outputPathUtf8);
+    void SessionEnd(const SessionEndCounters& counters);
+    void SegmentOpen(uint32_t segmentNumber, uint64_t startFrame, std::string_view fileNameUtf8);
+    void SegmentClose(uint32_t segmentNumber, uint64_t startFrame, uint64_t endFrame, uint64_t fileBytes,
+                      uint32_t gaps, uint64_t droppedFrames);
+    void FramesDropped(uint64_t atFrame, uint64_t frames);
+    void Gap(uint64_t atFrame);
+    void WatchdogTimeout(uint64_t atFrame, uint32_t timeoutMs);
+    void Reconnect(uint32_t attempt, uint32_t delayMs);
+    // Up to kMaxLevelChannels channels of peak and RMS level in dBFS.
+    void Levels(uint64_t atFrame, uint16_t channels, const float* peakDbfs, const float* rmsDbfs);
+    // User marker set through the control endpoint.
+    void Marker(uint64_t atFrame, std::string_view labelUtf8);
+
+    // Blocks until everything recorded before the call is in the file.
+    void Flush();
+    uint64_t DroppedEvents() const { return dropped_.load(std::memory_order_relaxed); }
+
+    static constexpr size_t kMaxLevelChannels = 8;
+    static constexpr size_t kMaxRecordBytes = 256;    // header + payload; strings are truncated
+    static constexpr size_t kQueueCapacity = 512;     // power of two
+
+private:
+    struct Slot {
+        std::atomic<size_t> sequence{0};
+        uint16_t length = 0;
+        unsigned char bytes[kMaxRecordBytes];
+    };
+
+    // Claims a slot and fills the record header; nullptr when the queue is full.
+    Slot* Begin(RecorderEventType type, size_t& position);
+    void Commit(Slot* slot, size_t position, unsigned char* end, bool urgent = false);
+    void Run();
+    size_t Drain();
+
+    std::unique_ptr<Slot[]> slots_;
+    alignas(64) std::atomic<size_t> enqueuePos_{0};
+    alignas(64) size_t dequeuePos_ = 0;                 // writer thread only
+    std::atomic<size_t> writtenPos_{0};
+    std::atomic<uint64_t> dropped_{0};
+
+    std::ofstream file_;
+    std::mutex wakeMutex_;
+    std::condition_variable wake_;
+    std::condition_variable flushed_;
+    bool stopping_ = false;
+    std::thread worker_;
+};
+
+// Writes one JSON object per record to `out` ({"seq":..,"time":"..Z","type":"segment_close",...}).
+// A record cut short at the end of the file (crash while appending) ends decoding quietly.
+// Returns the number of records; throws std::runtime_error if the file is not an event log.
+size_t DecodeEventLogToJson(const std::filesystem::path& path, std::ostream& out);
+
+const char* RecorderEventTypeName(RecorderEventType type);
@@ -421,6 +421,8 @@ struct AppState {
     HIMAGELIST folderImageList = nullptr;
     HIMAGELIST openImageList = nullptr;
     std::thread worker;
+    ThreadUsageProbe uiThreadUsage;   // message loop thread, reported with the recorder threads
+    RecorderStatusBoard statusBoard;  // published by the recorder threads, read by the status timer
     std::atomic<bool> stopRequested{false};
     std::atomic<bool> pauseRequested{false};
     int defaultBitrate = 192;
@@ -1241,14 +1243,10 @@ RecordingStatusParts BuildRecordingStatusParts(AppState* state) {
     swprintf_s(timeBuf, L"%02d:%02d:%02d", hours, mins, secs);
     parts.time = timeBuf;
 
-    std::filesystem::path sizePath = state->currentOutputPath;
-    if (!sizePath.empty()) {
-        sizePath = BuildSegmentPath(sizePath, 0);
-    }
-    uintmax_t bytes = 0;
-    std::error_code ec;
-    if (!sizePath.empty() && std::filesystem::exists(sizePath, ec)) {
-        bytes = std::filesystem::file_size(sizePath, ec);
+    // Every segment of the current (or last) session, as the writer thread last reported it.
+    uint64_t bytes = 0;
+    if (const auto snapshot = state->statusBoard.Read()) {
+        bytes = snapshot->output.fileBytes;
     }
     parts.size = FormatBytes(bytes);
 
@@ -1381,6 +1379,8 @@ void RunRecorder(AppState* state,
             controls.isPaused = [state]() {
                 return state->pauseRequested.load();
             };
+            controls.uiThread = &state->uiThreadUsage;
+            controls.status = &state->statusBoard;
 
             threadLogger.Info((isEnglish ? L"Recording system audio to " : L"开始录制系统音频到 ") + config.outputPath.wstring());
             RecorderStats stats = recorder.Record(config, controls);
@@ -1822,6 +1822,7 @@ LRESULT CALLBACK MainWindowProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lPara
     case WM_CREATE: {
         auto newState = std::make_unique<AppState>();
         newState->hwnd = hwnd;
+        newState->uiThreadUsage.BindCurrentThread();
         CreateChildControls(hwnd, newState.get());
         BuildMainMenu(newState.get());
         newState->player = new MediaFoundationPlayer();
@@ -0,0 +1,289 @@
+#include "Gzip.h"
+
+#include "Checksum.h"
+
+#include <algorithm>
+#include <array>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+
+constexpr size_t kWindowSize = 32768;
+constexpr size_t kMinMatch = 3;
+constexpr size_t kMaxMatch = 258;
+constexpr size_t kHashBits = 15;
+constexpr size_t kMaxChain = 48;
+constexpr size_t kReadChunk = 1 << 20;
+constexpr size_t kOutputFlush = 1 << 16;
+
+constexpr std::array<uint16_t, 29> kLengthBase = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+constexpr std::array<uint8_t, 29> kLengthExtra = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+constexpr std::array<uint16_t, 30> kDistanceBase = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769,
+    1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+constexpr std::array<uint8_t, 30> kDistanceExtra = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+uint32_t ReverseBits(uint32_t code, unsigned length) {
+    uint32_t reversed = 0;
+    for (unsigned i = 0; i < length; ++i) {
+        reversed = (reversed << 1) | (code & 1u);
+        code >>= 1;
+    }
+    return reversed;
+}
+
+// Fixed literal/length Huffman code (RFC 1951 3.2.6), pre-reversed for LSB-first output.
+struct FixedCode {
+    uint16_t bits;
+    uint8_t length;
+};
+
+std::array<FixedCode, 288> BuildFixedLiteralCodes() {
+    std::array<FixedCode, 288> codes{};
+    for (uint32_t symbol = 0; symbol < codes.size(); ++symbol) {
+        uint32_t code = 0;
+        unsigned length = 0;
+        if (symbol <= 143) {
+            code = 0x30 + symbol;
+            length = 8;
+        } else if (symbol <= 255) {
+            code = 0x190 + (symbol - 144);
+            length = 9;
+        } else if (symbol <= 279) {
+            code = symbol - 256;
+            length = 7;
+        } else {
+            code = 0xC0 + (symbol - 280);
+            length = 8;
+        }
+        codes[symbol] = FixedCode{static_cast<uint16_t>(ReverseBits(code, length)), static_cast<uint8_t>(length)};
+    }
+    return codes;
+}
+
+class BitSink {
+public:
+    explicit BitSink(std::ofstream& stream) : stream_(stream) { buffer_.reserve(kOutputFlush + 64); }
+
+    void PutBits(uint32_t value, unsigned count) {
+        bits_ |= static_cast<uint64_t>(value) << bitCount_;
+        bitCount_ += count;
+        while (bitCount_ >= 8) {
+            buffer_.push_back(static_cast<char>(bits_ & 0xFFu));
+            bits_ >>= 8;
+            bitCount_ -= 8;
+        }
+        if (buffer_.size() >= kOutputFlush) {
+            Flush();
+        }
+    }
+
+    void PutBytes(const void* data, size_t count) {
+        const auto* bytes = static_cast<const char*>(data);
+        buffer_.insert(buffer_.end(), bytes, bytes + count);
+    }
+
+    void AlignToByte() {
+        if (bitCount_ > 0) {
+            PutBits(0, 8 - bitCount_);
+        }
+    }
+
+    void Flush() {
+        stream_.write(buffer_.data(), static_cast<std::streamsize>(buffer_.size()));
+        written_ += buffer_.size();
+        buffer_.clear();
+    }
+
+    uint64_t Written() const { return written_ + buffer_.size(); }
+
+private:
+    std::ofstream& stream_;
+    std::vector<char> buffer_;
+    uint64_t bits_ = 0;
+    unsigned bitCount_ = 0;
+    uint64_t written_ = 0;
+};
+
+class DeflateEncoder {
+public:
+    explicit DeflateEncoder(BitSink& sink) : sink_(sink), codes_(BuildFixedLiteralCodes()) {}
+
+    void Begin() {
+        sink_.PutBits(1, 1);  // BFINAL: the whole stream is one fixed-Huffman block
+        sink_.PutBits(1, 2);  // BTYPE = 01
+    }
+
+    void Literal(uint8_t byte) { PutSymbol(byte); }
+
+    void Match(size_t length, size_t distance) {
+        size_t lengthIndex = kLengthBase.size() - 1;
+        while (kLengthBase[lengthIndex] > length) {
+            --lengthIndex;
+        }
+        PutSymbol(static_cast<uint32_t>(257 + lengthIndex));
+        if (kLengthExtra[lengthIndex]) {
+            sink_.PutBits(static_cast<uint32_t>(length - kLengthBase[lengthIndex]), kLengthExtra[lengthIndex]);
+        }
+        size_t distanceIndex = kDistanceBase.size() - 1;
+        while (kDistanceBase[distanceIndex] > distance) {
+            --distanceIndex;
+        }
+        sink_.PutBits(ReverseBits(static_cast<uint32_t>(distanceIndex), 5), 5);
+        if (kDistanceExtra[distanceIndex]) {
+            sink_.PutBits(static_cast<uint32_t>(distance - kDistanceBase[distanceIndex]), kDistanceExtra[distanceIndex]);
+        }
+    }
+
+    void End() {
+        PutSymbol(256);
+        sink_.AlignToByte();
+    }
+
+private:
+    void PutSymbol(uint32_t symbol) {
+        const FixedCode& code = codes_[symbol];
+        sink_.PutBits(code.bits, code.length);
+    }
+
+    BitSink& sink_;
+    const std::array<FixedCode, 288> codes_;
+};
+
+void PutLittleEndian32(BitSink& sink, uint32_t value) {
+    const unsigned char bytes[4] = {
+        static_cast<unsigned char>(value), static_cast<unsigned char>(value >> 8),
+        static_cast<unsigned char>(value >> 16), static_cast<unsigned char>(value >> 24)};
+    sink.PutBytes(bytes, sizeof(bytes));
+}
+
+size_t Hash(const uint8_t* data) {
+    return ((static_cast<size_t>(data[0]) << 10) ^ (static_cast<size_t>(data[1]) << 5) ^ data[2]) &
+           ((1u << kHashBits) - 1);
+}
+
+} // namespace
+
+GzipResult GzipCompressFile(const std::filesystem::path& source, const std::filesystem::path& destination) {
+    std::ifstream input(source, std::ios::binary);
+    if (!input) {
+        throw std::runtime_error("无法读取待压缩文件：" + source.string());
+    }
+    std::ofstream output(destination, std::ios::binary | std::ios::trunc);
+    if (!output) {
+        throw std::runtime_error("无法创建压缩文件：" + destination.string());
+    }
+
+    BitSink sink(output);
+    const unsigned char header[10] = {0x1f, 0x8b, 8, 0, 0, 0, 0, 0, 0, 0xff};  // no mtime/name, OS unknown
+    sink.PutBytes(header, sizeof(header));
+    DeflateEncoder encoder(sink);
+    encoder.Begin();
+
+    Crc32 crc;
+    uint64_t inputBytes = 0;
+    // buffer[0] holds absolute position `base`; at least one window of history is kept.
+    std::vector<uint8_t> buffer;
+    uint64_t base = 0;
+    uint64_t position = 0;
+    bool endOfInput = false;
+    std::vector<int64_t> head(size_t{1} << kHashBits, -1);
+    std::vector<int64_t> previous(kWindowSize, -1);
+
+    auto refill = [&]() {
+        const uint64_t keepFrom = position > kWindowSize ? std::max(base, position - kWindowSize) : base;
+        buffer.erase(buffer.begin(), buffer.begin() + static_cast<std::ptrdiff_t>(keepFrom - base));
+        base = keepFrom;
+        const size_t oldSize = buffer.size();
+        buffer.resize(oldSize + kReadChunk);
+        input.read(reinterpret_cast<char*>(buffer.data() + oldSize), static_cast<std::streamsize>(kReadChunk));
+        const auto got = static_cast<size_t>(input.gcount());
+        buffer.resize(oldSize + got);
+        if (got == 0) {
+            endOfInput = true;
+            return;
+        }
+        crc.Update(buffer.data() + oldSize, got);
+        inputBytes += got;
+    };
+
+    auto insert = [&](uint64_t at) {
+        const size_t hash = Hash(buffer.data() + (at - base));
+        previous[at & (kWindowSize - 1)] = head[hash];
+        head[hash] = static_cast<int64_t>(at);
+    };
+
+    while (true) {
+        if (!endOfInput && base + buffer.size() - position < kMaxMatch + kMinMatch) {
+            refill();
+            continue;
+        }
+        const uint64_t available = base + buffer.size() - position;
+        if (available == 0) {
+            break;
+        }
+
+        size_t bestLength = 0;
+        uint64_t bestDistance = 0;
+        if (available >= kMinMatch) {
+            const uint8_t* current = buffer.data() + (position - base);
+            const size_t limit = static_cast<size_t>(std::min<uint64_t>(available, kMaxMatch));
+            int64_t candidate = head[Hash(current)];
+            for (size_t chain = 0; chain < kMaxChain && candidate >= 0; ++chain) {
+                const auto candidatePos = static_cast<uint64_t>(candidate);
+                if (candidatePos >= position || position - candidatePos > kWindowSize) {
+                    break;
+                }
+                const uint8_t* match = buffer.data() + (candidatePos - base);
+                // Cheap reject: a longer match must also agree at the current best length.
+                if (bestLength == 0 || match[bestLength] == current[bestLength]) {
+                    size_t length = 0;
+                    while (length < limit && match[length] == current[length]) {
+                        ++length;
+                    }
+                    if (length > bestLength) {
+                        bestLength = length;
+                        bestDistance = position - candidatePos;
+                        if (length == limit) {
+                            break;
+                        }
+                    }
+                }
+                const int64_t next = previous[candidatePos & (kWindowSize - 1)];
+                if (next >= candidate) {
+                    break;  // slot was reused by a newer position
+                }
+                candidate = next;
+            }
+            insert(position);
+        }
+
+        if (bestLength >= kMinMatch) {
+            encoder.Match(bestLength, static_cast<size_t>(bestDistance));
+            for (uint64_t at = position + 1; at < position + bestLength; ++at) {
+                if (base + buffer.size() - at >= kMinMatch) {
+                    insert(at);
+                }
+            }
+            position += bestLength;
+        } else {
+            encoder.Literal(buffer[position - base]);
+            ++position;
+        }
+    }
+
+    encoder.End();
+    PutLittleEndian32(sink, crc.Value());
+    PutLittleEndian32(sink, static_cast<uint32_t>(inputBytes));
+    sink.Flush();
+    output.flush();
+    if (!output || input.bad()) {
+        throw std::runtime_error("写入压缩文件失败：" + destination.string());
+    }
+    return GzipResult{inputBytes, sink.Written()};
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+
+struct GzipResult {
+    uint64_t inputBytes = 0;
+    uint64_t outputBytes = 0;
+};
+
+// Compresses `source` into a gzip file at `destination` (RFC 1951/1952). The encoder is a
+// small self-contained LZ77 + fixed-Huffman deflate, tuned for text such as rotated logs;
+// any gzip/zlib reader can decompress the result. Streams the input in chunks, so memory
+// use is independent of the file size. Throws std::runtime_error on I/O failure.
+GzipResult GzipCompressFile(const std::filesystem::path& source, const std::filesystem::path& destination);
@@ -0,0 +1,97 @@
+#include "HdrHistogram.h"
+
+#include <algorithm>
+#include <cstdio>
+
+namespace {
+
+unsigned Magnitude(uint64_t value) {
+    unsigned magnitude = 0;
+    while (value >>= 1) {
+        ++magnitude;
+    }
+    return magnitude;
+}
+
+} // namespace
+
+size_t HdrHistogram::BucketIndex(uint64_t value) {
+    if (value < kSubBuckets) {
+        return static_cast<size_t>(value);
+    }
+    const unsigned magnitude = std::min(Magnitude(value), kMaxMagnitude);
+    if (magnitude == kMaxMagnitude) {
+        return kBucketCount - 1;
+    }
+    const unsigned shift = magnitude - kSubBucketBits;
+    const uint64_t top = value >> shift;  // in [kSubBuckets, 2 * kSubBuckets)
+    return static_cast<size_t>((shift + 1) * kSubBuckets + (top - kSubBuckets));
+}
+
+uint64_t HdrHistogram::BucketLowerBound(size_t index) {
+    const uint64_t group = index / kSubBuckets;
+    const uint64_t sub = index % kSubBuckets;
+    if (group == 0) {
+        return sub;
+    }
+    return (kSubBuckets + sub) << (group - 1);
+}
+
+uint64_t HdrHistogram::BucketWidth(size_t index) {
+    const uint64_t group = index / kSubBuckets;
+    return group == 0 ? 1 : 1ull << (group - 1);
+}
+
+uint64_t HdrHistogram::Percentile(double quantile) const {
+    const uint64_t total = Count();
+    if (total == 0) {
+        return 0;
+    }
+    const double clamped = std::clamp(quantile, 0.0, 1.0);
+    const auto rank = std::max<uint64_t>(1, static_cast<uint64_t>(clamped * static_cast<double>(total) + 0.5));
+    uint64_t seen = 0;
+    for (size_t i = 0; i < kBucketCount; ++i) {
+        seen += buckets_[i].load(std::memory_order_relaxed);
+        if (seen >= rank) {
+            const uint64_t midpoint = BucketLowerBound(i) + BucketWidth(i) / 2;
+            return std::min(midpoint, Max());
+        }
+    }
+    return Max();
+}
+
+std::string HdrHistogram::Summary() const {
+    return "p50=" + PipelineLatencies::FormatNanos(Percentile(0.50)) +
+           " p90=" + PipelineLatencies::FormatNanos(Percentile(0.90)) +
+           " p99=" + PipelineLatencies::FormatNanos(Percentile(0.99)) +
+           " p99.9=" + PipelineLatencies::FormatNanos(Percentile(0.999)) +
+           " max=" + PipelineLatencies::FormatNanos(Max()) +
+           " n=" + std::to_string(Count());
+}
+
+void PipelineLatencies::AccumulateInto(PipelineLatencies& totals) {
+    packetInterval.AccumulateInto(&totals.packetInterval);
+    captureToPop.AccumulateInto(&totals.captureToPop);
+    writerWrite.AccumulateInto(&totals.writerWrite);
+    writerFlush.AccumulateInto(&totals.writerFlush);
+    segmentRoll.AccumulateInto(&totals.segmentRoll);
+}
+
+std::string PipelineLatencies::FormatNanos(uint64_t nanos) {
+    char buffer[32];
+    FormatNanos(nanos, buffer, sizeof(buffer));
+    return buffer;
+}
+
+void PipelineLatencies::FormatNanos(uint64_t nanos, char* buffer, size_t size) {
+    const double value = static_cast<double>(nanos);
+    if (nanos < 1000) {
+        std::snprintf(buffer, size, "%lluns", static_cast<unsigned long long>(nanos));
+    } else if (nanos < 1000000) {
+        std::snprintf(buffer, size, value < 1e4 ? "%.2fus" : value < 1e5 ? "%.1fus" : "%.0fus", value / 1e3);
+    } else if (nanos < 1000000000) {
+        std::snprintf(buffer, size, value < 1e7 ? "%.2fms" : value < 1e8 ? "%.1fms" : "%.0fms", value / 1e6);
+    } else {
+        std::snprintf(buffer, size, "%.2fs", value / 1e9);
+    }
+}
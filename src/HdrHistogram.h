@@ -0,0 +1,146 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+
+// Log-linear (HDR-style) histogram of nanosecond values. Each power of two is split into
+// 32 linear sub-buckets, so any recorded value is reported within ~3% of its true value
+// from 1 ns up to about 73 minutes; larger values land in the last bucket. Record() is a
+// handful of relaxed atomic operations and never allocates, so the audio threads can call
+// it; queries may run concurrently and see a slightly stale but usable distribution.
+// A histogram can forward every value to a longer-lived one (per-session -> process totals).
+class HdrHistogram {
+public:
+    static constexpr unsigned kSubBucketBits = 5;
+    static constexpr uint64_t kSubBuckets = 1ull << kSubBucketBits;
+    static constexpr unsigned kMaxMagnitude = 42;  // values are clamped below 2^42 ns
+    static constexpr size_t kBucketCount = (kMaxMagnitude - kSubBucketBits + 1) * kSubBuckets;
+
+    void Record(uint64_t nanos) {
+        buckets_[BucketIndex(nanos)].fetch_add(1, std::memory_order_relaxed);
+        count_.fetch_add(1, std::memory_order_relaxed);
+        uint64_t currentMax = max_.load(std::memory_order_relaxed);
+        while (nanos > currentMax && !max_.compare_exchange_weak(currentMax, nanos, std::memory_order_relaxed)) {
+        }
+        sum_.fetch_add(nanos, std::memory_order_relaxed);
+        if (total_) {
+            total_->Record(nanos);
+        }
+    }
+
+    // Values recorded from now on are also recorded into `total` (set before recording starts).
+    void AccumulateInto(HdrHistogram* total) { total_ = total; }
+
+    uint64_t Count() const { return count_.load(std::memory_order_relaxed); }
+    uint64_t Max() const { return max_.load(std::memory_order_relaxed); }
+    uint64_t SumNanos() const { return sum_.load(std::memory_order_relaxed); }
+    // Observations in bucket `index` alone (not cumulative).
+    uint64_t BucketCount(size_t index) const { return buckets_[index].load(std::memory_order_relaxed); }
+    // Value at `quantile` (0..1), reported as the midpoint of its bucket; 0 when empty.
+    uint64_t Percentile(double quantile) const;
+    // "p50=1.2ms p90=… p99=… p99.9=… max=… n=…"
+    std::string Summary() const;
+
+    static size_t BucketIndex(uint64_t value);
+    static uint64_t BucketLowerBound(size_t index);
+    static uint64_t BucketWidth(size_t index);
+
+private:
+    std::array<std::atomic<uint64_t>, kBucketCount> buckets_{};
+    std::atomic<uint64_t> count_{0};
+    std::atomic<uint64_t> max_{0};
+    std::atomic<uint64_t> sum_{0};
+    HdrHistogram* total_ = nullptr;
+};
+
+inline uint64_t MonotonicNanos() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+// Latency distributions of one recording session.
+struct PipelineLatencies {
+    HdrHistogram packetInterval;   // capture thread: time between wakeups that delivered audio
+    HdrHistogram captureToPop;     // GetBuffer returned -> writer popped those bytes from the ring
+    HdrHistogram writerWrite;      // IAudioWriter::Write
+    HdrHistogram writerFlush;      // IAudioWriter::Flush
+    HdrHistogram segmentRoll;      // close + open of a segment
+
+    // Forwards every stage to the matching histogram of `totals`.
+    void AccumulateInto(PipelineLatencies& totals);
+
+    // Duration formatted with a unit that keeps 3 significant digits ("850us", "12.3ms").
+    static std::string FormatNanos(uint64_t nanos);
+    // Same into `buffer` (32 bytes is always enough), for callers that must not allocate.
+    static void FormatNanos(uint64_t nanos, char* buffer, size_t size);
+};
+
+// Single-producer/single-consumer queue of (ring byte offset, capture time) markers that lets
+// the writer attribute each pop to the packet that produced it. Each marker carries the
+// monotonic time for latency and the wall-clock time the packet was captured, so the writer
+// can date a frame by when it was recorded rather than when it reached the disk. The capture
+// thread skips a marker when the queue is full rather than waiting.
+class CaptureTimestampQueue {
+public:
+    static constexpr size_t kCapacity = 1024;  // power of two
+
+    bool Push(uint64_t endOffset, uint64_t captureNanos, int64_t wallNanos) {
+        const uint64_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - head_.load(std::memory_order_acquire) >= kCapacity) {
+            return false;
+        }
+        entries_[tail & (kCapacity - 1)] = Entry{endOffset, captureNanos, wallNanos};
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Records `nowNanos - captureNanos` for every marker whose bytes have all been read.
+    void ConsumeUpTo(uint64_t readOffset, uint64_t nowNanos, HdrHistogram& histogram) {
+        uint64_t head = head_.load(std::memory_order_relaxed);
+        const uint64_t tail = tail_.load(std::memory_order_acquire);
+        while (head != tail) {
+            const Entry& entry = entries_[head & (kCapacity - 1)];
+            if (entry.endOffset > readOffset) {
+                break;
+            }
+            histogram.Record(nowNanos > entry.captureNanos ? nowNanos - entry.captureNanos : 0);
+            lastConsumed_ = entry;
+            ++head;
+        }
+        head_.store(head, std::memory_order_release);
+    }
+
+    // Consumer thread: wall-clock capture time (ns since the epoch) of the byte at `offset`,
+    // extrapolated at `bytesPerSecond` from the nearest marker at or after it that is still
+    // known; nullopt before the first marker.
+    std::optional<int64_t> WallNanosAt(uint64_t offset, uint64_t bytesPerSecond) const {
+        std::optional<Entry> marker = lastConsumed_;
+        if (!marker || marker->endOffset < offset) {
+            const uint64_t head = head_.load(std::memory_order_relaxed);
+            if (head != tail_.load(std::memory_order_acquire)) {
+                marker = entries_[head & (kCapacity - 1)];
+            }
+        }
+        if (!marker || bytesPerSecond == 0) {
+            return std::nullopt;
+        }
+        const auto distance = static_cast<double>(marker->endOffset) - static_cast<double>(offset);
+        return marker->wallNanos - static_cast<int64_t>(distance * 1e9 / static_cast<double>(bytesPerSecond));
+    }
+
+private:
+    struct Entry {
+        uint64_t endOffset;
+        uint64_t captureNanos;
+        int64_t wallNanos;
+    };
+    std::array<Entry, kCapacity> entries_{};
+    std::optional<Entry> lastConsumed_;   // consumer thread only
+    alignas(64) std::atomic<uint64_t> head_{0};
+    alignas(64) std::atomic<uint64_t> tail_{0};
+};
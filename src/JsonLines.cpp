@@ -0,0 +1,350 @@
+#include "JsonLines.h"
+
+#include <charconv>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+namespace {
+
+void AppendUtf8(std::string& out, uint32_t codepoint) {
+    if (codepoint < 0x80) {
+        out.push_back(static_cast<char>(codepoint));
+    } else if (codepoint < 0x800) {
+        out.push_back(static_cast<char>(0xC0 | (codepoint >> 6)));
+        out.push_back(static_cast<char>(0x80 | (codepoint & 0x3F)));
+    } else if (codepoint < 0x10000) {
+        out.push_back(static_cast<char>(0xE0 | (codepoint >> 12)));
+        out.push_back(static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | (codepoint & 0x3F)));
+    } else {
+        out.push_back(static_cast<char>(0xF0 | (codepoint >> 18)));
+        out.push_back(static_cast<char>(0x80 | ((codepoint >> 12) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | (codepoint & 0x3F)));
+    }
+}
+
+class Parser {
+public:
+    explicit Parser(std::string_view text) : text_(text) {}
+
+    std::optional<JsonObject> ParseObject() {
+        SkipSpace();
+        if (!Consume('{')) {
+            return std::nullopt;
+        }
+        JsonObject object;
+        SkipSpace();
+        if (Consume('}')) {
+            return Finish(std::move(object));
+        }
+        while (true) {
+            SkipSpace();
+            std::string key;
+            if (!ParseString(key)) {
+                return std::nullopt;
+            }
+            SkipSpace();
+            if (!Consume(':')) {
+                return std::nullopt;
+            }
+            SkipSpace();
+            JsonValue value;
+            if (!ParseValue(value)) {
+                return std::nullopt;
+            }
+            object.insert_or_assign(std::move(key), std::move(value));
+            SkipSpace();
+            if (Consume(',')) {
+                continue;
+            }
+            if (Consume('}')) {
+                return Finish(std::move(object));
+            }
+            return std::nullopt;
+        }
+    }
+
+private:
+    std::optional<JsonObject> Finish(JsonObject object) {
+        SkipSpace();
+        if (pos_ != text_.size()) {
+            return std::nullopt;
+        }
+        return object;
+    }
+
+    void SkipSpace() {
+        while (pos_ < text_.size() &&
+               (text_[pos_] == ' ' || text_[pos_] == '\t' || text_[pos_] == '\r' || text_[pos_] == '\n')) {
+            ++pos_;
+        }
+    }
+
+    bool Consume(char ch) {
+        if (pos_ < text_.size() && text_[pos_] == ch) {
+            ++pos_;
+            return true;
+        }
+        return false;
+    }
+
+    bool ConsumeLiteral(std::string_view literal) {
+        if (text_.substr(pos_, literal.size()) == literal) {
+            pos_ += literal.size();
+            return true;
+        }
+        return false;
+    }
+
+    bool ParseHex4(uint32_t& value) {
+        if (pos_ + 4 > text_.size()) {
+            return false;
+        }
+        value = 0;
+        for (int i = 0; i < 4; ++i) {
+            const char ch = text_[pos_++];
+            value <<= 4;
+            if (ch >= '0' && ch <= '9') {
+                value |= static_cast<uint32_t>(ch - '0');
+            } else if (ch >= 'a' && ch <= 'f') {
+                value |= static_cast<uint32_t>(ch - 'a' + 10);
+            } else if (ch >= 'A' && ch <= 'F') {
+                value |= static_cast<uint32_t>(ch - 'A' + 10);
+            } else {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool ParseString(std::string& out) {
+        if (!Consume('"')) {
+            return false;
+        }
+        while (pos_ < text_.size()) {
+            const char ch = text_[pos_++];
+            if (ch == '"') {
+                return true;
+            }
+            if (ch != '\\') {
+                out.push_back(ch);
+                continue;
+            }
+            if (pos_ >= text_.size()) {
+                return false;
+            }
+            const char esc = text_[pos_++];
+            switch (esc) {
+            case '"': out.push_back('"'); break;
+            case '\\': out.push_back('\\'); break;
+            case '/': out.push_back('/'); break;
+            case 'b': out.push_back('\b'); break;
+            case 'f': out.push_back('\f'); break;
+            case 'n': out.push_back('\n'); break;
+            case 'r': out.push_back('\r'); break;
+            case 't': out.push_back('\t'); break;
+            case 'u': {
+                uint32_t codepoint = 0;
+                if (!ParseHex4(codepoint)) {
+                    return false;
+                }
+                if (codepoint >= 0xD800 && codepoint <= 0xDBFF) {
+                    uint32_t low = 0;
+                    if (!ConsumeLiteral("\\u") || !ParseHex4(low) || low < 0xDC00 || low > 0xDFFF) {
+                        return false;
+                    }
+                    codepoint = 0x10000 + ((codepoint - 0xD800) << 10) + (low - 0xDC00);
+                }
+                AppendUtf8(out, codepoint);
+                break;
+            }
+            default:
+                return false;
+            }
+        }
+        return false;
+    }
+
+    bool ParseValue(JsonValue& value) {
+        if (pos_ >= text_.size()) {
+            return false;
+        }
+        const char ch = text_[pos_];
+        if (ch == '"') {
+            value.kind = JsonValue::Kind::String;
+            return ParseString(value.text);
+        }
+        if (ConsumeLiteral("true")) {
+            value.kind = JsonValue::Kind::Bool;
+            value.boolean = true;
+            return true;
+        }
+        if (ConsumeLiteral("false")) {
+            value.kind = JsonValue::Kind::Bool;
+            value.boolean = false;
+            return true;
+        }
+        if (ConsumeLiteral("null")) {
+            value.kind = JsonValue::Kind::Null;
+            return true;
+        }
+        const size_t start = pos_;
+        while (pos_ < text_.size()) {
+            const char c = text_[pos_];
+            if ((c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E') {
+                ++pos_;
+            } else {
+                break;
+            }
+        }
+        if (start == pos_) {
+            return false;
+        }
+        value.kind = JsonValue::Kind::Number;
+        value.text.assign(text_.substr(start, pos_ - start));
+        char* end = nullptr;
+        value.number = std::strtod(value.text.c_str(), &end);
+        return end && *end == '\0';
+    }
+
+    std::string_view text_;
+    size_t pos_ = 0;
+};
+
+} // namespace
+
+std::string JsonEscape(std::string_view text) {
+    std::string out;
+    out.reserve(text.size() + 2);
+    for (const char ch : text) {
+        switch (ch) {
+        case '"': out += "\\\""; break;
+        case '\\': out += "\\\\"; break;
+        case '\n': out += "\\n"; break;
+        case '\r': out += "\\r"; break;
+        case '\t': out += "\\t"; break;
+        default:
+            if (static_cast<unsigned char>(ch) < 0x20) {
+                char buffer[8];
+                std::snprintf(buffer, sizeof(buffer), "\\u%04x", static_cast<unsigned>(static_cast<unsigned char>(ch)));
+                out += buffer;
+            } else {
+                out.push_back(ch);
+            }
+            break;
+        }
+    }
+    return out;
+}
+
+void JsonObjectBuilder::Key(std::string_view key) {
+    if (!first_) {
+        text_.push_back(',');
+    }
+    first_ = false;
+    text_.push_back('"');
+    text_ += JsonEscape(key);
+    text_ += "\":";
+}
+
+JsonObjectBuilder& JsonObjectBuilder::Add(std::string_view key, std::string_view value) {
+    Key(key);
+    text_.push_back('"');
+    text_ += JsonEscape(value);
+    text_.push_back('"');
+    return *this;
+}
+
+JsonObjectBuilder& JsonObjectBuilder::Add(std::string_view key, uint64_t value) {
+    Key(key);
+    text_ += std::to_string(value);
+    return *this;
+}
+
+JsonObjectBuilder& JsonObjectBuilder::Add(std::string_view key, int64_t value) {
+    Key(key);
+    text_ += std::to_string(value);
+    return *this;
+}
+
+JsonObjectBuilder& JsonObjectBuilder::Add(std::string_view key, double value) {
+    Key(key);
+    if (!std::isfinite(value)) {
+        text_ += "null";
+        return *this;
+    }
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%.6g", value);
+    text_ += buffer;
+    return *this;
+}
+
+JsonObjectBuilder& JsonObjectBuilder::Add(std::string_view key, bool value) {
+    Key(key);
+    text_ += value ? "true" : "false";
+    return *this;
+}
+
+uint64_t JsonValue::AsUint64() const {
+    uint64_t parsed = 0;
+    const auto result = std::from_chars(text.data(), text.data() + text.size(), parsed);
+    if (result.ec == std::errc() && result.ptr == text.data() + text.size()) {
+        return parsed;
+    }
+    return number > 0 ? static_cast<uint64_t>(number) : 0;
+}
+
+int64_t JsonValue::AsInt64() const {
+    int64_t parsed = 0;
+    const auto result = std::from_chars(text.data(), text.data() + text.size(), parsed);
+    if (result.ec == std::errc() && result.ptr == text.data() + text.size()) {
+        return parsed;
+    }
+    return static_cast<int64_t>(number);
+}
+
+std::optional<JsonObject> ParseJsonObject(std::string_view line) {
+    return Parser(line).ParseObject();
+}
+
+std::optional<std::string> JsonGetString(const JsonObject& object, std::string_view key) {
+    auto it = object.find(key);
+    if (it == object.end() || it->second.kind != JsonValue::Kind::String) {
+        return std::nullopt;
+    }
+    return it->second.text;
+}
+
+std::optional<uint64_t> JsonGetUint64(const JsonObject& object, std::string_view key) {
+    auto it = object.find(key);
+    if (it == object.end() || it->second.kind != JsonValue::Kind::Number || it->second.number < 0) {
+        return std::nullopt;
+    }
+    return it->second.AsUint64();
+}
+
+std::optional<int64_t> JsonGetInt64(const JsonObject& object, std::string_view key) {
+    auto it = object.find(key);
+    if (it == object.end() || it->second.kind != JsonValue::Kind::Number) {
+        return std::nullopt;
+    }
+    return it->second.AsInt64();
+}
+
+std::optional<double> JsonGetDouble(const JsonObject& object, std::string_view key) {
+    auto it = object.find(key);
+    if (it == object.end() || it->second.kind != JsonValue::Kind::Number) {
+        return std::nullopt;
+    }
+    return it->second.number;
+}
+
+std::optional<bool> JsonGetBool(const JsonObject& object, std::string_view key) {
+    auto it = object.find(key);
+    if (it == object.end() || it->second.kind != JsonValue::Kind::Bool) {
+        return std::nullopt;
+    }
+    return it->second.boolean;
+}
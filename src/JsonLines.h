@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+
+// Minimal helpers for the flat JSON objects used in manifests and other
+// line-oriented files: one object per line, scalar values only.
+class JsonObjectBuilder {
+public:
+    JsonObjectBuilder& Add(std::string_view key, std::string_view value);
+    JsonObjectBuilder& Add(std::string_view key, const char* value) { return Add(key, std::string_view(value)); }
+    JsonObjectBuilder& Add(std::string_view key, uint64_t value);
+    JsonObjectBuilder& Add(std::string_view key, int64_t value);
+    JsonObjectBuilder& Add(std::string_view key, uint32_t value) { return Add(key, static_cast<uint64_t>(value)); }
+    JsonObjectBuilder& Add(std::string_view key, int value) { return Add(key, static_cast<int64_t>(value)); }
+    JsonObjectBuilder& Add(std::string_view key, double value);
+    JsonObjectBuilder& Add(std::string_view key, bool value);
+
+    std::string Str() const { return text_ + "}"; }
+
+private:
+    void Key(std::string_view key);
+
+    std::string text_ = "{";
+    bool first_ = true;
+};
+
+struct JsonValue {
+    enum class Kind { Null, Bool, Number, String };
+    Kind kind = Kind::Null;
+    bool boolean = false;
+    double number = 0.0;
+    std::string text; // string payload, or the raw literal for numbers
+
+    uint64_t AsUint64() const;
+    int64_t AsInt64() const;
+};
+
+using JsonObject = std::map<std::string, JsonValue, std::less<>>;
+
+std::string JsonEscape(std::string_view text);
+std::optional<JsonObject> ParseJsonObject(std::string_view line);
+
+std::optional<std::string> JsonGetString(const JsonObject& object, std::string_view key);
+std::optional<uint64_t> JsonGetUint64(const JsonObject& object, std::string_view key);
+std::optional<int64_t> JsonGetInt64(const JsonObject& object, std::string_view key);
+std::optional<double> JsonGetDouble(const JsonObject& object, std::string_view key);
+std::optional<bool> JsonGetBool(const JsonObject& object, std::string_view key);
@@ -0,0 +1,243 @@
+#include "LogRotation.h"
+
+#include "Gzip.h"
+
+#include <algorithm>
+#include <ctime>
+#include <cwchar>
+#include <cwctype>
+#include <exception>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#if defined(_WIN32)
+#include <Windows.h>
+#elif defined(__linux__)
+#include <sys/resource.h>
+#endif
+
+namespace {
+
+constexpr wchar_t kCompressedSuffix[] = L".gz";
+constexpr wchar_t kPartialSuffix[] = L".part";
+
+struct RotatedLog {
+    std::filesystem::path path;
+    std::wstring stamp;       // "YYYYMMDD-HHMMSS"
+    unsigned sequence = 0;    // the "-N" collision suffix, 0 when absent
+    bool compressed = false;
+};
+
+void EnterBackgroundPriority() {
+#if defined(_WIN32)
+    SetThreadPriority(GetCurrentThread(), THREAD_MODE_BACKGROUND_BEGIN);
+    SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_IDLE);
+#elif defined(__linux__)
+    setpriority(PRIO_PROCESS, 0, 19);
+#endif
+}
+
+bool AllDigits(const std::wstring& text, size_t offset, size_t count) {
+    if (offset + count > text.size()) {
+        return false;
+    }
+    for (size_t i = offset; i < offset + count; ++i) {
+        if (!std::iswdigit(text[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool EndsWith(const std::wstring& text, const std::wstring& suffix) {
+    return text.size() >= suffix.size() && text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+// Parses "<stem>.YYYYMMDD-HHMMSS[-N]<ext>[.gz]".
+std::optional<RotatedLog> ParseRotatedLog(const std::filesystem::path& path,
+                                          const std::wstring& stem,
+                                          const std::wstring& extension) {
+    std::wstring name = path.filename().wstring();
+    RotatedLog log;
+    log.path = path;
+    if (EndsWith(name, kCompressedSuffix)) {
+        log.compressed = true;
+        name.resize(name.size() - std::wcslen(kCompressedSuffix));
+    }
+    const std::wstring prefix = stem + L".";
+    if (name.compare(0, prefix.size(), prefix) != 0 || !EndsWith(name, extension)) {
+        return std::nullopt;
+    }
+    std::wstring middle = name.substr(prefix.size(), name.size() - prefix.size() - extension.size());
+    if (middle.size() < 15 || !AllDigits(middle, 0, 8) || middle[8] != L'-' || !AllDigits(middle, 9, 6)) {
+        return std::nullopt;
+    }
+    log.stamp = middle.substr(0, 15);
+    if (middle.size() > 15) {
+        if (middle[15] != L'-' || !AllDigits(middle, 16, middle.size() - 16) || middle.size() > 16 + 6) {
+            return std::nullopt;
+        }
+        log.sequence = static_cast<unsigned>(std::wcstoul(middle.c_str() + 16, nullptr, 10));
+    }
+    return log;
+}
+
+std::vector<RotatedLog> ListRotatedLogs(const std::filesystem::path& activePath) {
+    std::vector<RotatedLog> logs;
+    const std::wstring stem = activePath.stem().wstring();
+    const std::wstring extension = activePath.extension().wstring();
+    const std::filesystem::path directory = activePath.has_parent_path() ? activePath.parent_path() : std::filesystem::path(L".");
+    std::error_code ec;
+    for (std::filesystem::directory_iterator it(directory, ec), end; !ec && it != end; it.increment(ec)) {
+        if (!it->is_regular_file(ec)) {
+            continue;
+        }
+        if (auto log = ParseRotatedLog(it->path(), stem, extension)) {
+            logs.push_back(std::move(*log));
+        }
+    }
+    // Oldest first.
+    std::sort(logs.begin(), logs.end(), [](const RotatedLog& a, const RotatedLog& b) {
+        return a.stamp != b.stamp ? a.stamp < b.stamp : a.sequence < b.sequence;
+    });
+    return logs;
+}
+
+std::filesystem::path AppendToFilename(const std::filesystem::path& path, const wchar_t* suffix) {
+    std::filesystem::path result = path;
+    result += suffix;
+    return result;
+}
+
+} // namespace
+
+std::filesystem::path BuildRotatedLogPath(const std::filesystem::path& activePath,
+                                          std::chrono::system_clock::time_point time) {
+    const std::time_t timeT = std::chrono::system_clock::to_time_t(time);
+    std::tm tm{};
+#if defined(_WIN32)
+    localtime_s(&tm, &timeT);
+#else
+    localtime_r(&timeT, &tm);
+#endif
+    wchar_t stamp[32];
+    const size_t length = std::wcsftime(stamp, sizeof(stamp) / sizeof(stamp[0]), L"%Y%m%d-%H%M%S", &tm);
+    const std::wstring base = activePath.stem().wstring() + L"." + std::wstring(stamp, length);
+    const std::wstring extension = activePath.extension().wstring();
+
+    std::error_code ec;
+    for (unsigned sequence = 1;; ++sequence) {
+        std::wstring name = base;
+        if (sequence > 1) {
+            name += L"-" + std::to_wstring(sequence);
+        }
+        name += extension;
+        const std::filesystem::path candidate = activePath.parent_path() / name;
+        if (!std::filesystem::exists(candidate, ec) &&
+            !std::filesystem::exists(AppendToFilename(candidate, kCompressedSuffix), ec)) {
+            return candidate;
+        }
+    }
+}
+
+LogArchiver::LogArchiver(const std::filesystem::path& activePath, LogRotationPolicy policy, WarningCallback onWarning)
+    : activePath_(activePath), policy_(std::move(policy)), onWarning_(std::move(onWarning)) {
+    worker_ = std::thread([this]() { Run(); });
+}
+
+LogArchiver::~LogArchiver() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    if (worker_.joinable()) {
+        // Finishes the file in progress; queued files are resumed by the next run.
+        worker_.join();
+    }
+}
+
+void LogArchiver::Enqueue(const std::filesystem::path& rotatedPath) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        queue_.push_back(rotatedPath);
+    }
+    wake_.notify_one();
+}
+
+void LogArchiver::Run() {
+    EnterBackgroundPriority();
+
+    if (policy_.compress) {
+        // Resume files an earlier run rotated but did not get to compress.
+        std::vector<std::filesystem::path> leftovers;
+        for (const auto& log : ListRotatedLogs(activePath_)) {
+            if (!log.compressed) {
+                leftovers.push_back(log.path);
+            }
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        queue_.insert(queue_.begin(), leftovers.begin(), leftovers.end());
+    }
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        wake_.wait(lock, [this]() { return stopping_ || !queue_.empty() || retentionPending_; });
+        if (stopping_) {
+            break;
+        }
+        if (!queue_.empty()) {
+            const std::filesystem::path path = std::move(queue_.front());
+            queue_.pop_front();
+            lock.unlock();
+            if (policy_.compress) {
+                Compress(path);
+            }
+            lock.lock();
+            retentionPending_ = true;
+            continue;
+        }
+        retentionPending_ = false;
+        lock.unlock();
+        EnforceRetention();
+        lock.lock();
+    }
+}
+
+void LogArchiver::Compress(const std::filesystem::path& rotatedPath) {
+    std::error_code ec;
+    if (!std::filesystem::exists(rotatedPath, ec)) {
+        return;   // already removed by retention
+    }
+    const std::filesystem::path target = AppendToFilename(rotatedPath, kCompressedSuffix);
+    const std::filesystem::path partial = AppendToFilename(target, kPartialSuffix);
+    try {
+        GzipCompressFile(rotatedPath, partial);
+        std::filesystem::rename(partial, target);
+        std::filesystem::remove(rotatedPath);
+    } catch (const std::exception&) {
+        std::filesystem::remove(partial, ec);
+        if (onWarning_) {
+            onWarning_(L"压缩日志文件失败，保留未压缩文件：" + rotatedPath.wstring());
+        }
+    }
+}
+
+void LogArchiver::EnforceRetention() {
+    if (policy_.keepFiles == 0) {
+        return;
+    }
+    std::vector<RotatedLog> logs = ListRotatedLogs(activePath_);
+    if (logs.size() <= policy_.keepFiles) {
+        return;
+    }
+    const size_t excess = logs.size() - policy_.keepFiles;
+    for (size_t i = 0; i < excess; ++i) {
+        std::error_code ec;
+        std::filesystem::remove(logs[i].path, ec);
+        if (ec && onWarning_) {
+            onWarning_(L"删除过期日志文件失败：" + logs[i].path.wstring());
+        }
+    }
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+
+struct LogRotationPolicy {
+    std::optional<uint64_t> maxBytes = 64ull * 1024 * 1024;   // rotate once the file reaches this size
+    std::optional<std::chrono::minutes> maxAge;               // rotate once the file is this old
+    size_t keepFiles = 10;                                    // rotated files kept; 0 keeps all
+    bool compress = true;                                     // gzip rotated files in the background
+
+    bool Enabled() const { return maxBytes.has_value() || maxAge.has_value(); }
+};
+
+// "<dir>/<stem>.YYYYMMDD-HHMMSS[-N]<ext>" next to `activePath`, stamped with local time and
+// not colliding with an existing rotated or compressed file.
+std::filesystem::path BuildRotatedLogPath(const std::filesystem::path& activePath,
+                                          std::chrono::system_clock::time_point time);
+
+// Background housekeeping of rotated log files: gzip compression (via "<name>.gz.part" and
+// a rename, then the plain file is removed) and the retention count. It owns one thread at
+// background priority; the logger only hands over paths, so rotation never waits on it.
+// Rotated files left uncompressed by an earlier run are picked up at construction.
+class LogArchiver {
+public:
+    using WarningCallback = std::function<void(const std::wstring& message)>;
+
+    LogArchiver(const std::filesystem::path& activePath, LogRotationPolicy policy, WarningCallback onWarning);
+    ~LogArchiver();
+
+    LogArchiver(const LogArchiver&) = delete;
+    LogArchiver& operator=(const LogArchiver&) = delete;
+
+    void Enqueue(const std::filesystem::path& rotatedPath);
+
+private:
+    void Run();
+    void Compress(const std::filesystem::path& rotatedPath);
+    void EnforceRetention();
+
+    const std::filesystem::path activePath_;
+    const LogRotationPolicy policy_;
+    WarningCallback onWarning_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::deque<std::filesystem::path> queue_;
+    bool retentionPending_ = true;
+    bool stopping_ = false;
+    std::thread worker_;
+};
@@ -1,67 +1,306 @@
 ﻿#include "Logger.h"
 
-#include <chrono>
+#include <algorithm>
 #include <codecvt>
-#include <iomanip>
-#include <sstream>
-#include <stdexcept>
-#include <locale>
+#include <cwchar>
 #include <iostream>
+#include <locale>
+#include <stdexcept>
+#include <system_error>
 #include <utility>
+#include <vector>
+
+namespace {
+// Without an explicit flush or error the background thread wakes up this often.
+constexpr auto kIdleWait = std::chrono::milliseconds(20);
+constexpr size_t kMaxBatch = 256;
+// After a failed rename (e.g. another process holds the file) rotation is retried this late.
+constexpr auto kRotationRetry = std::chrono::minutes(1);
 
-void Logger::EnableFileLogging(const std::filesystem::path& path) {
-    std::lock_guard<std::mutex> lock(mutex_);
+uint64_t Utf8Length(const std::wstring& text) {
+    uint64_t bytes = 0;
+    for (const wchar_t ch : text) {
+        const auto code = static_cast<uint32_t>(ch);
+        if (code < 0x80) {
+            bytes += 1;
+        } else if (code < 0x800 || (code >= 0xD800 && code <= 0xDFFF)) {
+            bytes += 2;   // a UTF-16 surrogate pair encodes as 4 bytes
+        } else if (code < 0x10000) {
+            bytes += 3;
+        } else {
+            bytes += 4;
+        }
+    }
+    return bytes;
+}
+}
+
+Logger::Logger()
+    : slots_(std::make_unique<Slot[]>(kQueueCapacity)) {
+    for (size_t i = 0; i < kQueueCapacity; ++i) {
+        slots_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    worker_ = std::thread([this]() { Run(); });
+}
+
+Logger::~Logger() {
+    {
+        std::lock_guard<std::mutex> lock(wakeMutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    if (worker_.joinable()) {
+        worker_.join();
+    }
+    archiver_.reset();
+}
+
+void Logger::EnableFileLogging(const std::filesystem::path& path, LogRotationPolicy rotation) {
+    std::lock_guard<std::mutex> lock(configMutex_);
     if (path.has_parent_path() && !path.parent_path().empty()) {
         std::filesystem::create_directories(path.parent_path());
     }
-    file_.open(path, std::ios::app);
-    if (!file_) {
+    if (file_.is_open()) {
+        file_.close();
+    }
+    filePath_ = path;
+    if (!OpenFileLocked(std::chrono::system_clock::now())) {
         throw std::runtime_error("打开日志文件失败：" + path.string());
     }
-    // Ensure Unicode device names serialize reliably (UTF-8 on disk)
-    file_.imbue(std::locale(std::locale::classic(), new std::codecvt_utf8_utf16<wchar_t>()));
     fileEnabled_ = true;
-    filePath_ = path;
+    archiver_.reset();
+    rotation_ = std::move(rotation);
+    if (rotation_.Enabled()) {
+        archiver_ = std::make_unique<LogArchiver>(path, rotation_, [this](const std::wstring& message) { Warn(message); });
+    }
 }
 
 void Logger::SetSink(std::function<void(LogLevel, const std::wstring&)> sink) {
-    std::lock_guard<std::mutex> lock(mutex_);
+    std::lock_guard<std::mutex> lock(configMutex_);
     sink_ = std::move(sink);
 }
 
-void Logger::Log(LogLevel level, const std::wstring& message) {
-    const std::wstring line = Timestamp() + L" [" + LevelLabel(level) + L"] " + message;
+void Logger::SetConsoleOutput(bool enabled) {
+    std::lock_guard<std::mutex> lock(configMutex_);
+    consoleEnabled_ = enabled;
+}
+
+bool Logger::Log(LogLevel level, std::wstring_view message) {
+    // Bounded MPSC queue (Vyukov): a slot is free for position p when its sequence equals p.
+    // Info leaves the last kReservedSlots to warnings and errors, so a burst of status lines
+    // cannot crowd out the message that explains a failure.
+    const size_t headroom = level == LogLevel::Info ? kReservedSlots : 0;
+    size_t pos = enqueuePos_.load(std::memory_order_relaxed);
+    Slot* slot = nullptr;
+    while (true) {
+        slot = &slots_[pos & (kQueueCapacity - 1)];
+        const size_t sequence = slot->sequence.load(std::memory_order_acquire);
+        const auto diff = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(pos);
+        if (diff == 0) {
+            if (headroom != 0) {
+                const size_t ahead = pos + headroom;
+                const size_t aheadSequence = slots_[ahead & (kQueueCapacity - 1)].sequence.load(std::memory_order_acquire);
+                if (static_cast<std::ptrdiff_t>(aheadSequence) - static_cast<std::ptrdiff_t>(ahead) < 0) {
+                    dropped_.fetch_add(1, std::memory_order_relaxed);
+                    return false;
+                }
+            }
+            if (enqueuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            if (level == LogLevel::Error) {
+                // Errors are never dropped: wait for the writer thread to free a slot.
+                wake_.notify_one();
+                std::this_thread::yield();
+                pos = enqueuePos_.load(std::memory_order_relaxed);
+                continue;
+            }
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        } else {
+            pos = enqueuePos_.load(std::memory_order_relaxed);
+        }
+    }
+
+    slot->level = level;
+    slot->time = std::chrono::system_clock::now();
+    size_t length = std::min(message.size(), kMaxMessageChars);
+    std::wmemcpy(slot->text, message.data(), length);
+    if (message.size() > kMaxMessageChars) {
+        slot->text[kMaxMessageChars - 1] = L'…';
+    }
+    slot->length = static_cast<uint32_t>(length);
+    slot->sequence.store(pos + 1, std::memory_order_release);
+
     if (level == LogLevel::Error) {
-        std::wcerr << line << std::endl;
-    } else {
-        std::wcout << line << std::endl;
+        wake_.notify_one();
     }
+    return true;
+}
+
+void Logger::Flush() {
+    const size_t target = enqueuePos_.load(std::memory_order_acquire);
+    std::unique_lock<std::mutex> lock(wakeMutex_);
+    wake_.notify_one();
+    flushed_.wait(lock, [this, target]() {
+        return stopping_ || writtenPos_.load(std::memory_order_acquire) >= target;
+    });
+}
+
+void Logger::Run() {
+    std::unique_lock<std::mutex> lock(wakeMutex_);
+    while (true) {
+        const bool stop = stopping_;
+        lock.unlock();
+        while (Drain() > 0) {
+        }
+        lock.lock();
+        flushed_.notify_all();
+        if (stop) {
+            break;
+        }
+        wake_.wait_for(lock, kIdleWait);
+    }
+}
+
+size_t Logger::Drain() {
+    struct Entry {
+        LogLevel level;
+        std::wstring line;
+    };
+    std::vector<Entry> batch;
+    while (batch.size() < kMaxBatch) {
+        Slot& slot = slots_[dequeuePos_ & (kQueueCapacity - 1)];
+        if (slot.sequence.load(std::memory_order_acquire) != dequeuePos_ + 1) {
+            break;
+        }
+        std::wstring line = Timestamp(slot.time);
+        line += L" [";
+        line += LevelLabel(slot.level);
+        line += L"] ";
+        line.append(slot.text, slot.length);
+        batch.push_back(Entry{slot.level, std::move(line)});
+        slot.sequence.store(dequeuePos_ + kQueueCapacity, std::memory_order_release);
+        ++dequeuePos_;
+    }
+
+    const uint64_t dropped = dropped_.load(std::memory_order_relaxed);
+    if (dropped != droppedReported_) {
+        batch.push_back(Entry{LogLevel::Warning,
+                              Timestamp(std::chrono::system_clock::now()) + L" [" + LevelLabel(LogLevel::Warning) +
+                                  L"] 日志队列已满，丢弃了 " + std::to_wstring(dropped - droppedReported_) + L" 条日志。"});
+        droppedReported_ = dropped;
+    }
+    if (batch.empty()) {
+        return 0;
+    }
+
     std::function<void(LogLevel, const std::wstring&)> sinkCopy;
     {
-        std::lock_guard<std::mutex> lock(mutex_);
+        std::lock_guard<std::mutex> lock(configMutex_);
+        if (consoleEnabled_) {
+            bool wroteOut = false;
+            bool wroteErr = false;
+            for (const auto& entry : batch) {
+                if (entry.level == LogLevel::Error) {
+                    std::wcerr << entry.line << L'\n';
+                    wroteErr = true;
+                } else {
+                    std::wcout << entry.line << L'\n';
+                    wroteOut = true;
+                }
+            }
+            if (wroteOut) {
+                std::wcout.flush();
+            }
+            if (wroteErr) {
+                std::wcerr.flush();
+            }
+        }
         if (fileEnabled_ && file_) {
-            file_ << line << std::endl;
+            const auto now = std::chrono::system_clock::now();
+            if (RotationDueLocked(now)) {
+                RotateLocked(now);
+            }
+            for (const auto& entry : batch) {
+                file_ << entry.line << L'\n';
+                fileBytes_ += Utf8Length(entry.line) + 1;
+            }
+            file_.flush();
         }
         sinkCopy = sink_;
     }
     if (sinkCopy) {
-        sinkCopy(level, line);
+        for (const auto& entry : batch) {
+            sinkCopy(entry.level, entry.line);
+        }
     }
+    writtenPos_.store(dequeuePos_, std::memory_order_release);
+    return batch.size();
 }
 
-std::wstring Logger::Timestamp() const {
-    using namespace std::chrono;
-    auto now = system_clock::now();
-    auto timeT = system_clock::to_time_t(now);
-    std::tm tm{};
+bool Logger::OpenFileLocked(std::chrono::system_clock::time_point now) {
+    file_.clear();
+    file_.open(filePath_, std::ios::app);
+    if (!file_) {
+        return false;
+    }
+    // Ensure Unicode device names serialize reliably (UTF-8 on disk)
+    file_.imbue(std::locale(std::locale::classic(), new std::codecvt_utf8_utf16<wchar_t>()));
+    std::error_code ec;
+    const auto existing = std::filesystem::file_size(filePath_, ec);
+    fileBytes_ = ec ? 0 : existing;
+    fileOpened_ = now;
+    return true;
+}
+
+bool Logger::RotationDueLocked(std::chrono::system_clock::time_point now) const {
+    if (!rotation_.Enabled() || fileBytes_ == 0 || now < rotationRetryAfter_) {
+        return false;
+    }
+    if (rotation_.maxBytes && fileBytes_ >= *rotation_.maxBytes) {
+        return true;
+    }
+    return rotation_.maxAge && now - fileOpened_ >= *rotation_.maxAge;
+}
+
+void Logger::RotateLocked(std::chrono::system_clock::time_point now) {
+    // Only this thread writes the file, so the swap is close/rename/reopen; loggers keep
+    // enqueueing meanwhile and compression happens later on the archiver thread.
+    const std::filesystem::path rotated = BuildRotatedLogPath(filePath_, now);
+    file_.close();
+    std::error_code ec;
+    std::filesystem::rename(filePath_, rotated, ec);
+    if (!OpenFileLocked(now)) {
+        Warn(L"轮转后无法重新打开日志文件：" + filePath_.wstring());
+        return;
+    }
+    if (ec) {
+        rotationRetryAfter_ = now + kRotationRetry;
+        Warn(L"日志轮转失败，继续写入当前文件：" + filePath_.wstring());
+        return;
+    }
+    if (archiver_) {
+        archiver_->Enqueue(rotated);
+    }
+}
+
+const std::wstring& Logger::Timestamp(std::chrono::system_clock::time_point time) {
+    const std::time_t timeT = std::chrono::system_clock::to_time_t(time);
+    if (timeT != cachedSecond_) {
+        std::tm tm{};
 #if defined(_WIN32)
-    localtime_s(&tm, &timeT);
+        localtime_s(&tm, &timeT);
 #else
-    localtime_r(&timeT, &tm);
+        localtime_r(&timeT, &tm);
 #endif
-    std::wstringstream ss;
-    ss << std::put_time(&tm, L"%Y-%m-%d %H:%M:%S");
-    return ss.str();
+        wchar_t buffer[32];
+        const size_t length = std::wcsftime(buffer, sizeof(buffer) / sizeof(buffer[0]), L"%Y-%m-%d %H:%M:%S", &tm);
+        cachedTimestamp_.assign(buffer, length);
+        cachedSecond_ = timeT;
+    }
+    return cachedTimestamp_;
 }
 
 std::wstring Logger::LevelLabel(LogLevel level) const {
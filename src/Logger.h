@@ -1,10 +1,21 @@
 #pragma once
 
+#include "LogRotation.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
 #include <filesystem>
 #include <fstream>
 #include <functional>
+#include <memory>
 #include <mutex>
 #include <string>
+#include <string_view>
+#include <thread>
 
 enum class LogLevel {
     Info,
@@ -12,25 +23,84 @@ enum class LogLevel {
     Error
 };
 
+// Asynchronous logger. Log() copies the message into a slot of a bounded lock-free MPSC
+// queue and returns; a background thread formats timestamps, writes the console and the
+// log file in batches and calls the sink. When the queue is full an Info or Warning message
+// is dropped and counted rather than blocking the caller (capture/writer threads log too);
+// Info already gives way kReservedSlots early. Errors are never dropped: with the queue
+// completely full the caller waits for the writer thread.
+// The log file is rotated by the background thread between batches (close, rename,
+// reopen); compression and retention of rotated files run on a separate archiver thread.
 class Logger {
 public:
-    Logger() = default;
+    Logger();
+    ~Logger();
+
+    Logger(const Logger&) = delete;
+    Logger& operator=(const Logger&) = delete;
 
-    void EnableFileLogging(const std::filesystem::path& path);
+    void EnableFileLogging(const std::filesystem::path& path, LogRotationPolicy rotation = {});
     void SetSink(std::function<void(LogLevel, const std::wstring&)> sink);
+    void SetConsoleOutput(bool enabled);
+
+    // Views, so logging a literal or a preformatted buffer does not allocate.
+    // False when the message was dropped.
+    bool Log(LogLevel level, std::wstring_view message);
+    void Info(std::wstring_view message) { Log(LogLevel::Info, message); }
+    void Warn(std::wstring_view message) { Log(LogLevel::Warning, message); }
+    void Error(std::wstring_view message) { Log(LogLevel::Error, message); }
+
+    // Blocks until everything logged before the call has been written.
+    void Flush();
+    uint64_t DroppedMessages() const { return dropped_.load(std::memory_order_relaxed); }
 
-    void Log(LogLevel level, const std::wstring& message);
-    void Info(const std::wstring& message) { Log(LogLevel::Info, message); }
-    void Warn(const std::wstring& message) { Log(LogLevel::Warning, message); }
-    void Error(const std::wstring& message) { Log(LogLevel::Error, message); }
+    static constexpr size_t kMaxMessageChars = 480;   // longer messages are truncated
+    static constexpr size_t kQueueCapacity = 1024;    // power of two
+    static constexpr size_t kReservedSlots = 64;      // kept free of Info for warnings and errors
 
 private:
-    std::wstring Timestamp() const;
+    struct Slot {
+        std::atomic<size_t> sequence{0};
+        LogLevel level = LogLevel::Info;
+        std::chrono::system_clock::time_point time{};
+        uint32_t length = 0;
+        wchar_t text[kMaxMessageChars];
+    };
+
+    void Run();
+    size_t Drain();
+    const std::wstring& Timestamp(std::chrono::system_clock::time_point time);
     std::wstring LevelLabel(LogLevel level) const;
+    bool OpenFileLocked(std::chrono::system_clock::time_point now);
+    bool RotationDueLocked(std::chrono::system_clock::time_point now) const;
+    void RotateLocked(std::chrono::system_clock::time_point now);
+
+    std::unique_ptr<Slot[]> slots_;
+    alignas(64) std::atomic<size_t> enqueuePos_{0};
+    alignas(64) size_t dequeuePos_ = 0;                 // consumer thread only
+    std::atomic<size_t> writtenPos_{0};                 // records fully written, for Flush()
+    std::atomic<uint64_t> dropped_{0};
+    uint64_t droppedReported_ = 0;
+
+    // Timestamp cache, consumer thread only.
+    std::time_t cachedSecond_ = -1;
+    std::wstring cachedTimestamp_;
 
     std::wofstream file_;
     bool fileEnabled_ = false;
+    bool consoleEnabled_ = true;
     std::filesystem::path filePath_;
-    mutable std::mutex mutex_;
+    LogRotationPolicy rotation_;
+    uint64_t fileBytes_ = 0;                            // UTF-8 bytes in the active file
+    std::chrono::system_clock::time_point fileOpened_{};
+    std::chrono::system_clock::time_point rotationRetryAfter_{};
+    std::unique_ptr<LogArchiver> archiver_;
     std::function<void(LogLevel, const std::wstring&)> sink_;
+    std::mutex configMutex_;                            // file_/sink_/console flag vs. consumer
+
+    std::mutex wakeMutex_;
+    std::condition_variable wake_;
+    std::condition_variable flushed_;
+    bool stopping_ = false;
+    std::thread worker_;
 };
@@ -0,0 +1,247 @@
+#include "MetricsExporter.h"
+
+#if defined(_WIN32)
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+
+namespace {
+
+constexpr uintptr_t kNoSocket = ~static_cast<uintptr_t>(0);
+constexpr size_t kMaxRequestBytes = 8192;
+constexpr auto kPollSlice = std::chrono::milliseconds(200);
+
+#if defined(_WIN32)
+using NativeSocket = SOCKET;
+void CloseNativeSocket(NativeSocket socket) { closesocket(socket); }
+constexpr int kSendFlags = 0;
+#else
+using NativeSocket = int;
+void CloseNativeSocket(NativeSocket socket) { close(socket); }
+// A scraper that hangs up mid-response must not SIGPIPE the recorder.
+constexpr int kSendFlags = MSG_NOSIGNAL;
+#endif
+
+NativeSocket ToNative(uintptr_t socket) {
+    return static_cast<NativeSocket>(socket);
+}
+
+void SetReceiveTimeout(NativeSocket socket, std::chrono::milliseconds timeout) {
+#if defined(_WIN32)
+    const DWORD value = static_cast<DWORD>(timeout.count());
+    setsockopt(socket, SOL_SOCKET, SO_RCVTIMEO, reinterpret_cast<const char*>(&value), sizeof(value));
+    setsockopt(socket, SOL_SOCKET, SO_SNDTIMEO, reinterpret_cast<const char*>(&value), sizeof(value));
+#else
+    timeval value{};
+    value.tv_sec = static_cast<time_t>(timeout.count() / 1000);
+    value.tv_usec = static_cast<suseconds_t>((timeout.count() % 1000) * 1000);
+    setsockopt(socket, SOL_SOCKET, SO_RCVTIMEO, &value, sizeof(value));
+    setsockopt(socket, SOL_SOCKET, SO_SNDTIMEO, &value, sizeof(value));
+#endif
+}
+
+void SendAll(NativeSocket socket, const std::string& data) {
+    size_t sent = 0;
+    while (sent < data.size()) {
+        const int chunk = static_cast<int>(std::min<size_t>(data.size() - sent, 64 * 1024));
+        const auto result = send(socket, data.data() + sent, chunk, kSendFlags);
+        if (result <= 0) {
+            return;
+        }
+        sent += static_cast<size_t>(result);
+    }
+}
+
+std::string HttpResponse(const char* status, const char* contentType, const std::string& body) {
+    std::string response = "HTTP/1.1 ";
+    response += status;
+    response += "\r\nContent-Type: ";
+    response += contentType;
+    response += "\r\nContent-Length: " + std::to_string(body.size());
+    response += "\r\nConnection: close\r\n\r\n";
+    response += body;
+    return response;
+}
+
+} // namespace
+
+MetricsExporter::MetricsExporter(const RecorderMetrics& metrics, MetricsExporterOptions options, Logger& logger)
+    : metrics_(metrics), options_(std::move(options)), logger_(logger), listenSocket_(kNoSocket) {}
+
+MetricsExporter::~MetricsExporter() {
+    Stop();
+}
+
+void MetricsExporter::Start() {
+    if (options_.httpPort) {
+#if defined(_WIN32)
+        WSADATA data{};
+        if (WSAStartup(MAKEWORD(2, 2), &data) != 0) {
+            throw std::runtime_error("WSAStartup 失败");
+        }
+#endif
+        const NativeSocket socketHandle = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+#if defined(_WIN32)
+        const bool created = socketHandle != INVALID_SOCKET;
+#else
+        const bool created = socketHandle >= 0;
+#endif
+        if (!created) {
+#if defined(_WIN32)
+            WSACleanup();
+#endif
+            throw std::runtime_error("创建指标监听套接字失败");
+        }
+        int reuse = 1;
+        setsockopt(socketHandle, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&reuse), sizeof(reuse));
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_port = htons(*options_.httpPort);
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (bind(socketHandle, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0 ||
+            listen(socketHandle, 8) != 0) {
+            CloseNativeSocket(socketHandle);
+#if defined(_WIN32)
+            WSACleanup();
+#endif
+            throw std::runtime_error("无法监听指标端口 127.0.0.1:" + std::to_string(*options_.httpPort));
+        }
+        listenSocket_ = static_cast<uintptr_t>(socketHandle);
+        logger_.Info(L"[指标] Prometheus 端点：http://127.0.0.1:" + std::to_wstring(*options_.httpPort) + L"/metrics");
+    }
+    if (options_.textfilePath) {
+        logger_.Info(L"[指标] 定期写入文本文件：" + options_.textfilePath->wstring());
+    }
+    if (options_.httpPort || options_.textfilePath) {
+        worker_ = std::thread([this]() { Run(); });
+    }
+}
+
+void MetricsExporter::Stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stopping_.exchange(true)) {
+            return;
+        }
+    }
+    wake_.notify_all();
+    if (worker_.joinable()) {
+        worker_.join();
+    }
+    if (listenSocket_ != kNoSocket) {
+        CloseNativeSocket(ToNative(listenSocket_));
+        listenSocket_ = kNoSocket;
+#if defined(_WIN32)
+        WSACleanup();
+#endif
+    }
+    if (options_.textfilePath) {
+        try {
+            WriteTextfile(*options_.textfilePath, RenderPrometheusText(metrics_));
+        } catch (const std::exception&) {
+            logger_.Warn(L"[指标] 写入指标文件失败：" + options_.textfilePath->wstring());
+        }
+    }
+}
+
+void MetricsExporter::WriteTextfile(const std::filesystem::path& path, const std::string& text) {
+    // The collector must never see a half-written file: write a sibling and rename over.
+    std::filesystem::path temp = path;
+    temp += L".tmp";
+    {
+        std::ofstream file(temp, std::ios::binary | std::ios::trunc);
+        if (!file) {
+            throw std::runtime_error("无法写入指标文件：" + temp.string());
+        }
+        file.write(text.data(), static_cast<std::streamsize>(text.size()));
+        if (!file) {
+            throw std::runtime_error("写入指标文件失败：" + temp.string());
+        }
+    }
+    std::filesystem::rename(temp, path);
+}
+
+void MetricsExporter::Run() {
+    auto nextWrite = std::chrono::steady_clock::now();
+    while (!stopping_.load(std::memory_order_acquire)) {
+        const auto now = std::chrono::steady_clock::now();
+        if (options_.textfilePath && now >= nextWrite) {
+            try {
+                WriteTextfile(*options_.textfilePath, RenderPrometheusText(metrics_));
+                textfileFailureLogged_ = false;
+            } catch (const std::exception&) {
+                if (!textfileFailureLogged_) {
+                    logger_.Warn(L"[指标] 写入指标文件失败：" + options_.textfilePath->wstring());
+                    textfileFailureLogged_ = true;
+                }
+            }
+            nextWrite = now + options_.textfileInterval;
+        }
+
+        if (listenSocket_ == kNoSocket) {
+            std::unique_lock<std::mutex> lock(mutex_);
+            wake_.wait_until(lock, nextWrite, [this]() { return stopping_.load(std::memory_order_acquire); });
+            continue;
+        }
+
+        // Short select() slices keep Stop() responsive without a second wake-up mechanism.
+        const NativeSocket listener = ToNative(listenSocket_);
+        fd_set readable;
+        FD_ZERO(&readable);
+        FD_SET(listener, &readable);
+        timeval timeout{};
+        timeout.tv_usec = static_cast<decltype(timeout.tv_usec)>(
+            std::chrono::duration_cast<std::chrono::microseconds>(kPollSlice).count());
+        const int ready = select(static_cast<int>(listener) + 1, &readable, nullptr, nullptr, &timeout);
+        if (ready > 0 && FD_ISSET(listener, &readable)) {
+            ServeOneClient();
+        }
+    }
+}
+
+void MetricsExporter::ServeOneClient() {
+    const NativeSocket client = accept(ToNative(listenSocket_), nullptr, nullptr);
+#if defined(_WIN32)
+    if (client == INVALID_SOCKET) {
+        return;
+    }
+#else
+    if (client < 0) {
+        return;
+    }
+#endif
+    SetReceiveTimeout(client, std::chrono::milliseconds(1000));
+
+    std::string request;
+    char buffer[1024];
+    while (request.find("\r\n\r\n") == std::string::npos && request.size() < kMaxRequestBytes) {
+        const auto received = recv(client, buffer, static_cast<int>(sizeof(buffer)), 0);
+        if (received <= 0) {
+            break;
+        }
+        request.append(buffer, static_cast<size_t>(received));
+    }
+
+    const size_t lineEnd = request.find("\r\n");
+    const std::string requestLine = request.substr(0, lineEnd);
+    if (requestLine.rfind("GET /metrics ", 0) == 0 || requestLine.rfind("GET / ", 0) == 0) {
+        SendAll(client, HttpResponse("200 OK", "text/plain; version=0.0.4; charset=utf-8", RenderPrometheusText(metrics_)));
+    } else if (requestLine.rfind("GET ", 0) == 0) {
+        SendAll(client, HttpResponse("404 Not Found", "text/plain", "not found\n"));
+    } else {
+        SendAll(client, HttpResponse("405 Method Not Allowed", "text/plain", "only GET is supported\n"));
+    }
+    CloseNativeSocket(client);
+}
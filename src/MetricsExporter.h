@@ -0,0 +1,54 @@
+#pragma once
+
+#include "Logger.h"
+#include "RecorderMetrics.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <thread>
+
+struct MetricsExporterOptions {
+    // node_exporter textfile collector target; rewritten atomically (temp file + rename).
+    std::optional<std::filesystem::path> textfilePath;
+    // Serves GET /metrics on 127.0.0.1:<port>.
+    std::optional<uint16_t> httpPort;
+    std::chrono::milliseconds textfileInterval{5000};
+};
+
+// Publishes RecorderMetrics on its own thread. Rendering only loads atomics, so neither the
+// file writes nor HTTP scrapes interact with the capture or writer threads.
+class MetricsExporter {
+public:
+    MetricsExporter(const RecorderMetrics& metrics, MetricsExporterOptions options, Logger& logger);
+    ~MetricsExporter();
+
+    MetricsExporter(const MetricsExporter&) = delete;
+    MetricsExporter& operator=(const MetricsExporter&) = delete;
+
+    // Binds the HTTP port (throws std::runtime_error on failure) and starts the thread.
+    void Start();
+    // Writes the textfile once more so the final counters are visible after exit.
+    void Stop();
+
+    static void WriteTextfile(const std::filesystem::path& path, const std::string& text);
+
+private:
+    void Run();
+    void ServeOneClient();
+
+    const RecorderMetrics& metrics_;
+    const MetricsExporterOptions options_;
+    Logger& logger_;
+    uintptr_t listenSocket_;
+    bool textfileFailureLogged_ = false;
+
+    std::atomic<bool> stopping_{false};
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::thread worker_;
+};
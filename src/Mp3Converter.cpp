@@ -1,54 +1,81 @@
 ﻿#include "Mp3Converter.h"
+#include "Tracer.h"
 
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
 #include <Windows.h>
-#include <mmreg.h>
-#include <ks.h>
-#include <ksmedia.h>
+#else
+#include <dlfcn.h>
+#endif
 
 #include <algorithm>
 #include <array>
 #include <cmath>
+#include <condition_variable>
 #include <cstdint>
+#include <cstdlib>
 #include <cstring>
+#include <exception>
 #include <filesystem>
 #include <fstream>
+#include <functional>
+#include <iterator>
+#include <memory>
 #include <mutex>
+#include <optional>
 #include <stdexcept>
 #include <string>
+#include <thread>
 #include <vector>
 
 namespace {
 
+#if defined(_WIN32)
+#define LAME_CDECL __cdecl
+using LibraryHandle = HMODULE;
+#else
+#define LAME_CDECL
+using LibraryHandle = void*;
+#endif
+
 using lame_t = void*;
 
 struct LameApi {
-    HMODULE module = nullptr;
+    LibraryHandle module = nullptr;
     std::wstring modulePath;
-    lame_t (__cdecl* init)() = nullptr;
-    int (__cdecl* close)(lame_t) = nullptr;
-    int (__cdecl* set_num_channels)(lame_t, int) = nullptr;
-    int (__cdecl* set_in_samplerate)(lame_t, int) = nullptr;
-    int (__cdecl* set_out_samplerate)(lame_t, int) = nullptr;
-    int (__cdecl* set_brate)(lame_t, int) = nullptr;
-    int (__cdecl* set_mode)(lame_t, int) = nullptr;
-    int (__cdecl* set_quality)(lame_t, int) = nullptr;
-    int (__cdecl* init_params)(lame_t) = nullptr;
-    int (__cdecl* encode_buffer_interleaved)(lame_t, short int*, int, unsigned char*, int) = nullptr;
-    int (__cdecl* flush)(lame_t, unsigned char*, int) = nullptr;
+    lame_t (LAME_CDECL* init)() = nullptr;
+    int (LAME_CDECL* close)(lame_t) = nullptr;
+    int (LAME_CDECL* set_num_channels)(lame_t, int) = nullptr;
+    int (LAME_CDECL* set_in_samplerate)(lame_t, int) = nullptr;
+    int (LAME_CDECL* set_out_samplerate)(lame_t, int) = nullptr;
+    int (LAME_CDECL* set_brate)(lame_t, int) = nullptr;
+    int (LAME_CDECL* set_mode)(lame_t, int) = nullptr;
+    int (LAME_CDECL* set_quality)(lame_t, int) = nullptr;
+    int (LAME_CDECL* init_params)(lame_t) = nullptr;
+    int (LAME_CDECL* encode_buffer_interleaved)(lame_t, short int*, int, unsigned char*, int) = nullptr;
+    int (LAME_CDECL* flush)(lame_t, unsigned char*, int) = nullptr;
 };
 
 constexpr int kLameModeStereo = 1;
 constexpr int kLameModeMono = 3;
 constexpr size_t kFramesPerChunk = 4096;
 
-std::wstring GetEnvVar(const wchar_t* name) {
-    DWORD length = GetEnvironmentVariableW(name, nullptr, 0);
+#if defined(_WIN32)
+const std::array<const wchar_t*, 2> kLameLibraryNames = { L"libmp3lame.dll", L"lame_enc.dll" };
+constexpr const char* kLameMissing =
+    "无法加载 libmp3lame.dll 或 lame_enc.dll。请将 DLL 放在 loopback_recorder.exe 同目录，设置 LAME_DLL_PATH，"
+    "或安装 Windows 版 LAME。";
+
+std::filesystem::path LameLibraryOverride() {
+    DWORD length = GetEnvironmentVariableW(L"LAME_DLL_PATH", nullptr, 0);
     if (length == 0) {
         return {};
     }
     std::wstring value;
     value.resize(length - 1);
-    GetEnvironmentVariableW(name, value.data(), length);
+    GetEnvironmentVariableW(L"LAME_DLL_PATH", value.data(), length);
     return value;
 }
 
@@ -62,57 +89,107 @@ std::filesystem::path GetModuleDirectory() {
     return exePath.parent_path();
 }
 
+LibraryHandle OpenLibrary(const std::filesystem::path& path) {
+    return LoadLibraryW(path.c_str());
+}
+
+void* LibrarySymbol(LibraryHandle module, const char* name) {
+    return reinterpret_cast<void*>(GetProcAddress(module, name));
+}
+
+void CloseLibrary(LibraryHandle module) {
+    FreeLibrary(module);
+}
+
+std::wstring LibraryPath(LibraryHandle module, void*) {
+    std::array<wchar_t, MAX_PATH> pathBuffer{};
+    DWORD len = GetModuleFileNameW(module, pathBuffer.data(), static_cast<DWORD>(pathBuffer.size()));
+    if (len > 0 && len < pathBuffer.size()) {
+        return std::wstring(pathBuffer.data(), len);
+    }
+    return {};
+}
+#else
+const std::array<const char*, 2> kLameLibraryNames = { "libmp3lame.so.0", "libmp3lame.so" };
+constexpr const char* kLameMissing =
+    "无法加载 libmp3lame.so.0。请安装 LAME 共享库（如 libmp3lame0 软件包），或设置 LAME_DLL_PATH 指向该库。";
+
+std::filesystem::path LameLibraryOverride() {
+    const char* value = std::getenv("LAME_DLL_PATH");
+    return value ? std::filesystem::path(value) : std::filesystem::path();
+}
+
+std::filesystem::path GetModuleDirectory() {
+    std::error_code ec;
+    const auto exePath = std::filesystem::read_symlink("/proc/self/exe", ec);
+    return ec ? std::filesystem::current_path() : exePath.parent_path();
+}
+
+LibraryHandle OpenLibrary(const std::filesystem::path& path) {
+    return dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL);
+}
+
+void* LibrarySymbol(LibraryHandle module, const char* name) {
+    return dlsym(module, name);
+}
+
+void CloseLibrary(LibraryHandle module) {
+    dlclose(module);
+}
+
+std::wstring LibraryPath(LibraryHandle, void* symbol) {
+    Dl_info info{};
+    if (dladdr(symbol, &info) && info.dli_fname) {
+        return std::filesystem::path(info.dli_fname).wstring();
+    }
+    return {};
+}
+#endif
+
 LameApi LoadLameApi() {
     std::vector<std::filesystem::path> candidates;
-    const auto userPath = GetEnvVar(L"LAME_DLL_PATH");
+    const auto userPath = LameLibraryOverride();
     if (!userPath.empty()) {
-        candidates.emplace_back(userPath);
+        candidates.push_back(userPath);
     }
     const auto exeDir = GetModuleDirectory();
-    const std::array<const wchar_t*, 2> defaultNames = { L"libmp3lame.dll", L"lame_enc.dll" };
-    for (const auto* name : defaultNames) {
+    for (const auto* name : kLameLibraryNames) {
         candidates.push_back(exeDir / name);
     }
-    for (const auto* name : defaultNames) {
+    for (const auto* name : kLameLibraryNames) {
         candidates.emplace_back(name);
     }
 
-    HMODULE module = nullptr;
     for (const auto& candidate : candidates) {
-        module = LoadLibraryW(candidate.c_str());
+        LibraryHandle module = OpenLibrary(candidate);
         if (module) {
             LameApi api;
             api.module = module;
-            std::array<wchar_t, MAX_PATH> pathBuffer{};
-            DWORD len = GetModuleFileNameW(module, pathBuffer.data(), static_cast<DWORD>(pathBuffer.size()));
-            if (len > 0 && len < pathBuffer.size()) {
-                api.modulePath.assign(pathBuffer.data(), len);
-            }
             auto require = [&](const char* name) {
-                FARPROC proc = GetProcAddress(module, name);
+                void* proc = LibrarySymbol(module, name);
                 if (!proc) {
-                    FreeLibrary(module);
+                    CloseLibrary(module);
                     throw std::runtime_error(std::string("libmp3lame 缺少符号：") + name);
                 }
                 return proc;
             };
-            api.init = reinterpret_cast<lame_t (__cdecl*)()>(require("lame_init"));
-            api.close = reinterpret_cast<int (__cdecl*)(lame_t)>(require("lame_close"));
-            api.set_num_channels = reinterpret_cast<int (__cdecl*)(lame_t, int)>(require("lame_set_num_channels"));
-            api.set_in_samplerate = reinterpret_cast<int (__cdecl*)(lame_t, int)>(require("lame_set_in_samplerate"));
-            api.set_out_samplerate = reinterpret_cast<int (__cdecl*)(lame_t, int)>(require("lame_set_out_samplerate"));
-            api.set_brate = reinterpret_cast<int (__cdecl*)(lame_t, int)>(require("lame_set_brate"));
-            api.set_mode = reinterpret_cast<int (__cdecl*)(lame_t, int)>(require("lame_set_mode"));
-            api.set_quality = reinterpret_cast<int (__cdecl*)(lame_t, int)>(require("lame_set_quality"));
-            api.init_params = reinterpret_cast<int (__cdecl*)(lame_t)>(require("lame_init_params"));
-            api.encode_buffer_interleaved = reinterpret_cast<int (__cdecl*)(lame_t, short int*, int, unsigned char*, int)>(require("lame_encode_buffer_interleaved"));
-            api.flush = reinterpret_cast<int (__cdecl*)(lame_t, unsigned char*, int)>(require("lame_encode_flush"));
+            void* init = require("lame_init");
+            api.modulePath = LibraryPath(module, init);
+            api.init = reinterpret_cast<lame_t (LAME_CDECL*)()>(init);
+            api.close = reinterpret_cast<int (LAME_CDECL*)(lame_t)>(require("lame_close"));
+            api.set_num_channels = reinterpret_cast<int (LAME_CDECL*)(lame_t, int)>(require("lame_set_num_channels"));
+            api.set_in_samplerate = reinterpret_cast<int (LAME_CDECL*)(lame_t, int)>(require("lame_set_in_samplerate"));
+            api.set_out_samplerate = reinterpret_cast<int (LAME_CDECL*)(lame_t, int)>(require("lame_set_out_samplerate"));
+            api.set_brate = reinterpret_cast<int (LAME_CDECL*)(lame_t, int)>(require("lame_set_brate"));
+            api.set_mode = reinterpret_cast<int (LAME_CDECL*)(lame_t, int)>(require("lame_set_mode"));
+            api.set_quality = reinterpret_cast<int (LAME_CDECL*)(lame_t, int)>(require("lame_set_quality"));
+            api.init_params = reinterpret_cast<int (LAME_CDECL*)(lame_t)>(require("lame_init_params"));
+            api.encode_buffer_interleaved = reinterpret_cast<int (LAME_CDECL*)(lame_t, short int*, int, unsigned char*, int)>(require("lame_encode_buffer_interleaved"));
+            api.flush = reinterpret_cast<int (LAME_CDECL*)(lame_t, unsigned char*, int)>(require("lame_encode_flush"));
             return api;
         }
     }
-    throw std::runtime_error(
-        "无法加载 libmp3lame.dll 或 lame_enc.dll。请将 DLL 放在 loopback_recorder.exe 同目录，设置 LAME_DLL_PATH，"
-        "或安装 Windows 版 LAME。");
+    throw std::runtime_error(kLameMissing);
 }
 
 const LameApi& GetLameApi() {
@@ -133,7 +210,7 @@ const LameApi& GetLameApi() {
 }
 
 struct WavMetadata {
-    WAVEFORMATEX format{};
+    AudioFormat format{};
     uint64_t dataOffset = 0;
     uint64_t dataSize = 0;
 };
@@ -174,24 +251,12 @@ WavMetadata ParseWav(std::ifstream& stream) {
         }
         const std::string chunkId(chunk.id, chunk.id + 4);
         if (chunkId == "fmt ") {
-            std::vector<char> buffer(chunk.size);
-            ReadBytes(stream, buffer.data(), buffer.size());
+            std::vector<std::byte> buffer(chunk.size);
+            ReadBytes(stream, reinterpret_cast<char*>(buffer.data()), buffer.size());
             if (chunk.size & 1u) {
                 stream.seekg(1, std::ios::cur);
             }
-            if (buffer.size() < sizeof(WAVEFORMATEX)) {
-                throw std::runtime_error("fmt 块过小");
-            }
-            std::memcpy(&metadata.format, buffer.data(), sizeof(WAVEFORMATEX));
-            if (metadata.format.wFormatTag == WAVE_FORMAT_EXTENSIBLE && buffer.size() >= sizeof(WAVEFORMATEXTENSIBLE)) {
-                auto* ext = reinterpret_cast<const WAVEFORMATEXTENSIBLE*>(buffer.data());
-                metadata.format = ext->Format;
-                if (ext->SubFormat == KSDATAFORMAT_SUBTYPE_PCM) {
-                    metadata.format.wFormatTag = WAVE_FORMAT_PCM;
-                } else if (ext->SubFormat == KSDATAFORMAT_SUBTYPE_IEEE_FLOAT) {
-                    metadata.format.wFormatTag = WAVE_FORMAT_IEEE_FLOAT;
-                }
-            }
+            metadata.format = DecodeWaveFormatChunk(buffer.data(), buffer.size());
             fmtFound = true;
         } else if (chunkId == "data") {
             const auto dataPos = stream.tellg();
@@ -213,7 +278,7 @@ WavMetadata ParseWav(std::ifstream& stream) {
     if (!fmtFound || !dataFound) {
         throw std::runtime_error("WAV 文件缺少 fmt 或 data 块");
     }
-    if (metadata.format.nChannels == 0 || metadata.format.nSamplesPerSec == 0) {
+    if (metadata.format.channels == 0 || metadata.format.sampleRate == 0) {
         throw std::runtime_error("不支持的 WAV 格式");
     }
     if (metadata.dataSize == 0) {
@@ -241,12 +306,12 @@ int16_t FloatToInt16(float value) {
 
 void ConvertSamples(const uint8_t* source,
                     size_t frames,
-                    const WAVEFORMATEX& format,
+                    const AudioFormat& format,
                     size_t targetChannels,
                     std::vector<int16_t>& destination) {
     destination.resize(frames * targetChannels);
-    const size_t srcChannels = format.nChannels;
-    if (format.wFormatTag == WAVE_FORMAT_PCM && format.wBitsPerSample == 16) {
+    const size_t srcChannels = format.channels;
+    if (!format.floatSamples && format.bitsPerSample == 16) {
         const auto* samples = reinterpret_cast<const int16_t*>(source);
         if (srcChannels == targetChannels) {
             std::copy(samples, samples + frames * targetChannels, destination.begin());
@@ -286,7 +351,7 @@ void ConvertSamples(const uint8_t* source,
                 destination[frame * 2 + 1] = ClampToInt16(rightAcc / rightCount);
             }
         }
-    } else if (format.wFormatTag == WAVE_FORMAT_IEEE_FLOAT && format.wBitsPerSample == 32) {
+    } else if (format.floatSamples && format.bitsPerSample == 32) {
         const auto* samples = reinterpret_cast<const float*>(source);
         if (srcChannels == targetChannels) {
             for (size_t i = 0; i < frames * targetChannels; ++i) {
@@ -335,10 +400,248 @@ void ConvertSamples(const uint8_t* source,
 
 } // namespace
 
-void Mp3Converter::ConvertWavToMp3(const std::filesystem::path& wavPath,
-                                   const std::filesystem::path& mp3Path,
-                                   const Mp3ConversionOptions& options,
-                                   Logger& logger) {
+class Mp3Encoder {
+public:
+    Mp3Encoder(const std::filesystem::path& path, size_t channels, uint32_t sampleRate, uint32_t bitrateKbps)
+        : lame_(GetLameApi()), path_(path), bitrateKbps_(std::clamp<uint32_t>(bitrateKbps, 64, 320)) {
+        handle_ = lame_.init();
+        if (!handle_) {
+            throw std::runtime_error("lame_init 失败");
+        }
+        try {
+            lame_.set_num_channels(handle_, static_cast<int>(channels));
+            lame_.set_in_samplerate(handle_, static_cast<int>(sampleRate));
+            lame_.set_out_samplerate(handle_, static_cast<int>(sampleRate));
+            lame_.set_brate(handle_, static_cast<int>(bitrateKbps_));
+            lame_.set_mode(handle_, channels == 1 ? kLameModeMono : kLameModeStereo);
+            lame_.set_quality(handle_, 2);
+            if (lame_.init_params(handle_) < 0) {
+                throw std::runtime_error("lame_init_params 失败");
+            }
+            mp3Buffer_.resize(static_cast<size_t>(1.25 * kFramesPerChunk) + 8192);
+            stream_.open(path_, std::ios::binary | std::ios::trunc);
+            if (!stream_) {
+                throw std::runtime_error("打开 MP3 文件写入失败：" + path_.string());
+            }
+        } catch (...) {
+            lame_.close(handle_);
+            throw;
+        }
+    }
+
+    ~Mp3Encoder() { lame_.close(handle_); }
+
+    Mp3Encoder(const Mp3Encoder&) = delete;
+    Mp3Encoder& operator=(const Mp3Encoder&) = delete;
+
+    void Encode(const int16_t* pcm, size_t frames) {
+        if (!stream_) {
+            throw std::runtime_error("写入 MP3 文件失败：" + path_.string());
+        }
+        const size_t needed = static_cast<size_t>(1.25 * frames) + 7200;
+        if (mp3Buffer_.size() < needed) {
+            mp3Buffer_.resize(needed);
+        }
+        // LAME takes a non-const pointer but does not modify the input.
+        const int encoded = lame_.encode_buffer_interleaved(handle_,
+                                                            const_cast<short int*>(reinterpret_cast<const short int*>(pcm)),
+                                                            static_cast<int>(frames),
+                                                            mp3Buffer_.data(),
+                                                            static_cast<int>(mp3Buffer_.size()));
+        if (encoded < 0) {
+            throw std::runtime_error("lame_encode_buffer_interleaved 失败，错误码 " + std::to_string(encoded));
+        }
+        if (encoded > 0) {
+            WriteEncoded(mp3Buffer_.data(), static_cast<size_t>(encoded));
+        }
+    }
+
+    void Flush() {
+        stream_.flush();
+        if (!stream_) {
+            throw std::runtime_error("刷新 MP3 数据到磁盘失败");
+        }
+    }
+
+    // Drains the encoder and closes the file; throws if anything failed to reach it.
+    void Finish() {
+        const int flushBytes = lame_.flush(handle_, mp3Buffer_.data(), static_cast<int>(mp3Buffer_.size()));
+        if (flushBytes < 0) {
+            throw std::runtime_error("lame_encode_flush 失败，错误码 " + std::to_string(flushBytes));
+        }
+        if (flushBytes > 0) {
+            WriteEncoded(mp3Buffer_.data(), static_cast<size_t>(flushBytes));
+        }
+        stream_.flush();
+        const bool written = static_cast<bool>(stream_);
+        stream_.close();
+        if (!written) {
+            throw std::runtime_error("写入 MP3 文件失败：" + path_.string());
+        }
+    }
+
+    const std::filesystem::path& Path() const { return path_; }
+    uint32_t BitrateKbps() const { return bitrateKbps_; }
+    uint64_t BytesWritten() const { return bytesWritten_; }
+    uint32_t StreamCrc32c() const { return streamCrc_.Value(); }
+
+private:
+    void WriteEncoded(const unsigned char* data, size_t byteCount) {
+        stream_.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(byteCount));
+        bytesWritten_ += byteCount;
+        streamCrc_.Update(data, byteCount);
+    }
+
+    const LameApi& lame_;
+    const std::filesystem::path path_;
+    const uint32_t bitrateKbps_;
+    lame_t handle_ = nullptr;
+    std::ofstream stream_;
+    std::vector<unsigned char> mp3Buffer_;
+    uint64_t bytesWritten_ = 0;
+    Crc32c streamCrc_;
+};
+
+namespace {
+
+using EncoderList = std::vector<std::unique_ptr<Mp3Encoder>>;
+
+EncoderList OpenEncoders(const std::vector<Mp3Rendition>& renditions, size_t channels, uint32_t sampleRate) {
+    if (renditions.empty()) {
+        throw std::runtime_error("未指定 MP3 输出");
+    }
+    EncoderList encoders;
+    encoders.reserve(renditions.size());
+    for (const auto& rendition : renditions) {
+        encoders.push_back(std::make_unique<Mp3Encoder>(rendition.path, channels, sampleRate,
+                                                        rendition.options.bitrateKbps));
+    }
+    return encoders;
+}
+
+std::wstring DescribeBitrates(const EncoderList& encoders) {
+    std::wstring text;
+    for (const auto& encoder : encoders) {
+        text += (text.empty() ? L"" : L"/") + std::to_wstring(encoder->BitrateKbps());
+    }
+    return text + L" kbps";
+}
+
+// One thread per encoder, one chunk at a time. Submit() hands over the next chunk once every
+// encoder is done with the previous one, so the caller converts chunk n + 1 while chunk n is
+// being encoded; the chunk must stay untouched until the following Submit() or Drain().
+class EncoderCrew {
+public:
+    EncoderCrew(EncoderList& encoders, const std::function<void()>& prepareThread) {
+        workers_.reserve(encoders.size());
+        for (auto& encoder : encoders) {
+            workers_.emplace_back([this, target = encoder.get(), prepareThread]() {
+                if (prepareThread) {
+                    prepareThread();
+                }
+                Run(*target);
+            });
+        }
+    }
+
+    ~EncoderCrew() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        ready_.notify_all();
+        for (auto& worker : workers_) {
+            worker.join();
+        }
+    }
+
+    EncoderCrew(const EncoderCrew&) = delete;
+    EncoderCrew& operator=(const EncoderCrew&) = delete;
+
+    void Submit(const int16_t* pcm, size_t frames) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        WaitIdleLocked(lock);
+        pcm_ = pcm;
+        frames_ = frames;
+        busy_ = workers_.size();
+        ++round_;
+        ready_.notify_all();
+    }
+
+    // Waits for the last chunk; rethrows the first encoder failure.
+    void Drain() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        WaitIdleLocked(lock);
+    }
+
+private:
+    void WaitIdleLocked(std::unique_lock<std::mutex>& lock) {
+        done_.wait(lock, [this]() { return busy_ == 0; });
+        if (error_) {
+            std::rethrow_exception(error_);
+        }
+    }
+
+    void Run(Mp3Encoder& encoder) {
+        uint64_t seen = 0;
+        std::unique_lock<std::mutex> lock(mutex_);
+        for (;;) {
+            ready_.wait(lock, [&]() { return stopping_ || round_ != seen; });
+            if (round_ == seen) {
+                return;
+            }
+            seen = round_;
+            const int16_t* pcm = pcm_;
+            const size_t frames = frames_;
+            const bool skip = static_cast<bool>(error_);
+            lock.unlock();
+            std::exception_ptr failure;
+            if (!skip) {
+                try {
+                    encoder.Encode(pcm, frames);
+                } catch (...) {
+                    failure = std::current_exception();
+                }
+            }
+            lock.lock();
+            if (failure && !error_) {
+                error_ = failure;
+            }
+            if (--busy_ == 0) {
+                done_.notify_all();
+            }
+        }
+    }
+
+    std::mutex mutex_;
+    std::condition_variable ready_;
+    std::condition_variable done_;
+    const int16_t* pcm_ = nullptr;
+    size_t frames_ = 0;
+    uint64_t round_ = 0;
+    size_t busy_ = 0;
+    bool stopping_ = false;
+    std::exception_ptr error_;
+    std::vector<std::thread> workers_;
+};
+
+} // namespace
+
+void Mp3Converter::Preload() {
+    GetLameApi();
+}
+
+Mp3ConversionResult Mp3Converter::ConvertWavToMp3(const std::filesystem::path& wavPath,
+                                                  const std::filesystem::path& mp3Path,
+                                                  const Mp3ConversionOptions& options,
+                                                  Logger& logger) {
+    return ConvertWavToMp3Ladder(wavPath, {Mp3Rendition{mp3Path, options}}, logger);
+}
+
+Mp3ConversionResult Mp3Converter::ConvertWavToMp3Ladder(const std::filesystem::path& wavPath,
+                                                        const std::vector<Mp3Rendition>& renditions,
+                                                        Logger& logger,
+                                                        const std::function<void()>& prepareThread) {
     if (wavPath.empty()) {
         throw std::runtime_error("输入的 WAV 路径为空");
     }
@@ -352,62 +655,45 @@ void Mp3Converter::ConvertWavToMp3(const std::filesystem::path& wavPath,
     }
 
     WavMetadata metadata = ParseWav(wavStream);
-    const size_t targetChannels = static_cast<size_t>(std::min<uint16_t>(metadata.format.nChannels, 2));
-    if (metadata.format.nChannels > targetChannels) {
+    const size_t targetChannels = static_cast<size_t>(std::min<uint16_t>(metadata.format.channels, 2));
+    if (metadata.format.channels > targetChannels) {
         logger.Warn(L"MP3 编码器仅支持单声道/立体声；将 " +
-                    std::to_wstring(metadata.format.nChannels) + L" 声道下混到 " +
+                    std::to_wstring(metadata.format.channels) + L" 声道下混到 " +
                     std::to_wstring(targetChannels) + L"。");
     }
 
-    const auto& lame = GetLameApi();
-    struct LameHandle {
-        const LameApi* api = nullptr;
-        lame_t handle = nullptr;
-        ~LameHandle() {
-            if (handle && api && api->close) {
-                api->close(handle);
-            }
-        }
-    } encoder;
-    encoder.api = &lame;
-    encoder.handle = lame.init();
-    if (!encoder.handle) {
-        throw std::runtime_error("lame_init 失败");
+    const size_t frameBytes = metadata.format.BytesPerFrame();
+    if (frameBytes == 0) {
+        throw std::runtime_error("无效的 WAV 块对齐");
     }
 
-    const auto bitrate = static_cast<int>(std::clamp<uint32_t>(options.bitrateKbps, 64, 320));
-    lame.set_num_channels(encoder.handle, static_cast<int>(targetChannels));
-    lame.set_in_samplerate(encoder.handle, static_cast<int>(metadata.format.nSamplesPerSec));
-    lame.set_out_samplerate(encoder.handle, static_cast<int>(metadata.format.nSamplesPerSec));
-    lame.set_brate(encoder.handle, bitrate);
-    lame.set_mode(encoder.handle, targetChannels == 1 ? kLameModeMono : kLameModeStereo);
-    lame.set_quality(encoder.handle, 2);
-    if (lame.init_params(encoder.handle) < 0) {
-        throw std::runtime_error("lame_init_params 失败");
-    }
+    const auto& lame = GetLameApi();
+    EncoderList encoders = OpenEncoders(renditions, targetChannels, metadata.format.sampleRate);
     if (!lame.modulePath.empty()) {
         logger.Info(L"[MP3] 使用 libmp3lame：" + lame.modulePath);
     }
-    logger.Info(L"[MP3] 输入格式：声道=" + std::to_wstring(metadata.format.nChannels) +
-                L"，采样率=" + std::to_wstring(metadata.format.nSamplesPerSec) +
-                L" Hz，位深=" + std::to_wstring(metadata.format.wBitsPerSample));
-
-    std::ofstream mp3Stream(mp3Path, std::ios::binary | std::ios::trunc);
-    if (!mp3Stream) {
-        throw std::runtime_error("打开 MP3 文件写入失败：" + mp3Path.string());
-    }
-
-    const size_t frameBytes = metadata.format.nBlockAlign;
-    if (frameBytes == 0) {
-        throw std::runtime_error("无效的 WAV 块对齐");
+    logger.Info(L"[MP3] 输入格式：声道=" + std::to_wstring(metadata.format.channels) +
+                L"，采样率=" + std::to_wstring(metadata.format.sampleRate) +
+                L" Hz，位深=" + std::to_wstring(metadata.format.bitsPerSample));
+    if (encoders.size() > 1) {
+        logger.Info(L"[MP3] 码率阶梯：" + DescribeBitrates(encoders) + L"，一次读取与转换，" +
+                    std::to_wstring(encoders.size()) + L" 个编码线程。");
     }
 
+    // A single rendition is encoded inline; a ladder double-buffers the converted samples so
+    // reading and converting overlap with the encoders.
     std::vector<uint8_t> rawBuffer(frameBytes * kFramesPerChunk);
-    std::vector<int16_t> pcmBuffer;
-    pcmBuffer.reserve(kFramesPerChunk * targetChannels);
-    std::vector<unsigned char> mp3Buffer(static_cast<size_t>(1.25 * kFramesPerChunk) + 8192);
+    std::vector<int16_t> pcmBuffers[2];
+    for (auto& buffer : pcmBuffers) {
+        buffer.reserve(kFramesPerChunk * targetChannels);
+    }
+    std::optional<EncoderCrew> crew;
+    if (encoders.size() > 1) {
+        crew.emplace(encoders, prepareThread);
+    }
 
     uint64_t remaining = metadata.dataSize;
+    size_t chunk = 0;
     wavStream.seekg(static_cast<std::streamoff>(metadata.dataOffset), std::ios::beg);
     while (remaining > 0) {
         const size_t toRead = static_cast<size_t>(std::min<uint64_t>(remaining, rawBuffer.size()));
@@ -421,159 +707,202 @@ void Mp3Converter::ConvertWavToMp3(const std::filesystem::path& wavPath,
         if (framesRead == 0) {
             break;
         }
+        auto& pcmBuffer = pcmBuffers[chunk++ % 2];
         ConvertSamples(rawBuffer.data(), framesRead, metadata.format, targetChannels, pcmBuffer);
-        const int encoded = lame.encode_buffer_interleaved(encoder.handle,
-                                                           reinterpret_cast<short int*>(pcmBuffer.data()),
-                                                           static_cast<int>(framesRead),
-                                                           mp3Buffer.data(),
-                                                           static_cast<int>(mp3Buffer.size()));
-        if (encoded < 0) {
-            throw std::runtime_error("lame_encode_buffer_interleaved 失败，错误码 " + std::to_string(encoded));
+        if (crew) {
+            crew->Submit(pcmBuffer.data(), framesRead);
+        } else {
+            encoders.front()->Encode(pcmBuffer.data(), framesRead);
         }
-        mp3Stream.write(reinterpret_cast<const char*>(mp3Buffer.data()), encoded);
     }
-
-    const int flushBytes = lame.flush(encoder.handle, mp3Buffer.data(), static_cast<int>(mp3Buffer.size()));
-    if (flushBytes < 0) {
-        throw std::runtime_error("lame_encode_flush 失败，错误码 " + std::to_string(flushBytes));
+    if (crew) {
+        crew->Drain();
+        crew.reset();
     }
-    if (flushBytes > 0) {
-        mp3Stream.write(reinterpret_cast<const char*>(mp3Buffer.data()), flushBytes);
+
+    for (auto& encoder : encoders) {
+        encoder->Finish();
+        logger.Info(L"MP3 已生成：" + encoder->Path().wstring());
     }
-    mp3Stream.flush();
+    return Mp3ConversionResult{metadata.dataSize / frameBytes, static_cast<uint32_t>(metadata.format.sampleRate)};
+}
 
-    logger.Info(L"MP3 已生成：" + mp3Path.wstring());
+Mp3StreamInfo Mp3Converter::ScanMp3File(const std::filesystem::path& mp3Path) {
+    return MapMp3Frames(mp3Path).info;
 }
 
-Mp3StreamWriter::Mp3StreamWriter(const std::filesystem::path& path,
-                                 const WAVEFORMATEX& format,
-                                 const Mp3ConversionOptions& options,
-                                 Logger& logger)
-    : path_(path), logger_(&logger) {
-    try {
-        format_ = format;
-        if (format_.wFormatTag == WAVE_FORMAT_EXTENSIBLE &&
-            format_.cbSize >= sizeof(WAVEFORMATEXTENSIBLE) - sizeof(WAVEFORMATEX)) {
-            const auto* ext = reinterpret_cast<const WAVEFORMATEXTENSIBLE*>(&format);
-            if (ext->SubFormat == KSDATAFORMAT_SUBTYPE_PCM) {
-                format_.wFormatTag = WAVE_FORMAT_PCM;
-            } else if (ext->SubFormat == KSDATAFORMAT_SUBTYPE_IEEE_FLOAT) {
-                format_.wFormatTag = WAVE_FORMAT_IEEE_FLOAT;
-            }
-        }
+Mp3FrameMap Mp3Converter::MapMp3Frames(const std::filesystem::path& mp3Path) {
+    static constexpr uint32_t kBitratesV1[16] = {0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 0};
+    static constexpr uint32_t kBitratesV2[16] = {0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160, 0};
+    static constexpr uint32_t kSampleRatesV1[3] = {44100, 48000, 32000};
 
-        bytesPerFrame_ = format_.nBlockAlign;
-        if (bytesPerFrame_ == 0) {
-            throw std::runtime_error("无效的音频块对齐");
-        }
+    Mp3FrameMap map;
+    Mp3StreamInfo& info = map.info;
+    std::ifstream stream(mp3Path, std::ios::binary);
+    if (!stream) {
+        return map;
+    }
+    std::vector<unsigned char> data((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
 
-        targetChannels_ = static_cast<size_t>(std::min<uint16_t>(format_.nChannels, 2));
-        if (format_.nChannels > targetChannels_) {
-            logger.Info(L"[MP3] 正在下混 " + std::to_wstring(format_.nChannels) +
-                        L" 声道到 " + std::to_wstring(targetChannels_) + L"。");
-        }
+    size_t offset = 0;
+    if (data.size() >= 10 && data[0] == 'I' && data[1] == 'D' && data[2] == '3') {
+        const size_t tagSize = (static_cast<size_t>(data[6] & 0x7F) << 21) | (static_cast<size_t>(data[7] & 0x7F) << 14) |
+                               (static_cast<size_t>(data[8] & 0x7F) << 7) | static_cast<size_t>(data[9] & 0x7F);
+        offset = 10 + tagSize;
+    }
 
-        const auto& lame = GetLameApi();
-        api_ = &lame;
-        handle_ = lame.init();
-        if (!handle_) {
-            throw std::runtime_error("lame_init 失败");
+    while (offset + 4 <= data.size()) {
+        const unsigned char* header = data.data() + offset;
+        if (header[0] != 0xFF || (header[1] & 0xE0) != 0xE0) {
+            break;
         }
-
-        const auto bitrate = static_cast<int>(std::clamp<uint32_t>(options.bitrateKbps, 64, 320));
-        lame.set_num_channels(handle_, static_cast<int>(targetChannels_));
-        lame.set_in_samplerate(handle_, static_cast<int>(format_.nSamplesPerSec));
-        lame.set_out_samplerate(handle_, static_cast<int>(format_.nSamplesPerSec));
-        lame.set_brate(handle_, bitrate);
-        lame.set_mode(handle_, targetChannels_ == 1 ? kLameModeMono : kLameModeStereo);
-        lame.set_quality(handle_, 2);
-        if (lame.init_params(handle_) < 0) {
-            throw std::runtime_error("lame_init_params 失败");
+        const uint32_t versionBits = (header[1] >> 3) & 0x03;  // 3 = MPEG-1, 2 = MPEG-2, 0 = MPEG-2.5
+        const uint32_t layerBits = (header[1] >> 1) & 0x03;    // 1 = Layer III
+        const uint32_t bitrateIndex = header[2] >> 4;
+        const uint32_t rateIndex = (header[2] >> 2) & 0x03;
+        const uint32_t padding = (header[2] >> 1) & 0x01;
+        if (versionBits == 1 || layerBits != 1 || rateIndex == 3) {
+            break;
         }
-        if (!lame.modulePath.empty()) {
-            logger.Info(L"[MP3] 使用 libmp3lame：" + lame.modulePath);
+        const bool mpeg1 = versionBits == 3;
+        const uint32_t bitrate = (mpeg1 ? kBitratesV1 : kBitratesV2)[bitrateIndex] * 1000;
+        uint32_t sampleRate = kSampleRatesV1[rateIndex];
+        if (versionBits == 2) {
+            sampleRate /= 2;
+        } else if (versionBits == 0) {
+            sampleRate /= 4;
         }
-        logger.Info(L"[MP3] 实时编码：声道=" + std::to_wstring(format_.nChannels) +
-                    L"，采样率=" + std::to_wstring(format_.nSamplesPerSec) +
-                    L" Hz，位深=" + std::to_wstring(format_.wBitsPerSample) +
-                    L"，比特率=" + std::to_wstring(bitrate) + L" kbps。");
-
-        mp3Buffer_.resize(8192);
-
-        stream_.open(path_, std::ios::binary | std::ios::trunc);
-        if (!stream_) {
-            throw std::runtime_error("打开 MP3 文件写入失败：" + path_.string());
+        if (bitrate == 0) {
+            break;
         }
-    } catch (...) {
-        if (api_ && handle_) {
-            const auto* lame = reinterpret_cast<const LameApi*>(api_);
-            if (lame->close) {
-                lame->close(handle_);
-            }
-            handle_ = nullptr;
+        const uint32_t samplesPerFrame = mpeg1 ? 1152 : 576;
+        const size_t frameBytes = (samplesPerFrame / 8) * bitrate / sampleRate + padding;
+        if (offset + frameBytes > data.size()) {
+            break;
         }
-        throw;
+        if (info.sampleRate != 0 && info.sampleRate != sampleRate) {
+            break;
+        }
+        if (info.frames == 0) {
+            // The Xing/Info tag sits where the first granule's main data would start. LAME
+            // reserves the frame with a zeroed body and only fills it if asked to afterwards.
+            const bool mono = (header[3] >> 6) == 3;
+            const size_t sideInfo = mpeg1 ? (mono ? 17 : 32) : (mono ? 9 : 17);
+            const size_t tagOffset = offset + 4 + ((header[1] & 0x01) ? 0 : 2) + sideInfo;
+            const auto body = data.begin() + static_cast<std::ptrdiff_t>(offset + 4);
+            const bool placeholder = std::all_of(body, body + static_cast<std::ptrdiff_t>(frameBytes - 4),
+                                                 [](unsigned char byte) { return byte == 0; });
+            map.leadingInfoFrame = placeholder || (tagOffset + 4 <= offset + frameBytes &&
+                (std::memcmp(data.data() + tagOffset, "Xing", 4) == 0 || std::memcmp(data.data() + tagOffset, "Info", 4) == 0));
+        }
+        info.sampleRate = sampleRate;
+        ++info.frames;
+        info.samples += samplesPerFrame;
+        map.samplesPerFrame = samplesPerFrame;
+        map.frames.push_back(Mp3FrameSpan{offset, static_cast<uint32_t>(frameBytes)});
+        offset += frameBytes;
+    }
+
+    // Trailing ID3v1 tag is the only data allowed after the last frame.
+    const bool trailingTag = data.size() - offset == 128 && data[offset] == 'T' && data[offset + 1] == 'A' && data[offset + 2] == 'G';
+    info.valid = info.frames > 0 && (offset == data.size() || trailingTag);
+    return map;
+}
+
+Mp3StreamWriter::Mp3StreamWriter(const std::filesystem::path& path,
+                                 const AudioFormat& format,
+                                 const Mp3ConversionOptions& options,
+                                 Logger& logger)
+    : Mp3StreamWriter(std::vector<Mp3Rendition>{Mp3Rendition{path, options}}, format, logger) {}
+
+Mp3StreamWriter::Mp3StreamWriter(const std::vector<Mp3Rendition>& renditions,
+                                 const AudioFormat& format,
+                                 Logger& logger)
+    : format_(format), logger_(&logger) {
+    bytesPerFrame_ = format_.BytesPerFrame();
+    if (bytesPerFrame_ == 0) {
+        throw std::runtime_error("无效的音频块对齐");
     }
+
+    targetChannels_ = static_cast<size_t>(std::min<uint16_t>(format_.channels, 2));
+    if (format_.channels > targetChannels_) {
+        logger.Info(L"[MP3] 正在下混 " + std::to_wstring(format_.channels) +
+                    L" 声道到 " + std::to_wstring(targetChannels_) + L"。");
+    }
+
+    const auto& lame = GetLameApi();
+    encoders_ = OpenEncoders(renditions, targetChannels_, format_.sampleRate);
+    if (!lame.modulePath.empty()) {
+        logger.Info(L"[MP3] 使用 libmp3lame：" + lame.modulePath);
+    }
+    logger.Info(L"[MP3] 实时编码：声道=" + std::to_wstring(format_.channels) +
+                L"，采样率=" + std::to_wstring(format_.sampleRate) +
+                L" Hz，位深=" + std::to_wstring(format_.bitsPerSample) +
+                L"，比特率=" + DescribeBitrates(encoders_) + L"。");
+
+    pending_.reserve(bytesPerFrame_);
 }
 
 Mp3StreamWriter::~Mp3StreamWriter() {
-    Close();
+    try {
+        Close();
+    } catch (const std::exception&) {
+        // Owners call Close() themselves and report its errors; this only cleans up after
+        // a failure they already saw.
+    }
 }
 
-void Mp3StreamWriter::Write(const BYTE* data, size_t byteCount) {
+void Mp3StreamWriter::Write(const uint8_t* data, size_t byteCount) {
     if (finalized_) {
         return;
     }
-    if (!stream_) {
-        throw std::runtime_error("MP3 流未打开");
-    }
     if (byteCount == 0) {
         return;
     }
 
-    const size_t existing = pending_.size();
-    pending_.resize(existing + byteCount);
-    std::memcpy(pending_.data() + existing, data, byteCount);
-
-    const size_t framesAvailable = pending_.size() / bytesPerFrame_;
-    if (framesAvailable == 0) {
-        return;
+    // Whole frames are encoded straight from the caller's buffer; only a frame split across
+    // calls is carried over, in pending_ (reserved for one frame, so this never allocates).
+    if (!pending_.empty()) {
+        const size_t take = std::min(byteCount, bytesPerFrame_ - pending_.size());
+        pending_.insert(pending_.end(), data, data + take);
+        data += take;
+        byteCount -= take;
+        if (pending_.size() < bytesPerFrame_) {
+            return;
+        }
+        EncodeFrames(pending_.data(), 1);
+        pending_.clear();
     }
-    const size_t bytesToProcess = framesAvailable * bytesPerFrame_;
-
-    ConvertSamples(pending_.data(), framesAvailable, format_, targetChannels_, pcmBuffer_);
-    const size_t needed = static_cast<size_t>(1.25 * framesAvailable) + 7200;
-    if (mp3Buffer_.size() < needed) {
-        mp3Buffer_.resize(needed);
+    const size_t frames = byteCount / bytesPerFrame_;
+    if (frames > 0) {
+        EncodeFrames(data, frames);
     }
+    const size_t processed = frames * bytesPerFrame_;
+    pending_.insert(pending_.end(), data + processed, data + byteCount);
+}
 
-    const auto* lame = reinterpret_cast<const LameApi*>(api_);
-    const int encoded = lame->encode_buffer_interleaved(handle_,
-                                                        reinterpret_cast<short int*>(pcmBuffer_.data()),
-                                                        static_cast<int>(framesAvailable),
-                                                        mp3Buffer_.data(),
-                                                        static_cast<int>(mp3Buffer_.size()));
-    if (encoded < 0) {
-        throw std::runtime_error("lame_encode_buffer_interleaved 失败，错误码 " + std::to_string(encoded));
-    }
-    if (encoded > 0) {
-        stream_.write(reinterpret_cast<const char*>(mp3Buffer_.data()), encoded);
+void Mp3StreamWriter::EncodeFrames(const uint8_t* data, size_t frames) {
+    ConvertSamples(data, frames, format_, targetChannels_, pcmBuffer_);
+    TraceScope scope("lame.encode");
+    for (auto& encoder : encoders_) {
+        encoder->Encode(pcmBuffer_.data(), frames);
     }
+}
 
-    const size_t remainder = pending_.size() - bytesToProcess;
-    if (remainder > 0) {
-        std::memmove(pending_.data(), pending_.data() + bytesToProcess, remainder);
-    }
-    pending_.resize(remainder);
+uint64_t Mp3StreamWriter::BytesWritten(size_t rendition) const {
+    return encoders_.at(rendition)->BytesWritten();
+}
+
+uint32_t Mp3StreamWriter::StreamCrc32c(size_t rendition) const {
+    return encoders_.at(rendition)->StreamCrc32c();
 }
 
 void Mp3StreamWriter::Flush() {
-    if (finalized_ || !stream_) {
+    if (finalized_) {
         return;
     }
-    stream_.flush();
-    if (!stream_) {
-        throw std::runtime_error("刷新 MP3 数据到磁盘失败");
+    for (auto& encoder : encoders_) {
+        encoder->Flush();
     }
 }
 
@@ -583,62 +912,16 @@ void Mp3StreamWriter::Close() {
     }
     finalized_ = true;
 
-    if (stream_) {
-        if (!pending_.empty()) {
-            const size_t remainder = pending_.size() % bytesPerFrame_;
-            if (remainder != 0) {
-                const size_t pad = bytesPerFrame_ - remainder;
-                pending_.resize(pending_.size() + pad, 0);
-            }
-            const size_t framesAvailable = pending_.size() / bytesPerFrame_;
-            if (framesAvailable > 0) {
-                ConvertSamples(pending_.data(), framesAvailable, format_, targetChannels_, pcmBuffer_);
-                const size_t needed = static_cast<size_t>(1.25 * framesAvailable) + 7200;
-                if (mp3Buffer_.size() < needed) {
-                    mp3Buffer_.resize(needed);
-                }
-                const auto* lame = reinterpret_cast<const LameApi*>(api_);
-                const int encoded = lame->encode_buffer_interleaved(handle_,
-                                                                    reinterpret_cast<short int*>(pcmBuffer_.data()),
-                                                                    static_cast<int>(framesAvailable),
-                                                                    mp3Buffer_.data(),
-                                                                    static_cast<int>(mp3Buffer_.size()));
-                if (encoded < 0) {
-                    throw std::runtime_error("lame_encode_buffer_interleaved 失败，错误码 " + std::to_string(encoded));
-                }
-                if (encoded > 0) {
-                    stream_.write(reinterpret_cast<const char*>(mp3Buffer_.data()), encoded);
-                }
-            }
-            pending_.clear();
-        }
-
-        const auto* lame = reinterpret_cast<const LameApi*>(api_);
-        if (lame && handle_) {
-            if (mp3Buffer_.empty()) {
-                mp3Buffer_.resize(8192);
-            }
-            const int flushBytes = lame->flush(handle_, mp3Buffer_.data(), static_cast<int>(mp3Buffer_.size()));
-            if (flushBytes < 0) {
-                throw std::runtime_error("lame_encode_flush 失败，错误码 " + std::to_string(flushBytes));
-            }
-            if (flushBytes > 0) {
-                stream_.write(reinterpret_cast<const char*>(mp3Buffer_.data()), flushBytes);
-            }
-        }
-        stream_.flush();
-        stream_.close();
+    if (!pending_.empty()) {
+        // A trailing partial frame is padded with silence.
+        pending_.resize(bytesPerFrame_, 0);
+        EncodeFrames(pending_.data(), 1);
+        pending_.clear();
     }
-
-    if (api_ && handle_) {
-        const auto* lame = reinterpret_cast<const LameApi*>(api_);
-        if (lame->close) {
-            lame->close(handle_);
+    for (auto& encoder : encoders_) {
+        encoder->Finish();
+        if (logger_) {
+            logger_->Info(L"MP3 流已完成：" + encoder->Path().wstring());
         }
-        handle_ = nullptr;
-    }
-
-    if (logger_) {
-        logger_->Info(L"MP3 流已完成：" + path_.wstring());
     }
 }
@@ -1,53 +1,111 @@
 #pragma once
 
+#include "AudioFormat.h"
+#include "Checksum.h"
 #include "Logger.h"
 
-#include <Windows.h>
 #include <filesystem>
 #include <fstream>
+#include <functional>
 #include <cstddef>
 #include <cstdint>
-#include <mmreg.h>
+#include <memory>
 #include <vector>
 
 struct Mp3ConversionOptions {
     uint32_t bitrateKbps = 192;
 };
 
+// One output of a multi-bitrate encode. All renditions share the read, the sample conversion
+// and the downmix; only the LAME encode runs once per rendition.
+struct Mp3Rendition {
+    std::filesystem::path path;
+    Mp3ConversionOptions options;
+};
+
+struct Mp3ConversionResult {
+    uint64_t inputFrames = 0;
+    uint32_t sampleRate = 0;
+};
+
+// Result of walking the frame headers of an MPEG Layer III file.
+struct Mp3StreamInfo {
+    bool valid = false;        // the frame chain runs from the first frame to end of file
+    uint64_t frames = 0;
+    uint64_t samples = 0;      // per channel, includes encoder delay/padding and the Info frame
+    uint32_t sampleRate = 0;
+};
+
+// Byte range of one MPEG audio frame within its file.
+struct Mp3FrameSpan {
+    uint64_t offset = 0;
+    uint32_t bytes = 0;
+};
+
+// Frame chain of a file, for cutting it at frame boundaries without decoding.
+struct Mp3FrameMap {
+    Mp3StreamInfo info;
+    std::vector<Mp3FrameSpan> frames;
+    uint32_t samplesPerFrame = 0;
+    bool leadingInfoFrame = false;   // frames[0] is LAME's Xing/Info tag (or its empty placeholder), not audio
+};
+
 class Mp3Converter {
 public:
-    static void ConvertWavToMp3(const std::filesystem::path& wavPath,
-                                const std::filesystem::path& mp3Path,
-                                const Mp3ConversionOptions& options,
-                                Logger& logger);
+    // Loads the LAME library now rather than when the first MP3 segment opens; throws if missing.
+    static void Preload();
+    static Mp3ConversionResult ConvertWavToMp3(const std::filesystem::path& wavPath,
+                                               const std::filesystem::path& mp3Path,
+                                               const Mp3ConversionOptions& options,
+                                               Logger& logger);
+    // Encodes the WAV into every rendition in one pass: the calling thread reads and converts
+    // the next chunk while one thread per rendition encodes the current one. `prepareThread`
+    // runs first on each of those threads (e.g. to lower their priority).
+    static Mp3ConversionResult ConvertWavToMp3Ladder(const std::filesystem::path& wavPath,
+                                                     const std::vector<Mp3Rendition>& renditions,
+                                                     Logger& logger,
+                                                     const std::function<void()>& prepareThread = {});
+    static Mp3StreamInfo ScanMp3File(const std::filesystem::path& mp3Path);
+    static Mp3FrameMap MapMp3Frames(const std::filesystem::path& mp3Path);
 };
 
+// LAME instance and output file of one rendition; defined in Mp3Converter.cpp.
+class Mp3Encoder;
+
 class Mp3StreamWriter {
 public:
     Mp3StreamWriter(const std::filesystem::path& path,
-                    const WAVEFORMATEX& format,
+                    const AudioFormat& format,
                     const Mp3ConversionOptions& options,
                     Logger& logger);
+    // Bitrate ladder: each Write() is converted once and encoded into every rendition in turn,
+    // on the calling thread. Rendition 0 is the primary stream.
+    Mp3StreamWriter(const std::vector<Mp3Rendition>& renditions,
+                    const AudioFormat& format,
+                    Logger& logger);
     ~Mp3StreamWriter();
 
     Mp3StreamWriter(const Mp3StreamWriter&) = delete;
     Mp3StreamWriter& operator=(const Mp3StreamWriter&) = delete;
 
-    void Write(const BYTE* data, size_t byteCount);
+    void Write(const uint8_t* data, size_t byteCount);
     void Flush();
     void Close();
 
+    size_t Renditions() const { return encoders_.size(); }
+    // Encoded bytes written so far and their running CRC-32C (covers the whole file).
+    uint64_t BytesWritten(size_t rendition = 0) const;
+    uint32_t StreamCrc32c(size_t rendition = 0) const;
+
 private:
-    std::filesystem::path path_;
-    std::ofstream stream_;
-    const void* api_ = nullptr;
-    void* handle_ = nullptr;
-    WAVEFORMATEX format_{};
+    void EncodeFrames(const uint8_t* data, size_t frames);
+
+    AudioFormat format_{};
     size_t bytesPerFrame_ = 0;
     size_t targetChannels_ = 0;
-    std::vector<uint8_t> pending_;
+    std::vector<std::unique_ptr<Mp3Encoder>> encoders_;
+    std::vector<uint8_t> pending_;          // less than one frame, carried to the next Write()
     std::vector<int16_t> pcmBuffer_;
-    std::vector<unsigned char> mp3Buffer_;
     bool finalized_ = false;
     Logger* logger_ = nullptr;
 };
@@ -0,0 +1,185 @@
+#include "PcmPipeSource.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+
+constexpr auto kReaderSlice = std::chrono::milliseconds(100);
+constexpr size_t kReadChunkBytes = 64 * 1024;
+
+} // namespace
+
+PcmPipeSource::PcmPipeSource(PcmPipeSourceOptions options)
+    : options_(std::move(options)),
+      format_(MakeAudioFormat(options_.sampleRate, options_.channels, options_.floatSamples)),
+      packetBytes_(std::max<size_t>(1, static_cast<size_t>(options_.sampleRate) * options_.period.count() / 1000) *
+                   format_.BytesPerFrame()),
+      ring_(static_cast<size_t>(format_.BytesPerSecond())),
+      packet_(packetBytes_) {}
+
+PcmPipeSource::~PcmPipeSource() {
+    Stop();
+}
+
+std::wstring PcmPipeSource::Describe() const {
+    const std::wstring name = options_.path == "-" ? std::wstring(L"标准输入") : options_.path.wstring();
+    return L"PCM 管道 " + name + L"，" + std::to_wstring(options_.sampleRate) + L" Hz × " +
+           std::to_wstring(options_.channels) + (options_.floatSamples ? L" f32le" : L" s16le");
+}
+
+void PcmPipeSource::Start() {
+    Stop();
+    interrupted_.store(false, std::memory_order_release);
+    stopping_.store(false, std::memory_order_release);
+    endOfInput_.store(false, std::memory_order_release);
+    readFailed_.store(false, std::memory_order_release);
+    reader_ = std::thread([this]() { ReaderLoop(); });
+}
+
+void PcmPipeSource::Stop() {
+    if (!reader_.joinable()) {
+        return;
+    }
+    stopping_.store(true, std::memory_order_release);
+    spaceAvailable_.Set();
+#if defined(_WIN32)
+    // The reader blocks in ReadFile; cancel until it notices (it may not have entered the call yet).
+    while (!endOfInput_.load(std::memory_order_acquire)) {
+        CancelSynchronousIo(static_cast<HANDLE>(reader_.native_handle()));
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+#endif
+    reader_.join();
+}
+
+void PcmPipeSource::ReaderLoop() {
+    std::vector<uint8_t> chunk(kReadChunkBytes);
+    auto finish = [this](const wchar_t* error) {
+        if (error) {
+            lastError_ = error;
+            readFailed_.store(true, std::memory_order_release);
+        }
+        endOfInput_.store(true, std::memory_order_release);
+        dataReady_.Set();
+    };
+
+#if defined(_WIN32)
+    const bool useStdin = options_.path == "-";
+    HANDLE input = useStdin ? GetStdHandle(STD_INPUT_HANDLE)
+                            : CreateFileW(options_.path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE,
+                                          nullptr, OPEN_EXISTING, 0, nullptr);
+    if (input == INVALID_HANDLE_VALUE || input == nullptr) {
+        finish(L"无法打开 PCM 输入");
+        return;
+    }
+#else
+    const int input = options_.path == "-" ? dup(STDIN_FILENO) : open(options_.path.c_str(), O_RDONLY | O_NONBLOCK);
+    if (input < 0) {
+        finish(L"无法打开 PCM 输入");
+        return;
+    }
+#endif
+
+    const wchar_t* error = nullptr;
+    while (!stopping_.load(std::memory_order_acquire)) {
+        const size_t room = std::min(chunk.size(), ring_.AvailableToWrite());
+        if (room == 0) {
+            spaceAvailable_.Wait(kReaderSlice);
+            continue;
+        }
+#if defined(_WIN32)
+        DWORD received = 0;
+        if (!ReadFile(input, chunk.data(), static_cast<DWORD>(room), &received, nullptr)) {
+            const DWORD code = GetLastError();
+            if (code != ERROR_BROKEN_PIPE && code != ERROR_HANDLE_EOF && code != ERROR_OPERATION_ABORTED) {
+                error = L"读取 PCM 输入失败";
+            }
+            break;
+        }
+        if (received == 0) {
+            break;
+        }
+#else
+        // A FIFO opened non-blocking reports neither data nor hang-up until a writer shows up.
+        pollfd descriptor{input, POLLIN, 0};
+        const int ready = poll(&descriptor, 1, static_cast<int>(kReaderSlice.count()));
+        if (ready == 0 || (ready < 0 && errno == EINTR)) {
+            continue;
+        }
+        const auto received = ready > 0 ? read(input, chunk.data(), room) : -1;
+        if (received < 0) {
+            if (errno == EAGAIN || errno == EINTR) {
+                continue;
+            }
+            error = L"读取 PCM 输入失败";
+            break;
+        }
+        if (received == 0) {
+            break;
+        }
+#endif
+        ring_.Write(chunk.data(), static_cast<size_t>(received));
+        dataReady_.Set();
+    }
+
+#if defined(_WIN32)
+    if (!useStdin) {
+        CloseHandle(input);
+    }
+#else
+    close(input);
+#endif
+    finish(error);
+}
+
+SourceWaitResult PcmPipeSource::Wait(std::chrono::milliseconds timeout) {
+    const auto deadline = std::chrono::steady_clock::now() + timeout;
+    for (;;) {
+        if (interrupted_.load(std::memory_order_acquire)) {
+            return SourceWaitResult::Interrupted;
+        }
+        if (ring_.AvailableToRead() >= format_.BytesPerFrame() || endOfInput_.load(std::memory_order_acquire)) {
+            return SourceWaitResult::PacketsReady;
+        }
+        const auto now = std::chrono::steady_clock::now();
+        if (now >= deadline) {
+            return SourceWaitResult::Timeout;
+        }
+        // Short slices so Interrupt() is noticed without a second event.
+        dataReady_.Wait(std::min(std::chrono::duration_cast<std::chrono::milliseconds>(deadline - now) +
+                                     std::chrono::milliseconds(1),
+                                 std::chrono::milliseconds(20)));
+    }
+}
+
+void PcmPipeSource::Interrupt() {
+    interrupted_.store(true, std::memory_order_release);
+    dataReady_.Set();
+}
+
+SourceReadResult PcmPipeSource::Read(SourcePacket& packet) {
+    const size_t available = ring_.AvailableToRead() / format_.BytesPerFrame() * format_.BytesPerFrame();
+    if (available == 0) {
+        if (!endOfInput_.load(std::memory_order_acquire)) {
+            return SourceReadResult::Empty;
+        }
+        return readFailed_.load(std::memory_order_acquire) ? SourceReadResult::Failed : SourceReadResult::EndOfStream;
+    }
+    const size_t bytes = ring_.Read(packet_.data(), std::min(available, packetBytes_));
+    spaceAvailable_.Set();
+    packet.data = packet_.data();
+    packet.frames = static_cast<uint32_t>(bytes / format_.BytesPerFrame());
+    packet.silent = false;
+    packet.discontinuity = false;
+    return SourceReadResult::Packet;
+}
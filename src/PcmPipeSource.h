@@ -0,0 +1,62 @@
+#pragma once
+
+#include "AudioSource.h"
+#include "SignalEvent.h"
+#include "SpscByteRing.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct PcmPipeSourceOptions {
+    std::filesystem::path path;              // FIFO, named pipe, regular file; "-" = standard input
+    uint32_t sampleRate = 48000;
+    uint16_t channels = 2;
+    bool floatSamples = false;               // s16le by default, f32le when set
+    std::chrono::milliseconds period{10};    // largest packet handed to the pipeline
+};
+
+// Raw interleaved PCM read from a pipe, e.g. `ffmpeg ... -f s16le - | loopback_recorder`.
+// A reader thread copies whatever arrives into an internal one-second ring and blocks when
+// the ring is full, so pacing comes from the writer of the pipe. End of input ends the
+// session once the ring has been drained.
+class PcmPipeSource : public IAudioSource {
+public:
+    explicit PcmPipeSource(PcmPipeSourceOptions options);
+    ~PcmPipeSource() override;
+
+    PcmPipeSource(const PcmPipeSource&) = delete;
+    PcmPipeSource& operator=(const PcmPipeSource&) = delete;
+
+    const AudioFormat& Format() const override { return format_; }
+    std::wstring Describe() const override;
+
+    void Start() override;
+    void Stop() override;
+    SourceWaitResult Wait(std::chrono::milliseconds timeout) override;
+    void Interrupt() override;
+    SourceReadResult Read(SourcePacket& packet) override;
+    void Release(const SourcePacket&) override {}
+    std::wstring LastError() const override { return lastError_; }
+
+private:
+    void ReaderLoop();
+
+    const PcmPipeSourceOptions options_;
+    const AudioFormat format_;
+    const size_t packetBytes_;
+    SpscByteRingBuffer ring_;
+    std::vector<uint8_t> packet_;
+    SignalEvent dataReady_;
+    SignalEvent spaceAvailable_;
+    std::atomic<bool> interrupted_{false};
+    std::atomic<bool> stopping_{false};
+    std::atomic<bool> endOfInput_{false};
+    std::atomic<bool> readFailed_{false};
+    std::wstring lastError_;
+    std::thread reader_;
+};
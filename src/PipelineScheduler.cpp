@@ -0,0 +1,23 @@
+#include "PipelineScheduler.h"
+
+bool SystemPipelineScheduler::WaitUntil(const std::function<bool()>& ready, std::chrono::nanoseconds timeout) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    return wake_.wait_for(lock, timeout, ready);
+}
+
+void SystemPipelineScheduler::Wake() {
+    // Taking the lock orders the change behind ready() before a waiter's next check.
+    { std::lock_guard<std::mutex> lock(mutex_); }
+    wake_.notify_all();
+}
+
+void SystemPipelineScheduler::Join(std::thread& thread) {
+    if (thread.joinable()) {
+        thread.join();
+    }
+}
+
+PipelineScheduler& SystemScheduler() {
+    static SystemPipelineScheduler scheduler;
+    return scheduler;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+// Where the recorder threads start, block, sleep and read the time. CapturePipeline takes one
+// through RecorderControls::scheduler; without it everything runs on the OS
+// (SystemScheduler()). VirtualScheduler puts the same calls on a virtual clock and runs one
+// thread at a time, so a whole recording can be simulated deterministically.
+class PipelineScheduler {
+public:
+    virtual ~PipelineScheduler() = default;
+
+    virtual std::chrono::steady_clock::time_point Now() = 0;
+
+    // Blocks the calling thread until ready() is true or `timeout` has passed; returns ready().
+    // ready() must be a side-effect free check that does not call back into the scheduler;
+    // whoever makes it true calls Wake() afterwards.
+    virtual bool WaitUntil(const std::function<bool()>& ready, std::chrono::nanoseconds timeout) = 0;
+    virtual void Wake() = 0;
+    virtual void SleepFor(std::chrono::nanoseconds duration) = 0;
+
+    // Threads that block through this scheduler must be started and joined through it too.
+    virtual std::thread StartThread(std::function<void()> body) = 0;
+    virtual void Join(std::thread& thread) = 0;
+};
+
+// The steady clock and real threads.
+class SystemPipelineScheduler : public PipelineScheduler {
+public:
+    std::chrono::steady_clock::time_point Now() override { return std::chrono::steady_clock::now(); }
+    bool WaitUntil(const std::function<bool()>& ready, std::chrono::nanoseconds timeout) override;
+    void Wake() override;
+    void SleepFor(std::chrono::nanoseconds duration) override { std::this_thread::sleep_for(duration); }
+    std::thread StartThread(std::function<void()> body) override { return std::thread(std::move(body)); }
+    void Join(std::thread& thread) override;
+
+private:
+    std::mutex mutex_;
+    std::condition_variable wake_;
+};
+
+PipelineScheduler& SystemScheduler();
@@ -0,0 +1,179 @@
+#include "RecorderDaemon.h"
+#include "Mp3Converter.h"
+#include "PcmPipeSource.h"
+#include "RecordingUtils.h"
+#include "SyntheticSource.h"
+
+#include <algorithm>
+#include <cwctype>
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+namespace {
+
+constexpr auto kSleepSlice = std::chrono::milliseconds(200);
+
+std::wstring FormatLocalMinute(std::chrono::system_clock::time_point time) {
+    return ExpandOutputTemplate("%Y-%m-%d %H:%M", time).wstring();
+}
+
+std::wstring DescribeEntry(const ScheduledSession& session) {
+    return L"第 " + std::to_wstring(session.entry->line) + L" 行（" + FormatLocalMinute(session.start) + L"，" +
+           std::to_wstring(session.entry->duration.count()) + L" 秒）";
+}
+
+// Sleeps until `deadline` in short slices; false if a stop was requested first.
+bool SleepUntil(std::chrono::system_clock::time_point deadline, const std::function<bool()>& shouldStop) {
+    for (;;) {
+        if (shouldStop()) {
+            return false;
+        }
+        const auto now = std::chrono::system_clock::now();
+        if (now >= deadline) {
+            return true;
+        }
+        std::this_thread::sleep_for(std::min<std::chrono::system_clock::duration>(deadline - now, kSleepSlice));
+    }
+}
+
+bool WritesMp3(const std::string& outputTemplate) {
+    std::wstring extension = std::filesystem::path(outputTemplate).extension().wstring();
+    for (auto& ch : extension) {
+        ch = static_cast<wchar_t>(std::towlower(ch));
+    }
+    return extension.empty() || extension == L".mp3";
+}
+
+} // namespace
+
+std::unique_ptr<IAudioSource> MakeScheduledSource(const ScheduleEntry& entry) {
+    switch (entry.source) {
+    case ScheduledSourceKind::Synthetic: {
+        SyntheticSourceOptions options;
+        options.sampleRate = entry.sampleRate;
+        options.channels = entry.channels;
+        options.floatSamples = entry.floatSamples;
+        return std::make_unique<SyntheticSource>(options);
+    }
+    case ScheduledSourceKind::Pipe: {
+        PcmPipeSourceOptions options;
+        options.path = entry.pipePath;
+        options.sampleRate = entry.sampleRate;
+        options.channels = entry.channels;
+        options.floatSamples = entry.floatSamples;
+        return std::make_unique<PcmPipeSource>(std::move(options));
+    }
+    case ScheduledSourceKind::Loopback:
+        break;
+    }
+    return nullptr;
+}
+
+RecorderDaemon::RecorderDaemon(RecordingSchedule schedule, RecorderDaemonOptions options, Logger& logger)
+    : schedule_(std::move(schedule)), options_(std::move(options)), logger_(logger), pipeline_(logger) {}
+
+RecorderConfig RecorderDaemon::ConfigFor(const ScheduledSession& session) const {
+    const ScheduleEntry& entry = *session.entry;
+    RecorderConfig config = options_.baseConfig;
+    config.outputPath = ExpandOutputTemplate(entry.outputTemplate, session.start);
+    if (config.outputPath.extension().empty()) {
+        config.outputPath = EnsureExtension(config.outputPath, L".mp3");
+    }
+    if (entry.mp3BitrateKbps) {
+        config.mp3BitrateKbps = entry.mp3BitrateKbps;
+    }
+    if (entry.segmentDuration) {
+        config.segmentDuration = entry.segmentDuration;
+    }
+    config.maxDuration = entry.duration;
+    return config;
+}
+
+std::unique_ptr<IAudioSource> RecorderDaemon::MakeSource(const ScheduleEntry& entry) const {
+    if (auto source = MakeScheduledSource(entry)) {
+        return source;
+    }
+    if (options_.makeSource) {
+        if (auto source = options_.makeSource(entry)) {
+            return source;
+        }
+    }
+    throw std::runtime_error("此平台不支持回环音频源");
+}
+
+void RecorderDaemon::Run(const std::function<bool()>& shouldStop, RecorderControls controls) {
+    const auto& entries = schedule_.Entries();
+    logger_.Info(L"[计划] 已载入 " + std::to_wstring(entries.size()) + L" 个录音条目。");
+    if (std::any_of(entries.begin(), entries.end(), [](const ScheduleEntry& entry) { return WritesMp3(entry.outputTemplate); }) ||
+        options_.baseConfig.compression) {
+        try {
+            Mp3Converter::Preload();
+            logger_.Info(L"[计划] LAME 编码库已预加载。");
+        } catch (const std::exception& ex) {
+            logger_.Warn(L"[计划] 无法预加载 LAME：" + Utf8ToWide(ex.what()) + L"；MP3 条目会在开始时失败。");
+        }
+    }
+
+    const auto outerStop = controls.shouldStop;
+    auto stopRequested = [&]() { return shouldStop() || (outerStop && outerStop()); };
+    controls.shouldStop = stopRequested;
+
+    auto cursor = std::chrono::system_clock::now();
+    while (!stopRequested()) {
+        const auto next = schedule_.Next(cursor);
+        if (!next) {
+            logger_.Warn(L"[计划] 未来四年内没有可执行的条目；守护进程退出。");
+            return;
+        }
+        cursor = next->start;
+        if (std::chrono::system_clock::now() > next->start + options_.lateStartTolerance) {
+            ++sessionsSkipped_;
+            logger_.Warn(L"[计划] 跳过 " + DescribeEntry(*next) + L"：开始时间已过（与上一场录音重叠）。");
+            continue;
+        }
+        logger_.Info(L"[计划] 下一场录音：" + DescribeEntry(*next) + L"。");
+
+        if (!SleepUntil(next->start - options_.prewarm, stopRequested)) {
+            break;
+        }
+        RecorderConfig config = ConfigFor(*next);
+        std::unique_ptr<IAudioSource> source;
+        try {
+            source = MakeSource(*next->entry);
+            pipeline_.Prepare(source->Format(), config);
+        } catch (const std::exception& ex) {
+            ++sessionsSkipped_;
+            logger_.Error(L"[计划] 准备 " + DescribeEntry(*next) + L" 失败：" + Utf8ToWide(ex.what()));
+            continue;
+        }
+        if (!SleepUntil(next->start, stopRequested)) {
+            break;
+        }
+
+        // Starting late (slow pre-warm, busy host) still ends at the scheduled time.
+        const auto remaining = std::chrono::ceil<std::chrono::seconds>(next->end - std::chrono::system_clock::now());
+        if (remaining.count() <= 0) {
+            ++sessionsSkipped_;
+            continue;
+        }
+        config.maxDuration = std::min(remaining, next->entry->duration);
+        config.outputPath = EnsureUniquePath(config.outputPath);
+        try {
+            if (config.outputPath.has_parent_path()) {
+                std::filesystem::create_directories(config.outputPath.parent_path());
+            }
+            logger_.Info(L"[计划] 开始录音：" + DescribeEntry(*next) + L" → " + config.outputPath.wstring());
+            const RecorderStats stats = pipeline_.Run(*source, config, controls);
+            ++sessionsRecorded_;
+            logger_.Info(L"[计划] 录音结束：" + std::to_wstring(stats.framesCaptured) + L" 帧，" +
+                         std::to_wstring(stats.segmentsWritten) + L" 个分段，丢弃 " +
+                         std::to_wstring(stats.framesDropped) + L" 帧。");
+        } catch (const std::exception& ex) {
+            logger_.Error(L"[计划] " + DescribeEntry(*next) + L" 录音失败：" + Utf8ToWide(ex.what()));
+        }
+    }
+    logger_.Info(L"[计划] 守护进程停止：已录制 " + std::to_wstring(sessionsRecorded_) + L" 场，跳过 " +
+                 std::to_wstring(sessionsSkipped_) + L" 场。");
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "AudioSource.h"
+#include "CapturePipeline.h"
+#include "Logger.h"
+#include "RecordingSchedule.h"
+
+#include <chrono>
+#include <functional>
+#include <memory>
+
+struct RecorderDaemonOptions {
+    RecorderConfig baseConfig;                      // per-entry bitrate/segment/output override it
+    std::chrono::milliseconds prewarm{2000};        // build the source and buffers this early
+    std::chrono::seconds lateStartTolerance{30};    // later than this, an occurrence is skipped
+    // Builds the source for an entry. Synthetic and pipe entries are handled by
+    // MakeScheduledSource(); the caller supplies loopback (device selection needs COM).
+    std::function<std::unique_ptr<IAudioSource>(const ScheduleEntry&)> makeSource;
+};
+
+// Runs a recording schedule in one long-lived process: the LAME library stays loaded and the
+// capture ring and buffers are reused, and each session's source is created and prepared
+// shortly before its start time so recording begins on the minute. Sessions never overlap;
+// an occurrence that starts while another session is running is logged and skipped.
+class RecorderDaemon {
+public:
+    RecorderDaemon(RecordingSchedule schedule, RecorderDaemonOptions options, Logger& logger);
+
+    // Blocks until `shouldStop` returns true (checked a few times per second, and by the
+    // running session). `controls` are passed to every session.
+    void Run(const std::function<bool()>& shouldStop, RecorderControls controls = {});
+
+    uint32_t SessionsRecorded() const { return sessionsRecorded_; }
+    uint32_t SessionsSkipped() const { return sessionsSkipped_; }
+
+private:
+    RecorderConfig ConfigFor(const ScheduledSession& session) const;
+    std::unique_ptr<IAudioSource> MakeSource(const ScheduleEntry& entry) const;
+
+    RecordingSchedule schedule_;
+    RecorderDaemonOptions options_;
+    Logger& logger_;
+    CapturePipeline pipeline_;
+    uint32_t sessionsRecorded_ = 0;
+    uint32_t sessionsSkipped_ = 0;
+};
+
+// Synthetic tone or PCM pipe source for an entry; nullptr for loopback entries.
+std::unique_ptr<IAudioSource> MakeScheduledSource(const ScheduleEntry& entry);
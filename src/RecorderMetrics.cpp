@@ -0,0 +1,132 @@
+#include "RecorderMetrics.h"
+
+#include <cstdio>
+
+namespace {
+
+std::string FormatDouble(double value) {
+    char buffer[64];
+    std::snprintf(buffer, sizeof(buffer), "%.9g", value);
+    return buffer;
+}
+
+void AppendMetric(std::string& out, const char* name, const char* type, const char* help, const std::string& value) {
+    out += "# HELP ";
+    out += name;
+    out += ' ';
+    out += help;
+    out += "\n# TYPE ";
+    out += name;
+    out += ' ';
+    out += type;
+    out += '\n';
+    out += name;
+    out += ' ';
+    out += value;
+    out += '\n';
+}
+
+void AppendCounter(std::string& out, const char* name, const char* help, const std::atomic<uint64_t>& value) {
+    AppendMetric(out, name, "counter", help, std::to_string(value.load(std::memory_order_relaxed)));
+}
+
+void AppendGauge(std::string& out, const char* name, const char* help, const std::string& value) {
+    AppendMetric(out, name, "gauge", help, value);
+}
+
+// Bucket bounds are powers of two nanoseconds (about 1 us to 8.6 s). They fall on HDR bucket
+// edges, so each cumulative count (values below the bound) is exact, not interpolated.
+constexpr unsigned kFirstBoundShift = 10;
+constexpr unsigned kLastBoundShift = 33;
+
+void AppendHistogram(std::string& out, const char* name, const char* help, const HdrHistogram& histogram) {
+    out += "# HELP ";
+    out += name;
+    out += ' ';
+    out += help;
+    out += "\n# TYPE ";
+    out += name;
+    out += " histogram\n";
+    uint64_t cumulative = 0;
+    size_t bucket = 0;
+    for (unsigned shift = kFirstBoundShift; shift <= kLastBoundShift; ++shift) {
+        const uint64_t bound = 1ull << shift;
+        for (; bucket < HdrHistogram::kBucketCount && HdrHistogram::BucketLowerBound(bucket) < bound; ++bucket) {
+            cumulative += histogram.BucketCount(bucket);
+        }
+        out += name;
+        out += "_bucket{le=\"";
+        out += FormatDouble(static_cast<double>(bound) / 1e9);
+        out += "\"} ";
+        out += std::to_string(cumulative);
+        out += '\n';
+    }
+    for (; bucket < HdrHistogram::kBucketCount; ++bucket) {
+        cumulative += histogram.BucketCount(bucket);
+    }
+    out += name;
+    out += "_bucket{le=\"+Inf\"} " + std::to_string(cumulative) + '\n';
+    out += name;
+    out += "_sum " + FormatDouble(static_cast<double>(histogram.SumNanos()) / 1e9) + '\n';
+    out += name;
+    out += "_count " + std::to_string(cumulative) + '\n';
+}
+
+} // namespace
+
+std::string RenderPrometheusText(const RecorderMetrics& metrics) {
+    std::string out;
+    out.reserve(16384);
+
+    AppendCounter(out, "recorder_frames_captured_total", "Frames accepted from the capture device.", metrics.framesCaptured);
+    AppendCounter(out, "recorder_frames_silent_total", "Captured frames flagged silent by the audio engine.", metrics.silentFrames);
+    AppendCounter(out, "recorder_frames_paused_total", "Frames discarded while recording was paused.", metrics.pausedFrames);
+    AppendCounter(out, "recorder_frames_dropped_total", "Frames dropped because the ring buffer stayed full.", metrics.droppedFrames);
+    AppendCounter(out, "recorder_glitches_total", "Data discontinuities reported by the audio engine.", metrics.glitches);
+    AppendCounter(out, "recorder_capture_timeouts_total", "Capture watchdog timeouts.", metrics.watchdogTimeouts);
+    AppendCounter(out, "recorder_ring_waits_total", "Times the capture thread waited for ring buffer space.", metrics.ringWaits);
+    AppendCounter(out, "recorder_ring_timeouts_total", "Ring buffer waits that timed out and dropped audio.", metrics.ringTimeouts);
+    AppendGauge(out, "recorder_ring_bytes", "Bytes queued between the capture and writer threads.",
+                std::to_string(metrics.ringBytes.load(std::memory_order_relaxed)));
+    AppendGauge(out, "recorder_ring_capacity_bytes", "Ring buffer capacity.",
+                std::to_string(metrics.ringCapacityBytes.load(std::memory_order_relaxed)));
+    AppendGauge(out, "recorder_sample_rate_hertz", "Sample rate of the current capture format.",
+                std::to_string(metrics.sampleRate.load(std::memory_order_relaxed)));
+
+    AppendCounter(out, "recorder_frames_written_total", "Frames handed to the segment writer.", metrics.framesWritten);
+    AppendCounter(out, "recorder_pcm_bytes_written_total", "PCM bytes handed to the segment writers.", metrics.bytesWritten);
+    AppendCounter(out, "recorder_segments_opened_total", "Segment files opened.", metrics.segmentsOpened);
+    AppendCounter(out, "recorder_writer_wait_timeouts_total", "Writer thread waits for data that timed out.", metrics.writerWaitTimeouts);
+    AppendMetric(out, "recorder_writer_busy_seconds_total", "counter",
+                 "Time the writer thread spent writing and encoding.",
+                 FormatDouble(static_cast<double>(metrics.writerBusyNanos.load(std::memory_order_relaxed)) / 1e9));
+
+    const uint64_t framesWritten = metrics.framesWritten.load(std::memory_order_relaxed);
+    const uint32_t sampleRate = metrics.sampleRate.load(std::memory_order_relaxed);
+    double realtimeFactor = 0.0;
+    if (framesWritten > 0 && sampleRate > 0) {
+        const double audioSeconds = static_cast<double>(framesWritten) / sampleRate;
+        realtimeFactor = static_cast<double>(metrics.writerBusyNanos.load(std::memory_order_relaxed)) / 1e9 / audioSeconds;
+    }
+    AppendGauge(out, "recorder_writer_realtime_factor",
+                "Writer busy time per second of audio since start (encoder cost for MP3 output; 1 means no headroom).",
+                FormatDouble(realtimeFactor));
+
+    const PipelineLatencies& latencies = metrics.latencies;
+    AppendHistogram(out, "recorder_write_latency_seconds", "Latency of one segment writer Write call (encoding included).",
+                    latencies.writerWrite);
+    AppendHistogram(out, "recorder_flush_latency_seconds", "Latency of one segment writer Flush call.",
+                    latencies.writerFlush);
+    AppendHistogram(out, "recorder_segment_roll_seconds", "Time to close one segment and open the next.",
+                    latencies.segmentRoll);
+    AppendHistogram(out, "recorder_capture_to_write_seconds",
+                    "Time from the device handing over a packet to the writer thread popping it from the ring.",
+                    latencies.captureToPop);
+
+    AppendCounter(out, "recorder_sessions_total", "Recording sessions started (including reconnects).", metrics.sessions);
+    AppendCounter(out, "recorder_device_invalidations_total", "Sessions ended by a disconnected or changed device.",
+                  metrics.deviceInvalidations);
+    AppendGauge(out, "recorder_recording", "1 while audio is being captured.",
+                std::to_string(metrics.recording.load(std::memory_order_relaxed)));
+    return out;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "HdrHistogram.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Process-wide counters and gauges of the recorder, accumulated across Record() calls (device
+// reconnects). Each group has a single writer thread and sits on its own cache line; exporters
+// only read, so a scrape never takes a lock the audio threads use.
+struct RecorderMetrics {
+    // Written by the capture thread.
+    alignas(64) std::atomic<uint64_t> framesCaptured{0};
+    std::atomic<uint64_t> silentFrames{0};
+    std::atomic<uint64_t> pausedFrames{0};
+    std::atomic<uint64_t> droppedFrames{0};
+    std::atomic<uint64_t> glitches{0};
+    std::atomic<uint64_t> watchdogTimeouts{0};
+    std::atomic<uint64_t> ringWaits{0};
+    std::atomic<uint64_t> ringTimeouts{0};
+    std::atomic<uint64_t> ringBytes{0};         // gauge
+    std::atomic<uint64_t> ringCapacityBytes{0}; // gauge
+    std::atomic<uint32_t> sampleRate{0};        // gauge
+
+    // Written by the writer thread.
+    alignas(64) std::atomic<uint64_t> framesWritten{0};
+    std::atomic<uint64_t> bytesWritten{0};      // PCM bytes, before MP3 encoding
+    std::atomic<uint64_t> segmentsOpened{0};
+    std::atomic<uint64_t> writerWaitTimeouts{0};
+    std::atomic<uint64_t> writerBusyNanos{0};   // time spent in SegmentedOutput::Write (incl. MP3 encoding)
+
+    // Each session's PipelineLatencies forwards here, so the histograms keep counting across
+    // reconnects; exported as Prometheus histograms.
+    alignas(64) PipelineLatencies latencies;
+
+    // Written by the thread calling Record().
+    alignas(64) std::atomic<uint64_t> sessions{0};
+    std::atomic<uint64_t> deviceInvalidations{0};
+    std::atomic<uint32_t> recording{0};         // gauge, 1 while Record() runs
+};
+
+// Prometheus text exposition format (version 0.0.4).
+std::string RenderPrometheusText(const RecorderMetrics& metrics);
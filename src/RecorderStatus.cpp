@@ -0,0 +1,22 @@
+#include "RecorderStatus.h"
+
+#include <thread>
+
+namespace {
+constexpr int kReadAttempts = 1000;
+}
+
+std::optional<RecorderStatusSnapshot> RecorderStatusBoard::Read() const {
+    RecorderStatusSnapshot snapshot;
+    bool captureRead = false;
+    bool outputRead = false;
+    for (int attempt = 0; attempt < kReadAttempts; ++attempt) {
+        captureRead = captureRead || capture_.TryLoad(snapshot.capture);
+        outputRead = outputRead || output_.TryLoad(snapshot.output);
+        if (captureRead && outputRead) {
+            return snapshot;
+        }
+        std::this_thread::yield();
+    }
+    return std::nullopt;
+}
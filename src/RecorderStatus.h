@@ -0,0 +1,110 @@
+#pragma once
+
+#include "SharedStats.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <type_traits>
+
+// In-process, push-based view of the running recording for front ends: the pipeline publishes
+// and the UI thread copies a snapshot whenever it repaints, without touching the filesystem.
+// The capture and writer threads each own one section and never wait on readers.
+
+// Single-writer seqlock over a trivially copyable value, stored as relaxed atomic words so
+// readers racing a publication see a torn copy only to discard it.
+template <typename T>
+class SeqlockCell {
+    static_assert(std::is_trivially_copyable_v<T>, "SeqlockCell holds plain data");
+
+public:
+    void Store(const T& value) {
+        uint64_t words[kWords] = {};
+        std::memcpy(words, &value, sizeof(T));
+        const uint64_t start = sequence_.load(std::memory_order_relaxed);
+        sequence_.store(start + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (size_t i = 0; i < kWords; ++i) {
+            words_[i].store(words[i], std::memory_order_relaxed);
+        }
+        sequence_.store(start + 2, std::memory_order_release);
+    }
+
+    // False while a publication is in progress; the caller retries.
+    bool TryLoad(T& value) const {
+        const uint64_t before = sequence_.load(std::memory_order_acquire);
+        if (before & 1) {
+            return false;
+        }
+        uint64_t words[kWords];
+        for (size_t i = 0; i < kWords; ++i) {
+            words[i] = words_[i].load(std::memory_order_relaxed);
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (sequence_.load(std::memory_order_relaxed) != before) {
+            return false;
+        }
+        std::memcpy(&value, words, sizeof(T));
+        return true;
+    }
+
+private:
+    static constexpr size_t kWords = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+    std::atomic<uint64_t> sequence_{0};
+    std::atomic<uint64_t> words_[kWords] = {};
+};
+
+// Capture thread, once per wakeup.
+struct RecorderCaptureStatus {
+    uint32_t state = static_cast<uint32_t>(SharedRecorderState::Stopped);   // SharedRecorderState
+    uint32_t sampleRate = 0;
+    uint32_t channels = 0;
+    uint32_t glitches = 0;
+    uint64_t framesCaptured = 0;           // elapsed audio handed to the writer this session
+    uint64_t pausedFrames = 0;
+    uint64_t droppedFrames = 0;
+    // Levels since the previous update, dBFS; -200 means digital silence.
+    float peakDbfs[kSharedStatsMaxChannels] = {};
+    float rmsDbfs[kSharedStatsMaxChannels] = {};
+};
+
+struct RecorderSegmentStatus {
+    uint32_t number = 0;                   // 1-based
+    uint64_t frames = 0;
+    uint64_t fileBytes = 0;
+};
+
+constexpr size_t kRecorderStatusRecentSegments = 8;
+
+// Writer thread, after every write and segment change.
+struct RecorderOutputStatus {
+    uint64_t framesWritten = 0;
+    uint64_t fileBytes = 0;                // written to the session's segment files, the open one included
+    RecorderSegmentStatus current;         // the open segment; number 0 before the first opens
+    uint32_t closedSegments = 0;
+    RecorderSegmentStatus recent[kRecorderStatusRecentSegments];   // last closed segments, oldest first
+};
+
+struct RecorderStatusSnapshot {
+    RecorderCaptureStatus capture;
+    RecorderOutputStatus output;
+};
+
+// Shared by the pipeline (RecorderControls::status) and any number of readers. Each Run()
+// starts both sections over, so a board reused across sessions shows the current one.
+class RecorderStatusBoard {
+public:
+    void PublishCapture(const RecorderCaptureStatus& status) { capture_.Store(status); }
+    void PublishOutput(const RecorderOutputStatus& status) { output_.Store(status); }
+
+    // Any thread; no I/O, no allocation. Each section is consistent on its own, and nullopt
+    // only if a writer kept one busy for every attempt.
+    std::optional<RecorderStatusSnapshot> Read() const;
+
+private:
+    SeqlockCell<RecorderCaptureStatus> capture_;
+    SeqlockCell<RecorderOutputStatus> output_;
+};
@@ -0,0 +1,311 @@
+#include "RecordingSchedule.h"
+
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+
+std::tm LocalTime(std::time_t timeT) {
+    std::tm tm{};
+#if defined(_WIN32)
+    localtime_s(&tm, &timeT);
+#else
+    localtime_r(&timeT, &tm);
+#endif
+    return tm;
+}
+
+bool ParseNumber(const std::string& text, int& value) {
+    if (text.empty() || text.size() > 9 || !std::all_of(text.begin(), text.end(), [](unsigned char ch) {
+            return std::isdigit(ch) != 0;
+        })) {
+        return false;
+    }
+    value = std::stoi(text);
+    return true;
+}
+
+// Returns the bit set of values in [low, high] named by one cron field.
+uint64_t ParseCronField(const std::string& field, int low, int high, const char* name) {
+    auto fail = [&]() -> std::runtime_error {
+        return std::runtime_error(std::string("无效的 cron ") + name + "字段：" + field);
+    };
+    uint64_t bits = 0;
+    std::stringstream items(field);
+    std::string item;
+    while (std::getline(items, item, ',')) {
+        int step = 1;
+        const size_t slash = item.find('/');
+        if (slash != std::string::npos) {
+            if (!ParseNumber(item.substr(slash + 1), step) || step <= 0) {
+                throw fail();
+            }
+            item.resize(slash);
+        }
+        int first = low;
+        int last = high;
+        if (item != "*") {
+            const size_t dash = item.find('-');
+            if (dash != std::string::npos) {
+                if (!ParseNumber(item.substr(0, dash), first) || !ParseNumber(item.substr(dash + 1), last)) {
+                    throw fail();
+                }
+            } else {
+                if (!ParseNumber(item, first)) {
+                    throw fail();
+                }
+                // "5/15" means 5, 20, 35, ... as in cron; a bare "5" is just 5.
+                last = slash != std::string::npos ? high : first;
+            }
+        }
+        if (first < low || last > high || first > last) {
+            throw fail();
+        }
+        for (int value = first; value <= last; value += step) {
+            bits |= uint64_t{1} << value;
+        }
+    }
+    if (bits == 0) {
+        throw fail();
+    }
+    return bits;
+}
+
+std::vector<std::string> SplitWhitespace(const std::string& line) {
+    std::istringstream stream(line);
+    return { std::istream_iterator<std::string>(stream), std::istream_iterator<std::string>() };
+}
+
+ScheduleEntry ParseEntry(const std::vector<std::string>& tokens) {
+    if (tokens.size() < 7) {
+        throw std::runtime_error("需要 5 个 cron 字段、时长和输出模板");
+    }
+    ScheduleEntry entry;
+    entry.when = CronExpression::Parse(tokens[0] + " " + tokens[1] + " " + tokens[2] + " " + tokens[3] + " " + tokens[4]);
+    entry.duration = ParseScheduleDuration(tokens[5]);
+    entry.outputTemplate = tokens[6];
+
+    for (size_t i = 7; i < tokens.size(); ++i) {
+        const std::string& option = tokens[i];
+        const size_t equals = option.find('=');
+        if (equals == std::string::npos) {
+            throw std::runtime_error("选项应为 key=value：" + option);
+        }
+        const std::string key = option.substr(0, equals);
+        const std::string value = option.substr(equals + 1);
+        int number = 0;
+        if (key == "source") {
+            if (value == "loopback") {
+                entry.source = ScheduledSourceKind::Loopback;
+            } else if (value == "synthetic") {
+                entry.source = ScheduledSourceKind::Synthetic;
+            } else if (value.rfind("pipe:", 0) == 0 && value.size() > 5) {
+                entry.source = ScheduledSourceKind::Pipe;
+                entry.pipePath = std::filesystem::path(std::u8string(value.begin() + 5, value.end()));
+            } else {
+                throw std::runtime_error("source 应为 loopback、synthetic 或 pipe:PATH：" + value);
+            }
+        } else if (key == "device") {
+            if (!ParseNumber(value, number)) {
+                throw std::runtime_error("device 应为设备序号：" + value);
+            }
+            entry.deviceIndex = static_cast<size_t>(number);
+        } else if (key == "bitrate") {
+            if (!ParseNumber(value, number) || number < 32 || number > 320) {
+                throw std::runtime_error("bitrate 应在 32 到 320 kbps 之间：" + value);
+            }
+            entry.mp3BitrateKbps = static_cast<uint32_t>(number);
+        } else if (key == "segment") {
+            entry.segmentDuration = ParseScheduleDuration(value);
+        } else if (key == "rate") {
+            if (!ParseNumber(value, number) || number < 8000 || number > 384000) {
+                throw std::runtime_error("rate 应在 8000 到 384000 Hz 之间：" + value);
+            }
+            entry.sampleRate = static_cast<uint32_t>(number);
+        } else if (key == "channels") {
+            if (!ParseNumber(value, number) || number < 1 || number > 8) {
+                throw std::runtime_error("channels 应在 1 到 8 之间：" + value);
+            }
+            entry.channels = static_cast<uint16_t>(number);
+        } else if (key == "sample") {
+            if (value != "s16" && value != "f32") {
+                throw std::runtime_error("sample 应为 s16 或 f32：" + value);
+            }
+            entry.floatSamples = value == "f32";
+        } else {
+            throw std::runtime_error("未知选项：" + key);
+        }
+    }
+    return entry;
+}
+
+} // namespace
+
+CronExpression CronExpression::Parse(const std::string& text) {
+    const auto fields = SplitWhitespace(text);
+    if (fields.size() != 5) {
+        throw std::runtime_error("cron 表达式需要 5 个字段：" + text);
+    }
+    CronExpression expression;
+    expression.text_ = text;
+    expression.minutes_ = ParseCronField(fields[0], 0, 59, "分钟");
+    expression.hours_ = static_cast<uint32_t>(ParseCronField(fields[1], 0, 23, "小时"));
+    expression.days_ = static_cast<uint32_t>(ParseCronField(fields[2], 1, 31, "日"));
+    expression.months_ = static_cast<uint16_t>(ParseCronField(fields[3], 1, 12, "月"));
+    uint64_t weekdays = ParseCronField(fields[4], 0, 7, "星期");
+    if (weekdays & (uint64_t{1} << 7)) {
+        weekdays = (weekdays | 1) & 0x7f;   // 7 is Sunday too
+    }
+    expression.weekdays_ = static_cast<uint8_t>(weekdays);
+    // Like cron: a day field that starts with '*' does not restrict, even with a step.
+    expression.daysRestricted_ = fields[2][0] != '*';
+    expression.weekdaysRestricted_ = fields[4][0] != '*';
+    return expression;
+}
+
+bool CronExpression::Matches(const std::tm& local) const {
+    return (minutes_ >> local.tm_min & 1) && (hours_ >> local.tm_hour & 1) && (months_ >> (local.tm_mon + 1) & 1) &&
+           DayMatches(local);
+}
+
+bool CronExpression::DayMatches(const std::tm& local) const {
+    const bool dayMatch = (days_ >> local.tm_mday & 1) != 0;
+    const bool weekdayMatch = (weekdays_ >> local.tm_wday & 1) != 0;
+    if (daysRestricted_ && weekdaysRestricted_) {
+        return dayMatch || weekdayMatch;
+    }
+    return dayMatch && weekdayMatch;
+}
+
+std::optional<std::chrono::system_clock::time_point> CronExpression::Next(
+    std::chrono::system_clock::time_point after) const {
+    const std::time_t afterT = std::chrono::system_clock::to_time_t(after);
+    std::tm tm = LocalTime(afterT);
+    const int lastYear = tm.tm_year + 4;
+    tm.tm_sec = 0;
+    tm.tm_min += 1;
+    // Advance wall-clock fields in the largest unit that fails to match; mktime normalizes
+    // overflow and DST transitions, and every step moves strictly forward.
+    for (;;) {
+        tm.tm_isdst = -1;
+        const std::time_t candidate = std::mktime(&tm);
+        if (candidate == static_cast<std::time_t>(-1) || tm.tm_year > lastYear) {
+            return std::nullopt;
+        }
+        if (!(months_ >> (tm.tm_mon + 1) & 1)) {
+            tm.tm_mon += 1;
+            tm.tm_mday = 1;
+            tm.tm_hour = 0;
+            tm.tm_min = 0;
+            continue;
+        }
+        if (!DayMatches(tm)) {
+            tm.tm_mday += 1;
+            tm.tm_hour = 0;
+            tm.tm_min = 0;
+            continue;
+        }
+        if (!(hours_ >> tm.tm_hour & 1)) {
+            tm.tm_hour += 1;
+            tm.tm_min = 0;
+            continue;
+        }
+        if (!(minutes_ >> tm.tm_min & 1)) {
+            tm.tm_min += 1;
+            continue;
+        }
+        if (candidate <= afterT) {
+            // A repeated wall-clock hour (DST fall-back) maps back before `after`.
+            tm.tm_min += 1;
+            continue;
+        }
+        return std::chrono::system_clock::from_time_t(candidate);
+    }
+}
+
+RecordingSchedule RecordingSchedule::Load(const std::filesystem::path& path) {
+    std::ifstream stream(path, std::ios::binary);
+    if (!stream) {
+        throw std::runtime_error("无法打开计划文件：" + path.string());
+    }
+    const std::string text((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+    return Parse(text);
+}
+
+RecordingSchedule RecordingSchedule::Parse(const std::string& text) {
+    RecordingSchedule schedule;
+    std::istringstream stream(text.rfind("\xEF\xBB\xBF", 0) == 0 ? text.substr(3) : text);
+    std::string line;
+    size_t lineNumber = 0;
+    while (std::getline(stream, line)) {
+        ++lineNumber;
+        const auto tokens = SplitWhitespace(line);
+        if (tokens.empty() || tokens[0][0] == '#') {
+            continue;
+        }
+        try {
+            ScheduleEntry entry = ParseEntry(tokens);
+            entry.line = lineNumber;
+            schedule.entries_.push_back(std::move(entry));
+        } catch (const std::exception& ex) {
+            throw std::runtime_error("计划文件第 " + std::to_string(lineNumber) + " 行：" + ex.what());
+        }
+    }
+    if (schedule.entries_.empty()) {
+        throw std::runtime_error("计划文件中没有录音条目");
+    }
+    return schedule;
+}
+
+std::optional<ScheduledSession> RecordingSchedule::Next(std::chrono::system_clock::time_point after) const {
+    std::optional<ScheduledSession> best;
+    for (const auto& entry : entries_) {
+        const auto start = entry.when.Next(after);
+        if (start && (!best || *start < best->start)) {
+            best = ScheduledSession{ &entry, *start, *start + entry.duration };
+        }
+    }
+    return best;
+}
+
+std::chrono::seconds ParseScheduleDuration(const std::string& text) {
+    auto fail = [&]() { return std::runtime_error("无效的时长（例如 90s、10m、2h、1h30m）：" + text); };
+    int64_t total = 0;
+    size_t pos = 0;
+    while (pos < text.size()) {
+        const size_t digitsEnd = text.find_first_not_of("0123456789", pos);
+        if (digitsEnd == pos || digitsEnd == std::string::npos || digitsEnd - pos > 6) {
+            throw fail();
+        }
+        const int64_t value = std::stoll(text.substr(pos, digitsEnd - pos));
+        switch (text[digitsEnd]) {
+        case 's': total += value; break;
+        case 'm': total += value * 60; break;
+        case 'h': total += value * 3600; break;
+        default: throw fail();
+        }
+        pos = digitsEnd + 1;
+    }
+    if (total <= 0) {
+        throw fail();
+    }
+    return std::chrono::seconds(total);
+}
+
+std::filesystem::path ExpandOutputTemplate(const std::string& pattern, std::chrono::system_clock::time_point start) {
+    const std::tm tm = LocalTime(std::chrono::system_clock::to_time_t(start));
+    std::string expanded(pattern.size() + 64, '\0');
+    for (;;) {
+        const size_t length = std::strftime(expanded.data(), expanded.size(), pattern.c_str(), &tm);
+        if (length > 0 || pattern.empty()) {
+            expanded.resize(length);
+            break;
+        }
+        expanded.resize(expanded.size() * 2);
+    }
+    return std::filesystem::path(std::u8string(expanded.begin(), expanded.end()));
+}
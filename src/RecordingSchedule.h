@@ -0,0 +1,83 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <ctime>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <vector>
+
+// Minute, hour, day-of-month, month and day-of-week fields of a cron expression, each
+// accepting `*`, lists, ranges and steps (`*/15`, `1-5`, `0,30`). As in cron, when both
+// day fields are restricted a time matches if either of them does. Evaluated in local time.
+class CronExpression {
+public:
+    static CronExpression Parse(const std::string& text);
+
+    bool Matches(const std::tm& local) const;
+    // First matching minute strictly after `after`; nullopt if none within four years.
+    std::optional<std::chrono::system_clock::time_point> Next(std::chrono::system_clock::time_point after) const;
+
+    const std::string& Text() const { return text_; }
+
+private:
+    bool DayMatches(const std::tm& local) const;
+
+    std::string text_;
+    uint64_t minutes_ = 0;    // bit n = minute n
+    uint32_t hours_ = 0;
+    uint32_t days_ = 0;       // bit n = day n (1..31)
+    uint16_t months_ = 0;     // bit n = month n (1..12)
+    uint8_t weekdays_ = 0;    // bit n = weekday n (0 = Sunday)
+    bool daysRestricted_ = false;
+    bool weekdaysRestricted_ = false;
+};
+
+enum class ScheduledSourceKind {
+    Loopback,
+    Synthetic,
+    Pipe,
+};
+
+// One line of a schedule file:
+//   <min> <hour> <dom> <month> <dow>  <duration>  <output template>  [key=value ...]
+// e.g. `0 9 * * 1-5  2h  D:\rec\%Y-%m-%d\standup.mp3  bitrate=128 segment=600`.
+struct ScheduleEntry {
+    size_t line = 0;
+    CronExpression when;
+    std::chrono::seconds duration{0};
+    std::string outputTemplate;                 // UTF-8, strftime codes expanded at the start time
+    ScheduledSourceKind source = ScheduledSourceKind::Loopback;
+    std::filesystem::path pipePath;             // source=pipe:PATH
+    std::optional<size_t> deviceIndex;          // loopback only
+    std::optional<uint32_t> mp3BitrateKbps;
+    std::optional<std::chrono::seconds> segmentDuration;
+    uint32_t sampleRate = 48000;                // synthetic/pipe only
+    uint16_t channels = 2;
+    bool floatSamples = false;
+};
+
+struct ScheduledSession {
+    const ScheduleEntry* entry = nullptr;
+    std::chrono::system_clock::time_point start;
+    std::chrono::system_clock::time_point end;
+};
+
+class RecordingSchedule {
+public:
+    static RecordingSchedule Load(const std::filesystem::path& path);
+    static RecordingSchedule Parse(const std::string& text);
+
+    const std::vector<ScheduleEntry>& Entries() const { return entries_; }
+    // Earliest session starting strictly after `after`; ties go to the earlier line.
+    std::optional<ScheduledSession> Next(std::chrono::system_clock::time_point after) const;
+
+private:
+    std::vector<ScheduleEntry> entries_;
+};
+
+// "90s", "10m", "2h", "1h30m"; throws on anything else or zero.
+std::chrono::seconds ParseScheduleDuration(const std::string& text);
+// Expands strftime codes (%Y, %m, %d, %H, %M, %S, ...) in local time.
+std::filesystem::path ExpandOutputTemplate(const std::string& pattern, std::chrono::system_clock::time_point start);
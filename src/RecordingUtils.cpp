@@ -10,19 +10,15 @@
 #include <stdexcept>
 #include <string>
 
-namespace {
-
-std::wstring ToWide(const std::string& text) {
-    return std::wstring(text.begin(), text.end());
-}
-
-}
-
 std::filesystem::path DefaultOutputPath() {
     auto now = std::chrono::system_clock::now();
     auto now_t = std::chrono::system_clock::to_time_t(now);
     std::tm tm{};
+#if defined(_WIN32)
     localtime_s(&tm, &now_t);
+#else
+    localtime_r(&now_t, &tm);
+#endif
     wchar_t buffer[64];
     wcsftime(buffer, std::size(buffer), L"loopback_%Y%m%d_%H%M%S.mp3", &tm);
     return buffer;
@@ -75,6 +71,14 @@ std::filesystem::path EnsureUniquePath(const std::filesystem::path& path) {
     return path;
 }
 
+std::wstring Utf8ToWide(const std::string& text) {
+    try {
+        return std::filesystem::path(std::u8string(text.begin(), text.end())).wstring();
+    } catch (const std::exception&) {
+        return std::wstring(text.begin(), text.end());
+    }
+}
+
 void ConvertRecordedSegmentsToMp3(const std::filesystem::path& wavBasePath,
                                   const std::filesystem::path& mp3BasePath,
                                   uint32_t segmentCount,
@@ -4,10 +4,14 @@
 #include "Logger.h"
 
 #include <filesystem>
+#include <string>
 
 std::filesystem::path DefaultOutputPath();
 std::filesystem::path EnsureExtension(std::filesystem::path path, const std::wstring& desiredExtension);
 std::filesystem::path EnsureUniquePath(const std::filesystem::path& path);
+// Widens UTF-8 text such as exception messages for the logger; invalid UTF-8 is widened
+// byte by byte.
+std::wstring Utf8ToWide(const std::string& text);
 void ConvertRecordedSegmentsToMp3(const std::filesystem::path& wavBasePath,
                                   const std::filesystem::path& mp3BasePath,
                                   uint32_t segmentCount,
@@ -0,0 +1,273 @@
+#include "SegmentCompressor.h"
+
+#include "RecordingUtils.h"
+#include "SegmentNaming.h"
+
+#include <algorithm>
+#include <exception>
+#include <fstream>
+#include <string>
+#include <system_error>
+
+#if defined(_WIN32)
+#include <Windows.h>
+#elif defined(__linux__)
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+// LAME adds encoder delay, end padding and a leading Info frame; anything beyond a few
+// frames of slack means the encode was cut short or the stream is corrupt.
+constexpr uint64_t kMaxExtraSamples = 1152 * 4;
+
+std::string ToUtf8(const std::filesystem::path& path) {
+    const auto text = path.u8string();
+    return std::string(text.begin(), text.end());
+}
+
+std::filesystem::path FromUtf8(const std::string& text) {
+    return std::filesystem::path(std::u8string(text.begin(), text.end()));
+}
+
+void EnterBackgroundPriority() {
+#if defined(_WIN32)
+    // Lowers CPU, I/O and memory priority of the calling thread.
+    SetThreadPriority(GetCurrentThread(), THREAD_MODE_BACKGROUND_BEGIN);
+    SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_IDLE);
+#elif defined(__linux__)
+    // On Linux the nice value and the I/O priority are per thread when applied to the calling
+    // thread. The idle I/O class only gets the disk when nobody else wants it, so encoding
+    // never delays the writer's segment writes. glibc has no wrapper for ioprio_set.
+    constexpr int kIoprioWhoProcess = 1;
+    constexpr int kIoprioClassIdle = 3;
+    constexpr int kIoprioClassShift = 13;
+    setpriority(PRIO_PROCESS, 0, 19);
+    syscall(SYS_ioprio_set, kIoprioWhoProcess, 0, kIoprioClassIdle << kIoprioClassShift);
+#endif
+}
+
+} // namespace
+
+std::filesystem::path BuildCompressionStatePath(const std::filesystem::path& basePath) {
+    std::wstring stem = basePath.stem().wstring();
+    if (stem.empty()) {
+        stem = L"segment";
+    }
+    return basePath.parent_path() / (stem + L".compress-queue");
+}
+
+SegmentCompressor::SegmentCompressor(const std::filesystem::path& statePath,
+                                     CompressionOptions options,
+                                     Logger& logger,
+                                     CompletedCallback onCompleted)
+    : statePath_(statePath), options_(options), logger_(logger), onCompleted_(std::move(onCompleted)) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        LoadStateLocked();
+        if (!queue_.empty()) {
+            logger_.Info(L"[压缩] 恢复上次未完成的 " + std::to_wstring(queue_.size()) + L" 个压缩任务。");
+        }
+    }
+    const unsigned threads = std::max(1u, options_.threads);
+    for (unsigned i = 0; i < threads; ++i) {
+        workers_.emplace_back([this]() { Run(); });
+    }
+}
+
+SegmentCompressor::~SegmentCompressor() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    for (auto& worker : workers_) {
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+}
+
+void SegmentCompressor::Enqueue(uint32_t segmentNumber, const std::filesystem::path& wavPath) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        queue_.push_back(Job{segmentNumber, wavPath, false});
+        SaveStateLocked();
+    }
+    wake_.notify_one();
+}
+
+void SegmentCompressor::WaitIdle() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    idle_.wait(lock, [this]() { return queue_.empty() && active_.empty(); });
+}
+
+size_t SegmentCompressor::PendingJobs() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return queue_.size() + active_.size();
+}
+
+void SegmentCompressor::LoadStateLocked() {
+    std::ifstream stream(statePath_, std::ios::binary);
+    if (!stream) {
+        return;
+    }
+    std::string line;
+    while (std::getline(stream, line)) {
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        const auto tab = line.find('\t');
+        if (tab == std::string::npos || tab + 1 >= line.size()) {
+            continue;
+        }
+        Job job;
+        try {
+            job.segmentNumber = static_cast<uint32_t>(std::stoul(line.substr(0, tab)));
+        } catch (...) {
+            continue;
+        }
+        job.path = FromUtf8(line.substr(tab + 1));
+        job.resumed = true;
+        queue_.push_back(std::move(job));
+    }
+}
+
+void SegmentCompressor::SaveStateLocked() {
+    std::error_code ec;
+    if (queue_.empty() && active_.empty()) {
+        std::filesystem::remove(statePath_, ec);
+        return;
+    }
+    auto tempPath = statePath_;
+    tempPath += L".tmp";
+    {
+        std::ofstream stream(tempPath, std::ios::binary | std::ios::trunc);
+        if (!stream) {
+            logger_.Warn(L"[压缩] 无法写入任务状态文件：" + tempPath.wstring());
+            return;
+        }
+        auto writeJob = [&stream](const Job& job) {
+            stream << job.segmentNumber << '\t' << ToUtf8(job.path) << '\n';
+        };
+        std::for_each(active_.begin(), active_.end(), writeJob);
+        std::for_each(queue_.begin(), queue_.end(), writeJob);
+    }
+    std::filesystem::rename(tempPath, statePath_, ec);
+    if (ec) {
+        logger_.Warn(L"[压缩] 更新任务状态文件失败：" + statePath_.wstring());
+    }
+}
+
+void SegmentCompressor::Run() {
+    EnterBackgroundPriority();
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        wake_.wait(lock, [this]() { return stopping_ || !queue_.empty(); });
+        if (stopping_) {
+            break; // unfinished jobs stay in the state file for the next session
+        }
+        Job job = std::move(queue_.front());
+        queue_.pop_front();
+        active_.push_back(job);
+        lock.unlock();
+
+        Process(job);
+
+        lock.lock();
+        active_.erase(std::find_if(active_.begin(), active_.end(),
+                                   [&job](const Job& other) { return other.path == job.path; }));
+        SaveStateLocked();
+        if (queue_.empty() && active_.empty()) {
+            idle_.notify_all();
+        }
+    }
+}
+
+void SegmentCompressor::Process(const Job& job) {
+    auto reportFailure = [&]() {
+        Completion failed;
+        failed.segmentNumber = job.segmentNumber;
+        failed.sourcePath = job.path;
+        Report(job, failed);
+    };
+    std::error_code ec;
+    if (!std::filesystem::exists(job.path, ec)) {
+        logger_.Warn(L"[压缩] 分段已不存在，跳过：" + job.path.wstring());
+        reportFailure();
+        return;
+    }
+    auto mp3Path = job.path;
+    mp3Path.replace_extension(L".mp3");
+    // Every file is encoded to a .part name and renamed only once all of them passed.
+    std::vector<std::filesystem::path> outputPaths{mp3Path};
+    std::vector<Mp3Rendition> renditions{Mp3Rendition{mp3Path, options_.mp3Options}};
+    for (const auto kbps : options_.ladderKbps) {
+        outputPaths.push_back(BuildRenditionPath(mp3Path, kbps));
+        renditions.push_back(Mp3Rendition{outputPaths.back(), Mp3ConversionOptions{kbps}});
+    }
+    for (auto& rendition : renditions) {
+        rendition.path += L".part";
+    }
+
+    try {
+        const Mp3ConversionResult result = Mp3Converter::ConvertWavToMp3Ladder(job.path, renditions, logger_,
+                                                                                  EnterBackgroundPriority);
+        for (const auto& rendition : renditions) {
+            const Mp3StreamInfo info = Mp3Converter::ScanMp3File(rendition.path);
+            const bool complete = info.valid && info.sampleRate == result.sampleRate &&
+                                  info.samples + 1152 >= result.inputFrames &&
+                                  info.samples <= result.inputFrames + kMaxExtraSamples;
+            if (!complete) {
+                throw std::runtime_error("MP3 校验失败：帧数 " + std::to_string(info.samples) + "，WAV 帧数 " +
+                                         std::to_string(result.inputFrames));
+            }
+        }
+        for (size_t i = 0; i < renditions.size(); ++i) {
+            std::filesystem::rename(renditions[i].path, outputPaths[i]);
+        }
+    } catch (const std::exception& ex) {
+        for (const auto& rendition : renditions) {
+            std::filesystem::remove(rendition.path, ec);
+        }
+        logger_.Error(L"[压缩] 分段 #" + std::to_wstring(job.segmentNumber) + L" 压缩失败，保留 WAV：" +
+                      job.path.wstring() + L"（" + Utf8ToWide(ex.what()) + L"）");
+        reportFailure();
+        return;
+    }
+
+    Completion completion;
+    completion.segmentNumber = job.segmentNumber;
+    completion.compressed = true;
+    completion.sourcePath = job.path;
+    completion.compressedPath = mp3Path;
+    completion.renditionPaths.assign(outputPaths.begin() + 1, outputPaths.end());
+    for (const auto& path : outputPaths) {
+        const auto size = std::filesystem::file_size(path, ec);
+        completion.compressedBytes += ec ? 0 : size;
+    }
+    if (options_.deleteSource) {
+        completion.sourceDeleted = std::filesystem::remove(job.path, ec);
+        if (ec) {
+            logger_.Warn(L"[压缩] 删除已压缩的 WAV 失败：" + job.path.wstring());
+        }
+    }
+    logger_.Info(L"[压缩] 分段 #" + std::to_wstring(job.segmentNumber) + L" 已压缩并校验：" + mp3Path.wstring() +
+                 (completion.renditionPaths.empty()
+                      ? L""
+                      : L"（另有 " + std::to_wstring(completion.renditionPaths.size()) + L" 个码率）") +
+                 (completion.sourceDeleted ? L"（已删除 WAV）" : L""));
+    Report(job, completion);
+}
+
+void SegmentCompressor::Report(const Job& job, const Completion& completion) {
+    if (onCompleted_ && !job.resumed) {
+        try {
+            onCompleted_(completion);
+        } catch (const std::exception& ex) {
+            logger_.Warn(L"[压缩] 完成回调失败：" + Utf8ToWide(ex.what()));
+        }
+    }
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "Logger.h"
+#include "Mp3Converter.h"
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct CompressionOptions {
+    Mp3ConversionOptions mp3Options;
+    // Extra bitrates encoded in the same pass as mp3Options, saved as <stem>-<kbps>k.mp3.
+    std::vector<uint32_t> ladderKbps;
+    bool deleteSource = false;   // remove the WAV once the MP3 passed verification
+    unsigned threads = 1;
+};
+
+// Background MP3 encoding of closed WAV segments. Workers run at background priority so
+// they never compete with the capture and writer threads. Pending jobs are mirrored in a
+// small state file (one "<segment>\t<path>" per line) and picked up again by the next
+// session that records to the same base path.
+class SegmentCompressor {
+public:
+    struct Completion {
+        uint32_t segmentNumber = 0;
+        bool compressed = false;   // false: the job failed or the WAV was gone, and nothing else is set
+        std::filesystem::path sourcePath;
+        std::filesystem::path compressedPath;
+        std::vector<std::filesystem::path> renditionPaths;   // ladder files next to compressedPath
+        uint64_t compressedBytes = 0;                        // all MP3 files of the segment
+        bool sourceDeleted = false;
+    };
+    // Invoked on a worker thread once per job, only for segments enqueued by this session.
+    using CompletedCallback = std::function<void(const Completion& completion)>;
+
+    SegmentCompressor(const std::filesystem::path& statePath,
+                      CompressionOptions options,
+                      Logger& logger,
+                      CompletedCallback onCompleted = {});
+    ~SegmentCompressor();
+
+    SegmentCompressor(const SegmentCompressor&) = delete;
+    SegmentCompressor& operator=(const SegmentCompressor&) = delete;
+
+    void Enqueue(uint32_t segmentNumber, const std::filesystem::path& wavPath);
+    // Blocks until every queued job has been processed.
+    void WaitIdle();
+    size_t PendingJobs() const;
+
+private:
+    struct Job {
+        uint32_t segmentNumber = 0;
+        std::filesystem::path path;
+        bool resumed = false;   // left over from an earlier session
+    };
+
+    void Run();
+    void Process(const Job& job);
+    void Report(const Job& job, const Completion& completion);
+    void LoadStateLocked();
+    void SaveStateLocked();
+
+    const std::filesystem::path statePath_;
+    const CompressionOptions options_;
+    Logger& logger_;
+    CompletedCallback onCompleted_;
+    mutable std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable idle_;
+    std::deque<Job> queue_;
+    std::vector<Job> active_;
+    bool stopping_ = false;
+    std::vector<std::thread> workers_;
+};
+
+std::filesystem::path BuildCompressionStatePath(const std::filesystem::path& basePath);
@@ -0,0 +1,250 @@
+#include "SegmentManifest.h"
+
+#include "Checksum.h"
+#include "JsonLines.h"
+#include "RecordingUtils.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <set>
+#include <stdexcept>
+#include <string_view>
+#include <system_error>
+#include <thread>
+
+namespace {
+
+std::string ToUtf8(const std::filesystem::path& path) {
+    const auto text = path.u8string();
+    return std::string(text.begin(), text.end());
+}
+
+std::filesystem::path FromUtf8(const std::string& text) {
+    return std::filesystem::path(std::u8string(text.begin(), text.end()));
+}
+
+int64_t ToUnixMillis(std::chrono::system_clock::time_point time) {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(time.time_since_epoch()).count();
+}
+
+std::chrono::system_clock::time_point FromUnixMillis(int64_t millis) {
+    return std::chrono::system_clock::time_point(std::chrono::milliseconds(millis));
+}
+
+std::string FormatUtc(std::chrono::system_clock::time_point time) {
+    const int64_t millis = ToUnixMillis(time);
+    const std::time_t seconds = static_cast<std::time_t>(millis / 1000);
+    std::tm tm{};
+#if defined(_WIN32)
+    gmtime_s(&tm, &seconds);
+#else
+    gmtime_r(&seconds, &tm);
+#endif
+    char buffer[96];   // sized for any int the compiler can't rule out, not just real dates
+    std::snprintf(buffer, sizeof(buffer), "%04d-%02d-%02dT%02d:%02d:%02d.%03dZ",
+                  tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec,
+                  static_cast<int>(millis % 1000));
+    return buffer;
+}
+
+std::string FormatCrc(uint32_t crc) {
+    char buffer[12];
+    std::snprintf(buffer, sizeof(buffer), "%08x", crc);
+    return buffer;
+}
+
+} // namespace
+
+std::filesystem::path BuildManifestPath(const std::filesystem::path& basePath) {
+    std::wstring stem = basePath.stem().wstring();
+    if (stem.empty()) {
+        stem = L"segment";
+    }
+    return basePath.parent_path() / (stem + L".manifest.jsonl");
+}
+
+SegmentManifestWriter::SegmentManifestWriter(const std::filesystem::path& manifestPath)
+    : path_(manifestPath) {
+    stream_.open(path_, std::ios::binary | std::ios::app);
+    if (!stream_) {
+        throw std::runtime_error("打开分段清单失败：" + path_.string());
+    }
+}
+
+void SegmentManifestWriter::Append(const SegmentManifestEntry& entry) {
+    JsonObjectBuilder json;
+    json.Add("segment", entry.segmentNumber)
+        .Add("file", ToUtf8(entry.fileName))
+        .Add("start_utc", FormatUtc(entry.startTime))
+        .Add("end_utc", FormatUtc(entry.endTime))
+        .Add("start_unix_ms", ToUnixMillis(entry.startTime))
+        .Add("end_unix_ms", ToUnixMillis(entry.endTime))
+        .Add("start_frame", entry.startFrame)
+        .Add("end_frame", entry.endFrame)
+        .Add("sample_rate", entry.sampleRate)
+        .Add("bytes", entry.bytes)
+        .Add("dropped_frames", entry.droppedFrames)
+        .Add("gaps", entry.gaps)
+        .Add("crc32c", FormatCrc(entry.crc32c))
+        .Add("crc_offset", entry.crcOffset)
+        .Add("crc_bytes", entry.crcBytes);
+    AppendLine(json.Str());
+}
+
+void SegmentManifestWriter::AppendDeletion(uint32_t segmentNumber,
+                                           const std::filesystem::path& fileName,
+                                           std::chrono::system_clock::time_point deletedAt) {
+    JsonObjectBuilder json;
+    json.Add("segment", segmentNumber)
+        .Add("deleted", ToUtf8(fileName))
+        .Add("deleted_unix_ms", ToUnixMillis(deletedAt));
+    AppendLine(json.Str());
+}
+
+void SegmentManifestWriter::AppendLine(const std::string& line) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stream_ << line << '\n';
+    stream_.flush();
+    if (!stream_) {
+        throw std::runtime_error("写入分段清单失败：" + path_.string());
+    }
+}
+
+std::vector<SegmentManifestEntry> ReadSegmentManifest(const std::filesystem::path& manifestPath) {
+    std::ifstream stream(manifestPath, std::ios::binary);
+    if (!stream) {
+        throw std::runtime_error("打开分段清单失败：" + manifestPath.string());
+    }
+    std::vector<SegmentManifestEntry> entries;
+    std::set<std::string> deleted;
+    std::string line;
+    size_t lineNumber = 0;
+    while (std::getline(stream, line)) {
+        ++lineNumber;
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        if (line.empty()) {
+            continue;
+        }
+        auto object = ParseJsonObject(line);
+        if (!object) {
+            throw std::runtime_error("分段清单第 " + std::to_string(lineNumber) + " 行不是有效的 JSON");
+        }
+        if (const auto removed = JsonGetString(*object, "deleted")) {
+            deleted.insert(*removed);
+            continue;
+        }
+        const auto file = JsonGetString(*object, "file");
+        const auto crcText = JsonGetString(*object, "crc32c");
+        if (!file || !crcText) {
+            continue; // not a segment record
+        }
+        SegmentManifestEntry entry;
+        entry.segmentNumber = static_cast<uint32_t>(JsonGetUint64(*object, "segment").value_or(0));
+        entry.fileName = FromUtf8(*file);
+        entry.startTime = FromUnixMillis(JsonGetInt64(*object, "start_unix_ms").value_or(0));
+        entry.endTime = FromUnixMillis(JsonGetInt64(*object, "end_unix_ms").value_or(0));
+        entry.startFrame = JsonGetUint64(*object, "start_frame").value_or(0);
+        entry.endFrame = JsonGetUint64(*object, "end_frame").value_or(0);
+        entry.sampleRate = static_cast<uint32_t>(JsonGetUint64(*object, "sample_rate").value_or(0));
+        entry.bytes = JsonGetUint64(*object, "bytes").value_or(0);
+        entry.droppedFrames = JsonGetUint64(*object, "dropped_frames").value_or(0);
+        entry.gaps = static_cast<uint32_t>(JsonGetUint64(*object, "gaps").value_or(0));
+        entry.crc32c = static_cast<uint32_t>(std::strtoul(crcText->c_str(), nullptr, 16));
+        entry.crcOffset = JsonGetUint64(*object, "crc_offset").value_or(0);
+        entry.crcBytes = JsonGetUint64(*object, "crc_bytes").value_or(0);
+        entries.push_back(std::move(entry));
+    }
+    if (!deleted.empty()) {
+        std::erase_if(entries, [&](const SegmentManifestEntry& entry) {
+            return deleted.count(ToUtf8(entry.fileName)) > 0;
+        });
+    }
+    return entries;
+}
+
+ManifestVerifyResult VerifySegmentManifest(const std::filesystem::path& manifestPath,
+                                           unsigned threads,
+                                           Logger& logger) {
+    const auto entries = ReadSegmentManifest(manifestPath);
+    const auto directory = manifestPath.parent_path();
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    threads = static_cast<unsigned>(std::min<size_t>(threads, std::max<size_t>(entries.size(), 1)));
+    logger.Info(L"校验 " + std::to_wstring(entries.size()) + L" 个分段（" + std::to_wstring(threads) +
+                L" 个线程，CRC-32C " + (Crc32c::HardwareAccelerated() ? L"硬件加速" : L"查表") + L"）。");
+
+    std::atomic<size_t> next{0};
+    std::atomic<size_t> passed{0};
+    std::atomic<size_t> missing{0};
+    std::atomic<size_t> sizeMismatches{0};
+    std::atomic<size_t> checksumMismatches{0};
+
+    auto worker = [&]() {
+        std::vector<char> buffer(1 << 20);
+        while (true) {
+            const size_t index = next.fetch_add(1, std::memory_order_relaxed);
+            if (index >= entries.size()) {
+                return;
+            }
+            const auto& entry = entries[index];
+            const auto path = directory / entry.fileName;
+            std::error_code ec;
+            const auto size = std::filesystem::file_size(path, ec);
+            if (ec) {
+                ++missing;
+                logger.Error(L"[校验] 缺少分段：" + path.wstring());
+                continue;
+            }
+            if (size != entry.bytes || entry.crcOffset + entry.crcBytes > size) {
+                ++sizeMismatches;
+                logger.Error(L"[校验] 大小不符：" + path.wstring() + L"（清单 " + std::to_wstring(entry.bytes) +
+                             L" 字节，实际 " + std::to_wstring(size) + L" 字节）");
+                continue;
+            }
+            std::ifstream stream(path, std::ios::binary);
+            stream.seekg(static_cast<std::streamoff>(entry.crcOffset), std::ios::beg);
+            Crc32c crc;
+            uint64_t remaining = entry.crcBytes;
+            while (remaining > 0 && stream) {
+                const size_t toRead = static_cast<size_t>(std::min<uint64_t>(remaining, buffer.size()));
+                stream.read(buffer.data(), static_cast<std::streamsize>(toRead));
+                const auto got = static_cast<size_t>(stream.gcount());
+                if (got == 0) {
+                    break;
+                }
+                crc.Update(buffer.data(), got);
+                remaining -= got;
+            }
+            if (remaining != 0 || crc.Value() != entry.crc32c) {
+                ++checksumMismatches;
+                logger.Error(L"[校验] 校验和不符：" + path.wstring() + L"（清单 " +
+                             Utf8ToWide(FormatCrc(entry.crc32c)) + L"，实际 " + Utf8ToWide(FormatCrc(crc.Value())) + L"）");
+                continue;
+            }
+            ++passed;
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (unsigned i = 1; i < threads; ++i) {
+        pool.emplace_back(worker);
+    }
+    worker();
+    for (auto& thread : pool) {
+        thread.join();
+    }
+
+    ManifestVerifyResult result;
+    result.checked = entries.size();
+    result.passed = passed.load();
+    result.missing = missing.load();
+    result.sizeMismatches = sizeMismatches.load();
+    result.checksumMismatches = checksumMismatches.load();
+    return result;
+}
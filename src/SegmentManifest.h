@@ -0,0 +1,69 @@
+#pragma once
+
+#include "Logger.h"
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// One closed segment as recorded in the JSON Lines manifest next to the output files.
+struct SegmentManifestEntry {
+    uint32_t segmentNumber = 0;            // 1-based, matches the _NNN suffix
+    std::filesystem::path fileName;        // relative to the manifest directory
+    std::chrono::system_clock::time_point startTime{};
+    std::chrono::system_clock::time_point endTime{};
+    uint64_t startFrame = 0;               // session frame position (inclusive)
+    uint64_t endFrame = 0;                 // session frame position (exclusive)
+    uint32_t sampleRate = 0;
+    uint64_t bytes = 0;                    // final file size
+    uint64_t droppedFrames = 0;            // frames dropped by the capture side while this segment was open
+    uint32_t gaps = 0;                     // data discontinuities reported while this segment was open
+    uint32_t crc32c = 0;
+    uint64_t crcOffset = 0;                // checksum covers [crcOffset, crcOffset + crcBytes)
+    uint64_t crcBytes = 0;
+};
+
+std::filesystem::path BuildManifestPath(const std::filesystem::path& basePath);
+
+class SegmentManifestWriter {
+public:
+    explicit SegmentManifestWriter(const std::filesystem::path& manifestPath);
+
+    SegmentManifestWriter(const SegmentManifestWriter&) = delete;
+    SegmentManifestWriter& operator=(const SegmentManifestWriter&) = delete;
+
+    const std::filesystem::path& Path() const { return path_; }
+    void Append(const SegmentManifestEntry& entry);
+    // Records that a segment was removed by the retention policy so 'verify' skips it.
+    void AppendDeletion(uint32_t segmentNumber,
+                        const std::filesystem::path& fileName,
+                        std::chrono::system_clock::time_point deletedAt);
+
+private:
+    void AppendLine(const std::string& line);
+
+    std::filesystem::path path_;
+    std::ofstream stream_;
+    std::mutex mutex_;
+};
+
+std::vector<SegmentManifestEntry> ReadSegmentManifest(const std::filesystem::path& manifestPath);
+
+struct ManifestVerifyResult {
+    size_t checked = 0;
+    size_t passed = 0;
+    size_t missing = 0;
+    size_t sizeMismatches = 0;
+    size_t checksumMismatches = 0;
+    bool Ok() const { return passed == checked; }
+};
+
+// Re-reads every segment listed in the manifest on `threads` workers (0 = hardware concurrency)
+// and compares sizes and checksums.
+ManifestVerifyResult VerifySegmentManifest(const std::filesystem::path& manifestPath,
+                                           unsigned threads,
+                                           Logger& logger);
@@ -1,7 +1,9 @@
 #include "SegmentNaming.h"
 
+#include <ctime>
 #include <iomanip>
 #include <sstream>
+#include <string>
 
 std::filesystem::path BuildSegmentPath(const std::filesystem::path& basePath, size_t segmentIndex) {
     auto directory = basePath.parent_path();
@@ -18,3 +20,49 @@ std::filesystem::path BuildSegmentPath(const std::filesystem::path& basePath, si
     }
     return directory / filename;
 }
+
+std::filesystem::path BuildRenditionPath(const std::filesystem::path& path, uint32_t bitrateKbps) {
+    std::wstring stem = path.stem().wstring();
+    if (stem.empty()) {
+        stem = L"segment";
+    }
+    return path.parent_path() / (stem + L"-" + std::to_wstring(bitrateKbps) + L"k" + path.extension().wstring());
+}
+
+std::chrono::system_clock::time_point AlignedSegmentStart(std::chrono::system_clock::time_point time,
+                                                          std::chrono::seconds period) {
+    using namespace std::chrono;
+    if (period.count() <= 0) {
+        return time;
+    }
+    const auto sinceEpoch = duration_cast<seconds>(time.time_since_epoch());
+    auto aligned = sinceEpoch - (sinceEpoch % period);
+    if (aligned > sinceEpoch) {
+        aligned -= period; // pre-epoch times round towards negative infinity
+    }
+    return system_clock::time_point(aligned);
+}
+
+std::filesystem::path BuildAlignedSegmentPath(const std::filesystem::path& basePath,
+                                              std::chrono::system_clock::time_point boundary) {
+    auto directory = basePath.parent_path();
+    std::wstring stem = basePath.stem().wstring();
+    std::wstring extension = basePath.extension().wstring();
+    if (stem.empty()) {
+        stem = L"segment";
+    }
+    const std::time_t boundaryT = std::chrono::system_clock::to_time_t(boundary);
+    std::tm tm{};
+#if defined(_WIN32)
+    gmtime_s(&tm, &boundaryT);
+#else
+    gmtime_r(&boundaryT, &tm);
+#endif
+    std::wstringstream builder;
+    builder << stem << L"_" << std::put_time(&tm, L"%Y%m%dT%H%M%SZ");
+    std::filesystem::path filename = builder.str();
+    if (!extension.empty()) {
+        filename += extension;
+    }
+    return directory / filename;
+}
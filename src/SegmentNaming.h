@@ -1,5 +1,17 @@
 #pragma once
 
+#include <chrono>
+#include <cstdint>
 #include <filesystem>
 
 std::filesystem::path BuildSegmentPath(const std::filesystem::path& basePath, size_t segmentIndex);
+
+// Extra MP3 bitrate of the same audio, written next to the primary file (stem-128k.mp3).
+std::filesystem::path BuildRenditionPath(const std::filesystem::path& path, uint32_t bitrateKbps);
+
+// Wall-clock aligned segments are named after the UTC boundary they start at
+// (stem_20260114T100000Z.ext), so the file covering any instant follows from the time alone.
+std::chrono::system_clock::time_point AlignedSegmentStart(std::chrono::system_clock::time_point time,
+                                                          std::chrono::seconds period);
+std::filesystem::path BuildAlignedSegmentPath(const std::filesystem::path& basePath,
+                                              std::chrono::system_clock::time_point boundary);
@@ -0,0 +1,141 @@
+#include "SegmentRetention.h"
+
+#include <algorithm>
+#include <exception>
+#include <string>
+#include <system_error>
+
+SegmentRetention::SegmentRetention(RetentionPolicy policy, Logger& logger, DeletedCallback onDeleted)
+    : policy_(policy), logger_(logger), onDeleted_(std::move(onDeleted)) {
+    worker_ = std::thread([this]() { Run(); });
+}
+
+SegmentRetention::~SegmentRetention() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    if (worker_.joinable()) {
+        worker_.join();
+    }
+}
+
+void SegmentRetention::OnSegmentClosed(uint32_t segmentNumber,
+                                       std::vector<std::filesystem::path> paths,
+                                       uint64_t bytes,
+                                       std::chrono::system_clock::time_point closedAt,
+                                       bool held) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        index_.push_back(Entry{segmentNumber, std::move(paths), bytes, closedAt, held});
+        totalBytes_ += bytes;
+        pending_ = true;
+    }
+    wake_.notify_one();
+}
+
+void SegmentRetention::UpdateSegmentFiles(uint32_t segmentNumber,
+                                          std::vector<std::filesystem::path> paths,
+                                          uint64_t bytes) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = std::find_if(index_.begin(), index_.end(),
+                               [segmentNumber](const Entry& entry) { return entry.segmentNumber == segmentNumber; });
+        if (it == index_.end()) {
+            lateFiles_.push_back(Entry{segmentNumber, std::move(paths), bytes, {}});
+        } else {
+            totalBytes_ = totalBytes_ - it->bytes + bytes;
+            it->paths = std::move(paths);
+            it->bytes = bytes;
+            it->held = false;
+        }
+        pending_ = true;
+    }
+    wake_.notify_one();
+}
+
+uint64_t SegmentRetention::RetainedBytes() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return totalBytes_;
+}
+
+size_t SegmentRetention::RetainedSegments() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return index_.size();
+}
+
+std::vector<SegmentRetention::Entry> SegmentRetention::CollectExpiredLocked(std::chrono::system_clock::time_point now) {
+    std::vector<Entry> expired = std::move(lateFiles_);
+    lateFiles_.clear();
+    // Strictly oldest first: a held segment stops expiry until it is released, even if the
+    // budget stays exceeded meanwhile.
+    while (!index_.empty() && !index_.front().held) {
+        const Entry& oldest = index_.front();
+        const bool overCount = policy_.maxSegments && index_.size() > *policy_.maxSegments;
+        const bool overBytes = policy_.maxBytes && totalBytes_ > *policy_.maxBytes;
+        const bool tooOld = policy_.maxAge && oldest.closedAt + *policy_.maxAge <= now;
+        if (!overCount && !overBytes && !tooOld) {
+            break;
+        }
+        totalBytes_ -= oldest.bytes;
+        expired.push_back(oldest);
+        index_.pop_front();
+    }
+    return expired;
+}
+
+void SegmentRetention::Run() {
+    // Age-based expiry has to be re-evaluated even when no new segment closes.
+    std::chrono::seconds ageCheckInterval(60);
+    if (policy_.maxAge) {
+        ageCheckInterval = std::clamp(*policy_.maxAge / 10, std::chrono::seconds(1), std::chrono::seconds(60));
+    }
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        auto ready = [this]() { return pending_ || stopping_; };
+        if (policy_.maxAge) {
+            wake_.wait_for(lock, ageCheckInterval, ready);
+        } else {
+            wake_.wait(lock, ready);
+        }
+        pending_ = false;
+        const bool stop = stopping_;
+        std::vector<Entry> expired = CollectExpiredLocked(std::chrono::system_clock::now());
+        const uint64_t retainedBytes = totalBytes_;
+        lock.unlock();
+
+        for (const auto& entry : expired) {
+            for (const auto& path : entry.paths) {
+                std::error_code ec;
+                const bool removed = std::filesystem::remove(path, ec);
+                if (ec) {
+                    const std::string reason = ec.message();
+                    logger_.Warn(L"[保留策略] 删除旧分段失败：" + path.wstring() + L"（" +
+                                 std::wstring(reason.begin(), reason.end()) + L"）");
+                    continue;
+                }
+                if (!removed) {
+                    logger_.Warn(L"[保留策略] 旧分段已不存在：" + path.wstring());
+                } else {
+                    logger_.Info(L"[保留策略] 已删除分段 #" + std::to_wstring(entry.segmentNumber) + L"：" +
+                                 path.wstring() + L"（保留 " + std::to_wstring(retainedBytes / (1024 * 1024)) + L" MiB）");
+                }
+                if (onDeleted_) {
+                    try {
+                        onDeleted_(entry.segmentNumber, path);
+                    } catch (const std::exception& ex) {
+                        const std::string what = ex.what();
+                        logger_.Warn(L"[保留策略] 删除回调失败：" + std::wstring(what.begin(), what.end()));
+                    }
+                }
+            }
+        }
+
+        lock.lock();
+        if (stop) {
+            break;
+        }
+    }
+}
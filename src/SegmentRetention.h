@@ -0,0 +1,77 @@
+#pragma once
+
+#include "Logger.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+struct RetentionPolicy {
+    std::optional<uint64_t> maxBytes;
+    std::optional<std::chrono::seconds> maxAge;
+    std::optional<uint32_t> maxSegments;
+
+    bool Enabled() const { return maxBytes.has_value() || maxAge.has_value() || maxSegments.has_value(); }
+};
+
+// Rolling archive for one recording session. Closed segments are handed over by the
+// writer thread; a background thread deletes the oldest ones once the session exceeds
+// the byte, age or count budget. Sizes come from the in-memory index, never from
+// directory scans.
+class SegmentRetention {
+public:
+    using DeletedCallback = std::function<void(uint32_t segmentNumber, const std::filesystem::path& path)>;
+
+    SegmentRetention(RetentionPolicy policy, Logger& logger, DeletedCallback onDeleted = {});
+    ~SegmentRetention();
+
+    SegmentRetention(const SegmentRetention&) = delete;
+    SegmentRetention& operator=(const SegmentRetention&) = delete;
+
+    // A held segment is still being read by someone else (e.g. queued for background
+    // compression): neither it nor any newer segment expires until UpdateSegmentFiles()
+    // reports its final files.
+    void OnSegmentClosed(uint32_t segmentNumber,
+                         std::vector<std::filesystem::path> paths,
+                         uint64_t bytes,
+                         std::chrono::system_clock::time_point closedAt,
+                         bool held = false);
+    // A closed segment gained or lost files after the fact (e.g. background compression):
+    // `paths` replaces the tracked file set and `bytes` its total size, and a hold is
+    // released. Files reported for a segment that has already expired are deleted.
+    void UpdateSegmentFiles(uint32_t segmentNumber, std::vector<std::filesystem::path> paths, uint64_t bytes);
+
+    uint64_t RetainedBytes() const;
+    size_t RetainedSegments() const;
+
+private:
+    struct Entry {
+        uint32_t segmentNumber = 0;
+        std::vector<std::filesystem::path> paths;
+        uint64_t bytes = 0;
+        std::chrono::system_clock::time_point closedAt{};
+        bool held = false;
+    };
+
+    void Run();
+    std::vector<Entry> CollectExpiredLocked(std::chrono::system_clock::time_point now);
+
+    const RetentionPolicy policy_;
+    Logger& logger_;
+    DeletedCallback onDeleted_;
+    mutable std::mutex mutex_;
+    std::condition_variable wake_;
+    std::deque<Entry> index_;
+    std::vector<Entry> lateFiles_;   // reported after their segment expired; deleted next round
+    uint64_t totalBytes_ = 0;
+    bool pending_ = false;
+    bool stopping_ = false;
+    std::thread worker_;
+};
@@ -0,0 +1,559 @@
+#include "SegmentedOutput.h"
+
+#include "RecordingUtils.h"
+#include "SegmentNaming.h"
+#include "Tracer.h"
+#include "WavWriter.h"
+
+#include <algorithm>
+#include <exception>
+#include <iterator>
+#include <string>
+#include <system_error>
+
+namespace {
+
+constexpr int64_t kNanosPerSecond = 1000000000;
+
+uint64_t DurationToFramesCeil(std::chrono::nanoseconds duration, uint32_t sampleRate) {
+    if (duration.count() <= 0) {
+        return 0;
+    }
+    const auto ns = static_cast<uint64_t>(duration.count());
+    const uint64_t whole = ns / kNanosPerSecond;
+    const uint64_t rest = ns % kNanosPerSecond;
+    return whole * sampleRate + (rest * sampleRate + kNanosPerSecond - 1) / kNanosPerSecond;
+}
+
+class WavWriterAdapter final : public IAudioWriter {
+public:
+    WavWriterAdapter(const std::filesystem::path& path, const AudioFormat& format)
+        : writer_(path, format) {}
+    void Write(const uint8_t* data, size_t byteCount) override { writer_.Write(data, byteCount); }
+    void Flush() override { writer_.Flush(); }
+    void Close() override { writer_.Close(); }
+    uint64_t FileBytes() const override { return writer_.DataOffset() + writer_.DataBytes(); }
+    SegmentChecksum Checksum() const override {
+        return SegmentChecksum{writer_.DataCrc32c(), writer_.DataOffset(), writer_.DataBytes()};
+    }
+    uint64_t RenditionBytes() const override { return 0; }
+private:
+    WavWriter writer_;
+};
+
+class Mp3WriterAdapter final : public IAudioWriter {
+public:
+    // Rendition 0 is the segment itself; the others are its ladder files.
+    Mp3WriterAdapter(const std::vector<Mp3Rendition>& renditions, const AudioFormat& format, Logger& logger)
+        : writer_(renditions, format, logger) {}
+    void Write(const uint8_t* data, size_t byteCount) override { writer_.Write(data, byteCount); }
+    void Flush() override { writer_.Flush(); }
+    void Close() override { writer_.Close(); }
+    uint64_t FileBytes() const override { return writer_.BytesWritten(); }
+    SegmentChecksum Checksum() const override {
+        return SegmentChecksum{writer_.StreamCrc32c(), 0, writer_.BytesWritten()};
+    }
+    uint64_t RenditionBytes() const override {
+        uint64_t bytes = 0;
+        for (size_t i = 1; i < writer_.Renditions(); ++i) {
+            bytes += writer_.BytesWritten(i);
+        }
+        return bytes;
+    }
+private:
+    Mp3StreamWriter writer_;
+};
+
+} // namespace
+
+SegmentedOutput::SegmentedOutput(SegmentedOutputOptions options, const AudioFormat& format, Logger& logger)
+    : options_(std::move(options)),
+      format_(format),
+      logger_(logger),
+      bytesPerFrame_(format.BytesPerFrame()),
+      flushThreshold_(static_cast<size_t>(format.BytesPerFrame()) * format.sampleRate) {}
+
+SegmentedOutput::~SegmentedOutput() = default;
+
+void SegmentedOutput::Start() {
+    droppedAtSegmentStart_ = DroppedNow();
+    gapsAtSegmentStart_ = GapsNow();
+    PublishStatus();
+    if (options_.writeManifest) {
+        const auto manifestPath = BuildManifestPath(options_.basePath);
+        try {
+            manifest_ = std::make_shared<SegmentManifestWriter>(manifestPath);
+            logger_.Info(L"分段清单：" + manifestPath.wstring());
+        } catch (const std::exception& ex) {
+            logger_.Warn(L"无法创建分段清单，将不记录校验信息：" + Utf8ToWide(ex.what()));
+        }
+    }
+    if (options_.writeIndex) {
+        const auto indexPath = BuildArchiveIndexPath(options_.basePath);
+        try {
+            index_ = std::make_unique<ArchiveIndexWriter>(indexPath);
+            logger_.Info(L"归档时间索引：" + indexPath.wstring());
+        } catch (const std::exception& ex) {
+            logger_.Warn(L"无法打开归档时间索引，将不记录时间位置：" + Utf8ToWide(ex.what()));
+        }
+    }
+    if (options_.retention.Enabled()) {
+        SegmentRetention::DeletedCallback onDeleted;
+        if (manifest_) {
+            onDeleted = [manifest = manifest_](uint32_t segmentNumber, const std::filesystem::path& path) {
+                manifest->AppendDeletion(segmentNumber, path.filename(), std::chrono::system_clock::now());
+            };
+        }
+        retention_ = std::make_unique<SegmentRetention>(options_.retention, logger_, std::move(onDeleted));
+        std::wstring budget;
+        if (options_.retention.maxBytes) {
+            budget += L" 字节上限=" + std::to_wstring(*options_.retention.maxBytes);
+        }
+        if (options_.retention.maxAge) {
+            budget += L" 时长上限=" + std::to_wstring(options_.retention.maxAge->count()) + L"s";
+        }
+        if (options_.retention.maxSegments) {
+            budget += L" 分段上限=" + std::to_wstring(*options_.retention.maxSegments);
+        }
+        logger_.Info(L"已启用分段保留策略：" + budget);
+    }
+    if (options_.compression && !options_.mp3Output) {
+        SegmentCompressor::CompletedCallback onCompressed =
+            [manifest = manifest_, retention = retention_.get()](const SegmentCompressor::Completion& done) {
+                if (done.sourceDeleted && manifest) {
+                    manifest->AppendDeletion(done.segmentNumber, done.sourcePath.filename(),
+                                             std::chrono::system_clock::now());
+                }
+                if (retention) {
+                    // Also releases the hold taken when the segment closed, failed jobs included.
+                    std::vector<std::filesystem::path> paths;
+                    uint64_t bytes = 0;
+                    if (done.compressed) {
+                        paths.push_back(done.compressedPath);
+                        paths.insert(paths.end(), done.renditionPaths.begin(), done.renditionPaths.end());
+                        bytes = done.compressedBytes;
+                    }
+                    if (!done.sourceDeleted) {
+                        std::error_code ec;
+                        paths.push_back(done.sourcePath);
+                        const auto size = std::filesystem::file_size(done.sourcePath, ec);
+                        bytes += ec ? 0 : size;
+                    }
+                    retention->UpdateSegmentFiles(done.segmentNumber, std::move(paths), bytes);
+                }
+            };
+        compressor_ = std::make_unique<SegmentCompressor>(BuildCompressionStatePath(options_.basePath),
+                                                          *options_.compression, logger_, std::move(onCompressed));
+        logger_.Info(L"已启用后台压缩：分段关闭后以低优先级编码为 MP3（" +
+                     std::to_wstring(options_.compression->mp3Options.bitrateKbps) + L" kbps，" +
+                     std::to_wstring(std::max(1u, options_.compression->threads)) + L" 线程）" +
+                     (options_.compression->deleteSource ? L"，校验通过后删除 WAV。" : L"。"));
+    }
+    if (options_.mp3Output && !options_.mp3LadderKbps.empty()) {
+        std::wstring ladder;
+        for (const auto kbps : options_.mp3LadderKbps) {
+            ladder += (ladder.empty() ? L"" : L"/") + std::to_wstring(kbps);
+        }
+        logger_.Info(L"MP3 码率阶梯：每个分段另存 " + ladder + L" kbps 版本，与主输出共用一次采样转换。");
+    }
+    if (options_.diskGuard) {
+        const bool canReduceBitrate = options_.mp3Output && options_.diskGuard->fallbackBitrateKbps &&
+                                      *options_.diskGuard->fallbackBitrateKbps < options_.mp3Options.bitrateKbps;
+        diskGuard_ = std::make_unique<DiskSpaceGuard>(*options_.diskGuard, options_.basePath.parent_path(), fileBytesWritten_,
+                                                      canReduceBitrate, logger_, options_.freeSpaceProbe);
+        if (options_.diskGuardThread) {
+            diskGuard_->Start();
+        }
+        if (!options_.segmentationEnabled &&
+            (canReduceBitrate || options_.diskGuard->fallbackDirectory)) {
+            logger_.Info(L"磁盘空间回退需要新分段：触发时将在当前文件之后开启新分段。");
+        }
+    }
+    if (options_.alignPeriod) {
+        logger_.Info(L"分段按墙钟对齐：每 " + std::to_wstring(options_.alignPeriod->count()) +
+                     L" 秒（UTC 整倍数）切换，首段缩短至下一个边界。");
+    }
+    OpenSegment();
+}
+
+std::unique_ptr<IAudioWriter> SegmentedOutput::OpenWriter(const std::filesystem::path& path) {
+    std::unique_ptr<IAudioWriter> writer = OpenFileWriter(path);
+    return options_.wrapWriter ? options_.wrapWriter(std::move(writer)) : std::move(writer);
+}
+
+std::unique_ptr<IAudioWriter> SegmentedOutput::OpenFileWriter(const std::filesystem::path& path) {
+    if (options_.mp3Output) {
+        Mp3ConversionOptions mp3Options = options_.mp3Options;
+        if (diskGuard_) {
+            if (const auto kbps = diskGuard_->BitrateOverride()) {
+                mp3Options.bitrateKbps = std::min(mp3Options.bitrateKbps, *kbps);
+            }
+        }
+        std::vector<Mp3Rendition> renditions{Mp3Rendition{path, mp3Options}};
+        const auto ladderPaths = RenditionPaths(path);
+        for (size_t i = 0; i < ladderPaths.size(); ++i) {
+            Mp3ConversionOptions ladderOptions{options_.mp3LadderKbps[i]};
+            if (diskGuard_) {
+                if (const auto kbps = diskGuard_->BitrateOverride()) {
+                    ladderOptions.bitrateKbps = std::min(ladderOptions.bitrateKbps, *kbps);
+                }
+            }
+            renditions.push_back(Mp3Rendition{ladderPaths[i], ladderOptions});
+        }
+        return std::make_unique<Mp3WriterAdapter>(renditions, format_, logger_);
+    }
+    return std::make_unique<WavWriterAdapter>(path, format_);
+}
+
+std::filesystem::path SegmentedOutput::SegmentBasePath() const {
+    if (diskGuard_) {
+        if (const auto directory = diskGuard_->FallbackDirectory()) {
+            return *directory / options_.basePath.filename();
+        }
+    }
+    return options_.basePath;
+}
+
+std::vector<std::filesystem::path> SegmentedOutput::RenditionPaths(const std::filesystem::path& segmentPath) const {
+    std::vector<std::filesystem::path> paths;
+    if (options_.mp3Output) {
+        for (const auto kbps : options_.mp3LadderKbps) {
+            paths.push_back(BuildRenditionPath(segmentPath, kbps));
+        }
+    }
+    return paths;
+}
+
+std::filesystem::path SegmentedOutput::RecordedName() const {
+    // Manifest and index resolve names against their own directory; segments written
+    // elsewhere (fallback directory) are recorded with their full path.
+    if (segmentPath_.parent_path() == options_.basePath.parent_path()) {
+        return segmentPath_.filename();
+    }
+    return std::filesystem::absolute(segmentPath_);
+}
+
+std::filesystem::path SegmentedOutput::NextAlignedPath(std::chrono::system_clock::time_point boundary) const {
+    const auto path = BuildAlignedSegmentPath(SegmentBasePath(), boundary);
+    std::error_code ec;
+    if (!std::filesystem::exists(path, ec)) {
+        return path;
+    }
+    // A restart inside the same period must not truncate the earlier file.
+    for (int attempt = 2; attempt < 1000; ++attempt) {
+        auto candidate = path;
+        candidate.replace_filename(path.stem().wstring() + L"-" + std::to_wstring(attempt) + path.extension().wstring());
+        if (!std::filesystem::exists(candidate, ec)) {
+            return candidate;
+        }
+    }
+    return path;
+}
+
+void SegmentedOutput::OpenSegment() {
+    // A segment starts at the wall-clock time its first frame was captured, not at session
+    // start plus frames written (device clock drift and drop accounting would walk a 24/7
+    // session's boundaries off the UTC multiples their names claim) and not at the time the
+    // writer gets to it (a slow disk would shift it by the ring backlog). Frames only measure
+    // time inside a segment.
+    const auto now = NextFrameCaptureTime();
+    if (options_.alignPeriod) {
+        const auto period = *options_.alignPeriod;
+        auto boundary = AlignedSegmentStart(now, period);
+        // A segment that filled its frame target ends on the next boundary even if the device
+        // clock ran fast and the wall clock is still just short of it.
+        const bool reachedTarget = segmentBoundary_ && segmentFrameTarget_ && framesInSegment_ >= *segmentFrameTarget_;
+        if (reachedTarget && *segmentBoundary_ + period > boundary) {
+            boundary = *segmentBoundary_ + period;
+        }
+        const auto remaining = std::chrono::duration_cast<std::chrono::nanoseconds>(boundary + period - now);
+        segmentFrameTarget_ = std::max<uint64_t>(DurationToFramesCeil(remaining, format_.sampleRate), 1);
+        segmentBoundary_ = boundary;
+        segmentPath_ = NextAlignedPath(boundary);
+    } else {
+        segmentFrameTarget_ = options_.segmentFrameTarget;
+        segmentPath_ = BuildSegmentPath(SegmentBasePath(), segmentIndex_);
+    }
+    if (segmentIndex_ == 0) {
+        logger_.Info(L"打开初始分段：" + segmentPath_.wstring());
+    }
+    writer_ = OpenWriter(segmentPath_);
+    framesInSegment_ = 0;
+    bytesInSegment_ = 0;
+    bytesPendingFlush_ = 0;
+    segmentStartFrame_ = totalFrames_;
+    segmentStartTime_ = now;
+    segmentsOpened_.store(static_cast<uint32_t>(segmentIndex_ + 1), std::memory_order_release);
+    UpdateFileBytes();
+    PublishStatus();
+    if (options_.events) {
+        const auto name = segmentPath_.filename().u8string();
+        options_.events->SegmentOpen(static_cast<uint32_t>(segmentIndex_ + 1), segmentStartFrame_,
+                                     std::string_view(reinterpret_cast<const char*>(name.data()), name.size()));
+    }
+}
+
+void SegmentedOutput::CloseSegment() {
+    if (!writer_) {
+        return;
+    }
+    if (bytesPendingFlush_ > 0) {
+        writer_->Flush();
+        bytesPendingFlush_ = 0;
+    }
+    writer_->Close();
+    const auto closedAt = std::chrono::system_clock::now();
+    const uint64_t fileBytes = writer_->FileBytes();
+    const uint64_t renditionBytes = writer_->RenditionBytes();
+    const auto segmentNumber = static_cast<uint32_t>(segmentIndex_ + 1);
+    // The capture thread bumps both counters while segments roll: read them once, and let the
+    // next segment start from the same values so nothing falls between the two.
+    const uint32_t gapsNow = GapsNow();
+    const uint64_t droppedNow = DroppedNow();
+    const uint32_t segmentGaps = gapsNow - gapsAtSegmentStart_;
+    const uint64_t segmentDropped = droppedNow - droppedAtSegmentStart_;
+    gapsAtSegmentStart_ = gapsNow;
+    droppedAtSegmentStart_ = droppedNow;
+
+    if (manifest_) {
+        SegmentManifestEntry entry;
+        entry.segmentNumber = segmentNumber;
+        entry.fileName = RecordedName();
+        entry.startTime = segmentStartTime_;
+        entry.endTime = NextFrameCaptureTime();
+        entry.startFrame = segmentStartFrame_;
+        entry.endFrame = totalFrames_;
+        entry.sampleRate = format_.sampleRate;
+        entry.bytes = fileBytes;
+        entry.droppedFrames = segmentDropped;
+        entry.gaps = segmentGaps;
+        const SegmentChecksum checksum = writer_->Checksum();
+        entry.crc32c = checksum.crc32c;
+        entry.crcOffset = checksum.offset;
+        entry.crcBytes = checksum.bytes;
+        try {
+            manifest_->Append(entry);
+        } catch (const std::exception& ex) {
+            logger_.Warn(L"写入分段清单失败，后续分段不再记录：" + Utf8ToWide(ex.what()));
+            manifest_.reset();
+        }
+    }
+    if (index_ && framesInSegment_ > 0) {
+        try {
+            index_->Append(RecordedName(), segmentStartTime_, framesInSegment_, format_.sampleRate,
+                           segmentGaps, segmentDropped);
+        } catch (const std::exception& ex) {
+            logger_.Warn(L"写入归档时间索引失败，后续分段不再记录：" + Utf8ToWide(ex.what()));
+            index_.reset();
+        }
+    }
+    if (options_.events) {
+        options_.events->SegmentClose(segmentNumber, segmentStartFrame_, totalFrames_, fileBytes,
+                                      segmentGaps, segmentDropped);
+    }
+    writer_.reset();
+    closedFileBytes_ += fileBytes;
+    closedRenditionBytes_ += renditionBytes;
+    UpdateFileBytes();
+    if (options_.status) {
+        auto& recent = status_.recent;
+        const size_t kept = std::min<size_t>(status_.closedSegments, kRecorderStatusRecentSegments);
+        if (kept == kRecorderStatusRecentSegments) {
+            std::copy(std::begin(recent) + 1, std::end(recent), std::begin(recent));
+        }
+        recent[std::min(kept, kRecorderStatusRecentSegments - 1)] =
+            RecorderSegmentStatus{segmentNumber, framesInSegment_, fileBytes};
+        ++status_.closedSegments;
+        PublishStatus();
+    }
+    if (retention_) {
+        std::vector<std::filesystem::path> paths = RenditionPaths(segmentPath_);
+        paths.insert(paths.begin(), segmentPath_);
+        // A segment queued for compression is not deleted before the compressor reports back.
+        retention_->OnSegmentClosed(segmentNumber, std::move(paths), fileBytes + renditionBytes, closedAt,
+                                    compressor_ != nullptr);
+    }
+    if (compressor_) {
+        compressor_->Enqueue(segmentNumber, segmentPath_);
+    }
+}
+
+void SegmentedOutput::Write(const uint8_t* data, size_t byteCount) {
+    TraceScope scope("output.Write");
+    if (diskGuard_ && diskGuard_->ConsumeRollRequest()) {
+        RollSegment(L"磁盘空间");
+    }
+    while (byteCount > 0) {
+        // A full segment is rolled only once more audio arrives, so a session that ends
+        // exactly on a boundary does not leave an empty file behind.
+        if (segmentFrameTarget_ && framesInSegment_ >= *segmentFrameTarget_) {
+            Roll(options_.alignPeriod ? L"墙钟边界" : L"分段时长");
+        } else if (options_.segmentByteTarget && bytesInSegment_ >= *options_.segmentByteTarget) {
+            Roll(L"分段大小");
+        }
+        // Split the chunk so duration-based segments end exactly on their frame target.
+        size_t part = byteCount;
+        if (segmentFrameTarget_ && options_.segmentationEnabled && *segmentFrameTarget_ > framesInSegment_) {
+            const uint64_t framesLeft = *segmentFrameTarget_ - framesInSegment_;
+            part = static_cast<size_t>(std::min<uint64_t>(part, framesLeft * bytesPerFrame_));
+        }
+        WriteToSegment(data, part);
+        data += part;
+        byteCount -= part;
+    }
+    PublishStatus();
+}
+
+void SegmentedOutput::WriteToSegment(const uint8_t* data, size_t byteCount) {
+    PipelineLatencies* const latencies = options_.latencies;
+    const uint64_t writeStart = latencies ? MonotonicNanos() : 0;
+    writer_->Write(data, byteCount);
+    if (latencies) {
+        latencies->writerWrite.Record(MonotonicNanos() - writeStart);
+    }
+    bytesPendingFlush_ += byteCount;
+    bytesInSegment_ += byteCount;
+    bytesWritten_.store(bytesWritten_.load(std::memory_order_relaxed) + byteCount, std::memory_order_relaxed);
+    UpdateFileBytes();
+    const uint64_t frames = byteCount / bytesPerFrame_;
+    framesInSegment_ += frames;
+    totalFrames_ += frames;
+    if (bytesPendingFlush_ >= flushThreshold_) {
+        TraceScope scope("output.Flush");
+        const uint64_t flushStart = latencies ? MonotonicNanos() : 0;
+        writer_->Flush();
+        if (latencies) {
+            latencies->writerFlush.Record(MonotonicNanos() - flushStart);
+        }
+        bytesPendingFlush_ = 0;
+    }
+}
+
+void SegmentedOutput::Roll(const wchar_t* reason) {
+    if (!options_.segmentationEnabled) {
+        return;
+    }
+    RollSegment(reason);
+}
+
+void SegmentedOutput::RollSegment(const wchar_t* reason) {
+    TraceScope scope("segment.roll");
+    const uint64_t rollStart = options_.latencies ? MonotonicNanos() : 0;
+    CloseSegment();
+    ++segmentIndex_;
+    OpenSegment();
+    if (options_.latencies) {
+        options_.latencies->segmentRoll.Record(MonotonicNanos() - rollStart);
+    }
+    const std::wstring reasonText = reason ? std::wstring(reason) : std::wstring(L"滚动");
+    logger_.Info(L"开始分段 #" + std::to_wstring(segmentIndex_ + 1) +
+                 L"（" + reasonText + L"）：" + segmentPath_.wstring());
+}
+
+void SegmentedOutput::ApplyLiveSettings(const LiveOutputSettings& settings) {
+    if (settings.mp3BitrateKbps && settings.mp3BitrateKbps != options_.mp3Options.bitrateKbps) {
+        if (options_.mp3Output) {
+            options_.mp3Options.bitrateKbps = settings.mp3BitrateKbps;
+            logger_.Info(L"[配置] MP3 码率改为 " + std::to_wstring(settings.mp3BitrateKbps) + L" kbps，自下一分段生效。");
+        } else {
+            logger_.Warn(L"[配置] WAV 输出不使用码率设置，已忽略。");
+        }
+    }
+    const std::optional<uint64_t> frameTarget =
+        settings.segmentFrameTarget ? std::optional<uint64_t>(settings.segmentFrameTarget) : std::nullopt;
+    if (frameTarget != options_.segmentFrameTarget) {
+        if (options_.alignPeriod) {
+            logger_.Warn(L"[配置] 分段按墙钟对齐时不能修改分段时长，已忽略。");
+        } else {
+            options_.segmentFrameTarget = frameTarget;
+            segmentFrameTarget_ = frameTarget;
+            logger_.Info(frameTarget ? L"[配置] 分段时长改为 " + std::to_wstring(*frameTarget / format_.sampleRate) + L" 秒。"
+                                     : std::wstring(L"[配置] 已关闭按时长分段。"));
+        }
+    }
+    const std::optional<uint64_t> byteTarget =
+        settings.segmentByteTarget ? std::optional<uint64_t>(settings.segmentByteTarget) : std::nullopt;
+    if (byteTarget != options_.segmentByteTarget) {
+        options_.segmentByteTarget = byteTarget;
+        logger_.Info(byteTarget ? L"[配置] 分段大小改为 " + std::to_wstring(*byteTarget) + L" 字节。"
+                                : std::wstring(L"[配置] 已关闭按大小分段。"));
+    }
+}
+
+void LiveOutputSettingsSlot::Publish(const LiveOutputSettings& settings) {
+    const uint64_t start = sequence_.load(std::memory_order_relaxed);
+    sequence_.store(start + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    mp3BitrateKbps_.store(settings.mp3BitrateKbps, std::memory_order_relaxed);
+    segmentFrameTarget_.store(settings.segmentFrameTarget, std::memory_order_relaxed);
+    segmentByteTarget_.store(settings.segmentByteTarget, std::memory_order_relaxed);
+    sequence_.store(start + 2, std::memory_order_release);
+}
+
+bool LiveOutputSettingsSlot::TakeNew(LiveOutputSettings& settings) {
+    const uint64_t before = sequence_.load(std::memory_order_acquire);
+    if (before == taken_ || (before & 1) != 0) {
+        return false;
+    }
+    LiveOutputSettings value;
+    value.mp3BitrateKbps = mp3BitrateKbps_.load(std::memory_order_relaxed);
+    value.segmentFrameTarget = segmentFrameTarget_.load(std::memory_order_relaxed);
+    value.segmentByteTarget = segmentByteTarget_.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (sequence_.load(std::memory_order_relaxed) != before) {
+        return false;
+    }
+    taken_ = before;
+    settings = value;
+    return true;
+}
+
+void SegmentedOutput::Finish() {
+    CloseSegment();
+    if (compressor_) {
+        const size_t pending = compressor_->PendingJobs();
+        if (pending > 0) {
+            logger_.Info(L"等待后台压缩完成剩余 " + std::to_wstring(pending) + L" 个分段...");
+        }
+        compressor_->WaitIdle();
+    }
+}
+
+void SegmentedOutput::UpdateFileBytes() {
+    uint64_t bytes = closedFileBytes_ + closedRenditionBytes_;
+    if (writer_) {
+        bytes += writer_->FileBytes() + writer_->RenditionBytes();
+    }
+    fileBytesWritten_.store(bytes, std::memory_order_relaxed);
+}
+
+void SegmentedOutput::PublishStatus() {
+    if (!options_.status) {
+        return;
+    }
+    const uint64_t openBytes = writer_ ? writer_->FileBytes() : 0;
+    status_.framesWritten = totalFrames_;
+    status_.fileBytes = closedFileBytes_ + openBytes;
+    status_.current = writer_ ? RecorderSegmentStatus{static_cast<uint32_t>(segmentIndex_ + 1), framesInSegment_, openBytes}
+                              : RecorderSegmentStatus{};
+    options_.status->PublishOutput(status_);
+}
+
+std::chrono::system_clock::time_point SegmentedOutput::NextFrameCaptureTime() const {
+    if (options_.captureTimes) {
+        const auto nanos = options_.captureTimes->WallNanosAt(totalFrames_ * format_.BytesPerFrame(), format_.BytesPerSecond());
+        if (nanos) {
+            return std::chrono::system_clock::time_point(
+                std::chrono::duration_cast<std::chrono::system_clock::duration>(std::chrono::nanoseconds(*nanos)));
+        }
+    }
+    return std::chrono::system_clock::now();
+}
+
+uint64_t SegmentedOutput::DroppedNow() const {
+    return options_.droppedFrames ? options_.droppedFrames->load(std::memory_order_acquire) : 0;
+}
+
+uint32_t SegmentedOutput::GapsNow() const {
+    return options_.gaps ? options_.gaps->load(std::memory_order_acquire) : 0;
+}
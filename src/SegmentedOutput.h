@@ -0,0 +1,186 @@
+#pragma once
+
+#include "ArchiveIndex.h"
+#include "DiskSpaceGuard.h"
+#include "EventLog.h"
+#include "HdrHistogram.h"
+#include "Logger.h"
+#include "Mp3Converter.h"
+#include "RecorderStatus.h"
+#include "SegmentCompressor.h"
+#include "SegmentManifest.h"
+#include "SegmentRetention.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <vector>
+
+struct SegmentChecksum {
+    uint32_t crc32c = 0;
+    uint64_t offset = 0;
+    uint64_t bytes = 0;
+};
+
+class IAudioWriter {
+public:
+    virtual ~IAudioWriter() = default;
+    virtual void Write(const uint8_t* data, size_t byteCount) = 0;
+    virtual void Flush() = 0;
+    virtual void Close() = 0;
+    // Bytes written to the file so far (final once Close() returned) and the checksum
+    // gathered while writing (valid once Close() returned).
+    virtual uint64_t FileBytes() const = 0;
+    virtual SegmentChecksum Checksum() const = 0;
+    // Bytes written so far to the segment's MP3 ladder files, which FileBytes() leaves out.
+    virtual uint64_t RenditionBytes() const = 0;
+};
+
+using AudioWriterWrapper = std::function<std::unique_ptr<IAudioWriter>(std::unique_ptr<IAudioWriter>)>;
+
+struct SegmentedOutputOptions {
+    std::filesystem::path basePath;
+    bool mp3Output = false;
+    Mp3ConversionOptions mp3Options;
+    // MP3 output only: extra bitrates encoded from the same converted samples, each into its
+    // own file next to the segment (stem_001-128k.mp3). Manifest, index and status board
+    // describe the primary stream; retention deletes the renditions along with it.
+    std::vector<uint32_t> mp3LadderKbps;
+    bool segmentationEnabled = false;
+    std::optional<uint64_t> segmentFrameTarget;
+    std::optional<uint64_t> segmentByteTarget;
+    // When set, segment boundaries land on UTC multiples of this period and files are named
+    // after their boundary; segmentFrameTarget is then derived per segment.
+    std::optional<std::chrono::seconds> alignPeriod;
+    bool writeManifest = true;
+    bool writeIndex = true;
+    RetentionPolicy retention;
+    // WAV output only: closed segments are encoded to MP3 in the background.
+    std::optional<CompressionOptions> compression;
+    // Free-space monitor; its bitrate/directory fallbacks take effect at the next segment.
+    std::optional<DiskGuardPolicy> diskGuard;
+    DiskSpaceGuard::FreeSpaceProbe freeSpaceProbe;   // empty = query the filesystem
+    bool diskGuardThread = true;   // false: the owner drives DiskGuard()->Evaluate() (tools/disk_guard_check)
+    // Session-wide counters maintained by the capture thread; sampled at segment boundaries.
+    const std::atomic<uint64_t>* droppedFrames = nullptr;
+    const std::atomic<uint32_t>* gaps = nullptr;
+    // Write/Flush/roll durations are recorded here when set.
+    PipelineLatencies* latencies = nullptr;
+    // Capture-side wall-clock stamps of the ring offsets this output is fed (written bytes map
+    // 1:1 to ring bytes). Segment start times come from here; without it, from the clock at open.
+    const CaptureTimestampQueue* captureTimes = nullptr;
+    // Segment open/close records go here when set.
+    EventLogWriter* events = nullptr;
+    // Output section of the status board, published after every write and segment change.
+    RecorderStatusBoard* status = nullptr;
+    // Wraps the writer of every segment when set (fault injection in tools/recorder_soak).
+    AudioWriterWrapper wrapWriter;
+};
+
+// Output settings that can change while recording. Always the complete desired state; a zero
+// bitrate keeps the configured one and a zero target turns that limit off.
+struct LiveOutputSettings {
+    uint32_t mp3BitrateKbps = 0;
+    uint64_t segmentFrameTarget = 0;
+    uint64_t segmentByteTarget = 0;
+};
+
+// Hands LiveOutputSettings from the capture thread to the writer thread under a seqlock:
+// no locks and no allocation on either side. One publisher, one consumer.
+class LiveOutputSettingsSlot {
+public:
+    void Publish(const LiveOutputSettings& settings);
+    // True and fills `settings` if a complete publication newer than the last one taken is
+    // available; a publication in progress is picked up by a later call.
+    bool TakeNew(LiveOutputSettings& settings);
+
+private:
+    std::atomic<uint64_t> sequence_{0};
+    std::atomic<uint32_t> mp3BitrateKbps_{0};
+    std::atomic<uint64_t> segmentFrameTarget_{0};
+    std::atomic<uint64_t> segmentByteTarget_{0};
+    uint64_t taken_ = 0;   // consumer side only
+};
+
+// Owns the writer of the current segment on the writer thread: rolls to _NNN files by
+// duration/size/request, flushes roughly once per second and records each closed segment
+// in the manifest and the archive time index. When a retention policy is set, closed segments are handed to a
+// background SegmentRetention that deletes the oldest ones; with compression enabled they
+// are also queued on a SegmentCompressor.
+class SegmentedOutput {
+public:
+    SegmentedOutput(SegmentedOutputOptions options, const AudioFormat& format, Logger& logger);
+    ~SegmentedOutput();
+
+    SegmentedOutput(const SegmentedOutput&) = delete;
+    SegmentedOutput& operator=(const SegmentedOutput&) = delete;
+
+    void Start();
+    void Write(const uint8_t* data, size_t byteCount);
+    void Roll(const wchar_t* reason);
+    void Finish();
+    // Writer thread, between writes. Segment limits apply to the open segment (a shorter
+    // target rolls at the next write); a new bitrate applies from the next segment.
+    void ApplyLiveSettings(const LiveOutputSettings& settings);
+
+    // Safe to read from any thread.
+    uint32_t SegmentsOpened() const { return segmentsOpened_.load(std::memory_order_acquire); }
+    // PCM bytes handed to the writers.
+    uint64_t BytesWritten() const { return bytesWritten_.load(std::memory_order_relaxed); }
+    // Null unless options.diskGuard is set.
+    DiskSpaceGuard* DiskGuard() const { return diskGuard_.get(); }
+
+private:
+    std::unique_ptr<IAudioWriter> OpenWriter(const std::filesystem::path& path);
+    std::unique_ptr<IAudioWriter> OpenFileWriter(const std::filesystem::path& path);
+    void RollSegment(const wchar_t* reason);
+    void OpenSegment();
+    void CloseSegment();
+    std::filesystem::path SegmentBasePath() const;
+    std::vector<std::filesystem::path> RenditionPaths(const std::filesystem::path& segmentPath) const;
+    std::filesystem::path RecordedName() const;
+    void WriteToSegment(const uint8_t* data, size_t byteCount);
+    std::filesystem::path NextAlignedPath(std::chrono::system_clock::time_point boundary) const;
+    uint64_t DroppedNow() const;
+    // When the next frame to be written was captured.
+    std::chrono::system_clock::time_point NextFrameCaptureTime() const;
+    uint32_t GapsNow() const;
+    void PublishStatus();
+    void UpdateFileBytes();
+
+    SegmentedOutputOptions options_;
+    const AudioFormat& format_;
+    Logger& logger_;
+    const uint32_t bytesPerFrame_;
+    const size_t flushThreshold_;
+
+    std::unique_ptr<IAudioWriter> writer_;
+    std::shared_ptr<SegmentManifestWriter> manifest_;
+    std::unique_ptr<ArchiveIndexWriter> index_;
+    std::unique_ptr<SegmentRetention> retention_;
+    std::unique_ptr<SegmentCompressor> compressor_;   // after retention_: its callback uses it
+    std::unique_ptr<DiskSpaceGuard> diskGuard_;
+    std::filesystem::path segmentPath_;
+    std::optional<uint64_t> segmentFrameTarget_;
+    std::optional<std::chrono::system_clock::time_point> segmentBoundary_;   // alignPeriod: boundary the open segment is named after
+    size_t segmentIndex_ = 0;
+    uint64_t framesInSegment_ = 0;
+    uint64_t bytesInSegment_ = 0;
+    size_t bytesPendingFlush_ = 0;
+    uint64_t totalFrames_ = 0;
+    uint64_t segmentStartFrame_ = 0;
+    std::chrono::system_clock::time_point segmentStartTime_{};
+    uint64_t droppedAtSegmentStart_ = 0;
+    uint32_t gapsAtSegmentStart_ = 0;
+    RecorderOutputStatus status_;   // writer thread's copy of the board's output section
+    uint64_t closedFileBytes_ = 0;
+    uint64_t closedRenditionBytes_ = 0;
+    std::atomic<uint32_t> segmentsOpened_{0};
+    std::atomic<uint64_t> bytesWritten_{0};
+    std::atomic<uint64_t> fileBytesWritten_{0};   // encoded bytes in the session's files, for the disk guard
+};
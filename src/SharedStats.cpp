@@ -0,0 +1,292 @@
+#include "SharedStats.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+
+namespace {
+
+constexpr char kMagic[8] = {'L', 'R', 'S', 'T', 'A', 'T', 'S', '\0'};
+constexpr float kSilenceDbfs = -200.0f;
+constexpr int kReadAttempts = 1000;
+
+float ToDbfs(double linear) {
+    if (linear <= 0.0) {
+        return kSilenceDbfs;
+    }
+    return std::max(kSilenceDbfs, static_cast<float>(20.0 * std::log10(linear)));
+}
+
+uint32_t CurrentProcessId() {
+#if defined(_WIN32)
+    return static_cast<uint32_t>(GetCurrentProcessId());
+#else
+    return static_cast<uint32_t>(getpid());
+#endif
+}
+
+bool ProcessAlive(uint32_t processId) {
+#if defined(_WIN32)
+    HANDLE process = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, processId);
+    if (!process) {
+        return GetLastError() == ERROR_ACCESS_DENIED;
+    }
+    DWORD exitCode = 0;
+    const bool alive = GetExitCodeProcess(process, &exitCode) && exitCode == STILL_ACTIVE;
+    CloseHandle(process);
+    return alive;
+#else
+    return kill(static_cast<pid_t>(processId), 0) == 0 || errno == EPERM;
+#endif
+}
+
+#if defined(_WIN32)
+std::wstring MappingName(const std::string& name) {
+    return L"Local\\" + std::wstring(name.begin(), name.end());
+}
+#else
+std::string ShmName(const std::string& name) {
+    return "/" + name;
+}
+#endif
+
+// `existed` reports whether a create found the name already taken.
+void* MapBlock(const std::string& name, bool create, void*& mapping, bool* existed = nullptr) {
+    const size_t size = sizeof(SharedStatsBlock);
+#if defined(_WIN32)
+    const std::wstring mappingName = MappingName(name);
+    HANDLE handle = create
+        ? CreateFileMappingW(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, 0, static_cast<DWORD>(size), mappingName.c_str())
+        : OpenFileMappingW(FILE_MAP_READ, FALSE, mappingName.c_str());
+    if (!handle) {
+        return nullptr;
+    }
+    if (existed) {
+        *existed = GetLastError() == ERROR_ALREADY_EXISTS;
+    }
+    void* view = MapViewOfFile(handle, create ? FILE_MAP_ALL_ACCESS : FILE_MAP_READ, 0, 0, size);
+    if (!view) {
+        CloseHandle(handle);
+        return nullptr;
+    }
+    mapping = handle;
+    return view;
+#else
+    const std::string shmName = ShmName(name);
+    int fd = -1;
+    if (create) {
+        fd = shm_open(shmName.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+        if (existed) {
+            *existed = fd < 0 && errno == EEXIST;
+        }
+        if (fd < 0 && errno == EEXIST) {
+            fd = shm_open(shmName.c_str(), O_RDWR, 0);
+        }
+    } else {
+        fd = shm_open(shmName.c_str(), O_RDONLY, 0);
+    }
+    if (fd < 0) {
+        return nullptr;
+    }
+    if (create && ftruncate(fd, static_cast<off_t>(size)) != 0) {
+        close(fd);
+        return nullptr;
+    }
+    if (!create) {
+        struct stat info {};
+        if (fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < size) {
+            close(fd);
+            return nullptr;
+        }
+    }
+    void* view = mmap(nullptr, size, create ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    mapping = nullptr;
+    return view == MAP_FAILED ? nullptr : view;
+#endif
+}
+
+void UnmapBlock(const void* view, void* mapping) {
+    if (!view) {
+        return;
+    }
+#if defined(_WIN32)
+    UnmapViewOfFile(view);
+    if (mapping) {
+        CloseHandle(static_cast<HANDLE>(mapping));
+    }
+#else
+    (void)mapping;
+    munmap(const_cast<void*>(view), sizeof(SharedStatsBlock));
+#endif
+}
+
+} // namespace
+
+SharedStatsPublisher::SharedStatsPublisher(const std::string& name)
+    : name_(name) {
+    bool existed = false;
+    block_ = static_cast<SharedStatsBlock*>(MapBlock(name_, true, mapping_, &existed));
+    if (!block_) {
+        throw std::runtime_error("无法创建共享内存状态块：" + name_);
+    }
+    auto& header = block_->header;
+    if (existed && std::memcmp(header.magic, kMagic, sizeof(kMagic)) == 0) {
+        // Another recorder publishing under the same name keeps it; only a block whose
+        // owner has exited is taken over.
+        const uint32_t owner = block_->payload.processId;
+        if (owner != 0 && owner != CurrentProcessId() && ProcessAlive(owner)) {
+            UnmapBlock(block_, mapping_);
+            block_ = nullptr;
+            throw std::runtime_error("共享内存状态块 " + name_ + " 正被进程 " + std::to_string(owner) +
+                                     " 使用，请用 --stats-name 换一个名称");
+        }
+    }
+    // A block left behind by a previous run is re-initialised; keep the sequence even.
+    const uint64_t sequence = header.sequence.load(std::memory_order_relaxed);
+    header.sequence.store(sequence + 1 + (sequence & 1), std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = SharedStatsBlock::kVersion;
+    header.blockSize = static_cast<uint32_t>(sizeof(SharedStatsBlock));
+    block_->payload = SharedStatsPayload{};
+    block_->payload.processId = CurrentProcessId();
+    header.sequence.store(sequence + 2 + (sequence & 1), std::memory_order_release);
+}
+
+SharedStatsPublisher::~SharedStatsPublisher() {
+    const bool owned = block_->payload.processId == CurrentProcessId();
+    UnmapBlock(block_, mapping_);
+#if defined(_WIN32)
+    (void)owned;
+#else
+    // The name outlives the process on POSIX; remove it so monitors see the recorder is gone,
+    // unless another recorder has since taken the name over.
+    if (owned) {
+        shm_unlink(ShmName(name_).c_str());
+    }
+#endif
+}
+
+void SharedStatsPublisher::Publish(const SharedStatsPayload& payload) {
+    auto& sequence = block_->header.sequence;
+    const uint64_t start = sequence.load(std::memory_order_relaxed);
+    sequence.store(start + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    std::memcpy(&block_->payload, &payload, sizeof(SharedStatsPayload));
+    block_->payload.updateUnixMicros = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count());
+    block_->payload.updateCount = ++updates_;
+    block_->payload.processId = CurrentProcessId();
+
+    sequence.store(start + 2, std::memory_order_release);
+}
+
+SharedStatsReader::SharedStatsReader(const std::string& name) {
+    block_ = static_cast<const SharedStatsBlock*>(MapBlock(name, false, mapping_));
+    if (!block_) {
+        throw std::runtime_error("找不到共享内存状态块：" + name + "（录音程序是否在运行并启用了 --stats-shm？）");
+    }
+    if (std::memcmp(block_->header.magic, kMagic, sizeof(kMagic)) != 0 ||
+        block_->header.version != SharedStatsBlock::kVersion ||
+        block_->header.blockSize != sizeof(SharedStatsBlock)) {
+        UnmapBlock(block_, mapping_);
+        block_ = nullptr;
+        throw std::runtime_error("共享内存状态块版本不匹配：" + name);
+    }
+}
+
+SharedStatsReader::~SharedStatsReader() {
+    UnmapBlock(block_, mapping_);
+}
+
+std::optional<SharedStatsPayload> SharedStatsReader::Read() const {
+    for (int attempt = 0; attempt < kReadAttempts; ++attempt) {
+        const uint64_t before = block_->header.sequence.load(std::memory_order_acquire);
+        if (before & 1) {
+            std::this_thread::yield();
+            continue;
+        }
+        SharedStatsPayload snapshot;
+        std::memcpy(&snapshot, &block_->payload, sizeof(SharedStatsPayload));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (block_->header.sequence.load(std::memory_order_relaxed) == before) {
+            return snapshot;
+        }
+    }
+    return std::nullopt;
+}
+
+LevelMeter::LevelMeter(uint32_t channels, bool floatSamples)
+    : channels_(channels), floatSamples_(floatSamples) {}
+
+void LevelMeter::Accumulate(const unsigned char* data, size_t frames) {
+    const uint32_t metered = std::min<uint32_t>(channels_, kSharedStatsMaxChannels);
+    for (size_t frame = 0; frame < frames; ++frame) {
+        for (uint32_t channel = 0; channel < metered; ++channel) {
+            const size_t index = frame * channels_ + channel;
+            float sample = 0.0f;
+            if (floatSamples_) {
+                std::memcpy(&sample, data + index * sizeof(float), sizeof(float));
+            } else {
+                int16_t value = 0;
+                std::memcpy(&value, data + index * sizeof(int16_t), sizeof(int16_t));
+                sample = static_cast<float>(value) / 32768.0f;
+            }
+            const float magnitude = std::fabs(sample);
+            peak_[channel] = std::max(peak_[channel], magnitude);
+            sumSquares_[channel] += static_cast<double>(sample) * sample;
+        }
+    }
+    frames_ += frames;
+}
+
+void LevelMeter::Take(float* peakDbfs, float* rmsDbfs) {
+    for (size_t channel = 0; channel < kSharedStatsMaxChannels; ++channel) {
+        const bool metered = channel < channels_ && frames_ > 0;
+        peakDbfs[channel] = metered ? ToDbfs(peak_[channel]) : kSilenceDbfs;
+        rmsDbfs[channel] = metered ? ToDbfs(std::sqrt(sumSquares_[channel] / static_cast<double>(frames_))) : kSilenceDbfs;
+        peak_[channel] = 0.0f;
+        sumSquares_[channel] = 0.0;
+    }
+    frames_ = 0;
+}
+
+std::string DefaultSharedStatsName() {
+    return "loopback_recorder_stats";
+}
+
+const char* SharedRecorderStateName(uint32_t state) {
+    switch (static_cast<SharedRecorderState>(state)) {
+    case SharedRecorderState::Starting:
+        return "starting";
+    case SharedRecorderState::Recording:
+        return "recording";
+    case SharedRecorderState::Paused:
+        return "paused";
+    case SharedRecorderState::Stopping:
+        return "stopping";
+    case SharedRecorderState::Stopped:
+        return "stopped";
+    case SharedRecorderState::DeviceLost:
+        return "device-lost";
+    case SharedRecorderState::Failed:
+        return "failed";
+    }
+    return "unknown";
+}
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+
+// Live recorder state published in named shared memory ("Local\<name>" file mapping on
+// Windows, POSIX shm "/<name>" elsewhere) so monitors can poll it without parsing logs or
+// an IPC round trip. The block is fixed-layout and versioned; the recorder is the only
+// writer and updates it under a seqlock, readers retry while a write is in progress.
+
+enum class SharedRecorderState : uint32_t {
+    Starting = 0,
+    Recording = 1,
+    Paused = 2,
+    Stopping = 3,
+    Stopped = 4,
+    DeviceLost = 5,
+    Failed = 6,
+};
+
+constexpr size_t kSharedStatsMaxChannels = 8;
+
+// Plain data, copied out by readers. Append fields only at the end and bump kVersion.
+struct SharedStatsPayload {
+    uint64_t updateUnixMicros = 0;
+    uint64_t updateCount = 0;
+    uint32_t processId = 0;
+    uint32_t state = static_cast<uint32_t>(SharedRecorderState::Starting);
+    uint32_t sampleRate = 0;
+    uint32_t channels = 0;
+    uint64_t framesCaptured = 0;
+    uint64_t silentFrames = 0;
+    uint64_t pausedFrames = 0;
+    uint64_t droppedFrames = 0;
+    uint32_t glitches = 0;
+    uint32_t watchdogTimeouts = 0;
+    uint64_t ringBytes = 0;
+    uint64_t ringCapacityBytes = 0;
+    uint32_t segmentNumber = 0;            // 1-based, 0 before the first segment opens
+    uint32_t reserved = 0;
+    // Levels since the previous update, dBFS; -200 means digital silence.
+    float peakDbfs[kSharedStatsMaxChannels] = {};
+    float rmsDbfs[kSharedStatsMaxChannels] = {};
+    char outputPath[512] = {};             // UTF-8 base output path, NUL-terminated
+};
+
+struct SharedStatsHeader {
+    char magic[8];                         // "LRSTATS\0"
+    uint32_t version;
+    uint32_t blockSize;                    // sizeof(SharedStatsBlock)
+    std::atomic<uint64_t> sequence;        // odd while the writer is updating the payload
+    uint64_t reserved;
+};
+
+struct SharedStatsBlock {
+    static constexpr uint32_t kVersion = 1;
+
+    SharedStatsHeader header;
+    SharedStatsPayload payload;
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "seqlock counter must be lock-free across processes");
+
+// Creates the named block, or takes over one left behind by an exited process, and writes it.
+// Throws if a live process still publishes under the name. Single writer.
+class SharedStatsPublisher {
+public:
+    explicit SharedStatsPublisher(const std::string& name);
+    ~SharedStatsPublisher();
+
+    SharedStatsPublisher(const SharedStatsPublisher&) = delete;
+    SharedStatsPublisher& operator=(const SharedStatsPublisher&) = delete;
+
+    // Copies `payload` into the block under the seqlock; fills in update time, count and pid.
+    void Publish(const SharedStatsPayload& payload);
+    const std::string& Name() const { return name_; }
+
+private:
+    std::string name_;
+    void* mapping_ = nullptr;              // HANDLE on Windows
+    SharedStatsBlock* block_ = nullptr;
+    uint64_t updates_ = 0;
+};
+
+// Maps an existing block read-only.
+class SharedStatsReader {
+public:
+    explicit SharedStatsReader(const std::string& name);
+    ~SharedStatsReader();
+
+    SharedStatsReader(const SharedStatsReader&) = delete;
+    SharedStatsReader& operator=(const SharedStatsReader&) = delete;
+
+    // Consistent snapshot, or nullopt if the writer kept the block busy for every attempt.
+    std::optional<SharedStatsPayload> Read() const;
+
+private:
+    void* mapping_ = nullptr;
+    const SharedStatsBlock* block_ = nullptr;
+};
+
+// Per-channel peak/RMS accumulator for the capture thread (16-bit PCM or 32-bit float).
+class LevelMeter {
+public:
+    LevelMeter(uint32_t channels, bool floatSamples);
+
+    void Accumulate(const unsigned char* data, size_t frames);
+    void AccumulateSilence(size_t frames) { frames_ += frames; }
+    // Writes dBFS values for the frames seen since the last call and resets.
+    void Take(float* peakDbfs, float* rmsDbfs);
+
+private:
+    uint32_t channels_;
+    bool floatSamples_;
+    uint64_t frames_ = 0;
+    float peak_[kSharedStatsMaxChannels] = {};
+    double sumSquares_[kSharedStatsMaxChannels] = {};
+};
+
+std::string DefaultSharedStatsName();
+const char* SharedRecorderStateName(uint32_t state);
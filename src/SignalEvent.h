@@ -0,0 +1,58 @@
+#pragma once
+
+#include "PipelineScheduler.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+
+// Auto-reset event for the pipeline threads (the portable stand-in for a Win32 auto-reset
+// event). Set() only takes the lock when a thread is actually waiting, so signalling from
+// the capture loop stays a couple of atomic operations in the common case. Given a
+// scheduler, waits and wakeups go through it instead (VirtualScheduler simulation).
+class SignalEvent {
+public:
+    explicit SignalEvent(bool initiallySet = false, PipelineScheduler* scheduler = nullptr)
+        : signaled_(initiallySet), scheduler_(scheduler) {}
+
+    SignalEvent(const SignalEvent&) = delete;
+    SignalEvent& operator=(const SignalEvent&) = delete;
+
+    void Set() {
+        signaled_.store(true, std::memory_order_seq_cst);
+        if (scheduler_) {
+            scheduler_->Wake();
+            return;
+        }
+        if (waiters_.load(std::memory_order_seq_cst) > 0) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            wake_.notify_one();
+        }
+    }
+
+    // True when the event was set (and is consumed), false on timeout.
+    bool Wait(std::chrono::milliseconds timeout) {
+        if (signaled_.exchange(false, std::memory_order_acquire)) {
+            return true;
+        }
+        if (scheduler_) {
+            const std::function<bool()> ready = [this]() { return signaled_.load(std::memory_order_acquire); };
+            return scheduler_->WaitUntil(ready, timeout) && signaled_.exchange(false, std::memory_order_acquire);
+        }
+        std::unique_lock<std::mutex> lock(mutex_);
+        waiters_.fetch_add(1, std::memory_order_seq_cst);
+        const bool signaled = wake_.wait_for(lock, timeout, [this]() {
+            return signaled_.exchange(false, std::memory_order_acquire);
+        });
+        waiters_.fetch_sub(1, std::memory_order_relaxed);
+        return signaled;
+    }
+
+private:
+    std::atomic<bool> signaled_;
+    PipelineScheduler* const scheduler_;
+    std::atomic<int> waiters_{0};
+    std::mutex mutex_;
+    std::condition_variable wake_;
+};
@@ -1,9 +1,5 @@
 #pragma once
 
-#ifndef NOMINMAX
-#define NOMINMAX
-#endif
-#include <Windows.h>
 #include <atomic>
 #include <cstddef>
 #include <cstdint>
@@ -30,7 +26,7 @@ public:
         return static_cast<size_t>(writePos - readPos);
     }
 
-    size_t Write(const BYTE* data, size_t bytes) {
+    size_t Write(const uint8_t* data, size_t bytes) {
         if (bytes == 0) {
             return 0;
         }
@@ -51,7 +47,7 @@ public:
         return bytes;
     }
 
-    size_t Read(BYTE* dest, size_t maxBytes) {
+    size_t Read(uint8_t* dest, size_t maxBytes) {
         if (maxBytes == 0) {
             return 0;
         }
@@ -73,7 +69,7 @@ public:
     }
 
 private:
-    std::vector<BYTE> buffer_;
+    std::vector<uint8_t> buffer_;
     const size_t capacity_;
     std::atomic<uint64_t> writePos_{0};
     std::atomic<uint64_t> readPos_{0};
@@ -0,0 +1,171 @@
+#include "SyntheticSource.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace {
+
+constexpr double kTwoPi = 6.283185307179586;
+
+} // namespace
+
+SyntheticSource::SyntheticSource(SyntheticSourceOptions options)
+    : options_(options),
+      format_(MakeAudioFormat(options.sampleRate, options.channels, options.floatSamples)),
+      framesPerPacket_(static_cast<uint32_t>(std::max<uint64_t>(
+          1, static_cast<uint64_t>(options.sampleRate) * static_cast<uint64_t>(options.period.count()) / 1000))),
+      buffer_(static_cast<size_t>(framesPerPacket_) * format_.BytesPerFrame()),
+      random_(options.seed) {}
+
+std::wstring SyntheticSource::Describe() const {
+    return L"合成正弦 " + std::to_wstring(static_cast<int>(options_.toneHz)) + L" Hz，" +
+           std::to_wstring(options_.sampleRate) + L" Hz × " + std::to_wstring(options_.channels) +
+           (options_.floatSamples ? L" float" : L" 16-bit") + (options_.realTime ? L"，实时" : L"，不限速");
+}
+
+void SyntheticSource::Start() {
+    interrupted_.store(false, std::memory_order_release);
+    startTime_ = std::chrono::steady_clock::now();
+    framesProduced_ = 0;
+    framesLost_ = 0;
+    packets_ = 0;
+    discontinuities_ = 0;
+    pendingDiscontinuity_ = false;
+    lag_ = std::chrono::microseconds(0);
+    phase_ = 0.0;
+}
+
+std::chrono::steady_clock::time_point SyntheticSource::VisibleTime(std::chrono::steady_clock::time_point now) const {
+    auto visible = now - lag_;
+    if (options_.burstEvery.count() > 0 && options_.burstLength.count() > 0) {
+        const auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(visible - startTime_);
+        const std::chrono::microseconds every = options_.burstEvery;
+        if (elapsed >= every) {
+            const auto phase = elapsed % every;
+            if (phase < options_.burstLength) {
+                visible -= phase;
+            }
+        }
+    }
+    return visible;
+}
+
+uint64_t SyntheticSource::FramesDue(std::chrono::steady_clock::time_point now) const {
+    uint64_t due = std::numeric_limits<uint64_t>::max();
+    const uint64_t position = framesProduced_ + framesLost_;
+    if (options_.realTime) {
+        const auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(VisibleTime(now) - startTime_).count();
+        // Whole packets only, like a device that delivers one period at a time.
+        const uint64_t frames = static_cast<uint64_t>(std::max<int64_t>(elapsed, 0)) * options_.sampleRate / 1000000;
+        due = frames / framesPerPacket_ * framesPerPacket_;
+    }
+    if (options_.totalFrames) {
+        due = std::min(due, *options_.totalFrames);
+    }
+    return due > position ? due - position : 0;
+}
+
+SourceWaitResult SyntheticSource::Wait(std::chrono::milliseconds timeout) {
+    if (interrupted_.load(std::memory_order_acquire)) {
+        return SourceWaitResult::Interrupted;
+    }
+    const uint64_t position = framesProduced_ + framesLost_;
+    if (!options_.realTime || FramesDue(std::chrono::steady_clock::now()) > 0 ||
+        (options_.totalFrames && position >= *options_.totalFrames)) {
+        return SourceWaitResult::PacketsReady;
+    }
+    if (options_.jitter.count() > 0) {
+        lag_ = std::chrono::microseconds(
+            std::uniform_int_distribution<int64_t>(0, options_.jitter.count())(random_));
+    }
+    const uint64_t nextPacketFrame = (position / framesPerPacket_ + 1) * framesPerPacket_;
+    auto visibleDue = std::chrono::microseconds(nextPacketFrame * 1000000 / options_.sampleRate);
+    if (options_.burstEvery.count() > 0 && options_.burstLength.count() > 0 && visibleDue >= options_.burstEvery) {
+        const auto phase = visibleDue % std::chrono::microseconds(options_.burstEvery);
+        if (phase < options_.burstLength) {
+            visibleDue += options_.burstLength - phase;
+        }
+    }
+    const auto due = startTime_ + visibleDue + lag_;
+    const auto deadline = std::min(due, std::chrono::steady_clock::now() + timeout);
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (wake_.wait_until(lock, deadline, [this]() { return interrupted_.load(std::memory_order_acquire); })) {
+        return SourceWaitResult::Interrupted;
+    }
+    return std::chrono::steady_clock::now() >= due ? SourceWaitResult::PacketsReady : SourceWaitResult::Timeout;
+}
+
+void SyntheticSource::Interrupt() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        interrupted_.store(true, std::memory_order_release);
+    }
+    wake_.notify_all();
+}
+
+SourceReadResult SyntheticSource::Read(SourcePacket& packet) {
+    if (options_.totalFrames && framesProduced_ + framesLost_ >= *options_.totalFrames) {
+        return SourceReadResult::EndOfStream;
+    }
+    uint64_t due = FramesDue(std::chrono::steady_clock::now());
+    if (due == 0) {
+        return SourceReadResult::Empty;
+    }
+    if (options_.realTime && options_.deviceBuffer.count() > 0) {
+        // Whole packets beyond the device buffer were overwritten before anyone read them.
+        const uint64_t capacity = std::max<uint64_t>(
+            static_cast<uint64_t>(options_.sampleRate) * options_.deviceBuffer.count() / 1000 / framesPerPacket_, 1) *
+            framesPerPacket_;
+        if (due > capacity) {
+            const uint64_t lost = (due - capacity + framesPerPacket_ - 1) / framesPerPacket_ * framesPerPacket_;
+            framesLost_ += lost;
+            phase_ = std::fmod(phase_ + kTwoPi * options_.toneHz / options_.sampleRate * static_cast<double>(lost), kTwoPi);
+            pendingDiscontinuity_ = true;
+            due -= std::min(due, lost);
+            if (due == 0) {
+                return SourceReadResult::Empty;
+            }
+        }
+    }
+    const auto frames = static_cast<uint32_t>(std::min<uint64_t>(due, framesPerPacket_));
+    Fill(frames);
+    ++packets_;
+    packet.data = buffer_.data();
+    packet.frames = frames;
+    packet.silent = options_.amplitude <= 0.0;
+    packet.discontinuity = pendingDiscontinuity_ ||
+                           (options_.discontinuityEvery > 0 && packets_ % options_.discontinuityEvery == 0);
+    pendingDiscontinuity_ = false;
+    if (packet.discontinuity) {
+        ++discontinuities_;
+    }
+    framesProduced_ += frames;
+    return SourceReadResult::Packet;
+}
+
+void SyntheticSource::Fill(uint32_t frames) {
+    if (options_.amplitude <= 0.0) {
+        std::memset(buffer_.data(), 0, static_cast<size_t>(frames) * format_.BytesPerFrame());
+        return;
+    }
+    const double step = kTwoPi * options_.toneHz / options_.sampleRate;
+    const uint16_t channels = options_.channels;
+    if (options_.floatSamples) {
+        auto* samples = reinterpret_cast<float*>(buffer_.data());
+        for (uint32_t frame = 0; frame < frames; ++frame) {
+            const auto value = static_cast<float>(options_.amplitude * std::sin(phase_));
+            std::fill_n(samples + static_cast<size_t>(frame) * channels, channels, value);
+            phase_ += step;
+        }
+    } else {
+        auto* samples = reinterpret_cast<int16_t*>(buffer_.data());
+        for (uint32_t frame = 0; frame < frames; ++frame) {
+            const auto value = static_cast<int16_t>(std::lround(options_.amplitude * 32767.0 * std::sin(phase_)));
+            std::fill_n(samples + static_cast<size_t>(frame) * channels, channels, value);
+            phase_ += step;
+        }
+    }
+    phase_ = std::fmod(phase_, kTwoPi);
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "AudioSource.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <vector>
+
+struct SyntheticSourceOptions {
+    uint32_t sampleRate = 48000;
+    uint16_t channels = 2;
+    bool floatSamples = true;
+    std::chrono::milliseconds period{10};    // frames per packet = one period
+    bool realTime = true;                    // false: packets are always ready (benchmarks)
+    double toneHz = 440.0;
+    double amplitude = 0.25;                 // 0 = digital silence, flagged as silent
+    std::optional<uint64_t> totalFrames;     // end of stream after this many frames
+
+    // Real-time only, for soak tests. Each wakeup is delayed by a random 0..jitter; every
+    // burstEvery, packets are held back for burstLength and then handed out at once; packets
+    // not read within deviceBuffer are lost and the next one is flagged as a discontinuity,
+    // like an overflowing WASAPI buffer (zero = unlimited).
+    std::chrono::microseconds jitter{0};
+    std::chrono::milliseconds burstEvery{0};
+    std::chrono::milliseconds burstLength{0};
+    std::chrono::milliseconds deviceBuffer{0};
+    uint32_t discontinuityEvery = 0;         // also flag every Nth packet
+    uint32_t seed = 1;
+};
+
+// Generates a sine tone on every channel. In real-time mode packets become due on the
+// monotonic clock exactly like a device period, and a late reader gets several packets in
+// a row, as WASAPI would hand them out.
+class SyntheticSource : public IAudioSource {
+public:
+    explicit SyntheticSource(SyntheticSourceOptions options);
+
+    const AudioFormat& Format() const override { return format_; }
+    std::wstring Describe() const override;
+
+    void Start() override;
+    void Stop() override {}
+    SourceWaitResult Wait(std::chrono::milliseconds timeout) override;
+    void Interrupt() override;
+    SourceReadResult Read(SourcePacket& packet) override;
+    void Release(const SourcePacket&) override {}
+
+    uint64_t FramesProduced() const { return framesProduced_; }
+    uint64_t FramesLost() const { return framesLost_; }
+    uint64_t DiscontinuitiesFlagged() const { return discontinuities_; }
+
+private:
+    // The schedule as the reader sees it: `now` minus this wakeup's jitter, frozen during a
+    // burst hold.
+    std::chrono::steady_clock::time_point VisibleTime(std::chrono::steady_clock::time_point now) const;
+    uint64_t FramesDue(std::chrono::steady_clock::time_point now) const;
+    void Fill(uint32_t frames);
+
+    const SyntheticSourceOptions options_;
+    const AudioFormat format_;
+    const uint32_t framesPerPacket_;
+    std::vector<uint8_t> buffer_;
+    double phase_ = 0.0;
+    uint64_t framesProduced_ = 0;
+    uint64_t framesLost_ = 0;
+    uint64_t packets_ = 0;
+    uint64_t discontinuities_ = 0;
+    bool pendingDiscontinuity_ = false;
+    std::chrono::microseconds lag_{0};
+    std::minstd_rand random_;
+    std::chrono::steady_clock::time_point startTime_{};
+
+    std::atomic<bool> interrupted_{false};
+    std::mutex mutex_;
+    std::condition_variable wake_;
+};
@@ -0,0 +1,218 @@
+#include "ThreadUsage.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cstdlib>
+#include <cstring>
+#endif
+
+#include <cstdio>
+
+namespace {
+
+std::optional<uint64_t> Difference(const std::optional<uint64_t>& later, const std::optional<uint64_t>& earlier) {
+    if (!later) {
+        return std::nullopt;
+    }
+    const uint64_t base = earlier.value_or(0);
+    return *later > base ? *later - base : 0;
+}
+
+void AppendCounter(std::string& text, const char* label, const std::optional<uint64_t>& value) {
+    if (value) {
+        text += " ";
+        text += label;
+        text += '=';
+        text += std::to_string(*value);
+    }
+}
+
+#if defined(_WIN32)
+uint64_t FileTimeToNanos(const FILETIME& time) {
+    const uint64_t ticks = (static_cast<uint64_t>(time.dwHighDateTime) << 32) | time.dwLowDateTime;
+    return ticks * 100;   // FILETIME counts 100 ns intervals
+}
+
+ThreadCpuUsage QueryThreadTimes(HANDLE thread) {
+    ThreadCpuUsage usage;
+    FILETIME creation{};
+    FILETIME exit{};
+    FILETIME kernel{};
+    FILETIME user{};
+    if (GetThreadTimes(thread, &creation, &exit, &kernel, &user)) {
+        usage.userNanos = FileTimeToNanos(user);
+        usage.kernelNanos = FileTimeToNanos(kernel);
+    }
+    return usage;
+}
+#else
+uint64_t TimevalToNanos(const timeval& time) {
+    return static_cast<uint64_t>(time.tv_sec) * 1000000000ull + static_cast<uint64_t>(time.tv_usec) * 1000ull;
+}
+
+// Reads a small /proc file into `buffer` (NUL-terminated); empty on failure.
+size_t ReadProcFile(const char* path, char* buffer, size_t size) {
+    const int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        buffer[0] = '\0';
+        return 0;
+    }
+    size_t used = 0;
+    while (used + 1 < size) {
+        const ssize_t got = read(fd, buffer + used, size - 1 - used);
+        if (got <= 0) {
+            break;
+        }
+        used += static_cast<size_t>(got);
+    }
+    close(fd);
+    buffer[used] = '\0';
+    return used;
+}
+
+// /proc/self/task/<tid>/stat and .../status; used when sampling a thread other than the caller.
+// Parsed in place with fixed buffers: the status line samples the writer thread from the
+// capture thread every second, which must not allocate.
+ThreadCpuUsage ReadProcTaskUsage(int threadId) {
+    ThreadCpuUsage usage;
+    char path[64];
+    char text[4096];   // status is about 1.5 KiB; the switch counters are its last lines
+
+    std::snprintf(path, sizeof(path), "/proc/self/task/%d/stat", threadId);
+    ReadProcFile(path, text, sizeof(text));
+    // The command name may contain spaces and parentheses; fields resume after the last ')'.
+    if (const char* nameEnd = std::strrchr(text, ')')) {
+        // Field 3 (state) follows; minflt=10, majflt=12, utime=14, stime=15.
+        uint64_t values[16] = {};
+        const char* cursor = nameEnd + 1;
+        int field = 2;
+        while (field < 15 && *cursor) {
+            while (*cursor == ' ') {
+                ++cursor;
+            }
+            ++field;
+            char* next = nullptr;
+            values[field] = std::strtoull(cursor, &next, 10);
+            cursor = next != cursor ? next : std::strchr(cursor, ' ');
+            if (!cursor) {
+                break;
+            }
+        }
+        if (field == 15) {
+            const auto ticksPerSecond = static_cast<uint64_t>(sysconf(_SC_CLK_TCK));
+            usage.minorFaults = values[10];
+            usage.majorFaults = values[12];
+            usage.userNanos = values[14] * 1000000000ull / ticksPerSecond;
+            usage.kernelNanos = values[15] * 1000000000ull / ticksPerSecond;
+        }
+    }
+
+    std::snprintf(path, sizeof(path), "/proc/self/task/%d/status", threadId);
+    ReadProcFile(path, text, sizeof(text));
+    if (const char* line = std::strstr(text, "\nvoluntary_ctxt_switches:")) {
+        usage.voluntarySwitches = std::strtoull(line + std::strlen("\nvoluntary_ctxt_switches:"), nullptr, 10);
+    }
+    if (const char* line = std::strstr(text, "\nnonvoluntary_ctxt_switches:")) {
+        usage.involuntarySwitches = std::strtoull(line + std::strlen("\nnonvoluntary_ctxt_switches:"), nullptr, 10);
+    }
+    return usage;
+}
+#endif
+
+} // namespace
+
+ThreadCpuUsage ThreadCpuUsage::Since(const ThreadCpuUsage& earlier) const {
+    ThreadCpuUsage delta;
+    delta.userNanos = userNanos > earlier.userNanos ? userNanos - earlier.userNanos : 0;
+    delta.kernelNanos = kernelNanos > earlier.kernelNanos ? kernelNanos - earlier.kernelNanos : 0;
+    delta.voluntarySwitches = Difference(voluntarySwitches, earlier.voluntarySwitches);
+    delta.involuntarySwitches = Difference(involuntarySwitches, earlier.involuntarySwitches);
+    delta.minorFaults = Difference(minorFaults, earlier.minorFaults);
+    delta.majorFaults = Difference(majorFaults, earlier.majorFaults);
+    return delta;
+}
+
+std::string ThreadCpuUsage::Format(double recordedHours) const {
+    char buffer[96];
+    std::snprintf(buffer, sizeof(buffer), "user=%.2fs sys=%.2fs",
+                  static_cast<double>(userNanos) / 1e9, static_cast<double>(kernelNanos) / 1e9);
+    std::string text = buffer;
+    if (recordedHours > 0.0) {
+        std::snprintf(buffer, sizeof(buffer), " cpu/h=%.2fs", static_cast<double>(CpuNanos()) / 1e9 / recordedHours);
+        text += buffer;
+    }
+    AppendCounter(text, "vcsw", voluntarySwitches);
+    AppendCounter(text, "ivcsw", involuntarySwitches);
+    AppendCounter(text, "minflt", minorFaults);
+    AppendCounter(text, "majflt", majorFaults);
+    return text;
+}
+
+ThreadCpuUsage SampleCurrentThreadUsage() {
+#if defined(_WIN32)
+    return QueryThreadTimes(GetCurrentThread());
+#else
+    ThreadCpuUsage usage;
+    rusage data{};
+    if (getrusage(RUSAGE_THREAD, &data) == 0) {
+        usage.userNanos = TimevalToNanos(data.ru_utime);
+        usage.kernelNanos = TimevalToNanos(data.ru_stime);
+        usage.voluntarySwitches = static_cast<uint64_t>(data.ru_nvcsw);
+        usage.involuntarySwitches = static_cast<uint64_t>(data.ru_nivcsw);
+        usage.minorFaults = static_cast<uint64_t>(data.ru_minflt);
+        usage.majorFaults = static_cast<uint64_t>(data.ru_majflt);
+    }
+    return usage;
+#endif
+}
+
+ThreadUsageProbe::~ThreadUsageProbe() {
+#if defined(_WIN32)
+    if (handle_) {
+        CloseHandle(static_cast<HANDLE>(handle_));
+    }
+#endif
+}
+
+void ThreadUsageProbe::BindCurrentThread() {
+#if defined(_WIN32)
+    HANDLE duplicate = nullptr;
+    if (!DuplicateHandle(GetCurrentProcess(), GetCurrentThread(), GetCurrentProcess(), &duplicate,
+                         THREAD_QUERY_LIMITED_INFORMATION, FALSE, 0)) {
+        return;
+    }
+    handle_ = duplicate;
+#else
+    threadId_ = static_cast<int>(syscall(SYS_gettid));
+#endif
+    state_.store(Bound, std::memory_order_release);
+}
+
+void ThreadUsageProbe::Freeze() {
+    if (state_.load(std::memory_order_relaxed) != Bound) {
+        return;
+    }
+    frozen_ = SampleCurrentThreadUsage();
+    state_.store(Frozen, std::memory_order_release);
+}
+
+ThreadCpuUsage ThreadUsageProbe::Sample() const {
+    switch (state_.load(std::memory_order_acquire)) {
+    case Bound:
+#if defined(_WIN32)
+        return QueryThreadTimes(static_cast<HANDLE>(handle_));
+#else
+        return ReadProcTaskUsage(threadId_);
+#endif
+    case Frozen:
+        return frozen_;
+    default:
+        return {};
+    }
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <optional>
+#include <string>
+
+// Cumulative resource usage of one thread. CPU times are available everywhere; Windows has
+// no per-thread context-switch or page-fault counters, so those stay empty there.
+struct ThreadCpuUsage {
+    uint64_t userNanos = 0;
+    uint64_t kernelNanos = 0;
+    std::optional<uint64_t> voluntarySwitches;
+    std::optional<uint64_t> involuntarySwitches;
+    std::optional<uint64_t> minorFaults;
+    std::optional<uint64_t> majorFaults;
+
+    uint64_t CpuNanos() const { return userNanos + kernelNanos; }
+    // Usage accumulated since `earlier` (a previous sample of the same thread).
+    ThreadCpuUsage Since(const ThreadCpuUsage& earlier) const;
+    // "user=1.20s sys=0.31s cpu/h=5.4s vcsw=1200 ivcsw=4 minflt=12 majflt=0"; cpu/h is CPU
+    // time per hour of recorded audio and is left out when `recordedHours` is 0.
+    std::string Format(double recordedHours) const;
+};
+
+// Usage of the calling thread (getrusage(RUSAGE_THREAD) / GetThreadTimes).
+ThreadCpuUsage SampleCurrentThreadUsage();
+
+// Lets one thread read another thread's usage. The probe is created unbound; the observed
+// thread calls BindCurrentThread() when it starts and Freeze() right before it exits, so the
+// totals stay readable after it is gone. Sample() may be called from any thread and returns
+// zeros until the probe is bound.
+class ThreadUsageProbe {
+public:
+    ThreadUsageProbe() = default;
+    ~ThreadUsageProbe();
+
+    ThreadUsageProbe(const ThreadUsageProbe&) = delete;
+    ThreadUsageProbe& operator=(const ThreadUsageProbe&) = delete;
+
+    void BindCurrentThread();
+    void Freeze();
+    ThreadCpuUsage Sample() const;
+
+private:
+    enum State : int { Unbound, Bound, Frozen };
+
+    std::atomic<int> state_{Unbound};
+#if defined(_WIN32)
+    void* handle_ = nullptr;   // duplicated thread handle, stays valid after the thread exits
+#else
+    int threadId_ = 0;
+#endif
+    ThreadCpuUsage frozen_;
+};
+
+// Binds a probe for the lifetime of a thread body: Bind on entry, Freeze on every exit path.
+class ThreadUsageScope {
+public:
+    explicit ThreadUsageScope(ThreadUsageProbe& probe) : probe_(probe) { probe_.BindCurrentThread(); }
+    ~ThreadUsageScope() { probe_.Freeze(); }
+
+    ThreadUsageScope(const ThreadUsageScope&) = delete;
+    ThreadUsageScope& operator=(const ThreadUsageScope&) = delete;
+
+private:
+    ThreadUsageProbe& probe_;
+};
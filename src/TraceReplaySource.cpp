@@ -0,0 +1,169 @@
+#include "TraceReplaySource.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace {
+
+constexpr double kTwoPi = 6.283185307179586;
+
+AudioFormat ReplayFormat(const CaptureTrace& trace) {
+    const AudioFormat& recorded = trace.Format();
+    // Extensible mix formats replay as their plain equivalent (no channel mask).
+    if (recorded.bitsPerSample != (recorded.floatSamples ? 32 : 16)) {
+        throw std::runtime_error("回放仅支持 16-bit PCM 或 32-bit float 的跟踪");
+    }
+    if (recorded.channels == 0 || recorded.sampleRate == 0) {
+        throw std::runtime_error("跟踪中的音频格式无效");
+    }
+    return MakeAudioFormat(recorded.sampleRate, recorded.channels, recorded.floatSamples);
+}
+
+uint32_t LargestPacket(const CaptureTrace& trace) {
+    uint32_t largest = 0;
+    for (const auto& record : trace.records) {
+        if (record.kind == CaptureTraceKind::Read &&
+            static_cast<SourceReadResult>(record.result) == SourceReadResult::Packet) {
+            largest = std::max(largest, record.value);
+        }
+    }
+    return largest;
+}
+
+} // namespace
+
+TraceReplaySource::TraceReplaySource(CaptureTrace trace, TraceReplayOptions options)
+    : trace_(std::move(trace)),
+      options_(options),
+      format_(ReplayFormat(trace_)),
+      buffer_(static_cast<size_t>(LargestPacket(trace_)) * format_.BytesPerFrame()) {}
+
+std::wstring TraceReplaySource::Describe() const {
+    return L"采集时序回放（" + std::to_wstring(trace_.records.size()) + L" 条记录，" +
+           std::to_wstring(format_.sampleRate) + L" Hz × " + std::to_wstring(format_.channels) +
+           (options_.realTime ? L"，实时）" : L"，虚拟时钟）");
+}
+
+void TraceReplaySource::Start() {
+    interrupted_.store(false, std::memory_order_release);
+    const auto& records = trace_.records;
+    while (cursor_ < records.size() && records[cursor_].kind != CaptureTraceKind::Start) {
+        ++cursor_;
+    }
+    if (cursor_ < records.size()) {
+        ++cursor_;
+    }
+    origin_ = std::chrono::steady_clock::now();
+    virtualNanos_ = 0;
+    framesReplayed_ = 0;
+    mismatches_ = 0;
+    phase_ = 0.0;
+}
+
+bool TraceReplaySource::SessionEnded() const {
+    return cursor_ >= trace_.records.size() || trace_.records[cursor_].kind == CaptureTraceKind::Start ||
+           trace_.records[cursor_].kind == CaptureTraceKind::Stop;
+}
+
+bool TraceReplaySource::SleepUntilRecorded(uint64_t recordedNanos, std::chrono::steady_clock::time_point limit) {
+    const auto due = origin_ + std::chrono::nanoseconds(recordedNanos);
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (wake_.wait_until(lock, std::min(due, limit), [this]() { return interrupted_.load(std::memory_order_acquire); })) {
+        return false;
+    }
+    return due <= limit;
+}
+
+SourceWaitResult TraceReplaySource::Wait(std::chrono::milliseconds timeout) {
+    if (interrupted_.load(std::memory_order_acquire)) {
+        return SourceWaitResult::Interrupted;
+    }
+    const auto& records = trace_.records;
+    while (!SessionEnded() && records[cursor_].kind == CaptureTraceKind::Read) {
+        ++mismatches_;
+        ++cursor_;
+    }
+    if (SessionEnded()) {
+        return SourceWaitResult::PacketsReady;    // Read() reports the end of the stream
+    }
+    const CaptureTraceRecord& record = records[cursor_];
+    if (options_.realTime && !SleepUntilRecorded(record.nanos, std::chrono::steady_clock::now() + timeout)) {
+        return interrupted_.load(std::memory_order_acquire) ? SourceWaitResult::Interrupted : SourceWaitResult::Timeout;
+    }
+    ++cursor_;
+    virtualNanos_ = record.nanos;
+    const auto result = static_cast<SourceWaitResult>(record.result);
+    if (result == SourceWaitResult::Failed) {
+        lastError_ = L"回放：录制时此处等待音频事件失败。";
+    }
+    return result;
+}
+
+void TraceReplaySource::Interrupt() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        interrupted_.store(true, std::memory_order_release);
+    }
+    wake_.notify_all();
+}
+
+SourceReadResult TraceReplaySource::Read(SourcePacket& packet) {
+    if (SessionEnded()) {
+        return SourceReadResult::EndOfStream;
+    }
+    const CaptureTraceRecord& record = trace_.records[cursor_];
+    if (record.kind != CaptureTraceKind::Read) {
+        ++mismatches_;
+        return SourceReadResult::Empty;
+    }
+    if (options_.realTime) {
+        const auto due = origin_ + std::chrono::nanoseconds(record.nanos);
+        if (!SleepUntilRecorded(record.nanos, due)) {
+            return SourceReadResult::Empty;
+        }
+    }
+    ++cursor_;
+    virtualNanos_ = record.nanos;
+    const auto result = static_cast<SourceReadResult>(record.result);
+    switch (result) {
+    case SourceReadResult::Packet:
+        Fill(record.value);
+        packet.data = buffer_.data();
+        packet.frames = record.value;
+        packet.silent = (record.flags & kCaptureTraceSilent) != 0;
+        packet.discontinuity = (record.flags & kCaptureTraceDiscontinuity) != 0;
+        framesReplayed_ += record.value;
+        break;
+    case SourceReadResult::DeviceLost:
+        lastError_ = L"回放：录制时此处播放设备不可用。";
+        break;
+    case SourceReadResult::Failed:
+        lastError_ = L"回放：录制时此处读取音频包失败。";
+        break;
+    default:
+        break;
+    }
+    return result;
+}
+
+void TraceReplaySource::Fill(uint32_t frames) {
+    const double step = kTwoPi * options_.toneHz / format_.sampleRate;
+    const uint16_t channels = format_.channels;
+    if (format_.floatSamples) {
+        auto* samples = reinterpret_cast<float*>(buffer_.data());
+        for (uint32_t frame = 0; frame < frames; ++frame) {
+            const auto value = static_cast<float>(options_.amplitude * std::sin(phase_));
+            std::fill_n(samples + static_cast<size_t>(frame) * channels, channels, value);
+            phase_ += step;
+        }
+    } else {
+        auto* samples = reinterpret_cast<int16_t*>(buffer_.data());
+        for (uint32_t frame = 0; frame < frames; ++frame) {
+            const auto value = static_cast<int16_t>(std::lround(options_.amplitude * 32767.0 * std::sin(phase_)));
+            std::fill_n(samples + static_cast<size_t>(frame) * channels, channels, value);
+            phase_ += step;
+        }
+    }
+    phase_ = std::fmod(phase_, kTwoPi);
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "AudioSource.h"
+#include "CaptureTrace.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+struct TraceReplayOptions {
+    bool realTime = true;       // false: virtual clock, every call returns at once in trace order
+    double toneHz = 440.0;
+    double amplitude = 0.25;
+};
+
+// Feeds the pipeline the Wait/Read sequence of a capture timing trace. In real time every
+// call returns no earlier than it did in the recording, relative to Start(), so the pipeline
+// sees the same wakeups, bursts, timeouts and device errors; a Wait whose recorded return
+// lies beyond the caller's timeout times out instead and is replayed by the next one. On the
+// virtual clock the calls return immediately and VirtualTime() follows the recorded stamps.
+// Packets carry a sine tone in a plain PCM/float version of the recorded format. Each Start()
+// replays the next recorded session; the end of one is the end of the stream.
+class TraceReplaySource : public IAudioSource {
+public:
+    TraceReplaySource(CaptureTrace trace, TraceReplayOptions options = {});
+
+    const AudioFormat& Format() const override { return format_; }
+    std::wstring Describe() const override;
+
+    void Start() override;
+    void Stop() override {}
+    SourceWaitResult Wait(std::chrono::milliseconds timeout) override;
+    void Interrupt() override;
+    SourceReadResult Read(SourcePacket& packet) override;
+    void Release(const SourcePacket&) override {}
+    std::wstring LastError() const override { return lastError_; }
+
+    std::chrono::nanoseconds VirtualTime() const { return std::chrono::nanoseconds(virtualNanos_); }
+    uint64_t FramesReplayed() const { return framesReplayed_; }
+    // Calls that did not line up with the recording: reads the recording did not make, or
+    // recorded reads skipped because the replayed pipeline waited earlier.
+    uint64_t Mismatches() const { return mismatches_; }
+
+private:
+    bool SessionEnded() const;
+    // Real time: sleeps until `recordedNanos` after Start() or `limit`, whichever is first;
+    // false if interrupted or the limit came first.
+    bool SleepUntilRecorded(uint64_t recordedNanos, std::chrono::steady_clock::time_point limit);
+    void Fill(uint32_t frames);
+
+    const CaptureTrace trace_;
+    const TraceReplayOptions options_;
+    const AudioFormat format_;
+    std::vector<uint8_t> buffer_;
+    size_t cursor_ = 0;
+    uint64_t virtualNanos_ = 0;
+    uint64_t framesReplayed_ = 0;
+    uint64_t mismatches_ = 0;
+    double phase_ = 0.0;
+    std::wstring lastError_;
+    std::chrono::steady_clock::time_point origin_{};
+
+    std::atomic<bool> interrupted_{false};
+    std::mutex mutex_;
+    std::condition_variable wake_;
+};
@@ -0,0 +1,200 @@
+#include "Tracer.h"
+
+#include "JsonLines.h"
+
+#include <algorithm>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace Tracer {
+
+std::atomic<bool> g_enabled{false};
+
+namespace {
+
+enum class Phase : char {
+    Complete = 'X',
+    Instant = 'i',
+    Counter = 'C',
+};
+
+struct Event {
+    const char* name;
+    uint64_t timestampNs;
+    uint64_t durationNs;  // Complete events
+    int64_t value;        // Counter events
+    Phase phase;
+};
+
+struct ThreadBuffer {
+    explicit ThreadBuffer(uint32_t id) : tid(id), events(std::make_unique<Event[]>(kEventsPerThread)) {}
+
+    const uint32_t tid;
+    std::atomic<const char*> name{nullptr};
+    std::unique_ptr<Event[]> events;
+    std::atomic<uint64_t> written{0};  // published by the owning thread only
+};
+
+struct Registry {
+    std::mutex mutex;
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+    std::atomic<uint64_t> generation{1};
+    uint64_t originNs = 0;
+};
+
+Registry& GetRegistry() {
+    static Registry registry;
+    return registry;
+}
+
+struct ThreadSlot {
+    uint64_t generation = 0;
+    ThreadBuffer* buffer = nullptr;
+};
+
+thread_local ThreadSlot t_slot;
+
+ThreadBuffer& CurrentBuffer() {
+    Registry& registry = GetRegistry();
+    const uint64_t generation = registry.generation.load(std::memory_order_acquire);
+    if (t_slot.generation != generation) {
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        registry.buffers.push_back(std::make_unique<ThreadBuffer>(static_cast<uint32_t>(registry.buffers.size() + 1)));
+        t_slot.buffer = registry.buffers.back().get();
+        t_slot.generation = generation;
+    }
+    return *t_slot.buffer;
+}
+
+void Append(const Event& event) {
+    ThreadBuffer& buffer = CurrentBuffer();
+    const uint64_t index = buffer.written.load(std::memory_order_relaxed);
+    buffer.events[index % kEventsPerThread] = event;
+    buffer.written.store(index + 1, std::memory_order_release);
+}
+
+void AppendMicros(std::string& out, uint64_t ns) {
+    out += std::to_string(ns / 1000);
+    out += '.';
+    const std::string fraction = std::to_string(ns % 1000);
+    out.append(3 - fraction.size(), '0');
+    out += fraction;
+}
+
+} // namespace
+
+void Start() {
+    Registry& registry = GetRegistry();
+    {
+        // Buffers of the previous session are released here, so Start() must not race with
+        // threads that are still recording.
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        registry.buffers.clear();
+        registry.originNs = NowNs();
+        registry.generation.fetch_add(1, std::memory_order_acq_rel);
+    }
+    g_enabled.store(true, std::memory_order_release);
+}
+
+void Stop() {
+    g_enabled.store(false, std::memory_order_release);
+}
+
+uint64_t OverwrittenEvents() {
+    Registry& registry = GetRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    uint64_t overwritten = 0;
+    for (const auto& buffer : registry.buffers) {
+        const uint64_t written = buffer->written.load(std::memory_order_acquire);
+        overwritten += written > kEventsPerThread ? written - kEventsPerThread : 0;
+    }
+    return overwritten;
+}
+
+void RecordComplete(const char* name, uint64_t startNs, uint64_t endNs) {
+    Append(Event{name, startNs, endNs > startNs ? endNs - startNs : 0, 0, Phase::Complete});
+}
+
+void RecordInstantSlow(const char* name) {
+    Append(Event{name, NowNs(), 0, 0, Phase::Instant});
+}
+
+void RecordCounterSlow(const char* name, int64_t value) {
+    Append(Event{name, NowNs(), 0, value, Phase::Counter});
+}
+
+void SetThreadNameSlow(const char* name) {
+    CurrentBuffer().name.store(name, std::memory_order_release);
+}
+
+void WriteChromeTrace(const std::filesystem::path& path) {
+    Registry& registry = GetRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        throw std::runtime_error("无法写入跟踪文件：" + path.string());
+    }
+
+    std::string out;
+    out.reserve(1 << 20);
+    out += "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    bool first = true;
+    auto beginEvent = [&]() {
+        if (!first) {
+            out += ",\n";
+        }
+        first = false;
+    };
+
+    for (const auto& buffer : registry.buffers) {
+        const std::string tid = std::to_string(buffer->tid);
+        const char* threadName = buffer->name.load(std::memory_order_acquire);
+        beginEvent();
+        out += "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" + tid + ",\"args\":{\"name\":\"";
+        out += threadName ? JsonEscape(threadName) : "thread-" + tid;
+        out += "\"}}";
+
+        const uint64_t written = buffer->written.load(std::memory_order_acquire);
+        const uint64_t oldest = written > kEventsPerThread ? written - kEventsPerThread : 0;
+        for (uint64_t i = oldest; i < written; ++i) {
+            const Event& event = buffer->events[i % kEventsPerThread];
+            const uint64_t relative = event.timestampNs > registry.originNs ? event.timestampNs - registry.originNs : 0;
+            beginEvent();
+            out += "{\"name\":\"";
+            out += JsonEscape(event.name);
+            out += "\",\"ph\":\"";
+            out += static_cast<char>(event.phase);
+            out += "\",\"pid\":1,\"tid\":" + tid + ",\"ts\":";
+            AppendMicros(out, relative);
+            switch (event.phase) {
+            case Phase::Complete:
+                out += ",\"dur\":";
+                AppendMicros(out, event.durationNs);
+                break;
+            case Phase::Instant:
+                out += ",\"s\":\"t\"";
+                break;
+            case Phase::Counter:
+                out += ",\"args\":{\"value\":" + std::to_string(event.value) + "}";
+                break;
+            }
+            out += '}';
+            if (out.size() > (1u << 20) - 512) {
+                file.write(out.data(), static_cast<std::streamsize>(out.size()));
+                out.clear();
+            }
+        }
+    }
+    out += "\n]}\n";
+    file.write(out.data(), static_cast<std::streamsize>(out.size()));
+    if (!file) {
+        throw std::runtime_error("写入跟踪文件失败：" + path.string());
+    }
+}
+
+} // namespace Tracer
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+
+// Low-overhead pipeline tracer producing Chrome/Perfetto trace JSON (chrome://tracing,
+// ui.perfetto.dev). Each thread appends fixed-size events to its own buffer without locks;
+// buffers are registered on a thread's first event after Start() and only read by
+// WriteChromeTrace() once the traced threads are idle. While tracing is off, every trace
+// point costs one relaxed load and a not-taken branch. Names must be string literals.
+namespace Tracer {
+
+// Events kept per thread; when a thread wraps around, its oldest events are overwritten.
+constexpr size_t kEventsPerThread = 1u << 17;
+
+extern std::atomic<bool> g_enabled;
+
+inline bool Enabled() {
+    return g_enabled.load(std::memory_order_relaxed);
+}
+
+inline uint64_t NowNs() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+// Discards events from a previous session and enables recording.
+void Start();
+void Stop();
+// Writes everything recorded since Start(). Call after Stop() with the traced threads idle.
+void WriteChromeTrace(const std::filesystem::path& path);
+// Events overwritten because a thread buffer wrapped around.
+uint64_t OverwrittenEvents();
+
+void RecordComplete(const char* name, uint64_t startNs, uint64_t endNs);
+void RecordInstantSlow(const char* name);
+void RecordCounterSlow(const char* name, int64_t value);
+void SetThreadNameSlow(const char* name);
+
+inline void Instant(const char* name) {
+    if (Enabled()) {
+        RecordInstantSlow(name);
+    }
+}
+
+inline void Counter(const char* name, int64_t value) {
+    if (Enabled()) {
+        RecordCounterSlow(name, value);
+    }
+}
+
+inline void SetThreadName(const char* name) {
+    if (Enabled()) {
+        SetThreadNameSlow(name);
+    }
+}
+
+} // namespace Tracer
+
+// Records a complete ("X") event spanning the lifetime of the object.
+class TraceScope {
+public:
+    explicit TraceScope(const char* name)
+        : name_(Tracer::Enabled() ? name : nullptr), start_(name_ ? Tracer::NowNs() : 0) {}
+    ~TraceScope() {
+        if (name_) {
+            Tracer::RecordComplete(name_, start_, Tracer::NowNs());
+        }
+    }
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+    const char* name_;
+    uint64_t start_;
+};
@@ -0,0 +1,231 @@
+#include "VirtualScheduler.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <stdexcept>
+
+namespace {
+
+constexpr int64_t kNoDeadline = std::numeric_limits<int64_t>::max();
+
+int64_t DeadlineAfter(int64_t now, std::chrono::nanoseconds timeout) {
+    if (timeout.count() <= 0) {
+        return now;
+    }
+    return timeout.count() >= kNoDeadline - now ? kNoDeadline : now + timeout.count();
+}
+
+void Mix(uint64_t& digest, uint64_t value) {
+    for (int i = 0; i < 8; ++i) {
+        digest ^= (value >> (i * 8)) & 0xFF;
+        digest *= 1099511628211ull;
+    }
+}
+
+} // namespace
+
+VirtualScheduler::VirtualScheduler(VirtualSchedulerOptions options)
+    : options_(std::move(options)), random_(options_.seed) {}
+
+void VirtualScheduler::Run(const std::function<void()>& main) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (current_) {
+            throw std::logic_error("VirtualScheduler::Run is already running");
+        }
+        tasks_.clear();
+        auto task = std::make_unique<Task>();
+        task->thread = std::this_thread::get_id();
+        current_ = task.get();
+        tasks_.push_back(std::move(task));
+    }
+    struct Finish {
+        VirtualScheduler& scheduler;
+        ~Finish() {
+            std::lock_guard<std::mutex> lock(scheduler.mutex_);
+            for (size_t i = 1; i < scheduler.tasks_.size(); ++i) {
+                if (scheduler.tasks_[i]->state != TaskState::Finished) {
+                    scheduler.StuckLocked("the main thread returned while thread " + std::to_string(i) + " still runs");
+                }
+            }
+            scheduler.current_ = nullptr;
+        }
+    } finish{*this};
+    main();
+}
+
+std::chrono::steady_clock::time_point VirtualScheduler::Now() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return std::chrono::steady_clock::time_point{} + std::chrono::nanoseconds(now_);
+}
+
+bool VirtualScheduler::WaitUntil(const std::function<bool()>& ready, std::chrono::nanoseconds timeout) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (ready()) {
+        return true;
+    }
+    Task* self = current_;
+    self->state = TaskState::Blocked;
+    self->ready = &ready;
+    self->deadline = DeadlineAfter(now_, timeout);
+    SwitchLocked(lock);
+    self->ready = nullptr;
+    return ready();
+}
+
+void VirtualScheduler::Wake() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (PreemptLocked()) {
+        SwitchLocked(lock);
+    }
+}
+
+void VirtualScheduler::SleepFor(std::chrono::nanoseconds duration) {
+    static const std::function<bool()> never = []() { return false; };
+    WaitUntil(never, duration);
+}
+
+std::thread VirtualScheduler::StartThread(std::function<void()> body) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    auto owned = std::make_unique<Task>();
+    Task* task = owned.get();
+    task->id = tasks_.size();
+    tasks_.push_back(std::move(owned));
+    std::thread thread([this, task, body = std::move(body)]() {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            turn_.wait(lock, [this, task]() { return current_ == task; });
+        }
+        body();
+        std::unique_lock<std::mutex> lock(mutex_);
+        task->state = TaskState::Finished;
+        SwitchLocked(lock);
+    });
+    task->thread = thread.get_id();
+    if (PreemptLocked()) {
+        SwitchLocked(lock);
+    }
+    return thread;
+}
+
+void VirtualScheduler::Join(std::thread& thread) {
+    if (!thread.joinable()) {
+        return;
+    }
+    Task* task = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (const auto& candidate : tasks_) {
+            if (candidate->thread == thread.get_id()) {
+                task = candidate.get();
+            }
+        }
+    }
+    if (task) {
+        const std::function<bool()> finished = [task]() { return task->state == TaskState::Finished; };
+        WaitUntil(finished, std::chrono::nanoseconds::max());
+    }
+    // The finished thread only has to return from its body now; it no longer needs a turn.
+    thread.join();
+}
+
+std::chrono::nanoseconds VirtualScheduler::Elapsed() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return std::chrono::nanoseconds(now_);
+}
+
+uint64_t VirtualScheduler::Switches() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return switches_;
+}
+
+uint64_t VirtualScheduler::Digest() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return digest_;
+}
+
+bool VirtualScheduler::PreemptLocked() {
+    // Not std::generate_canonical: its draws differ between standard libraries.
+    return static_cast<double>(random_() >> 11) * 0x1.0p-53 < options_.preemption;
+}
+
+uint64_t VirtualScheduler::Random() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return random_();
+}
+
+void VirtualScheduler::SwitchLocked(std::unique_lock<std::mutex>& lock) {
+    Task* self = current_;
+    Task* next = PickNextLocked();
+    ++switches_;
+    Mix(digest_, next->id);
+    Mix(digest_, static_cast<uint64_t>(now_));
+    next->state = TaskState::Runnable;
+    if (next == self) {
+        return;
+    }
+    current_ = next;
+    turn_.notify_all();
+    if (self->state == TaskState::Finished) {
+        return;
+    }
+    turn_.wait(lock, [this, self]() { return current_ == self; });
+}
+
+VirtualScheduler::Task* VirtualScheduler::PickNextLocked() {
+    std::vector<Task*> candidates;
+    for (;;) {
+        int64_t earliest = kNoDeadline;
+        for (const auto& task : tasks_) {
+            if (task->state == TaskState::Runnable) {
+                candidates.push_back(task.get());
+            } else if (task->state == TaskState::Blocked) {
+                if (task->deadline <= now_ || (*task->ready)()) {
+                    candidates.push_back(task.get());
+                } else {
+                    earliest = std::min(earliest, task->deadline);
+                }
+            }
+        }
+        if (!candidates.empty()) {
+            return candidates[static_cast<size_t>(random_() % candidates.size())];
+        }
+        // Everything is blocked: let virtual time pass until the first timeout.
+        if (earliest == kNoDeadline) {
+            StuckLocked("deadlock: every thread waits without a timeout");
+        }
+        if (earliest > options_.timeLimit.count()) {
+            StuckLocked("no progress within the time limit");
+        }
+        now_ = earliest;
+    }
+}
+
+void VirtualScheduler::StuckLocked(const std::string& reason) {
+    std::string description = reason + " at " + std::to_string(now_ / 1000000) + " ms (seed " +
+                              std::to_string(options_.seed) + ")";
+    for (const auto& task : tasks_) {
+        description += "\n  thread " + std::to_string(task->id) + ": ";
+        switch (task->state) {
+        case TaskState::Runnable:
+            description += task.get() == current_ ? "running" : "runnable";
+            break;
+        case TaskState::Blocked:
+            description += task->deadline == kNoDeadline
+                ? std::string("blocked without timeout")
+                : "blocked until " + std::to_string(task->deadline / 1000000) + " ms";
+            break;
+        case TaskState::Finished:
+            description += "finished";
+            break;
+        }
+    }
+    if (options_.onStuck) {
+        options_.onStuck(description);
+    } else {
+        std::fprintf(stderr, "VirtualScheduler stuck: %s\n", description.c_str());
+    }
+    std::abort();
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include "PipelineScheduler.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct VirtualSchedulerOptions {
+    uint64_t seed = 1;
+    // Chance that Wake() or StartThread() hands the turn to another runnable thread there and
+    // then; blocking calls always do.
+    double preemption = 0.5;
+    // Virtual time after which the run counts as hung (a livelock of timed waits).
+    std::chrono::nanoseconds timeLimit = std::chrono::minutes(10);
+    // Called with a description of every thread when the run deadlocks or hits timeLimit.
+    // A stuck run cannot be unwound, so std::abort() follows if it returns.
+    std::function<void(const std::string&)> onStuck;
+};
+
+// Deterministic scheduler for simulating the pipeline. Threads are real, but only one runs at
+// a time and control changes hands only inside scheduler calls; which runnable thread goes
+// next is drawn from a PRNG seeded by `seed`. Time is virtual: it stands still while anything
+// can run and jumps to the earliest timeout once every thread is blocked, so a recording of
+// minutes simulates in milliseconds and the same seed replays the same interleaving.
+// Everything the simulated threads block on must go through the scheduler (SignalEvent built
+// with it, a source that waits with WaitUntil); a blocking OS call would stall the run.
+class VirtualScheduler : public PipelineScheduler {
+public:
+    explicit VirtualScheduler(VirtualSchedulerOptions options = {});
+
+    VirtualScheduler(const VirtualScheduler&) = delete;
+    VirtualScheduler& operator=(const VirtualScheduler&) = delete;
+
+    // Runs `main` as the first simulated thread, on the calling thread. Threads it starts must
+    // have been joined by the time it returns.
+    void Run(const std::function<void()>& main);
+
+    std::chrono::steady_clock::time_point Now() override;
+    bool WaitUntil(const std::function<bool()>& ready, std::chrono::nanoseconds timeout) override;
+    void Wake() override;
+    void SleepFor(std::chrono::nanoseconds duration) override;
+    std::thread StartThread(std::function<void()> body) override;
+    void Join(std::thread& thread) override;
+
+    std::chrono::nanoseconds Elapsed() const;
+    uint64_t Switches() const;
+    // Hash of every scheduling decision and the virtual time it was taken at; equal for two
+    // runs exactly when they interleaved the same way.
+    uint64_t Digest() const;
+    // A draw from the scheduler's PRNG, for simulated devices and faults that should follow
+    // the seed as well.
+    uint64_t Random();
+
+private:
+    enum class TaskState { Runnable, Blocked, Finished };
+    struct Task {
+        size_t id = 0;
+        TaskState state = TaskState::Runnable;
+        const std::function<bool()>* ready = nullptr;
+        int64_t deadline = 0;
+        std::thread::id thread;
+    };
+
+    // Picks the next thread and, unless that is the caller, parks the caller until its turn.
+    void SwitchLocked(std::unique_lock<std::mutex>& lock);
+    Task* PickNextLocked();
+    bool PreemptLocked();
+    [[noreturn]] void StuckLocked(const std::string& reason);
+
+    const VirtualSchedulerOptions options_;
+    mutable std::mutex mutex_;
+    std::condition_variable turn_;
+    std::vector<std::unique_ptr<Task>> tasks_;
+    Task* current_ = nullptr;
+    int64_t now_ = 0;
+    std::mt19937_64 random_;
+    uint64_t digest_ = 14695981039346656037ull;
+    uint64_t switches_ = 0;
+};
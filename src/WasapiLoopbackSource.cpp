@@ -0,0 +1,173 @@
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include "WasapiLoopbackSource.h"
+#include "HResultUtils.h"
+#include "Tracer.h"
+
+#include <avrt.h>
+#include <windows.h>
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+
+using Microsoft::WRL::ComPtr;
+
+namespace {
+
+void ThrowOnFailure(HRESULT hr, const wchar_t* wideContext, const char* narrowContext, Logger& logger) {
+    if (FAILED(hr)) {
+        logger.Error(std::wstring(wideContext) + DescribeHRESULTW(hr));
+        throw std::runtime_error(narrowContext + DescribeHRESULTA(hr));
+    }
+}
+
+} // namespace
+
+WasapiLoopbackSource::WasapiLoopbackSource(ComPtr<IMMDevice> device, std::chrono::milliseconds latencyHint, Logger& logger)
+    : device_(std::move(device)),
+      latency_(std::clamp(latencyHint, std::chrono::milliseconds(10), std::chrono::milliseconds(500))),
+      logger_(logger) {
+    if (!device_) {
+        throw std::runtime_error("渲染设备为空");
+    }
+    HRESULT hr = device_->Activate(__uuidof(IAudioClient), CLSCTX_ALL, nullptr, &audioClient_);
+    ThrowOnFailure(hr, L"IAudioClient 激活失败：", "IAudioClient 激活失败：", logger_);
+
+    WAVEFORMATEX* format = nullptr;
+    hr = audioClient_->GetMixFormat(&format);
+    ThrowOnFailure(hr, L"GetMixFormat 失败：", "GetMixFormat 失败：", logger_);
+    mixFormat_.reset(format);
+    try {
+        format_ = DecodeWaveFormatChunk(reinterpret_cast<const std::byte*>(format), sizeof(WAVEFORMATEX) + format->cbSize);
+    } catch (const std::exception& ex) {
+        logger_.Error(L"设备混音格式不受支持（格式标记 " + std::to_wstring(format->wFormatTag) + L"）。");
+        throw std::runtime_error(std::string("设备混音格式不受支持：") + ex.what());
+    }
+
+    const REFERENCE_TIME bufferDuration = static_cast<REFERENCE_TIME>(latency_.count()) * 10000; // 100ns units
+    hr = audioClient_->Initialize(AUDCLNT_SHAREMODE_SHARED,
+                                  AUDCLNT_STREAMFLAGS_LOOPBACK | AUDCLNT_STREAMFLAGS_EVENTCALLBACK,
+                                  bufferDuration,
+                                  0,
+                                  mixFormat_.get(),
+                                  nullptr);
+    ThrowOnFailure(hr, L"IAudioClient Initialize 失败：", "IAudioClient Initialize 失败：", logger_);
+
+    samplesReadyEvent_ = CreateEventW(nullptr, FALSE, FALSE, nullptr);
+    interruptEvent_ = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+    if (!samplesReadyEvent_ || !interruptEvent_) {
+        throw std::runtime_error("创建事件句柄失败");
+    }
+    hr = audioClient_->SetEventHandle(samplesReadyEvent_);
+    ThrowOnFailure(hr, L"SetEventHandle 失败：", "SetEventHandle 失败：", logger_);
+
+    hr = audioClient_->GetService(IID_PPV_ARGS(&captureClient_));
+    ThrowOnFailure(hr, L"获取 IAudioCaptureClient 失败：", "获取 IAudioCaptureClient 失败：", logger_);
+}
+
+WasapiLoopbackSource::~WasapiLoopbackSource() {
+    Stop();
+    if (samplesReadyEvent_) {
+        CloseHandle(samplesReadyEvent_);
+    }
+    if (interruptEvent_) {
+        CloseHandle(interruptEvent_);
+    }
+}
+
+std::wstring WasapiLoopbackSource::Describe() const {
+    return L"WASAPI 回环，采集延迟 " + std::to_wstring(latency_.count()) + L" ms";
+}
+
+void WasapiLoopbackSource::Start() {
+    ResetEvent(interruptEvent_);
+    pendingFrames_ = 0;
+    // The capture thread is the caller; MMCSS applies to it until Stop().
+    DWORD taskIndex = 0;
+    mmcssHandle_ = AvSetMmThreadCharacteristicsW(L"Pro Audio", &taskIndex);
+    if (!mmcssHandle_) {
+        std::wcerr << L"警告：无法进入 MMCSS“Pro Audio”优先级配置，将使用普通优先级继续。" << std::endl;
+    }
+    const HRESULT hr = audioClient_->Start();
+    if (FAILED(hr)) {
+        if (mmcssHandle_) {
+            AvRevertMmThreadCharacteristics(mmcssHandle_);
+            mmcssHandle_ = nullptr;
+        }
+        ThrowOnFailure(hr, L"启动音频客户端失败：", "启动音频客户端失败：", logger_);
+    }
+    started_ = true;
+    logger_.Info(L"WASAPI 回环采集已启动。");
+}
+
+void WasapiLoopbackSource::Stop() {
+    if (started_) {
+        audioClient_->Stop();
+        started_ = false;
+        logger_.Info(L"WASAPI 回环采集已停止。");
+    }
+    if (mmcssHandle_) {
+        AvRevertMmThreadCharacteristics(mmcssHandle_);
+        mmcssHandle_ = nullptr;
+    }
+}
+
+SourceWaitResult WasapiLoopbackSource::Wait(std::chrono::milliseconds timeout) {
+    HANDLE waitHandles[2] = { samplesReadyEvent_, interruptEvent_ };
+    const DWORD wait = WaitForMultipleObjects(2, waitHandles, FALSE, static_cast<DWORD>(timeout.count()));
+    switch (wait) {
+    case WAIT_OBJECT_0:
+        return SourceWaitResult::PacketsReady;
+    case WAIT_OBJECT_0 + 1:
+        return SourceWaitResult::Interrupted;
+    case WAIT_TIMEOUT:
+        return SourceWaitResult::Timeout;
+    default:
+        lastError_ = L"等待音频事件返回了异常代码。";
+        return SourceWaitResult::Failed;
+    }
+}
+
+void WasapiLoopbackSource::Interrupt() {
+    SetEvent(interruptEvent_);
+}
+
+SourceReadResult WasapiLoopbackSource::Read(SourcePacket& packet) {
+    HRESULT hr = captureClient_->GetNextPacketSize(&pendingFrames_);
+    if (FAILED(hr)) {
+        return Fail(hr, L"GetNextPacketSize");
+    }
+    if (pendingFrames_ == 0) {
+        return SourceReadResult::Empty;
+    }
+    BYTE* data = nullptr;
+    UINT32 frames = 0;
+    DWORD flags = 0;
+    {
+        TraceScope scope("GetBuffer");
+        hr = captureClient_->GetBuffer(&data, &frames, &flags, nullptr, nullptr);
+    }
+    if (FAILED(hr)) {
+        return Fail(hr, L"GetBuffer");
+    }
+    packet.data = data;
+    packet.frames = frames;
+    packet.silent = (flags & AUDCLNT_BUFFERFLAGS_SILENT) != 0;
+    packet.discontinuity = (flags & AUDCLNT_BUFFERFLAGS_DATA_DISCONTINUITY) != 0;
+    return SourceReadResult::Packet;
+}
+
+void WasapiLoopbackSource::Release(const SourcePacket& packet) {
+    captureClient_->ReleaseBuffer(packet.frames);
+}
+
+SourceReadResult WasapiLoopbackSource::Fail(HRESULT hr, const wchar_t* context) {
+    const std::wstring description = DescribeHRESULTW(hr);
+    if (hr == AUDCLNT_E_DEVICE_INVALIDATED) {
+        lastError_ = std::wstring(context) + L"：播放设备不可用（" + description + L"）";
+        return SourceReadResult::DeviceLost;
+    }
+    lastError_ = std::wstring(context) + L" 失败：" + description;
+    return SourceReadResult::Failed;
+}
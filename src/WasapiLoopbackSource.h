@@ -0,0 +1,55 @@
+#pragma once
+
+#include "AudioSource.h"
+#include "Logger.h"
+
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+#include <wrl/client.h>
+#include <Audioclient.h>
+#include <mmdeviceapi.h>
+
+#include <chrono>
+#include <memory>
+
+// Shared-mode, event-driven WASAPI loopback capture of a render endpoint. The client is
+// activated and initialized in the constructor, so a source built ahead of time only has to
+// Start() when recording begins.
+class WasapiLoopbackSource : public IAudioSource {
+public:
+    WasapiLoopbackSource(Microsoft::WRL::ComPtr<IMMDevice> device, std::chrono::milliseconds latencyHint, Logger& logger);
+    ~WasapiLoopbackSource() override;
+
+    WasapiLoopbackSource(const WasapiLoopbackSource&) = delete;
+    WasapiLoopbackSource& operator=(const WasapiLoopbackSource&) = delete;
+
+    const AudioFormat& Format() const override { return format_; }
+    std::wstring Describe() const override;
+
+    void Start() override;
+    void Stop() override;
+    SourceWaitResult Wait(std::chrono::milliseconds timeout) override;
+    void Interrupt() override;
+    SourceReadResult Read(SourcePacket& packet) override;
+    void Release(const SourcePacket& packet) override;
+    std::wstring LastError() const override { return lastError_; }
+
+private:
+    SourceReadResult Fail(HRESULT hr, const wchar_t* context);
+
+    Microsoft::WRL::ComPtr<IMMDevice> device_;
+    Microsoft::WRL::ComPtr<IAudioClient> audioClient_;
+    Microsoft::WRL::ComPtr<IAudioCaptureClient> captureClient_;
+    std::unique_ptr<WAVEFORMATEX, decltype(&CoTaskMemFree)> mixFormat_{nullptr, CoTaskMemFree};
+    AudioFormat format_;           // mixFormat_ as the recorder core describes it
+    std::chrono::milliseconds latency_;
+    HANDLE samplesReadyEvent_ = nullptr;
+    HANDLE interruptEvent_ = nullptr;
+    HANDLE mmcssHandle_ = nullptr;
+    bool started_ = false;
+    UINT32 pendingFrames_ = 0;   // GetNextPacketSize result not yet consumed
+    std::wstring lastError_;
+    Logger& logger_;
+};
@@ -1,7 +1,9 @@
 #include "WavWriter.h"
 
+#include <algorithm>
 #include <stdexcept>
 #include <cstring>
+#include <string>
 #include <system_error>
 
 namespace {
@@ -10,7 +12,59 @@ void WriteValue(std::ofstream& stream, uint32_t value) {
 }
 }
 
-WavWriter::WavWriter(const std::filesystem::path& path, const WAVEFORMATEX& format)
+WavFileLayout ReadWavFileLayout(const std::filesystem::path& path) {
+    std::ifstream stream(path, std::ios::binary);
+    if (!stream) {
+        throw std::runtime_error("打开 WAV 文件读取失败：" + path.string());
+    }
+    const uint64_t fileSize = std::filesystem::file_size(path);
+    char riff[12] = {};
+    stream.read(riff, sizeof(riff));
+    if (!stream || std::memcmp(riff, "RIFF", 4) != 0 || std::memcmp(riff + 8, "WAVE", 4) != 0) {
+        throw std::runtime_error("输入文件不是 RIFF/WAVE 文件：" + path.string());
+    }
+
+    WavFileLayout layout;
+    bool formatFound = false;
+    bool dataFound = false;
+    while (!dataFound) {
+        char id[4] = {};
+        uint32_t size = 0;
+        stream.read(id, sizeof(id));
+        stream.read(reinterpret_cast<char*>(&size), sizeof(size));
+        if (!stream) {
+            break;
+        }
+        if (std::memcmp(id, "fmt ", 4) == 0) {
+            std::vector<std::byte> chunk(std::min<uint32_t>(size, 4096));
+            stream.read(reinterpret_cast<char*>(chunk.data()), static_cast<std::streamsize>(chunk.size()));
+            if (!stream) {
+                break;
+            }
+            try {
+                layout.format = DecodeWaveFormatChunk(chunk.data(), chunk.size());
+            } catch (const std::exception& ex) {
+                throw std::runtime_error(std::string(ex.what()) + "：" + path.string());
+            }
+            formatFound = true;
+            stream.seekg(static_cast<std::streamoff>(size - chunk.size()) + (size & 1u), std::ios::cur);
+        } else if (std::memcmp(id, "data", 4) == 0) {
+            layout.dataOffset = static_cast<uint64_t>(stream.tellg());
+            const uint64_t available = fileSize > layout.dataOffset ? fileSize - layout.dataOffset : 0;
+            layout.dataBytes = (size == 0 || size > available) ? available : size;
+            dataFound = true;
+        } else {
+            stream.seekg(static_cast<std::streamoff>(size) + (size & 1u), std::ios::cur);
+        }
+    }
+    if (!formatFound || !dataFound) {
+        throw std::runtime_error("WAV 文件缺少 fmt 或 data 块：" + path.string());
+    }
+    layout.dataBytes -= layout.dataBytes % layout.format.BytesPerFrame();
+    return layout;
+}
+
+WavWriter::WavWriter(const std::filesystem::path& path, const AudioFormat& format)
     : path_(path) {
     std::error_code removeEc;
     std::filesystem::remove(path_, removeEc);
@@ -18,8 +72,7 @@ WavWriter::WavWriter(const std::filesystem::path& path, const WAVEFORMATEX& form
     if (!stream_) {
         throw std::runtime_error("打开输出文件失败");
     }
-    formatBlob_.assign(reinterpret_cast<const std::byte*>(&format),
-                       reinterpret_cast<const std::byte*>(&format) + sizeof(WAVEFORMATEX) + format.cbSize);
+    formatBlob_ = EncodeWaveFormatChunk(format);
     WriteHeader();
 }
 
@@ -27,7 +80,7 @@ WavWriter::~WavWriter() {
     Close();
 }
 
-void WavWriter::Write(const BYTE* data, size_t byteCount) {
+void WavWriter::Write(const uint8_t* data, size_t byteCount) {
     if (!stream_) {
         throw std::runtime_error("WAV 流未打开");
     }
@@ -36,6 +89,7 @@ void WavWriter::Write(const BYTE* data, size_t byteCount) {
         throw std::runtime_error("写入 WAV 数据失败");
     }
     dataBytes_ += static_cast<uint32_t>(byteCount);
+    dataCrc_.Update(data, byteCount);
 }
 
 void WavWriter::Flush() {
@@ -1,22 +1,39 @@
 #pragma once
 
-#include <Windows.h>
+#include "AudioFormat.h"
+#include "Checksum.h"
+
 #include <filesystem>
 #include <fstream>
 #include <vector>
 #include <cstddef>
 #include <cstdint>
-#include <mmreg.h>
+
+// Layout of an existing WAV file: the format from its fmt chunk and the data chunk location. A data chunk whose size was never patched (the writer
+// did not get to Close) is taken to run to the end of the file.
+struct WavFileLayout {
+    AudioFormat format;
+    uint64_t dataOffset = 0;
+    uint64_t dataBytes = 0;
+};
+
+WavFileLayout ReadWavFileLayout(const std::filesystem::path& path);
 
 class WavWriter {
 public:
-    WavWriter(const std::filesystem::path& path, const WAVEFORMATEX& format);
+    WavWriter(const std::filesystem::path& path, const AudioFormat& format);
     ~WavWriter();
 
-    void Write(const BYTE* data, size_t byteCount);
+    void Write(const uint8_t* data, size_t byteCount);
     void Flush();
     void Close();
 
+    // Data chunk location and running CRC-32C of the audio payload (the header is
+    // rewritten on Close, so checksums cover the data chunk only).
+    uint64_t DataOffset() const { return 20 + formatBlob_.size() + 8; }
+    uint64_t DataBytes() const { return dataBytes_; }
+    uint32_t DataCrc32c() const { return dataCrc_.Value(); }
+
     WavWriter(const WavWriter&) = delete;
     WavWriter& operator=(const WavWriter&) = delete;
 private:
@@ -27,5 +44,6 @@ private:
     std::ofstream stream_;
     std::vector<std::byte> formatBlob_;
     uint32_t dataBytes_ = 0;
+    Crc32c dataCrc_;
     bool finalized_ = false;
 };
@@ -1,8 +1,15 @@
+#include "ArchiveIndex.h"
+#include "ControlServer.h"
 #include "DeviceEnumerator.h"
 #include "LoopbackRecorder.h"
 #include "Logger.h"
+#include "MetricsExporter.h"
+#include "RecorderDaemon.h"
 #include "HResultUtils.h"
 #include "RecordingUtils.h"
+#include "SegmentManifest.h"
+#include "SharedStats.h"
+#include "WasapiLoopbackSource.h"
 
 #include <windows.h>
 
@@ -11,6 +18,7 @@
 #include <chrono>
 #include <cwctype>
 #include <filesystem>
+#include <functional>
 #include <iomanip>
 #include <iostream>
 #include <optional>
@@ -18,8 +26,10 @@
 #include <thread>
 #include <ctime>
 #include <iterator>
+#include <memory>
 #include <stdexcept>
 #include <cstdint>
+#include <vector>
 
 namespace {
 std::wstring ToWide(const std::string& text) {
@@ -55,26 +65,111 @@ struct CommandLineOptions {
     bool failOnGlitch = false;
     std::optional<int> bufferMs;
     std::optional<std::filesystem::path> logFile;
+    std::optional<int> logMaxMb;
+    std::optional<int> logRotateHours;
+    std::optional<int> logKeep;
+    bool logNoCompress = false;
     bool quiet = false;
     std::optional<int> segmentSeconds;
+    bool segmentAlign = false;
     std::optional<uint64_t> segmentBytes;
     bool convertToMp3 = false;
     std::optional<int> mp3BitrateKbps;
+    std::vector<uint32_t> mp3LadderKbps;
+    std::optional<double> gainDb;
+    bool noManifest = false;
+    bool noIndex = false;
+    std::optional<uint64_t> retainBytes;
+    std::optional<int> retainHours;
+    std::optional<int> retainSegments;
+    bool compressMp3 = false;
+    bool compressDeleteWav = false;
+    std::optional<int> compressThreads;
+    bool noDiskGuard = false;
+    std::optional<uint64_t> diskReserveMb;
+    std::optional<int> fallbackBitrateKbps;
+    std::optional<std::filesystem::path> fallbackDir;
+    std::optional<std::filesystem::path> tracePath;
+    std::optional<std::filesystem::path> captureTracePath;
+    std::optional<std::filesystem::path> metricsFile;
+    std::optional<std::filesystem::path> eventsPath;
+    std::optional<int> metricsPort;
+    bool statsShm = false;
+    std::optional<std::string> statsName;
+    std::optional<std::string> controlName;
+    bool controlWait = false;
 };
 
 void PrintUsage() {
     std::wcout << L"Loopback Recorder\n"
                << L"Usage: loopback_recorder [--list-devices] [--device-index N] [--seconds N] [--out path]\n"
                << L"                        [--latency-ms N] [--watchdog-ms N] [--buffer-ms N]\n"
-               << L"                        [--segment-seconds N] [--segment-bytes N]\n"
-               << L"                        [--mp3] [--mp3-bitrate K]\n"
-               << L"                        [--fail-on-glitch] [--mix-mic] [--log-file path] [--quiet]\n"
+               << L"                        [--segment-seconds N [--segment-align]] [--segment-bytes N]\n"
+               << L"                        [--mp3] [--mp3-bitrate K] [--mp3-ladder K[,K...]] [--gain-db DB]\n"
+               << L"                        [--retain-bytes N] [--retain-hours N] [--retain-segments N]\n"
+               << L"                        [--compress-mp3 [--compress-delete-wav] [--compress-threads N]]\n"
+               << L"                        [--disk-reserve-mb N] [--fallback-bitrate K] [--fallback-dir path] [--no-disk-guard]\n"
+               << L"                        [--fail-on-glitch] [--mix-mic] [--log-file path] [--quiet] [--no-manifest] [--no-index]\n"
+               << L"                        [--log-max-mb N] [--log-rotate-hours N] [--log-keep N] [--log-no-compress]\n"
+               << L"                        [--trace path.json] [--capture-trace path] [--metrics-port N] [--metrics-file path.prom]\n"
+               << L"                        [--stats-shm [--stats-name name]] [--events path.events]\n"
+               << L"                        [--control name [--control-wait]]\n"
+               << L"       loopback_recorder verify <manifest.jsonl> [--threads N]\n"
+               << L"       loopback_recorder locate <name.index> <time>\n"
+               << L"       loopback_recorder stats [--stats-name name] [--watch ms]\n"
+               << L"       loopback_recorder extract <name.index> --from <time> --to <time> --out file.wav|file.mp3\n"
+               << L"       loopback_recorder daemon <schedule.txt> [recording options]\n"
                << L"Notes:\n"
                << L"  - Output format is inferred from --out extension (.mp3 or .wav). Default is MP3.\n"
                << L"  - --mp3 is a legacy flag that forces .mp3 if no extension is provided.\n"
+               << L"  - --retain-* keeps a rolling archive: the oldest closed segments of the session are deleted\n"
+               << L"    in the background once the byte, age or segment-count budget is exceeded.\n"
+               << L"  - --segment-align cuts segments on UTC multiples of --segment-seconds (e.g. every full hour)\n"
+               << L"    and names them <name>_YYYYMMDDTHHMMSSZ; the first segment is shortened to the next boundary.\n"
+               << L"  - --compress-mp3 records WAV and encodes every closed segment to MP3 on low-priority\n"
+               << L"    background threads; unfinished jobs are resumed from <name>.compress-queue on the next run.\n"
+               << L"  - --mp3-ladder adds MP3 bitrates (64-320) encoded from the same conversion pass as the main\n"
+               << L"    output, live for .mp3 output or with --compress-mp3; each goes to <segment>-<K>k.mp3.\n"
+               << L"  - Each closed segment is listed in <name>.manifest.jsonl with its CRC-32C; 'verify' re-checks them.\n"
+               << L"  - Free space of the output volume is watched in the background. When the projected time to\n"
+               << L"    reach the reserve (default 256 MiB) drops below 10 minutes, the next segment switches to\n"
+               << L"    --fallback-bitrate (MP3, default 96), then to --fallback-dir; a warning is logged an hour ahead.\n"
+               << L"  - Closed segments are also appended to the binary time index <name>.index; 'locate' maps a\n"
+               << L"    wall-clock time to file and frame offset, 'extract' cuts a time range across segments.\n"
+               << L"    MP3 archives are cut at whole frames (1152 samples at 44.1/48 kHz) without re-encoding.\n"
+               << L"    <time> is YYYY-MM-DDTHH:MM:SS[.fff], local time unless suffixed with Z (UTC).\n"
+               << L"  - --trace records capture wakeups, GetBuffer, ring push/pop, writes, flushes, MP3 encoding and\n"
+               << L"    segment rolls per thread and writes Chrome trace JSON (chrome://tracing, ui.perfetto.dev).\n"
+               << L"  - --capture-trace records the timing and result of every device wait and packet read (no audio)\n"
+               << L"    in a compact binary file; tools/capture_replay feeds it back through the pipeline in real time\n"
+               << L"    or on a virtual clock to reproduce field glitches and drops on another machine.\n"
+               << L"  - --metrics-port serves Prometheus metrics on http://127.0.0.1:N/metrics; --metrics-file rewrites\n"
+               << L"    a .prom file every 5 s for node_exporter's textfile collector. Alert on recorder_frames_dropped_total.\n"
+               << L"  - --stats-shm publishes live state (counters, ring depth, levels, segment) in shared memory\n"
+               << L"    (default name loopback_recorder_stats); 'stats' reads it without touching the recorder.\n"
+               << L"  - --events appends session, segment open/close, drop, gap, watchdog, reconnect and 10 s level\n"
+               << L"    records to a compact binary log; tools/event_log_decode turns it into JSON lines.\n"
+               << L"  - --control serves JSON-lines commands (start, stop, pause, resume, segment, marker, status,\n"
+               << L"    configure) on \\\\.\\pipe\\<name> (a Unix socket elsewhere); replies carry the frame the command\n"
+               << L"    took effect at. --control-wait idles until a 'start' command arrives. 'configure' changes\n"
+               << L"    bitrate, segment_seconds, segment_bytes (0 = off) and gain_db without stopping the capture;\n"
+               << L"    bitrate applies from the next segment, or right away with \"apply\":\"now\" (which also rolls).\n"
+               << L"  - 'daemon' stays resident and records the sessions listed in a schedule file, one per line:\n"
+               << L"      <min> <hour> <day> <month> <weekday>  <duration>  <output template>  [key=value ...]\n"
+               << L"    e.g. '0 9 * * 1-5  2h  rec/%Y-%m-%d/standup.mp3  bitrate=128 segment=10m'. The template takes\n"
+               << L"    strftime codes; keys: source=loopback|synthetic|pipe:PATH, device=N, bitrate=K, segment=DUR,\n"
+               << L"    rate=HZ, channels=N, sample=s16|f32. LAME stays loaded and buffers are reused; each source is\n"
+               << L"    opened 2 s early so sessions start on time. Overlapping occurrences are skipped and logged.\n"
+               << L"  - --log-file rotates the log at 64 MiB (--log-max-mb, 0 = no size limit) and/or every\n"
+               << L"    --log-rotate-hours into <name>.YYYYMMDD-HHMMSS.log, gzips rotated files in the background\n"
+               << L"    and keeps the newest 10 (--log-keep, 0 = all).\n"
                << L"Examples:\n"
                << L"  loopback_recorder --seconds 30 --out demo.mp3\n"
                << L"  loopback_recorder --segment-seconds 300 --out session.wav\n"
+               << L"  loopback_recorder --segment-seconds 3600 --segment-align --out archive.mp3\n"
+               << L"  loopback_recorder --segment-seconds 600 --compress-mp3 --compress-delete-wav --out session.wav\n"
+               << L"  loopback_recorder --segment-seconds 3600 --mp3-bitrate 320 --mp3-ladder 128,64 --out show.mp3\n"
+               << L"  loopback_recorder extract session.index --from 2026-10-13T14:03:00 --to 2026-10-13T14:05:00 --out clip.wav\n"
                << L"  loopback_recorder --device-index 1\n";
 }
 
@@ -92,6 +187,20 @@ bool ParseInt(const std::wstring& text, int& value) {
     }
 }
 
+bool ParseDouble(const std::wstring& text, double& value) {
+    try {
+        size_t idx = 0;
+        double parsed = std::stod(text, &idx);
+        if (idx != text.size()) {
+            return false;
+        }
+        value = parsed;
+        return true;
+    } catch (...) {
+        return false;
+    }
+}
+
 bool ParseUint64(const std::wstring& text, uint64_t& value) {
     try {
         size_t idx = 0;
@@ -186,13 +295,163 @@ CommandLineOptions ParseArgs(int argc, wchar_t** argv) {
                 throw std::runtime_error("--segment-bytes must be a positive integer");
             }
             opts.segmentBytes = value;
+        } else if (arg == L"--retain-bytes") {
+            if (i + 1 >= argc) {
+                throw std::runtime_error("--retain-bytes requires a value");
+            }
+            uint64_t value = 0;
+            if (!ParseUint64(argv[++i], value) || value == 0) {
+                throw std::runtime_error("--retain-bytes must be a positive integer");
+            }
+            opts.retainBytes = value;
+        } else if (arg == L"--retain-hours") {
+            if (i + 1 >= argc) {
+                throw std::runtime_error("--retain-hours requires a value");
+            }
+            int value = 0;
+            if (!ParseInt(argv[++i], value) || value <= 0) {
+                throw std::runtime_error("--retain-hours must be a positive integer");
+            }
+            opts.retainHours = value;
+        } else if (arg == L"--retain-segments") {
+            if (i + 1 >= argc) {
+                throw std::runtime_error("--retain-segments requires a value");
+            }
+            int value = 0;
+            if (!ParseInt(argv[++i], value) || value <= 0) {
+                throw std::runtime_error("--retain-segments must be a positive integer");
+            }
+            opts.retainSegments = value;
         } else if (arg == L"--log-file") {
             if (i + 1 >= argc) {
                 throw std::runtime_error("--log-file requires a path");
             }
             opts.logFile = std::filesystem::path(argv[++i]);
+        } else if (arg == L"--log-max-mb") {
+            if (i + 1 >= argc) {
+                throw std::runtime_error("--log-max-mb requires a value");
+            }
+            int value = 0;
+            if (!ParseInt(argv[++i], value) || value < 0) {
+                throw std::runtime_error("--log-max-mb must be a non-negative integer");
+            }
+            opts.logMaxMb = value;
+        } else if (arg == L"--log-rotate-hours") {
+            if (i + 1 >= argc) {
+                throw std::runtime_error("--log-rotate-hours requires a value");
+            }
+            int value = 0;
+            if (!ParseInt(argv[++i], value) || value <= 0) {
+                throw std::runtime_error("--log-rotate-hours must be a positive integer");
+            }
+            opts.logRotateHours = value;
+        } else if (arg == L"--log-keep") {
+            if (i + 1 >= argc) {
+                throw std::runtime_error("--log-keep requires a value");
+            }
+            int value = 0;
+            if (!ParseInt(argv[++i], value) || value < 0) {
+                throw std::runtime_error("--log-keep must be a non-negative integer");
+            }
+            opts.logKeep = value;
+        } else if (arg == L"--log-no-compress") {
+            opts.logNoCompress = true;
+        } else if (arg == L"--trace") {
+            if (i + 1 >= argc) {
+                throw std::runtime_error("--trace requires a path");
+            }
+            opts.tracePath = std::filesystem::path(argv[++i]);
+        } else if (arg == L"--capture-trace") {
+            if (i + 1 >= argc) {
+                throw std::runtime_error("--capture-trace requires a path");
+            }
+            opts.captureTracePath = std::filesystem::path(argv[++i]);
+        } else if (arg == L"--events") {
+            if (i + 1 >= argc) {
+                throw std::runtime_error("--events requires a path");
+            }
+            opts.eventsPath = std::filesystem::path(argv[++i]);
+        } else if (arg == L"--metrics-file") {
+            if (i + 1 >= argc) {
+                throw std::runtime_error("--metrics-file requires a path");
+            }
+            opts.metricsFile = std::filesystem::path(argv[++i]);
+        } else if (arg == L"--metrics-port") {
+            if (i + 1 >= argc) {
+                throw std::runtime_error("--metrics-port requires a value");
+            }
+            int value = 0;
+            if (!ParseInt(argv[++i], value) || value <= 0 || value > 65535) {
+                throw std::runtime_error("--metrics-port must be between 1 and 65535");
+            }
+            opts.metricsPort = value;
+        } else if (arg == L"--stats-shm") {
+            opts.statsShm = true;
+        } else if (arg == L"--stats-name") {
+            if (i + 1 >= argc) {
+                throw std::runtime_error("--stats-name requires a value");
+            }
+            const std::wstring value = argv[++i];
+            opts.statsName = std::string(value.begin(), value.end());
+            opts.statsShm = true;
+        } else if (arg == L"--control") {
+            if (i + 1 >= argc) {
+                throw std::runtime_error("--control requires a pipe name");
+            }
+            const std::wstring value = argv[++i];
+            if (value.empty() || value.find(L'\\') != std::wstring::npos ||
+                std::any_of(value.begin(), value.end(), [](wchar_t ch) { return ch > 0x7f; })) {
+                throw std::runtime_error("--control expects an ASCII pipe name without backslashes");
+            }
+            opts.controlName = std::string(value.begin(), value.end());
+        } else if (arg == L"--control-wait") {
+            opts.controlWait = true;
         } else if (arg == L"--quiet") {
             opts.quiet = true;
+        } else if (arg == L"--compress-mp3") {
+            opts.compressMp3 = true;
+        } else if (arg == L"--compress-delete-wav") {
+            opts.compressDeleteWav = true;
+        } else if (arg == L"--compress-threads") {
+            if (i + 1 >= argc) {
+                throw std::runtime_error("--compress-threads requires a value");
+            }
+            int value = 0;
+            if (!ParseInt(argv[++i], value) || value <= 0 || value > 16) {
+                throw std::runtime_error("--compress-threads must be between 1 and 16");
+            }
+            opts.compressThreads = value;
+        } else if (arg == L"--no-disk-guard") {
+            opts.noDiskGuard = true;
+        } else if (arg == L"--disk-reserve-mb") {
+            if (i + 1 >= argc) {
+                throw std::runtime_error("--disk-reserve-mb requires a value");
+            }
+            uint64_t value = 0;
+            if (!ParseUint64(argv[++i], value)) {
+                throw std::runtime_error("--disk-reserve-mb must be a non-negative integer");
+            }
+            opts.diskReserveMb = value;
+        } else if (arg == L"--fallback-bitrate") {
+            if (i + 1 >= argc) {
+                throw std::runtime_error("--fallback-bitrate requires a value");
+            }
+            int value = 0;
+            if (!ParseInt(argv[++i], value) || value < 32 || value > 320) {
+                throw std::runtime_error("--fallback-bitrate must be between 32 and 320 kbps");
+            }
+            opts.fallbackBitrateKbps = value;
+        } else if (arg == L"--fallback-dir") {
+            if (i + 1 >= argc) {
+                throw std::runtime_error("--fallback-dir requires a path");
+            }
+            opts.fallbackDir = std::filesystem::path(argv[++i]);
+        } else if (arg == L"--segment-align") {
+            opts.segmentAlign = true;
+        } else if (arg == L"--no-manifest") {
+            opts.noManifest = true;
+        } else if (arg == L"--no-index") {
+            opts.noIndex = true;
         } else if (arg == L"--mp3") {
             opts.convertToMp3 = true;
         } else if (arg == L"--mp3-bitrate") {
@@ -204,6 +463,35 @@ CommandLineOptions ParseArgs(int argc, wchar_t** argv) {
                 throw std::runtime_error("--mp3-bitrate must be between 32 and 320 kbps");
             }
             opts.mp3BitrateKbps = value;
+        } else if (arg == L"--mp3-ladder") {
+            if (i + 1 >= argc) {
+                throw std::runtime_error("--mp3-ladder requires a comma-separated list of bitrates");
+            }
+            const std::wstring list = argv[++i];
+            opts.mp3LadderKbps.clear();
+            size_t start = 0;
+            while (start <= list.size()) {
+                const size_t end = std::min(list.find(L',', start), list.size());
+                int value = 0;
+                if (!ParseInt(list.substr(start, end - start), value) || value < 64 || value > 320) {
+                    throw std::runtime_error("--mp3-ladder bitrates must be between 64 and 320 kbps");
+                }
+                const auto kbps = static_cast<uint32_t>(value);
+                if (std::find(opts.mp3LadderKbps.begin(), opts.mp3LadderKbps.end(), kbps) != opts.mp3LadderKbps.end()) {
+                    throw std::runtime_error("--mp3-ladder lists a bitrate twice");
+                }
+                opts.mp3LadderKbps.push_back(kbps);
+                start = end + 1;
+            }
+        } else if (arg == L"--gain-db") {
+            if (i + 1 >= argc) {
+                throw std::runtime_error("--gain-db requires a value");
+            }
+            double value = 0.0;
+            if (!ParseDouble(argv[++i], value) || !(value >= -60.0 && value <= 24.0)) {
+                throw std::runtime_error("--gain-db must be between -60 and 24");
+            }
+            opts.gainDb = value;
         } else {
             throw std::runtime_error("Unknown argument: " + std::string(arg.begin(), arg.end()));
         }
@@ -211,6 +499,342 @@ CommandLineOptions ParseArgs(int argc, wchar_t** argv) {
     return opts;
 }
 
+int RunVerify(int argc, wchar_t** argv, Logger& logger) {
+    std::optional<std::filesystem::path> manifestPath;
+    unsigned threads = 0;
+    for (int i = 2; i < argc; ++i) {
+        std::wstring arg = argv[i];
+        if (arg == L"--threads") {
+            if (i + 1 >= argc) {
+                throw std::runtime_error("--threads requires a value");
+            }
+            int value = 0;
+            if (!ParseInt(argv[++i], value) || value <= 0) {
+                throw std::runtime_error("--threads must be a positive integer");
+            }
+            threads = static_cast<unsigned>(value);
+        } else if (!manifestPath) {
+            manifestPath = std::filesystem::path(arg);
+        } else {
+            throw std::runtime_error("Unknown argument: " + std::string(arg.begin(), arg.end()));
+        }
+    }
+    if (!manifestPath) {
+        throw std::runtime_error("verify requires a manifest path");
+    }
+    const auto started = std::chrono::steady_clock::now();
+    const ManifestVerifyResult result = VerifySegmentManifest(*manifestPath, threads, logger);
+    const auto elapsedMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - started).count();
+    logger.Flush();
+    std::wcout << L"Verified " << result.checked << L" segments in " << elapsedMs << L" ms: "
+               << result.passed << L" ok, " << result.missing << L" missing, "
+               << result.sizeMismatches << L" size mismatches, "
+               << result.checksumMismatches << L" checksum mismatches." << std::endl;
+    return result.Ok() ? 0 : 2;
+}
+
+std::chrono::system_clock::time_point ParseTimeArgument(const std::wstring& text, const char* name) {
+    const auto parsed = ParseTimestamp(std::string(text.begin(), text.end()));
+    if (!parsed) {
+        throw std::runtime_error(std::string(name) + " must look like 2026-10-13T14:03:22 (append Z for UTC)");
+    }
+    return *parsed;
+}
+
+int RunLocate(int argc, wchar_t** argv) {
+    if (argc != 4) {
+        throw std::runtime_error("locate requires an index path and a time");
+    }
+    const auto time = ParseTimeArgument(argv[3], "<time>");
+    const auto started = std::chrono::steady_clock::now();
+    const ArchiveIndex index = ArchiveIndex::Load(std::filesystem::path(argv[2]));
+    const auto loaded = std::chrono::steady_clock::now();
+    const auto location = index.Find(time);
+    const auto lookupUs = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - loaded).count();
+    const auto loadMs = std::chrono::duration_cast<std::chrono::milliseconds>(loaded - started).count();
+    if (!location) {
+        std::wcout << L"No recording covers " << ToWide(FormatTimestampUtc(time)) << L" ("
+                   << index.Size() << L" segments indexed)." << std::endl;
+        return 1;
+    }
+    const auto& record = location->record;
+    std::wcout << ToWide(FormatTimestampUtc(time)) << L" -> " << location->file.wstring()
+               << L" @ frame " << location->frameOffset << L" ("
+               << std::fixed << std::setprecision(3)
+               << static_cast<double>(location->frameOffset) / record.sampleRate << L" s)" << std::endl;
+    std::wcout << L"Segment: " << record.frameCount << L" frames @ " << record.sampleRate << L" Hz, gaps "
+               << record.gaps << L", dropped frames " << record.droppedFrames << std::endl;
+    std::wcout << L"Index: " << index.Size() << L" segments, loaded in " << loadMs << L" ms, lookup "
+               << lookupUs << L" us." << std::endl;
+    return 0;
+}
+
+int RunExtract(int argc, wchar_t** argv, Logger& logger) {
+    std::optional<std::filesystem::path> indexPath;
+    std::optional<std::chrono::system_clock::time_point> from;
+    std::optional<std::chrono::system_clock::time_point> to;
+    std::optional<std::filesystem::path> outputPath;
+    for (int i = 2; i < argc; ++i) {
+        std::wstring arg = argv[i];
+        if (arg == L"--from" || arg == L"--to" || arg == L"--out") {
+            if (i + 1 >= argc) {
+                throw std::runtime_error(std::string(arg.begin(), arg.end()) + " requires a value");
+            }
+            const std::wstring value = argv[++i];
+            if (arg == L"--from") {
+                from = ParseTimeArgument(value, "--from");
+            } else if (arg == L"--to") {
+                to = ParseTimeArgument(value, "--to");
+            } else {
+                outputPath = std::filesystem::path(value);
+            }
+        } else if (!indexPath) {
+            indexPath = std::filesystem::path(arg);
+        } else {
+            throw std::runtime_error("Unknown argument: " + std::string(arg.begin(), arg.end()));
+        }
+    }
+    if (!indexPath || !from || !to || !outputPath) {
+        throw std::runtime_error("extract requires <index> --from <time> --to <time> --out <file.wav>");
+    }
+    const ArchiveIndex index = ArchiveIndex::Load(*indexPath);
+    const ArchiveExtractResult result = ExtractArchiveRange(index, *from, *to, *outputPath, logger);
+    logger.Flush();
+    std::wcout << L"Extracted " << result.framesWritten << L" frames from " << result.segmentsUsed
+               << L" segments (" << result.silenceFrames << L" frames of silence) to "
+               << outputPath->wstring() << std::endl;
+    return 0;
+}
+
+int RunStats(int argc, wchar_t** argv) {
+    std::string name = DefaultSharedStatsName();
+    std::optional<int> watchMs;
+    for (int i = 2; i < argc; ++i) {
+        const std::wstring arg = argv[i];
+        if (arg == L"--stats-name" && i + 1 < argc) {
+            const std::wstring value = argv[++i];
+            name = std::string(value.begin(), value.end());
+        } else if (arg == L"--watch" && i + 1 < argc) {
+            int value = 0;
+            if (!ParseInt(argv[++i], value) || value <= 0) {
+                throw std::runtime_error("--watch must be a positive number of milliseconds");
+            }
+            watchMs = value;
+        } else {
+            throw std::runtime_error("Unknown argument: " + std::string(arg.begin(), arg.end()));
+        }
+    }
+
+    const SharedStatsReader reader(name);
+    while (true) {
+        const auto snapshot = reader.Read();
+        if (!snapshot) {
+            std::wcout << L"Stats block busy; retrying." << std::endl;
+        } else {
+            const auto nowMicros = std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::system_clock::now().time_since_epoch()).count();
+            const double ageMs = static_cast<double>(nowMicros - static_cast<int64_t>(snapshot->updateUnixMicros)) / 1000.0;
+            const double ringPercent = snapshot->ringCapacityBytes
+                ? 100.0 * static_cast<double>(snapshot->ringBytes) / static_cast<double>(snapshot->ringCapacityBytes)
+                : 0.0;
+            std::wcout << std::fixed << std::setprecision(1)
+                       << L"pid " << snapshot->processId << L" " << SharedRecorderStateName(snapshot->state)
+                       << L" (updated " << ageMs << L" ms ago): frames " << snapshot->framesCaptured
+                       << L", dropped " << snapshot->droppedFrames << L", glitches " << snapshot->glitches
+                       << L", ring " << ringPercent << L"%, segment #" << snapshot->segmentNumber << L", peak/rms dBFS";
+            const uint32_t channels = std::min<uint32_t>(snapshot->channels, static_cast<uint32_t>(kSharedStatsMaxChannels));
+            for (uint32_t channel = 0; channel < channels; ++channel) {
+                std::wcout << L" " << snapshot->peakDbfs[channel] << L"/" << snapshot->rmsDbfs[channel];
+            }
+            std::wcout << std::endl;
+        }
+        if (!watchMs) {
+            return snapshot ? 0 : 1;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(*watchMs));
+    }
+}
+
+void ConfigureFileLogging(const CommandLineOptions& options, Logger& logger) {
+    if (options.logFile) {
+        LogRotationPolicy rotation;
+        if (options.logMaxMb) {
+            rotation.maxBytes = *options.logMaxMb > 0
+                ? std::optional<uint64_t>(static_cast<uint64_t>(*options.logMaxMb) * 1024 * 1024)
+                : std::nullopt;
+        }
+        if (options.logRotateHours) {
+            rotation.maxAge = std::chrono::hours(*options.logRotateHours);
+        }
+        if (options.logKeep) {
+            rotation.keepFiles = static_cast<size_t>(*options.logKeep);
+        }
+        rotation.compress = !options.logNoCompress;
+        logger.EnableFileLogging(*options.logFile, rotation);
+        logger.Info(L"File logging enabled: " + options.logFile->wstring());
+    }
+}
+
+RecorderConfig BuildRecorderConfig(const CommandLineOptions& options, Logger& logger) {
+    RecorderConfig config;
+    config.outputPath = options.outputPath.value_or(DefaultOutputPath());
+    if (options.convertToMp3) {
+        config.outputPath = EnsureExtension(config.outputPath, L".mp3");
+    } else if (config.outputPath.extension().empty()) {
+        config.outputPath = EnsureExtension(config.outputPath, L".mp3");
+    }
+    if (options.mp3BitrateKbps) {
+        config.mp3BitrateKbps = static_cast<uint32_t>(*options.mp3BitrateKbps);
+    }
+    const bool mp3Output = ToLower(config.outputPath.extension().wstring()) == L".mp3";
+    if (options.compressMp3) {
+        if (mp3Output) {
+            logger.Warn(L"--compress-mp3 is ignored when output is already MP3.");
+        } else {
+            CompressionOptions compression;
+            compression.deleteSource = options.compressDeleteWav;
+            compression.threads = static_cast<unsigned>(options.compressThreads.value_or(1));
+            config.compression = compression;
+        }
+    } else if (options.compressDeleteWav || options.compressThreads) {
+        throw std::runtime_error("--compress-delete-wav/--compress-threads require --compress-mp3");
+    }
+    if (options.mp3BitrateKbps && !mp3Output && !config.compression) {
+        logger.Warn(L"--mp3-bitrate is ignored when output is not MP3.");
+    }
+    if (!options.mp3LadderKbps.empty()) {
+        if (mp3Output || config.compression) {
+            config.mp3LadderKbps = options.mp3LadderKbps;
+        } else {
+            logger.Warn(L"--mp3-ladder is ignored when output is not MP3 and --compress-mp3 is not set.");
+        }
+    }
+    config.enableMicMix = options.mixMic; // currently placeholder
+    if (options.gainDb) {
+        config.gainDb = *options.gainDb;
+    }
+    if (options.seconds) {
+        config.maxDuration = std::chrono::seconds(*options.seconds);
+    }
+    if (options.latencyMs) {
+        config.latencyHint = std::chrono::milliseconds(*options.latencyMs);
+    }
+    if (options.watchdogMs) {
+        config.watchdogTimeout = std::chrono::milliseconds(*options.watchdogMs);
+    }
+    config.failOnGlitch = options.failOnGlitch;
+    if (options.bufferMs) {
+        config.ringBufferSize = std::chrono::milliseconds(*options.bufferMs);
+    }
+    config.quietStatusUpdates = options.quiet;
+    config.writeManifest = !options.noManifest;
+    config.writeIndex = !options.noIndex;
+    config.tracePath = options.tracePath;
+    config.captureTracePath = options.captureTracePath;
+    if (options.noDiskGuard) {
+        config.diskGuard.reset();
+    } else {
+        if (options.diskReserveMb) {
+            config.diskGuard->reserveBytes = *options.diskReserveMb * 1024 * 1024;
+        }
+        if (options.fallbackBitrateKbps) {
+            config.diskGuard->fallbackBitrateKbps = static_cast<uint32_t>(*options.fallbackBitrateKbps);
+        }
+        config.diskGuard->fallbackDirectory = options.fallbackDir;
+    }
+    if (options.retainBytes) {
+        config.retention.maxBytes = options.retainBytes;
+    }
+    if (options.retainHours) {
+        config.retention.maxAge = std::chrono::hours(*options.retainHours);
+    }
+    if (options.retainSegments) {
+        config.retention.maxSegments = static_cast<uint32_t>(*options.retainSegments);
+    }
+    if (options.segmentSeconds) {
+        config.segmentDuration = std::chrono::seconds(*options.segmentSeconds);
+    }
+    if (options.segmentBytes) {
+        config.segmentBytes = options.segmentBytes;
+    }
+    if (options.segmentAlign) {
+        if (!config.segmentDuration) {
+            throw std::runtime_error("--segment-align requires --segment-seconds");
+        }
+        config.alignSegments = true;
+    }
+    if (config.retention.Enabled() && !config.segmentDuration && !config.segmentBytes) {
+        logger.Warn(L"--retain-* only removes closed segments; combine it with --segment-seconds or --segment-bytes.");
+    }
+    return config;
+}
+
+// Exporters and endpoints shared by the interactive recorder and the daemon. Declared in
+// destruction order: the control server goes before the queue it feeds.
+struct RecorderServices {
+    RecorderMetrics metrics;
+    std::unique_ptr<MetricsExporter> metricsExporter;
+    std::unique_ptr<EventLogWriter> events;
+    std::unique_ptr<SharedStatsPublisher> sharedStats;
+    ControlCommandQueue controlQueue;
+    std::unique_ptr<ControlServer> controlServer;
+};
+
+void StartRecorderServices(const CommandLineOptions& options, std::function<bool()> onControlStart,
+                           RecorderServices& services, RecorderControls& controls, Logger& logger) {
+    MetricsExporterOptions metricsOptions;
+    metricsOptions.textfilePath = options.metricsFile;
+    if (options.metricsPort) {
+        metricsOptions.httpPort = static_cast<uint16_t>(*options.metricsPort);
+    }
+    services.metricsExporter = std::make_unique<MetricsExporter>(services.metrics, std::move(metricsOptions), logger);
+    services.metricsExporter->Start();
+    controls.metrics = &services.metrics;
+
+    if (options.eventsPath) {
+        services.events = std::make_unique<EventLogWriter>(*options.eventsPath);
+        controls.events = services.events.get();
+        logger.Info(L"Binary event log: " + options.eventsPath->wstring());
+    }
+
+    if (options.controlName) {
+        ControlServerOptions controlOptions;
+        controlOptions.name = *options.controlName;
+        controlOptions.onStart = std::move(onControlStart);
+        services.controlServer = std::make_unique<ControlServer>(services.controlQueue, std::move(controlOptions), logger);
+        services.controlServer->Start();
+        controls.commands = &services.controlQueue;
+        controls.shouldStop = [previous = controls.shouldStop, &controlQueue = services.controlQueue]() {
+            return (previous && previous()) || controlQueue.StopRequested();
+        };
+    }
+
+    if (options.statsShm) {
+        const std::string statsName = options.statsName.value_or(DefaultSharedStatsName());
+        try {
+            services.sharedStats = std::make_unique<SharedStatsPublisher>(statsName);
+            controls.sharedStats = services.sharedStats.get();
+            logger.Info(L"Live stats published in shared memory: " + std::wstring(statsName.begin(), statsName.end()));
+        } catch (const std::exception&) {
+            logger.Warn(L"Unable to create the shared-memory stats block; continuing without it.");
+        }
+    }
+}
+
+void StopRecorderServices(RecorderServices& services, Logger& logger) {
+    if (services.controlServer) {
+        services.controlServer->Stop();
+    }
+    if (services.events) {
+        services.events->Flush();
+        if (const uint64_t droppedEvents = services.events->DroppedEvents()) {
+            logger.Warn(L"Event log queue overflowed; " + std::to_wstring(droppedEvents) + L" events were dropped.");
+        }
+    }
+}
+
 class ComGuard {
 public:
     ComGuard() {
@@ -223,21 +847,93 @@ public:
         CoUninitialize();
     }
 };
+
+int RunDaemon(int argc, wchar_t** argv, Logger& logger) {
+    if (argc < 3) {
+        throw std::runtime_error("daemon requires a schedule file");
+    }
+    // Recording options follow the schedule path, which stands in for the program name here.
+    const CommandLineOptions options = ParseArgs(argc - 2, argv + 2);
+    if (options.showHelp) {
+        PrintUsage();
+        return 0;
+    }
+    if (options.outputPath || options.seconds || options.listDevices || options.controlWait) {
+        throw std::runtime_error("--out, --seconds, --list-devices and --control-wait do not apply to daemon mode");
+    }
+    ConfigureFileLogging(options, logger);
+    const std::filesystem::path schedulePath(argv[2]);
+    RecordingSchedule schedule = RecordingSchedule::Load(schedulePath);
+    logger.Info(L"Loopback Recorder daemon starting with schedule " + schedulePath.wstring() + L".");
+
+    ComGuard com;
+    RecorderDaemonOptions daemonOptions;
+    daemonOptions.baseConfig = BuildRecorderConfig(options, logger);
+    daemonOptions.makeSource = [deviceIndex = options.deviceIndex, latencyHint = daemonOptions.baseConfig.latencyHint,
+                                &logger](const ScheduleEntry& entry) -> std::unique_ptr<IAudioSource> {
+        DeviceEnumerator enumerator;
+        const auto index = entry.deviceIndex ? entry.deviceIndex : deviceIndex;
+        auto device = index ? enumerator.GetDeviceByIndex(*index) : enumerator.GetDefaultRenderDevice();
+        if (!device) {
+            throw std::runtime_error("Unable to acquire playback device");
+        }
+        logger.Info(L"Selected playback device: " + DeviceEnumerator::GetFriendlyName(device.Get()));
+        return std::make_unique<WasapiLoopbackSource>(device, latencyHint, logger);
+    };
+
+    std::atomic<bool> stopRequested = false;
+    RecorderControls controls;
+    RecorderServices services;
+    StartRecorderServices(options, nullptr, services, controls, logger);
+
+    logger.Flush();
+    std::wcout << L"Daemon running. Press ENTER" << (options.controlName ? L" or send 'stop' to the control endpoint" : L"")
+               << L" to exit." << std::endl;
+    std::thread inputThread([&stopRequested]() {
+        // Without a console (service, nohup) stdin is at EOF; only an actual line stops the daemon.
+        std::wstring line;
+        if (std::getline(std::wcin, line)) {
+            stopRequested = true;
+        }
+    });
+    inputThread.detach();
+
+    RecorderDaemon daemon(std::move(schedule), std::move(daemonOptions), logger);
+    daemon.Run([&stopRequested]() { return stopRequested.load(); }, controls);
+    stopRequested = true;
+    StopRecorderServices(services, logger);
+    logger.Flush();
+    std::wcout << L"Daemon stopped: " << daemon.SessionsRecorded() << L" sessions recorded, "
+               << daemon.SessionsSkipped() << L" skipped." << std::endl;
+    return 0;
+}
 }
 
 int wmain(int argc, wchar_t** argv) {
     Logger logger;
     try {
+        if (argc >= 2 && std::wstring(argv[1]) == L"verify") {
+            return RunVerify(argc, argv, logger);
+        }
+        if (argc >= 2 && std::wstring(argv[1]) == L"locate") {
+            return RunLocate(argc, argv);
+        }
+        if (argc >= 2 && std::wstring(argv[1]) == L"extract") {
+            return RunExtract(argc, argv, logger);
+        }
+        if (argc >= 2 && std::wstring(argv[1]) == L"stats") {
+            return RunStats(argc, argv);
+        }
+        if (argc >= 2 && std::wstring(argv[1]) == L"daemon") {
+            return RunDaemon(argc, argv, logger);
+        }
         CommandLineOptions options = ParseArgs(argc, argv);
         if (options.showHelp) {
             PrintUsage();
             return 0;
         }
 
-        if (options.logFile) {
-            logger.EnableFileLogging(*options.logFile);
-            logger.Info(L"File logging enabled: " + options.logFile->wstring());
-        }
+        ConfigureFileLogging(options, logger);
         logger.Info(L"Loopback Recorder starting.");
 
         ComGuard com;
@@ -246,6 +942,7 @@ int wmain(int argc, wchar_t** argv) {
         if (options.listDevices) {
             logger.Info(L"Listing playback devices...");
             auto devices = enumerator.ListRenderDevices();
+            logger.Flush();
             std::wcout << L"Playback devices:" << std::endl;
             for (size_t i = 0; i < devices.size(); ++i) {
                 std::wcout << L"  [" << i << L"] " << devices[i].name;
@@ -257,40 +954,7 @@ int wmain(int argc, wchar_t** argv) {
             return 0;
         }
 
-        RecorderConfig config;
-        config.outputPath = options.outputPath.value_or(DefaultOutputPath());
-        if (options.convertToMp3) {
-            config.outputPath = EnsureExtension(config.outputPath, L".mp3");
-        } else if (config.outputPath.extension().empty()) {
-            config.outputPath = EnsureExtension(config.outputPath, L".mp3");
-        }
-        if (options.mp3BitrateKbps) {
-            config.mp3BitrateKbps = static_cast<uint32_t>(*options.mp3BitrateKbps);
-        }
-        if (options.mp3BitrateKbps && ToLower(config.outputPath.extension().wstring()) != L".mp3") {
-            logger.Warn(L"--mp3-bitrate is ignored when output is not MP3.");
-        }
-        config.enableMicMix = options.mixMic; // currently placeholder
-        if (options.seconds) {
-            config.maxDuration = std::chrono::seconds(*options.seconds);
-        }
-        if (options.latencyMs) {
-            config.latencyHint = std::chrono::milliseconds(*options.latencyMs);
-        }
-        if (options.watchdogMs) {
-            config.watchdogTimeout = std::chrono::milliseconds(*options.watchdogMs);
-        }
-        config.failOnGlitch = options.failOnGlitch;
-        if (options.bufferMs) {
-            config.ringBufferSize = std::chrono::milliseconds(*options.bufferMs);
-        }
-        config.quietStatusUpdates = options.quiet;
-        if (options.segmentSeconds) {
-            config.segmentDuration = std::chrono::seconds(*options.segmentSeconds);
-        }
-        if (options.segmentBytes) {
-            config.segmentBytes = options.segmentBytes;
-        }
+        RecorderConfig config = BuildRecorderConfig(options, logger);
         std::atomic<bool> stopRequested = false;
         std::atomic<bool> pauseRequested = false;
         std::atomic<bool> segmentRequested = false;
@@ -300,6 +964,7 @@ int wmain(int argc, wchar_t** argv) {
         constexpr int kReconnectDelayMs = 1500;
         int reconnectAttempts = 0;
 
+        logger.Flush();
         if (config.maxDuration) {
             std::wcout << L"Target duration: " << config.maxDuration->count() << L" seconds" << std::endl;
         }
@@ -346,13 +1011,32 @@ int wmain(int argc, wchar_t** argv) {
             return segmentRequested.compare_exchange_strong(expected, false);
         };
 
+        if (options.controlWait && !options.controlName) {
+            throw std::runtime_error("--control-wait requires --control");
+        }
+        std::atomic<bool> controlStartRequested = false;
+        RecorderServices services;
+        StartRecorderServices(options, [&controlStartRequested]() {
+            return !controlStartRequested.exchange(true);
+        }, services, controls, logger);
+        ControlCommandQueue& controlQueue = services.controlQueue;
+        const std::unique_ptr<EventLogWriter>& events = services.events;
+
         auto ensureParentDirectory = [](const std::filesystem::path& path) {
             if (path.has_parent_path() && !path.parent_path().empty()) {
                 std::filesystem::create_directories(path.parent_path());
             }
         };
 
-        while (true) {
+        if (options.controlWait) {
+            logger.Info(L"Waiting for a 'start' command on " + ToWide(services.controlServer->Endpoint()) + L".");
+            logger.Flush();
+            while (!controlStartRequested.load() && !stopRequested.load() && !controlQueue.StopRequested()) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            }
+        }
+
+        while (!stopRequested.load() && !controlQueue.StopRequested()) {
             DeviceEnumerator attemptEnumerator;
             Microsoft::WRL::ComPtr<IMMDevice> device;
             if (options.deviceIndex) {
@@ -370,6 +1054,7 @@ int wmain(int argc, wchar_t** argv) {
             ensureParentDirectory(config.outputPath);
             logger.Info(L"Output file: " + config.outputPath.wstring());
 
+            logger.Flush();
             std::wcout << L"Recording system audio to " << config.outputPath.wstring() << std::endl;
             if (reconnectAttempts > 0) {
                 std::wcout << L"[Reconnect] Attempt " << reconnectAttempts << L"/" << kMaxReconnectAttempts << std::endl;
@@ -378,7 +1063,8 @@ int wmain(int argc, wchar_t** argv) {
             LoopbackRecorder recorder(device, logger);
             RecorderStats stats = recorder.Record(config, controls);
 
-            const bool userRequestedStop = stopRequested.load();
+            const bool userRequestedStop = stopRequested.load() || controlQueue.StopRequested();
+            logger.Flush();
             std::wcout << L"Recording finished." << std::endl;
             std::wcout << L"Captured frames: " << stats.framesCaptured
                        << L", silent frames: " << stats.silentFrames
@@ -403,6 +1089,9 @@ int wmain(int argc, wchar_t** argv) {
                     break;
                 }
                 ++reconnectAttempts;
+                if (events) {
+                    events->Reconnect(static_cast<uint32_t>(reconnectAttempts), static_cast<uint32_t>(kReconnectDelayMs));
+                }
                 logger.Warn(L"Playback device disconnected; retrying in " +
                             std::to_wstring(kReconnectDelayMs) + L" ms (attempt " +
                             std::to_wstring(reconnectAttempts) + L"/" + std::to_wstring(kMaxReconnectAttempts) + L").");
@@ -413,10 +1102,12 @@ int wmain(int argc, wchar_t** argv) {
             break;
         }
         stopRequested = true;
+        StopRecorderServices(services, logger);
         return 0;
     } catch (const std::exception& ex) {
         std::string message = ex.what();
         logger.Error(L"Fatal error: " + ToWide(message));
+        logger.Flush();
         std::cerr << "Error: " << message << std::endl;
         return 1;
     }
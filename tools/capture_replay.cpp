@@ -0,0 +1,255 @@
+// Replays a capture timing trace (loopback_recorder --capture-trace) through the recording
+// pipeline, so a field machine's wakeups, bursts, watchdog timeouts and device errors can be
+// reproduced and profiled on a bench machine without its audio device.
+//
+//   capture_replay <trace> --summary          what the trace contains, no replay
+//   capture_replay <trace> [--virtual] ...    replays every recorded session
+//
+// In real time each source call returns no earlier than it did when recorded, so the writer
+// faces the same pressure; --virtual replays the same call sequence as fast as possible. The
+// pipeline runs with the recorder's defaults unless overridden; --trace adds a Chrome trace
+// of the replay for profiling.
+
+#include "CapturePipeline.h"
+#include "CaptureTrace.h"
+#include "Logger.h"
+#include "TraceReplaySource.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <optional>
+#include <string>
+
+namespace {
+
+struct ReplayOptions {
+    std::filesystem::path tracePath;
+    bool summary = false;
+    bool virtualClock = false;
+    std::filesystem::path outPath = std::filesystem::temp_directory_path() / "capture_replay" / "replay.wav";
+    std::optional<int> ringMs;
+    std::optional<int> watchdogMs;
+    std::optional<int> segmentSeconds;
+    bool failOnGlitch = false;
+    std::optional<std::filesystem::path> chromeTrace;
+    std::optional<std::filesystem::path> logFile;
+};
+
+void PrintUsage() {
+    std::printf("Usage: capture_replay <trace> --summary\n"
+                "       capture_replay <trace> [--virtual] [--out path.wav|.mp3] [--ring-ms N] [--watchdog-ms N]\n"
+                "                      [--segment-seconds N] [--fail-on-glitch] [--trace path.json] [--log path]\n");
+}
+
+bool ParseArgs(int argc, char** argv, ReplayOptions& options) {
+    bool haveTrace = false;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        const bool hasValue = i + 1 < argc;
+        if (arg == "--summary") {
+            options.summary = true;
+        } else if (arg == "--virtual") {
+            options.virtualClock = true;
+        } else if (arg == "--fail-on-glitch") {
+            options.failOnGlitch = true;
+        } else if (arg == "--out" && hasValue) {
+            options.outPath = std::filesystem::path(argv[++i]);
+        } else if (arg == "--ring-ms" && hasValue) {
+            options.ringMs = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--watchdog-ms" && hasValue) {
+            options.watchdogMs = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--segment-seconds" && hasValue) {
+            options.segmentSeconds = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--trace" && hasValue) {
+            options.chromeTrace = std::filesystem::path(argv[++i]);
+        } else if (arg == "--log" && hasValue) {
+            options.logFile = std::filesystem::path(argv[++i]);
+        } else if (!haveTrace && !arg.empty() && arg[0] != '-') {
+            options.tracePath = std::filesystem::path(arg);
+            haveTrace = true;
+        } else {
+            return false;
+        }
+    }
+    return haveTrace;
+}
+
+const char* WaitResultName(uint8_t result) {
+    switch (static_cast<SourceWaitResult>(result)) {
+    case SourceWaitResult::PacketsReady: return "ready";
+    case SourceWaitResult::Timeout: return "timeout";
+    case SourceWaitResult::Interrupted: return "interrupted";
+    case SourceWaitResult::Failed: return "failed";
+    }
+    return "unknown";
+}
+
+void PrintSummary(const CaptureTrace& trace) {
+    const AudioFormat& format = trace.Format();
+    std::printf("format: %u Hz, %u channels, %u-bit %s (channel mask 0x%x)\n", static_cast<unsigned>(format.sampleRate),
+                static_cast<unsigned>(format.channels), static_cast<unsigned>(format.bitsPerSample),
+                format.floatSamples ? "float" : "PCM", static_cast<unsigned>(format.channelMask));
+    struct Session {
+        uint64_t lastNanos = 0;
+        uint64_t packets = 0;
+        uint64_t frames = 0;
+        uint64_t emptyReads = 0;
+        uint64_t silentPackets = 0;
+        uint64_t discontinuities = 0;
+        uint64_t waits[4] = {};
+        uint64_t longestWaitMicros = 0;
+        uint64_t longestPacketGapNanos = 0;
+        uint64_t lastPacketNanos = 0;
+        uint64_t deviceErrors = 0;
+    };
+    std::optional<Session> session;
+    size_t sessionNumber = 0;
+    auto flush = [&]() {
+        if (!session) {
+            return;
+        }
+        std::printf("session %zu: %.3f s, %llu packets, %llu frames, %llu empty reads, %llu silent, %llu discontinuities\n",
+                    sessionNumber, static_cast<double>(session->lastNanos) / 1e9,
+                    static_cast<unsigned long long>(session->packets), static_cast<unsigned long long>(session->frames),
+                    static_cast<unsigned long long>(session->emptyReads),
+                    static_cast<unsigned long long>(session->silentPackets),
+                    static_cast<unsigned long long>(session->discontinuities));
+        std::printf("  waits:");
+        for (uint8_t result = 0; result < 4; ++result) {
+            std::printf(" %s=%llu", WaitResultName(result), static_cast<unsigned long long>(session->waits[result]));
+        }
+        std::printf(", longest wait %.1f ms, longest gap between packets %.1f ms, device errors %llu\n",
+                    static_cast<double>(session->longestWaitMicros) / 1000.0,
+                    static_cast<double>(session->longestPacketGapNanos) / 1e6,
+                    static_cast<unsigned long long>(session->deviceErrors));
+        session.reset();
+    };
+    for (const auto& record : trace.records) {
+        if (record.kind == CaptureTraceKind::Start) {
+            flush();
+            session.emplace();
+            ++sessionNumber;
+            continue;
+        }
+        if (!session) {
+            continue;
+        }
+        session->lastNanos = record.nanos;
+        if (record.kind == CaptureTraceKind::Wait) {
+            if (record.result < 4) {
+                ++session->waits[record.result];
+            }
+            session->longestWaitMicros = std::max<uint64_t>(session->longestWaitMicros, record.value);
+        } else if (record.kind == CaptureTraceKind::Read) {
+            switch (static_cast<SourceReadResult>(record.result)) {
+            case SourceReadResult::Packet:
+                ++session->packets;
+                session->frames += record.value;
+                session->silentPackets += (record.flags & kCaptureTraceSilent) ? 1 : 0;
+                session->discontinuities += (record.flags & kCaptureTraceDiscontinuity) ? 1 : 0;
+                if (session->lastPacketNanos) {
+                    session->longestPacketGapNanos =
+                        std::max(session->longestPacketGapNanos, record.nanos - session->lastPacketNanos);
+                }
+                session->lastPacketNanos = record.nanos;
+                break;
+            case SourceReadResult::Empty:
+                ++session->emptyReads;
+                break;
+            case SourceReadResult::DeviceLost:
+            case SourceReadResult::Failed:
+                ++session->deviceErrors;
+                break;
+            default:
+                break;
+            }
+        }
+    }
+    flush();
+    std::printf("%zu records in %zu sessions\n", trace.records.size(), sessionNumber);
+}
+
+size_t CountSessions(const CaptureTrace& trace) {
+    return static_cast<size_t>(std::count_if(trace.records.begin(), trace.records.end(),
+                                             [](const CaptureTraceRecord& record) {
+                                                 return record.kind == CaptureTraceKind::Start;
+                                             }));
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    ReplayOptions options;
+    if (!ParseArgs(argc, argv, options)) {
+        PrintUsage();
+        return 1;
+    }
+    try {
+        CaptureTrace trace = CaptureTrace::Load(options.tracePath);
+        if (options.summary) {
+            PrintSummary(trace);
+            return 0;
+        }
+        const size_t sessions = CountSessions(trace);
+
+        Logger logger;
+        logger.SetConsoleOutput(false);
+        if (options.logFile) {
+            logger.EnableFileLogging(*options.logFile);
+        }
+        TraceReplayOptions replayOptions;
+        replayOptions.realTime = !options.virtualClock;
+        TraceReplaySource source(std::move(trace), replayOptions);
+
+        RecorderConfig config;
+        config.quietStatusUpdates = true;
+        config.diskGuard.reset();
+        config.failOnGlitch = options.failOnGlitch;
+        config.tracePath = options.chromeTrace;
+        if (options.ringMs) {
+            config.ringBufferSize = std::chrono::milliseconds(*options.ringMs);
+        }
+        if (options.watchdogMs) {
+            config.watchdogTimeout = std::chrono::milliseconds(*options.watchdogMs);
+        }
+        if (options.segmentSeconds) {
+            config.segmentDuration = std::chrono::seconds(*options.segmentSeconds);
+        }
+        if (options.outPath.has_parent_path()) {
+            std::filesystem::create_directories(options.outPath.parent_path());
+        }
+
+        CapturePipeline pipeline(logger);
+        int exitCode = 0;
+        for (size_t session = 1; session <= sessions; ++session) {
+            config.outputPath = options.outPath;
+            if (sessions > 1) {
+                config.outputPath.replace_filename(options.outPath.stem().string() + "_s" + std::to_string(session) +
+                                                   options.outPath.extension().string());
+            }
+            const auto started = std::chrono::steady_clock::now();
+            const RecorderStats stats = pipeline.Run(source, config);
+            const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+            std::printf("session %zu: replayed %llu frames (%.3f s recorded) in %.3f s; captured=%llu dropped=%llu "
+                        "gaps=%u watchdog=%u ring-timeouts=%u mismatches=%llu -> %s\n",
+                        session, static_cast<unsigned long long>(source.FramesReplayed()),
+                        std::chrono::duration<double>(source.VirtualTime()).count(), elapsed,
+                        static_cast<unsigned long long>(stats.framesCaptured),
+                        static_cast<unsigned long long>(stats.framesDropped), stats.glitchCount, stats.watchdogTimeouts,
+                        stats.ringBufferTimeouts, static_cast<unsigned long long>(source.Mismatches()),
+                        config.outputPath.string().c_str());
+            if (stats.framesCaptured + stats.framesDropped != source.FramesReplayed()) {
+                exitCode = 2;
+            }
+        }
+        logger.Flush();
+        return exitCode;
+    } catch (const std::exception& ex) {
+        std::fprintf(stderr, "capture_replay: %s\n", ex.what());
+        return 1;
+    }
+}
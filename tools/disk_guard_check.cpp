@@ -0,0 +1,249 @@
+// Checks DiskSpaceGuard's time-to-full projection and fallback ladder against an injected
+// free-space probe and a virtual clock.
+//
+//   - escalation: a steady writer fills a simulated volume; the guard must stay quiet while
+//     the projection is beyond the warning horizon, then warn, reduce the MP3 bitrate, move
+//     to the fallback directory and finally report exhaustion, one step per cool-down, each
+//     step that needs a new segment requesting exactly one roll. WAV output (no bitrate to
+//     reduce) goes straight to the fallback directory.
+//   - rate: WAV and MP3 sessions through SegmentedOutput with the guard driven by hand; the
+//     rate behind the projection must match the bytes that reach the disk (the PCM rate for
+//     WAV, the bitrate for MP3), not the PCM handed to the writer.
+// MP3 runs are skipped when LAME cannot be loaded. Exit code 0 when every check passes.
+
+#include "DiskSpaceGuard.h"
+#include "Logger.h"
+#include "Mp3Converter.h"
+#include "SegmentedOutput.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace {
+
+using std::chrono::seconds;
+using Clock = std::chrono::steady_clock;
+
+constexpr uint64_t kMiB = 1024 * 1024;
+
+class Checker {
+public:
+    void Expect(bool condition, const std::string& what) {
+        if (!condition) {
+            failures_.push_back(what);
+        }
+    }
+    bool Report(const char* name) const {
+        std::printf("%s: %s\n", name, failures_.empty() ? "ok" : "FAILED");
+        for (const auto& failure : failures_) {
+            std::printf("  %s\n", failure.c_str());
+        }
+        return failures_.empty();
+    }
+
+private:
+    std::vector<std::string> failures_;
+};
+
+const char* StageName(DiskGuardStage stage) {
+    switch (stage) {
+    case DiskGuardStage::Normal: return "normal";
+    case DiskGuardStage::Warned: return "warned";
+    case DiskGuardStage::ReducedBitrate: return "reduced-bitrate";
+    case DiskGuardStage::Fallback: return "fallback";
+    case DiskGuardStage::Exhausted: return "exhausted";
+    }
+    return "?";
+}
+
+// A volume that a single writer fills at a constant rate, polled on a virtual clock.
+struct SimulatedVolume {
+    std::atomic<uint64_t> written{0};
+    uint64_t freeBytes = 0;
+    std::filesystem::path probed;
+
+    DiskSpaceGuard::FreeSpaceProbe Probe() {
+        return [this](const std::filesystem::path& directory) -> std::optional<uint64_t> {
+            probed = directory;
+            return freeBytes;
+        };
+    }
+    void Write(uint64_t bytes) {
+        written.store(written.load() + bytes);
+        freeBytes = freeBytes > bytes ? freeBytes - bytes : 0;
+    }
+};
+
+// Polls every pollInterval until the stage changes or `limit` elapses; returns the new stage.
+DiskGuardStage RunUntilStageChanges(DiskSpaceGuard& guard, SimulatedVolume& volume, Clock::time_point& now,
+                                    const DiskGuardPolicy& policy, uint64_t bytesPerSecond, seconds limit) {
+    const DiskGuardStage start = guard.Stage();
+    const auto step = std::chrono::duration_cast<seconds>(policy.pollInterval);
+    for (seconds elapsed{0}; elapsed < limit && guard.Stage() == start; elapsed += step) {
+        volume.Write(bytesPerSecond * static_cast<uint64_t>(step.count()));
+        now += step;
+        guard.Evaluate(now);
+    }
+    return guard.Stage();
+}
+
+bool CheckEscalation(const std::filesystem::path& outDir, Logger& logger) {
+    Checker checker;
+    DiskGuardPolicy policy;
+    policy.fallbackDirectory = outDir / "fallback";
+    const uint64_t rate = 4 * kMiB;
+    const auto cooldown = std::chrono::duration_cast<seconds>(policy.pollInterval * 12);
+
+    SimulatedVolume volume;
+    volume.freeBytes = policy.reserveBytes + rate * 2 * 3600;   // two hours at the write rate
+    DiskSpaceGuard guard(policy, outDir, volume.written, true, logger, volume.Probe());
+    Clock::time_point now{};
+    guard.Evaluate(now);
+    RunUntilStageChanges(guard, volume, now, policy, rate, seconds(60));
+    checker.Expect(guard.Stage() == DiskGuardStage::Normal, std::string("two hours left: stage ") + StageName(guard.Stage()));
+    const double projected = static_cast<double>(volume.freeBytes - policy.reserveBytes) / rate;
+    checker.Expect(std::abs(static_cast<double>(guard.TimeToFullSeconds()) - projected) <= projected * 0.01,
+                   "time to full " + std::to_string(guard.TimeToFullSeconds()) + " s, expected " +
+                       std::to_string(static_cast<int64_t>(projected)) + " s");
+
+    RunUntilStageChanges(guard, volume, now, policy, rate, seconds(2 * 3600));
+    checker.Expect(guard.Stage() == DiskGuardStage::Warned, std::string("after warning horizon: stage ") + StageName(guard.Stage()));
+    checker.Expect(guard.TimeToFullSeconds() < policy.warnHorizon.count() &&
+                       guard.TimeToFullSeconds() >= policy.warnHorizon.count() - policy.pollInterval.count() / 1000 - 1,
+                   "warned at " + std::to_string(guard.TimeToFullSeconds()) + " s to full");
+    checker.Expect(!guard.ConsumeRollRequest() && !guard.BitrateOverride(), "a warning must not change the output");
+
+    RunUntilStageChanges(guard, volume, now, policy, rate, seconds(3600));
+    checker.Expect(guard.Stage() == DiskGuardStage::ReducedBitrate, std::string("after action horizon: stage ") + StageName(guard.Stage()));
+    checker.Expect(guard.TimeToFullSeconds() < policy.actHorizon.count(), "bitrate reduced before the action horizon");
+    checker.Expect(guard.BitrateOverride() == policy.fallbackBitrateKbps, "bitrate override is the fallback bitrate");
+    checker.Expect(guard.ConsumeRollRequest() && !guard.ConsumeRollRequest(), "reduced bitrate requests exactly one roll");
+
+    const auto reducedAt = now;
+    RunUntilStageChanges(guard, volume, now, policy, rate, seconds(3600));
+    checker.Expect(guard.Stage() == DiskGuardStage::Fallback, std::string("next step: stage ") + StageName(guard.Stage()));
+    checker.Expect(now - reducedAt >= cooldown, "fallback waited for the cool-down");
+    checker.Expect(guard.FallbackDirectory() == policy.fallbackDirectory, "fallback directory published");
+    checker.Expect(guard.ConsumeRollRequest() && !guard.ConsumeRollRequest(), "fallback requests exactly one roll");
+
+    // The fallback volume is small too: a fresh projection there ends in exhaustion.
+    volume.freeBytes = policy.reserveBytes + rate * 120;
+    const auto fallbackAt = now;
+    RunUntilStageChanges(guard, volume, now, policy, rate, seconds(3600));
+    checker.Expect(volume.probed == *policy.fallbackDirectory, "probe follows the fallback directory");
+    checker.Expect(guard.Stage() == DiskGuardStage::Exhausted, std::string("fallback volume full: stage ") + StageName(guard.Stage()));
+    checker.Expect(now - fallbackAt >= cooldown, "exhaustion waited for the cool-down");
+    checker.Expect(!guard.ConsumeRollRequest(), "exhaustion does not roll");
+
+    // WAV output has no bitrate to reduce; the first step is the fallback directory.
+    SimulatedVolume wavVolume;
+    wavVolume.freeBytes = policy.reserveBytes + rate * 300;
+    DiskSpaceGuard wavGuard(policy, outDir, wavVolume.written, false, logger, wavVolume.Probe());
+    Clock::time_point wavNow{};
+    wavGuard.Evaluate(wavNow);
+    RunUntilStageChanges(wavGuard, wavVolume, wavNow, policy, rate, seconds(600));
+    checker.Expect(wavGuard.Stage() == DiskGuardStage::Fallback, std::string("WAV first step: stage ") + StageName(wavGuard.Stage()));
+    checker.Expect(!wavGuard.BitrateOverride(), "WAV output keeps its format");
+
+    // Below the reserve at the very first poll: act without waiting for a rate.
+    SimulatedVolume fullVolume;
+    fullVolume.freeBytes = policy.reserveBytes / 2;
+    DiskSpaceGuard fullGuard(policy, outDir, fullVolume.written, true, logger, fullVolume.Probe());
+    fullGuard.Evaluate(Clock::time_point{});
+    checker.Expect(fullGuard.Stage() == DiskGuardStage::ReducedBitrate,
+                   std::string("full at start: stage ") + StageName(fullGuard.Stage()));
+    return checker.Report("escalation");
+}
+
+// Records `seconds` of a 16-bit stereo tone through SegmentedOutput and compares the rate the
+// guard projects with `expectedBytesPerSecond`.
+bool CheckRate(const std::filesystem::path& outDir, const char* format, Logger& logger) {
+    const bool mp3 = std::string(format) == "mp3";
+    if (mp3) {
+        try {
+            Mp3Converter::Preload();
+        } catch (const std::exception& ex) {
+            std::printf("rate (%s): skipped: %s\n", format, ex.what());
+            return true;
+        }
+    }
+    Checker checker;
+    AudioFormat audioFormat;
+    audioFormat.sampleRate = 48000;
+    audioFormat.channels = 2;
+    audioFormat.bitsPerSample = 16;
+    const uint32_t kbps = 128;
+    const double expected = mp3 ? kbps * 1000.0 / 8.0 : static_cast<double>(audioFormat.BytesPerSecond());
+    const uint64_t freeBytes = 1024 * 1024 * kMiB;
+
+    SegmentedOutputOptions options;
+    options.basePath = outDir / (std::string("rate.") + format);
+    options.mp3Output = mp3;
+    options.mp3Options.bitrateKbps = kbps;
+    options.writeManifest = false;
+    options.writeIndex = false;
+    options.diskGuard = DiskGuardPolicy{};
+    options.freeSpaceProbe = [freeBytes](const std::filesystem::path&) -> std::optional<uint64_t> { return freeBytes; };
+    options.diskGuardThread = false;
+    SegmentedOutput output(std::move(options), audioFormat, logger);
+    output.Start();
+    DiskSpaceGuard* guard = output.DiskGuard();
+
+    std::vector<int16_t> second(static_cast<size_t>(audioFormat.sampleRate) * audioFormat.channels);
+    for (size_t i = 0; i < second.size(); ++i) {
+        second[i] = static_cast<int16_t>(8000.0 * std::sin(static_cast<double>(i / 2) * 0.0577));
+    }
+    Clock::time_point now{};
+    guard->Evaluate(now);
+    for (int poll = 0; poll < 6; ++poll) {
+        for (int s = 0; s < 10; ++s) {
+            output.Write(reinterpret_cast<const uint8_t*>(second.data()), second.size() * sizeof(int16_t));
+        }
+        now += seconds(10);
+        guard->Evaluate(now);
+    }
+    const double usable = static_cast<double>(freeBytes - DiskGuardPolicy{}.reserveBytes);
+    const double measured = usable / static_cast<double>(guard->TimeToFullSeconds());
+    checker.Expect(std::abs(measured - expected) <= expected * 0.05,
+                   "projected " + std::to_string(static_cast<int64_t>(measured)) + " B/s, expected " +
+                       std::to_string(static_cast<int64_t>(expected)) + " B/s on disk (PCM " +
+                       std::to_string(audioFormat.BytesPerSecond()) + " B/s)");
+    checker.Expect(guard->Stage() == DiskGuardStage::Normal, "an empty volume must not escalate");
+    output.Finish();
+    return checker.Report((std::string("rate (") + format + ")").c_str());
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::filesystem::path outDir = std::filesystem::temp_directory_path() / "disk_guard_check";
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--out-dir" && i + 1 < argc) {
+            outDir = argv[++i];
+        } else {
+            std::printf("Usage: disk_guard_check [--out-dir path]\n");
+            return 1;
+        }
+    }
+    std::error_code ec;
+    std::filesystem::remove_all(outDir, ec);
+    std::filesystem::create_directories(outDir);
+
+    Logger logger;
+    logger.SetConsoleOutput(false);
+    bool passed = CheckEscalation(outDir, logger);
+    passed = CheckRate(outDir, "wav", logger) && passed;
+    passed = CheckRate(outDir, "mp3", logger) && passed;
+    logger.Flush();
+    std::filesystem::remove_all(outDir, ec);
+    std::printf("%s\n", passed ? "all checks passed" : "checks FAILED");
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,24 @@
+// Converts a binary recorder event log (--events) to JSON lines on stdout, one object per
+// record, for jq or a fleet analytics pipeline. Portable; no Windows APIs.
+
+#include "EventLog.h"
+
+#include <cstdio>
+#include <exception>
+#include <iostream>
+
+int main(int argc, char** argv) {
+    if (argc != 2) {
+        std::fprintf(stderr, "Usage: event_log_decode <file.events>\n");
+        return 2;
+    }
+    try {
+        const size_t records = DecodeEventLogToJson(argv[1], std::cout);
+        std::cout.flush();
+        std::fprintf(stderr, "%zu records\n", records);
+        return 0;
+    } catch (const std::exception& ex) {
+        std::fprintf(stderr, "event_log_decode: %s\n", ex.what());
+        return 1;
+    }
+}
@@ -0,0 +1,156 @@
+// Measures the latency a capture-style thread pays per Logger call.
+//
+// One "capture" thread logs a short status line every packet period while optional noise
+// threads log at --noise-rate messages per second each (0: as fast as they can, which
+// saturates the queue); the per-call latency of the capture thread is reported as
+// percentiles over the calls that were enqueued. Console output is disabled so only the
+// enqueue path is measured; pass --file to include the background file writer.
+// Capture-thread drops are reported apart from the total: when any occur the percentiles
+// partly measure the drop path, and the exit code is 1.
+
+#include "Logger.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct BenchOptions {
+    int calls = 20000;
+    int noiseThreads = 2;
+    int noiseRate = 1000;   // messages per second per noise thread; 0 = unthrottled
+    std::chrono::microseconds period{1000};
+    std::optional<std::filesystem::path> logFile;
+};
+
+void PrintUsage() {
+    std::printf("Usage: logger_bench [--calls N] [--noise-threads N] [--noise-rate N] [--period-us N] [--file path]\n");
+}
+
+bool ParseArgs(int argc, char** argv, BenchOptions& options) {
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        const bool hasValue = i + 1 < argc;
+        if (arg == "--calls" && hasValue) {
+            options.calls = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--noise-threads" && hasValue) {
+            options.noiseThreads = std::max(0, std::atoi(argv[++i]));
+        } else if (arg == "--noise-rate" && hasValue) {
+            options.noiseRate = std::max(0, std::atoi(argv[++i]));
+        } else if (arg == "--period-us" && hasValue) {
+            options.period = std::chrono::microseconds(std::max(0, std::atoi(argv[++i])));
+        } else if (arg == "--file" && hasValue) {
+            options.logFile = std::filesystem::path(argv[++i]);
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+uint64_t Percentile(const std::vector<uint64_t>& sorted, double fraction) {
+    if (sorted.empty()) {
+        return 0;
+    }
+    const auto index = static_cast<size_t>(fraction * static_cast<double>(sorted.size() - 1));
+    return sorted[index];
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    BenchOptions options;
+    if (!ParseArgs(argc, argv, options)) {
+        PrintUsage();
+        return 1;
+    }
+
+    std::vector<uint64_t> latencies;
+    latencies.reserve(static_cast<size_t>(options.calls));
+    uint64_t dropped = 0;
+    uint64_t captureDropped = 0;
+    {
+        Logger logger;
+        logger.SetConsoleOutput(false);
+        if (options.logFile) {
+            logger.EnableFileLogging(*options.logFile);
+        }
+
+        std::atomic<bool> running{true};
+        std::vector<std::thread> noise;
+        for (int i = 0; i < options.noiseThreads; ++i) {
+            noise.emplace_back([&logger, &running, &options, i]() {
+                const auto interval = options.noiseRate > 0
+                    ? std::chrono::nanoseconds(1000000000LL / options.noiseRate)
+                    : std::chrono::nanoseconds(0);
+                auto next = std::chrono::steady_clock::now();
+                uint64_t n = 0;
+                while (running.load(std::memory_order_relaxed)) {
+                    logger.Info(L"[noise " + std::to_wstring(i) + L"] message " + std::to_wstring(n++));
+                    if (options.noiseRate > 0) {
+                        next += interval;
+                        std::this_thread::sleep_until(next);
+                    } else {
+                        std::this_thread::yield();
+                    }
+                }
+            });
+        }
+
+        std::thread capture([&]() {
+            const std::wstring message = L"[状态] fps=48000 ring=12% dropped=0 segment=#3";
+            auto next = std::chrono::steady_clock::now();
+            for (int i = 0; i < options.calls; ++i) {
+                const auto start = std::chrono::steady_clock::now();
+                const bool enqueued = logger.Log(LogLevel::Info, message);
+                const auto end = std::chrono::steady_clock::now();
+                if (enqueued) {
+                    latencies.push_back(static_cast<uint64_t>(
+                        std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count()));
+                } else {
+                    ++captureDropped;
+                }
+                next += options.period;
+                std::this_thread::sleep_until(next);
+            }
+        });
+        capture.join();
+        running = false;
+        for (auto& thread : noise) {
+            thread.join();
+        }
+        logger.Flush();
+        dropped = logger.DroppedMessages();
+    }
+
+    std::sort(latencies.begin(), latencies.end());
+    std::printf("calls=%d noise_threads=%d noise_rate=%d/s period_us=%lld file=%s\n", options.calls,
+                options.noiseThreads, options.noiseRate, static_cast<long long>(options.period.count()),
+                options.logFile ? "yes" : "no");
+    if (latencies.empty()) {
+        latencies.push_back(0);
+    }
+    std::printf("capture-thread Logger::Info latency (ns): p50=%llu p90=%llu p99=%llu p99.9=%llu max=%llu\n",
+                static_cast<unsigned long long>(Percentile(latencies, 0.50)),
+                static_cast<unsigned long long>(Percentile(latencies, 0.90)),
+                static_cast<unsigned long long>(Percentile(latencies, 0.99)),
+                static_cast<unsigned long long>(Percentile(latencies, 0.999)),
+                static_cast<unsigned long long>(latencies.back()));
+    std::printf("capture-thread calls dropped: %llu of %d\n", static_cast<unsigned long long>(captureDropped),
+                options.calls);
+    std::printf("dropped messages, all threads (queue full): %llu\n", static_cast<unsigned long long>(dropped));
+    if (captureDropped > 0) {
+        std::printf("WARNING: the queue was full for capture-thread calls; the latencies above cover only the "
+                    "enqueued calls and the load is not realistic. Lower --noise-rate or --noise-threads.\n");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,698 @@
+// Deterministic simulation of the capture/writer threading on a virtual clock.
+//
+// Every run draws a scenario from its seed: device period and jitter, engine stalls that end
+// in a burst, a bounded device buffer, ring size, watchdog, slow and stalling disk writes,
+// control commands (segment, pause, resume, marker, status, stop) and how the session ends.
+// It then records through CapturePipeline::Run on a VirtualScheduler, so every wait, event,
+// sleep and thread start is a scheduling point taken in an order drawn from the same seed.
+// Seconds of audio simulate in milliseconds, and a failing seed replays exactly with
+// --seed N --runs 1. After each run it checks:
+//   - frame accounting: frames read = captured + dropped + paused, and the manifest's drops
+//     and gaps match the session counters and the discontinuities the device flagged
+//   - content: every frame on disk carries its device frame index; indices only increase
+//     across the segments and there are exactly as many as were captured
+//   - segments: files tile the session, none is longer than the duration target, every
+//     boundary is a duration roll or a completed "segment" command, and every such command
+//     landed on a boundary
+//   - control: a command queued while the recorder was consuming commands is answered
+//   - liveness: the session ends (the scheduler reports a deadlock or a livelock)
+// With --verify each seed runs twice and must interleave and record identically.
+// Exit code 0 when every run passes, 1 otherwise, 3 if a run got stuck.
+
+#include "CapturePipeline.h"
+#include "ControlServer.h"
+#include "Logger.h"
+#include "SegmentManifest.h"
+#include "SegmentedOutput.h"
+#include "VirtualScheduler.h"
+#include "WavWriter.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <optional>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using std::chrono::milliseconds;
+using std::chrono::nanoseconds;
+using TimePoint = std::chrono::steady_clock::time_point;
+
+constexpr uint32_t kSampleRate = 48000;
+
+struct SimOptions {
+    uint64_t firstSeed = 1;
+    uint32_t runs = 200;
+    bool verify = false;
+    bool verbose = false;
+    std::filesystem::path outDir = std::filesystem::temp_directory_path() / "pipeline_sim";
+    std::optional<std::filesystem::path> logFile;
+};
+
+void PrintUsage() {
+    std::printf("Usage: pipeline_sim [--seed N] [--runs N] [--verify] [--verbose] [--out-dir path] [--log path]\n");
+}
+
+bool ParseArgs(int argc, char** argv, SimOptions& options) {
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        const bool hasValue = i + 1 < argc;
+        if (arg == "--seed" && hasValue) {
+            options.firstSeed = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--runs" && hasValue) {
+            options.runs = static_cast<uint32_t>(std::max(1, std::atoi(argv[++i])));
+        } else if (arg == "--verify") {
+            options.verify = true;
+        } else if (arg == "--verbose") {
+            options.verbose = true;
+        } else if (arg == "--out-dir" && hasValue) {
+            options.outDir = std::filesystem::path(argv[++i]);
+        } else if (arg == "--log" && hasValue) {
+            options.logFile = std::filesystem::path(argv[++i]);
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+enum class SessionEnd { SourceEnd, MaxDuration, StopCommand, StopCallback };
+
+const char* SessionEndName(SessionEnd end) {
+    switch (end) {
+    case SessionEnd::SourceEnd: return "source-end";
+    case SessionEnd::MaxDuration: return "max-duration";
+    case SessionEnd::StopCommand: return "stop-command";
+    case SessionEnd::StopCallback: return "stop-callback";
+    }
+    return "?";
+}
+
+struct Window {
+    milliseconds at{0};
+    milliseconds length{0};
+};
+
+struct PlannedCommand {
+    milliseconds at{0};
+    ControlCommandType type = ControlCommandType::Status;
+};
+
+struct Scenario {
+    uint64_t seed = 0;
+    double preemption = 0.5;
+    uint32_t seconds = 3;                    // audio the device produces
+    uint32_t periodMs = 10;
+    uint32_t jitterUs = 0;                   // at most one period, so packets stay in order
+    uint32_t deviceBufferPackets = 8;
+    std::vector<Window> deviceStalls;        // no packets; what was due arrives at the end at once
+    uint32_t ringMs = 200;
+    uint32_t watchdogMs = 200;
+    std::optional<uint32_t> segmentSeconds;
+    uint32_t slowWritePerMille = 0;
+    uint32_t slowWriteMaxMs = 0;
+    std::optional<Window> diskStall;
+    SessionEnd end = SessionEnd::SourceEnd;
+    milliseconds stopAt{0};                  // StopCommand / StopCallback
+    uint32_t maxSeconds = 0;                 // MaxDuration
+    std::vector<PlannedCommand> commands;
+};
+
+// std::uniform_int_distribution differs between standard libraries; seeds must replay anywhere.
+uint32_t Draw(std::mt19937_64& random, uint32_t low, uint32_t high) {
+    return low + static_cast<uint32_t>(random() % (static_cast<uint64_t>(high) - low + 1));
+}
+
+Scenario MakeScenario(uint64_t seed) {
+    std::mt19937_64 random(seed * 0x9E3779B97F4A7C15ull + 1);
+    Scenario scenario;
+    scenario.seed = seed;
+    scenario.preemption = Draw(random, 1, 9) / 10.0;
+    scenario.seconds = Draw(random, 2, 5);
+    const uint32_t periods[] = {3, 10, 10, 20};
+    scenario.periodMs = periods[Draw(random, 0, 3)];
+    scenario.jitterUs = Draw(random, 0, 2) == 0 ? 0 : Draw(random, 0, scenario.periodMs * 1000);
+    scenario.deviceBufferPackets = Draw(random, 2, 30);
+    const uint32_t ringSizes[] = {20, 50, 100, 300, 1000};
+    scenario.ringMs = ringSizes[Draw(random, 0, 4)];
+    scenario.watchdogMs = Draw(random, 50, 400);
+    const uint32_t totalMs = scenario.seconds * 1000;
+    for (uint32_t i = Draw(random, 0, 2); i > 0; --i) {
+        scenario.deviceStalls.push_back({milliseconds(Draw(random, 0, totalMs)),
+                                         milliseconds(Draw(random, 5, scenario.watchdogMs * 2))});
+    }
+    if (Draw(random, 0, 2) > 0) {
+        scenario.segmentSeconds = Draw(random, 1, 2);
+    }
+    if (Draw(random, 0, 1) == 1) {
+        scenario.slowWritePerMille = Draw(random, 1, 300);
+        scenario.slowWriteMaxMs = Draw(random, 1, 40);
+    }
+    if (Draw(random, 0, 2) == 0) {
+        scenario.diskStall = Window{milliseconds(Draw(random, 0, totalMs)), milliseconds(Draw(random, 50, 1500))};
+    }
+    scenario.end = static_cast<SessionEnd>(Draw(random, 0, 3));
+    scenario.stopAt = milliseconds(Draw(random, 100, totalMs));
+    scenario.maxSeconds = Draw(random, 1, scenario.seconds);
+    const ControlCommandType types[] = {ControlCommandType::Segment, ControlCommandType::Segment,
+                                        ControlCommandType::Segment, ControlCommandType::Pause,
+                                        ControlCommandType::Resume,  ControlCommandType::Marker,
+                                        ControlCommandType::Status};
+    for (uint32_t i = Draw(random, 0, 8); i > 0; --i) {
+        scenario.commands.push_back({milliseconds(Draw(random, 0, totalMs)), types[Draw(random, 0, 6)]});
+    }
+    if (scenario.end == SessionEnd::StopCommand) {
+        scenario.commands.push_back({scenario.stopAt, ControlCommandType::Stop});
+    }
+    std::sort(scenario.commands.begin(), scenario.commands.end(),
+              [](const PlannedCommand& a, const PlannedCommand& b) { return a.at < b.at; });
+    return scenario;
+}
+
+// A WASAPI-like device on the virtual clock. Packet i is due one period after packet i-1 plus
+// jitter; inside a stall nothing is due until it ends. Unread packets beyond the device
+// buffer are lost and the next packet delivered is flagged as a discontinuity. Each frame
+// carries its device frame index: the low 16 bits in the left channel, the high in the right.
+class SimulatedDevice : public IAudioSource {
+public:
+    SimulatedDevice(VirtualScheduler& scheduler, const Scenario& scenario)
+        : scheduler_(scheduler),
+          scenario_(scenario),
+          format_(MakeAudioFormat(kSampleRate, 2, false)),
+          packetFrames_(kSampleRate / 1000 * scenario.periodMs),
+          totalFrames_(static_cast<uint64_t>(scenario.seconds) * kSampleRate),
+          buffer_(static_cast<size_t>(packetFrames_) * format_.BytesPerFrame()) {}
+
+    const AudioFormat& Format() const override { return format_; }
+    std::wstring Describe() const override { return L"模拟设备"; }
+
+    void Start() override {
+        origin_ = scheduler_.Now();
+        interrupted_.store(false, std::memory_order_release);
+    }
+    void Stop() override {}
+
+    SourceWaitResult Wait(milliseconds timeout) override {
+        if (interrupted_.load(std::memory_order_acquire)) {
+            return SourceWaitResult::Interrupted;
+        }
+        if (Ended()) {
+            return SourceWaitResult::PacketsReady;   // Read() reports the end of the stream
+        }
+        const TimePoint due = DueTime(nextPacket_);
+        const TimePoint now = scheduler_.Now();
+        if (due > now) {
+            const std::function<bool()> interrupted = [this]() { return interrupted_.load(std::memory_order_acquire); };
+            scheduler_.WaitUntil(interrupted, std::min<nanoseconds>(due - now, timeout));
+        }
+        if (interrupted_.load(std::memory_order_acquire)) {
+            return SourceWaitResult::Interrupted;
+        }
+        return scheduler_.Now() >= due ? SourceWaitResult::PacketsReady : SourceWaitResult::Timeout;
+    }
+
+    void Interrupt() override {
+        interrupted_.store(true, std::memory_order_release);
+        scheduler_.Wake();
+    }
+
+    SourceReadResult Read(SourcePacket& packet) override {
+        if (Ended()) {
+            return SourceReadResult::EndOfStream;
+        }
+        const TimePoint now = scheduler_.Now();
+        uint64_t ready = 0;
+        while (!Ended(nextPacket_ + ready) && DueTime(nextPacket_ + ready) <= now) {
+            ++ready;
+        }
+        if (ready == 0) {
+            return SourceReadResult::Empty;
+        }
+        if (ready > scenario_.deviceBufferPackets) {
+            for (uint64_t lost = ready - scenario_.deviceBufferPackets; lost > 0; --lost) {
+                framesLost_ += FramesOf(nextPacket_++);
+            }
+            discontinuityPending_ = true;
+        }
+        const uint64_t firstFrame = nextPacket_ * packetFrames_;
+        const uint32_t frames = FramesOf(nextPacket_++);
+        auto* samples = reinterpret_cast<uint16_t*>(buffer_.data());
+        for (uint32_t frame = 0; frame < frames; ++frame) {
+            const uint64_t index = firstFrame + frame;
+            samples[frame * 2] = static_cast<uint16_t>(index & 0xFFFF);
+            samples[frame * 2 + 1] = static_cast<uint16_t>(index >> 16);
+        }
+        packet.data = buffer_.data();
+        packet.frames = frames;
+        packet.silent = false;
+        packet.discontinuity = discontinuityPending_;
+        if (discontinuityPending_) {
+            ++discontinuitiesDelivered_;
+            discontinuityPending_ = false;
+        }
+        framesRead_ += frames;
+        return SourceReadResult::Packet;
+    }
+
+    void Release(const SourcePacket&) override {}
+
+    uint64_t FramesRead() const { return framesRead_; }
+    uint64_t FramesLost() const { return framesLost_; }
+    uint64_t DiscontinuitiesDelivered() const { return discontinuitiesDelivered_; }
+    // Frame indices handed out or lost so far; everything on disk lies below.
+    uint64_t FramesConsumed() const { return std::min(nextPacket_ * packetFrames_, totalFrames_); }
+
+private:
+    bool Ended(uint64_t packet) const { return packet * packetFrames_ >= totalFrames_; }
+    bool Ended() const { return Ended(nextPacket_); }
+    uint32_t FramesOf(uint64_t packet) const {
+        return static_cast<uint32_t>(std::min<uint64_t>(packetFrames_, totalFrames_ - packet * packetFrames_));
+    }
+
+    TimePoint DueTime(uint64_t packet) const {
+        // Jitter per packet is a hash of the seed and the packet number, so Read() may look ahead.
+        uint64_t hash = (scenario_.seed + 1) * 0x9E3779B97F4A7C15ull ^ (packet + 1) * 0xC2B2AE3D27D4EB4Full;
+        hash ^= hash >> 29;
+        const uint64_t jitterUs = scenario_.jitterUs ? hash % (scenario_.jitterUs + 1) : 0;
+        auto due = milliseconds(static_cast<int64_t>((packet + 1) * scenario_.periodMs)) +
+                   std::chrono::microseconds(static_cast<int64_t>(jitterUs));
+        for (const Window& stall : scenario_.deviceStalls) {
+            if (due >= stall.at && due < stall.at + stall.length) {
+                due = stall.at + stall.length;
+            }
+        }
+        return origin_ + due;
+    }
+
+    VirtualScheduler& scheduler_;
+    const Scenario& scenario_;
+    const AudioFormat format_;
+    const uint32_t packetFrames_;
+    const uint64_t totalFrames_;
+    std::vector<uint8_t> buffer_;
+    TimePoint origin_{};
+    uint64_t nextPacket_ = 0;
+    uint64_t framesRead_ = 0;
+    uint64_t framesLost_ = 0;
+    uint64_t discontinuitiesDelivered_ = 0;
+    bool discontinuityPending_ = false;
+    std::atomic<bool> interrupted_{false};
+};
+
+// Writes take virtual time: now and then a slow one, and all of them during the disk stall.
+class SimulatedDisk final : public IAudioWriter {
+public:
+    SimulatedDisk(std::unique_ptr<IAudioWriter> inner, VirtualScheduler& scheduler, const Scenario& scenario,
+                  TimePoint origin)
+        : inner_(std::move(inner)), scheduler_(scheduler), scenario_(scenario), origin_(origin) {}
+
+    void Write(const uint8_t* data, size_t byteCount) override {
+        if (scenario_.slowWritePerMille && scheduler_.Random() % 1000 < scenario_.slowWritePerMille) {
+            scheduler_.SleepFor(milliseconds(1 + scheduler_.Random() % scenario_.slowWriteMaxMs));
+        }
+        if (scenario_.diskStall) {
+            const auto stallStart = origin_ + scenario_.diskStall->at;
+            const auto stallEnd = stallStart + scenario_.diskStall->length;
+            const auto now = scheduler_.Now();
+            if (now >= stallStart && now < stallEnd) {
+                scheduler_.SleepFor(stallEnd - now);
+            }
+        }
+        inner_->Write(data, byteCount);
+    }
+    void Flush() override { inner_->Flush(); }
+    void Close() override { inner_->Close(); }
+    uint64_t FileBytes() const override { return inner_->FileBytes(); }
+    SegmentChecksum Checksum() const override { return inner_->Checksum(); }
+    uint64_t RenditionBytes() const override { return inner_->RenditionBytes(); }
+
+private:
+    std::unique_ptr<IAudioWriter> inner_;
+    VirtualScheduler& scheduler_;
+    const Scenario& scenario_;
+    const TimePoint origin_;
+};
+
+struct IssuedCommand {
+    ControlCommandType type;
+    std::shared_ptr<ControlCommand> command;
+    bool mustComplete = false;    // the recorder was consuming commands after it was queued
+};
+
+class Checker {
+public:
+    void Expect(bool condition, const std::string& what) {
+        if (!condition) {
+            failures_.push_back(what);
+        }
+    }
+    bool Passed() const { return failures_.empty(); }
+    const std::vector<std::string>& Failures() const { return failures_; }
+
+private:
+    std::vector<std::string> failures_;
+};
+
+struct RunResult {
+    bool passed = false;
+    uint64_t digest = 0;
+    uint64_t switches = 0;
+    nanoseconds elapsed{0};
+    RecorderStats stats;
+    uint64_t framesLost = 0;
+    uint32_t segments = 0;
+    uint32_t rolls = 0;
+    std::vector<uint32_t> segmentCrcs;
+};
+
+// Frame indices in one segment file, in file order.
+std::vector<uint32_t> ReadFrameIndices(const std::filesystem::path& path) {
+    const WavFileLayout layout = ReadWavFileLayout(path);
+    std::vector<uint16_t> samples(static_cast<size_t>(layout.dataBytes / sizeof(uint16_t)));
+    std::ifstream stream(path, std::ios::binary);
+    stream.seekg(static_cast<std::streamoff>(layout.dataOffset));
+    stream.read(reinterpret_cast<char*>(samples.data()), static_cast<std::streamsize>(samples.size() * sizeof(uint16_t)));
+    std::vector<uint32_t> indices(samples.size() / 2);
+    for (size_t frame = 0; frame < indices.size(); ++frame) {
+        indices[frame] = static_cast<uint32_t>(samples[frame * 2]) | (static_cast<uint32_t>(samples[frame * 2 + 1]) << 16);
+    }
+    return indices;
+}
+
+RunResult RunSimulation(const Scenario& scenario, const SimOptions& options, Logger& logger) {
+    const std::filesystem::path directory = options.outDir / ("seed_" + std::to_string(scenario.seed));
+    std::error_code ec;
+    std::filesystem::remove_all(directory, ec);
+    std::filesystem::create_directories(directory);
+
+    VirtualSchedulerOptions schedulerOptions;
+    schedulerOptions.seed = scenario.seed;
+    schedulerOptions.preemption = scenario.preemption;
+    schedulerOptions.timeLimit = std::chrono::seconds(scenario.seconds + 60);
+    schedulerOptions.onStuck = [&scenario](const std::string& description) {
+        std::printf("seed %llu STUCK: %s\n", static_cast<unsigned long long>(scenario.seed), description.c_str());
+        std::fflush(stdout);
+        std::_Exit(3);
+    };
+    VirtualScheduler scheduler(schedulerOptions);
+    SimulatedDevice device(scheduler, scenario);
+
+    RecorderConfig config;
+    config.outputPath = directory / "sim.wav";
+    config.ringBufferSize = milliseconds(scenario.ringMs);
+    config.watchdogTimeout = milliseconds(scenario.watchdogMs);
+    config.diskGuard.reset();
+    if (scenario.segmentSeconds) {
+        config.segmentDuration = std::chrono::seconds(*scenario.segmentSeconds);
+    }
+    if (scenario.end == SessionEnd::MaxDuration) {
+        config.maxDuration = std::chrono::seconds(scenario.maxSeconds);
+    }
+
+    ControlCommandQueue commands;
+    RecorderStatusBoard statusBoard;
+    RecorderControls controls;
+    controls.scheduler = &scheduler;
+    controls.commands = &commands;
+    controls.status = &statusBoard;
+    controls.wrapWriter = [&](std::unique_ptr<IAudioWriter> inner) -> std::unique_ptr<IAudioWriter> {
+        return std::make_unique<SimulatedDisk>(std::move(inner), scheduler, scenario, TimePoint{});
+    };
+    if (scenario.end == SessionEnd::StopCallback) {
+        controls.shouldStop = [&scheduler, &scenario]() { return scheduler.Now() >= TimePoint{} + scenario.stopAt; };
+    }
+
+    CapturePipeline pipeline(logger);
+    RecorderStats stats;
+    std::optional<std::string> runError;
+    std::vector<IssuedCommand> issued;
+    std::atomic<bool> sessionOver{false};
+    scheduler.Run([&]() {
+        // A control client: queues each planned command at its time and waits for the answer.
+        std::thread client = scheduler.StartThread([&]() {
+            const std::function<bool()> over = [&sessionOver]() { return sessionOver.load(std::memory_order_acquire); };
+            for (const PlannedCommand& planned : scenario.commands) {
+                const auto now = scheduler.Now();
+                const auto at = TimePoint{} + planned.at;
+                if (at > now && scheduler.WaitUntil(over, at - now)) {
+                    return;
+                }
+                if (!commands.ConsumerActive()) {
+                    continue;
+                }
+                IssuedCommand entry{planned.type, std::make_shared<ControlCommand>()};
+                entry.command->type = planned.type;
+                entry.command->label = "sim";
+                entry.command->enqueuedAt = scheduler.Now();
+                if (!commands.Push(entry.command)) {
+                    continue;
+                }
+                scheduler.Wake();
+                entry.mustComplete = commands.ConsumerActive();
+                issued.push_back(entry);
+                const std::shared_ptr<ControlCommand> command = entry.command;
+                const std::function<bool()> answered = [command, &sessionOver]() {
+                    return command->Completed() || sessionOver.load(std::memory_order_acquire);
+                };
+                scheduler.WaitUntil(answered, std::chrono::seconds(5));
+            }
+        });
+        try {
+            stats = pipeline.Run(device, config, controls);
+        } catch (const std::exception& ex) {
+            runError = ex.what();
+        }
+        sessionOver.store(true, std::memory_order_release);
+        scheduler.Wake();
+        scheduler.Join(client);
+    });
+
+    RunResult result;
+    result.digest = scheduler.Digest();
+    result.switches = scheduler.Switches();
+    result.elapsed = scheduler.Elapsed();
+    result.stats = stats;
+    result.framesLost = device.FramesLost();
+
+    Checker checker;
+    checker.Expect(!runError, "Run() failed: " + runError.value_or(""));
+
+    // Frame accounting.
+    checker.Expect(device.FramesRead() == stats.framesCaptured + stats.framesDropped + stats.framesWhilePaused,
+                   "read " + std::to_string(device.FramesRead()) + " != captured " + std::to_string(stats.framesCaptured) +
+                       " + dropped " + std::to_string(stats.framesDropped) + " + paused " +
+                       std::to_string(stats.framesWhilePaused));
+    checker.Expect(stats.glitchCount == device.DiscontinuitiesDelivered(),
+                   "gaps " + std::to_string(stats.glitchCount) + " != flagged " +
+                       std::to_string(device.DiscontinuitiesDelivered()));
+    if (scenario.end == SessionEnd::MaxDuration) {
+        const uint64_t limit = static_cast<uint64_t>(scenario.maxSeconds) * kSampleRate;
+        checker.Expect(stats.framesCaptured <= limit + kSampleRate / 1000 * scenario.periodMs,
+                       "captured " + std::to_string(stats.framesCaptured) + " past the duration limit");
+    }
+
+    // Control commands.
+    std::vector<uint64_t> rollPositions;
+    for (const IssuedCommand& entry : issued) {
+        if (entry.mustComplete) {
+            checker.Expect(entry.command->Completed(), "a queued command was never answered");
+        }
+        if (entry.type == ControlCommandType::Segment && entry.command->Completed() && entry.command->ok) {
+            rollPositions.push_back(entry.command->framePosition);
+        }
+    }
+    std::sort(rollPositions.begin(), rollPositions.end());
+    rollPositions.erase(std::unique(rollPositions.begin(), rollPositions.end()), rollPositions.end());
+
+    // Segments and content.
+    std::vector<SegmentManifestEntry> entries;
+    try {
+        entries = ReadSegmentManifest(BuildManifestPath(config.outputPath));
+    } catch (const std::exception& ex) {
+        checker.Expect(stats.framesCaptured == 0, std::string("manifest: ") + ex.what());
+    }
+    result.segments = static_cast<uint32_t>(entries.size());
+    const uint64_t target = scenario.segmentSeconds   // 0 = no duration target
+        ? static_cast<uint64_t>(*scenario.segmentSeconds) * kSampleRate
+        : 0;
+    uint64_t expectedStart = 0;
+    uint64_t manifestDropped = 0;
+    uint64_t manifestGaps = 0;
+    uint64_t manifestBytes = 0;
+    int64_t lastIndex = -1;
+    for (size_t i = 0; i < entries.size(); ++i) {
+        const SegmentManifestEntry& entry = entries[i];
+        const std::string name = "segment #" + std::to_string(entry.segmentNumber);
+        checker.Expect(entry.startFrame == expectedStart, name + " starts at " + std::to_string(entry.startFrame) +
+                                                              ", expected " + std::to_string(expectedStart));
+        expectedStart = entry.endFrame;
+        manifestDropped += entry.droppedFrames;
+        manifestGaps += entry.gaps;
+        manifestBytes += entry.bytes;
+        const uint64_t length = entry.endFrame - entry.startFrame;
+        if (target != 0) {
+            checker.Expect(length <= target, name + " is longer than the duration target");
+        }
+        if (i > 0) {
+            const bool controlRoll = std::binary_search(rollPositions.begin(), rollPositions.end(), entry.startFrame);
+            const uint64_t previous = entries[i - 1].endFrame - entries[i - 1].startFrame;
+            checker.Expect(controlRoll || (target != 0 && previous == target),
+                           name + " starts at " + std::to_string(entry.startFrame) +
+                               " without a duration roll or a segment command");
+        }
+        try {
+            const std::vector<uint32_t> indices = ReadFrameIndices(directory / entry.fileName);
+            checker.Expect(indices.size() == length, name + ": " + std::to_string(indices.size()) +
+                                                         " frames on disk, manifest says " + std::to_string(length));
+            for (const uint32_t index : indices) {
+                if (static_cast<int64_t>(index) <= lastIndex) {
+                    checker.Expect(false, name + ": frame index " + std::to_string(index) + " after " +
+                                              std::to_string(lastIndex));
+                    break;
+                }
+                lastIndex = index;
+            }
+            result.segmentCrcs.push_back(entry.crc32c);
+        } catch (const std::exception& ex) {
+            checker.Expect(false, name + ": " + ex.what());
+        }
+    }
+    checker.Expect(expectedStart == stats.framesCaptured, "segments cover " + std::to_string(expectedStart) +
+                                                             " frames, captured " + std::to_string(stats.framesCaptured));
+    checker.Expect(lastIndex < static_cast<int64_t>(device.FramesConsumed()), "a frame index the device never produced");
+    checker.Expect(manifestDropped == stats.framesDropped, "manifest drops " + std::to_string(manifestDropped) +
+                                                               " != session drops " + std::to_string(stats.framesDropped));
+    checker.Expect(manifestGaps == stats.glitchCount, "manifest gaps " + std::to_string(manifestGaps) +
+                                                          " != session gaps " + std::to_string(stats.glitchCount));
+    // The status board a front end would show ends where the files on disk do.
+    if (const auto status = statusBoard.Read()) {
+        checker.Expect(status->output.fileBytes == manifestBytes, "status board reports " +
+                           std::to_string(status->output.fileBytes) + " bytes, manifest " + std::to_string(manifestBytes));
+        checker.Expect(status->output.framesWritten == stats.framesCaptured && status->capture.framesCaptured == stats.framesCaptured,
+                       "status board frames " + std::to_string(status->output.framesWritten) + "/" +
+                           std::to_string(status->capture.framesCaptured) + " != captured " + std::to_string(stats.framesCaptured));
+        checker.Expect(status->output.closedSegments == entries.size() && status->output.current.number == 0,
+                       "status board reports " + std::to_string(status->output.closedSegments) + " closed segments");
+        if (!entries.empty()) {
+            const size_t newest = std::min<size_t>(entries.size(), kRecorderStatusRecentSegments) - 1;
+            checker.Expect(status->output.recent[newest].number == entries.back().segmentNumber &&
+                               status->output.recent[newest].fileBytes == entries.back().bytes,
+                           "status board's newest segment does not match the manifest");
+        }
+        if (!runError) {
+            checker.Expect(status->capture.state == static_cast<uint32_t>(SharedRecorderState::Stopped) ||
+                               status->capture.state == static_cast<uint32_t>(SharedRecorderState::DeviceLost),
+                           std::string("status board left in state ") + SharedRecorderStateName(status->capture.state));
+        }
+    } else {
+        checker.Expect(false, "status board unreadable after the session");
+    }
+    for (const uint64_t position : rollPositions) {
+        if (position == 0 || position >= stats.framesCaptured) {
+            continue;   // nothing before it, or no audio after it to open a segment with
+        }
+        const bool boundary = std::any_of(entries.begin(), entries.end(),
+                                          [position](const SegmentManifestEntry& entry) { return entry.startFrame == position; });
+        checker.Expect(boundary, "segment command at frame " + std::to_string(position) + " left no boundary");
+        ++result.rolls;
+    }
+
+    result.passed = checker.Passed();
+    if (!result.passed || options.verbose) {
+        std::printf("seed %llu: %u s, %u ms period, jitter %u us, buffer %u, stalls %zu, ring %u ms, watchdog %u ms, "
+                    "segments %s, slow writes %u/1000, disk stall %s, %zu commands, %s, preemption %.1f\n",
+                    static_cast<unsigned long long>(scenario.seed), scenario.seconds, scenario.periodMs,
+                    scenario.jitterUs, scenario.deviceBufferPackets, scenario.deviceStalls.size(), scenario.ringMs,
+                    scenario.watchdogMs, scenario.segmentSeconds ? std::to_string(*scenario.segmentSeconds).c_str() : "off",
+                    scenario.slowWritePerMille, scenario.diskStall ? std::to_string(scenario.diskStall->length.count()).c_str() : "none",
+                    scenario.commands.size(), SessionEndName(scenario.end), scenario.preemption);
+        std::printf("  %.3f s virtual, %llu switches: captured=%llu dropped=%llu paused=%llu lost=%llu gaps=%u "
+                    "watchdog=%u segments=%u rolls=%u %s\n",
+                    std::chrono::duration<double>(result.elapsed).count(),
+                    static_cast<unsigned long long>(result.switches), static_cast<unsigned long long>(stats.framesCaptured),
+                    static_cast<unsigned long long>(stats.framesDropped),
+                    static_cast<unsigned long long>(stats.framesWhilePaused),
+                    static_cast<unsigned long long>(device.FramesLost()), stats.glitchCount, stats.watchdogTimeouts,
+                    result.segments, result.rolls, result.passed ? "ok" : "FAILED");
+        for (const std::string& failure : checker.Failures()) {
+            std::printf("  FAIL %s\n", failure.c_str());
+        }
+    }
+    if (result.passed) {
+        std::filesystem::remove_all(directory, ec);
+    }
+    return result;
+}
+
+bool SameOutcome(const RunResult& a, const RunResult& b) {
+    return a.digest == b.digest && a.stats.framesCaptured == b.stats.framesCaptured &&
+           a.stats.framesDropped == b.stats.framesDropped && a.stats.framesWhilePaused == b.stats.framesWhilePaused &&
+           a.stats.glitchCount == b.stats.glitchCount && a.stats.watchdogTimeouts == b.stats.watchdogTimeouts &&
+           a.framesLost == b.framesLost && a.segmentCrcs == b.segmentCrcs;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    SimOptions options;
+    if (!ParseArgs(argc, argv, options)) {
+        PrintUsage();
+        return 1;
+    }
+    Logger logger;
+    logger.SetConsoleOutput(false);
+    if (options.logFile) {
+        logger.EnableFileLogging(*options.logFile);
+    }
+
+    uint32_t failed = 0;
+    uint64_t switches = 0;
+    uint64_t dropped = 0;
+    uint64_t lost = 0;
+    uint64_t watchdogTimeouts = 0;
+    uint64_t rolls = 0;
+    nanoseconds simulated{0};
+    const auto started = std::chrono::steady_clock::now();
+    for (uint32_t run = 0; run < options.runs; ++run) {
+        const Scenario scenario = MakeScenario(options.firstSeed + run);
+        const RunResult result = RunSimulation(scenario, options, logger);
+        bool passed = result.passed;
+        if (passed && options.verify) {
+            const RunResult again = RunSimulation(scenario, options, logger);
+            if (!again.passed || !SameOutcome(result, again)) {
+                std::printf("seed %llu: a second run interleaved or recorded differently (digest %016llx vs %016llx)\n",
+                            static_cast<unsigned long long>(scenario.seed), static_cast<unsigned long long>(result.digest),
+                            static_cast<unsigned long long>(again.digest));
+                passed = false;
+            }
+        }
+        failed += passed ? 0 : 1;
+        switches += result.switches;
+        dropped += result.stats.framesDropped;
+        lost += result.framesLost;
+        watchdogTimeouts += result.stats.watchdogTimeouts;
+        rolls += result.rolls;
+        simulated += result.elapsed;
+    }
+    logger.Flush();
+    const double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    std::printf("%u runs (seeds %llu-%llu), %.0f s simulated in %.1f s, %llu thread switches; dropped=%llu lost=%llu "
+                "watchdog=%llu control-rolls=%llu\n",
+                options.runs, static_cast<unsigned long long>(options.firstSeed),
+                static_cast<unsigned long long>(options.firstSeed + options.runs - 1),
+                std::chrono::duration<double>(simulated).count(), wall, static_cast<unsigned long long>(switches),
+                static_cast<unsigned long long>(dropped), static_cast<unsigned long long>(lost),
+                static_cast<unsigned long long>(watchdogTimeouts), static_cast<unsigned long long>(rolls));
+    std::printf("%s\n", failed == 0 ? "all runs passed" : (std::to_string(failed) + " runs FAILED").c_str());
+    return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,168 @@
+// Checks that the recording pipeline does not allocate once it is running.
+//
+// Records N minutes of a synthetic tone per output format with everything a long recording
+// has attached: live metrics, the binary event log, a control queue, the GUI's status board
+// and the once-a-second status line. Built with LOOPBACK_RECORDER_COUNT_ALLOCATIONS, so CapturePipeline::Run
+// counts heap allocations per thread and reports those the capture and writer threads made
+// after the first second of audio. Segment rolls, warnings and glitch handling allocate by
+// design and are kept out of the run (one segment, clean source).
+// Exit code 0 when both threads stayed at zero for every format, 1 otherwise.
+
+#include "AllocationCounter.h"
+#include "CapturePipeline.h"
+#include "ControlServer.h"
+#include "EventLog.h"
+#include "Logger.h"
+#include "Mp3Converter.h"
+#include "RecorderMetrics.h"
+#include "RecorderStatus.h"
+#include "SyntheticSource.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct CheckOptions {
+    uint32_t minutes = 2;                    // audio per format
+    std::vector<std::string> formats{"wav", "mp3", "ladder"};   // ladder: MP3 at 192 + 128 + 64 kbps
+    bool realTime = false;                   // default: as fast as the pipeline accepts packets
+    std::filesystem::path outDir = std::filesystem::temp_directory_path() / "recorder_alloc_check";
+    std::optional<std::filesystem::path> logFile;
+    bool keep = false;
+};
+
+void PrintUsage() {
+    std::printf("Usage: recorder_alloc_check [--minutes N] [--formats wav,mp3,ladder] [--realtime] [--out-dir path]\n"
+                "                            [--keep] [--log path]\n");
+}
+
+bool ParseArgs(int argc, char** argv, CheckOptions& options) {
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        const bool hasValue = i + 1 < argc;
+        if (arg == "--minutes" && hasValue) {
+            options.minutes = static_cast<uint32_t>(std::max(1, std::atoi(argv[++i])));
+        } else if (arg == "--formats" && hasValue) {
+            options.formats.clear();
+            std::stringstream items(argv[++i]);
+            std::string item;
+            while (std::getline(items, item, ',')) {
+                if (item != "wav" && item != "mp3" && item != "ladder") {
+                    return false;
+                }
+                options.formats.push_back(item);
+            }
+        } else if (arg == "--realtime") {
+            options.realTime = true;
+        } else if (arg == "--out-dir" && hasValue) {
+            options.outDir = std::filesystem::path(argv[++i]);
+        } else if (arg == "--log" && hasValue) {
+            options.logFile = std::filesystem::path(argv[++i]);
+        } else if (arg == "--keep") {
+            options.keep = true;
+        } else {
+            return false;
+        }
+    }
+    return !options.formats.empty();
+}
+
+// true when the run completed and neither thread allocated after warm-up; a format the build
+// cannot write (no LAME) is skipped.
+bool CheckFormat(const CheckOptions& options, const std::string& format, Logger& logger) {
+    const uint64_t seconds = static_cast<uint64_t>(options.minutes) * 60;
+    SyntheticSourceOptions sourceOptions;
+    sourceOptions.realTime = options.realTime;
+    sourceOptions.totalFrames = seconds * sourceOptions.sampleRate;
+
+    RecorderConfig config;
+    const bool mp3 = format != "wav";
+    config.outputPath = options.outDir / (mp3 ? "alloc_check_" + format + ".mp3" : "alloc_check.wav");
+    if (format == "ladder") {
+        config.mp3LadderKbps = {128, 64};
+    }
+    config.maxDuration = std::chrono::seconds(seconds);
+    config.diskGuard.reset();
+    // The writer may lag a little behind a faster-than-real-time source; a drop would log.
+    config.ringBufferSize = std::chrono::milliseconds(10000);
+
+    RecorderMetrics metrics;
+    EventLogWriter events(options.outDir / ("alloc_check_" + format + ".events"));
+    ControlCommandQueue commands;
+    RecorderStatusBoard statusBoard;
+    RecorderControls controls;
+    controls.metrics = &metrics;
+    controls.events = &events;
+    controls.commands = &commands;
+    controls.status = &statusBoard;
+
+    std::printf("%s: %llu s of audio%s\n", format.c_str(), static_cast<unsigned long long>(seconds),
+                options.realTime ? " in real time" : "");
+    if (mp3) {
+        try {
+            Mp3Converter::Preload();
+        } catch (const std::exception& ex) {
+            std::printf("  skipped: %s\n", ex.what());
+            return true;
+        }
+    }
+    SyntheticSource source(sourceOptions);
+    RecorderStats stats;
+    try {
+        CapturePipeline pipeline(logger);
+        stats = pipeline.Run(source, config, controls);
+    } catch (const std::exception& ex) {
+        std::printf("  FAILED: %s\n", ex.what());
+        return false;
+    }
+    const bool clean = stats.captureSteadyAllocations == 0 && stats.writerSteadyAllocations == 0;
+    std::printf("  captured=%llu dropped=%llu steady-state allocations: capture=%llu writer=%llu  %s\n",
+                static_cast<unsigned long long>(stats.framesCaptured),
+                static_cast<unsigned long long>(stats.framesDropped),
+                static_cast<unsigned long long>(stats.captureSteadyAllocations),
+                static_cast<unsigned long long>(stats.writerSteadyAllocations), clean ? "ok" : "FAILED");
+    return clean && stats.framesCaptured == *sourceOptions.totalFrames;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    CheckOptions options;
+    if (!ParseArgs(argc, argv, options)) {
+        PrintUsage();
+        return 1;
+    }
+    if (!AllocationCounter::Enabled()) {
+        std::fprintf(stderr, "built without LOOPBACK_RECORDER_COUNT_ALLOCATIONS; nothing to check\n");
+        return 1;
+    }
+    std::error_code ec;
+    std::filesystem::remove_all(options.outDir, ec);
+    std::filesystem::create_directories(options.outDir);
+
+    Logger logger;
+    logger.SetConsoleOutput(false);
+    if (options.logFile) {
+        logger.EnableFileLogging(*options.logFile);
+    }
+
+    bool allPassed = true;
+    for (const auto& format : options.formats) {
+        allPassed = CheckFormat(options, format, logger) && allPassed;
+    }
+    logger.Flush();
+    if (!options.keep) {
+        std::filesystem::remove_all(options.outDir, ec);
+    }
+    std::printf("%s\n", allPassed ? "no allocations after warm-up" : "allocations after warm-up FAILED");
+    return allPassed ? 0 : 1;
+}
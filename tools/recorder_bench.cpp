@@ -0,0 +1,458 @@
+// Measures what the recording pipeline can sustain, without an audio device.
+//
+// Every case feeds a synthetic tone from memory as fast as the pipeline accepts it and times
+// four stages separately:
+//   source    packet generation alone (the floor every other stage includes)
+//   ring      capture-to-writer hand-off through SpscByteRingBuffer on two threads
+//   writer    SegmentedOutput on one thread: int16 conversion, LAME, file output, segment rolls
+//   pipeline  CapturePipeline::Run end to end, as a recording runs it
+// Each stage reports frames/s, the multiple of real time, heap allocations (counted by the
+// operator new of AllocationCounter.cpp) and I/O system calls of the whole process. Cases cover the
+// cross product of --formats, --channels, --chunk-ms and --segment-seconds. With
+// --min-realtime the exit code is 2 when a pipeline stage falls below that multiple, so the
+// bench can gate performance regressions in CI.
+
+#include "AllocationCounter.h"
+#include "CapturePipeline.h"
+#include "JsonLines.h"
+#include "Logger.h"
+#include "RecorderMetrics.h"
+#include "SegmentedOutput.h"
+#include "SpscByteRing.h"
+#include "SyntheticSource.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fstream>
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct BenchOptions {
+    uint32_t seconds = 60;                        // audio per case
+    uint32_t sampleRate = 48000;
+    std::vector<std::string> formats{"wav", "mp3"};
+    std::vector<uint32_t> channels{1, 2};
+    std::vector<uint32_t> chunkMs{10};
+    std::vector<uint32_t> segmentSeconds{0};
+    std::filesystem::path outDir = std::filesystem::temp_directory_path() / "recorder_bench";
+    bool keep = false;
+    bool json = false;
+    std::optional<double> minRealtime;
+};
+
+void PrintUsage() {
+    std::printf("Usage: recorder_bench [--seconds N] [--rate HZ] [--formats wav,mp3] [--channels 1,2,6]\n"
+                "                      [--chunk-ms 1,10,100] [--segment-seconds 0,10] [--out-dir path] [--keep]\n"
+                "                      [--json] [--min-realtime X]\n");
+}
+
+template <typename T, typename Parse>
+bool ParseList(const std::string& text, std::vector<T>& values, Parse parse) {
+    values.clear();
+    std::stringstream items(text);
+    std::string item;
+    while (std::getline(items, item, ',')) {
+        if (item.empty()) {
+            return false;
+        }
+        values.push_back(parse(item));
+    }
+    return !values.empty();
+}
+
+bool ParseArgs(int argc, char** argv, BenchOptions& options) {
+    auto toUint = [](const std::string& item) { return static_cast<uint32_t>(std::strtoul(item.c_str(), nullptr, 10)); };
+    auto toText = [](const std::string& item) { return item; };
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        const bool hasValue = i + 1 < argc;
+        if (arg == "--seconds" && hasValue) {
+            options.seconds = std::max(1u, toUint(argv[++i]));
+        } else if (arg == "--rate" && hasValue) {
+            options.sampleRate = std::clamp(toUint(argv[++i]), 8000u, 384000u);
+        } else if (arg == "--formats" && hasValue) {
+            if (!ParseList(argv[++i], options.formats, toText) ||
+                std::any_of(options.formats.begin(), options.formats.end(),
+                            [](const std::string& format) { return format != "wav" && format != "mp3"; })) {
+                return false;
+            }
+        } else if (arg == "--channels" && hasValue) {
+            if (!ParseList(argv[++i], options.channels, toUint) ||
+                std::any_of(options.channels.begin(), options.channels.end(), [](uint32_t n) { return n < 1 || n > 8; })) {
+                return false;
+            }
+        } else if (arg == "--chunk-ms" && hasValue) {
+            if (!ParseList(argv[++i], options.chunkMs, toUint) ||
+                std::any_of(options.chunkMs.begin(), options.chunkMs.end(), [](uint32_t ms) { return ms < 1 || ms > 1000; })) {
+                return false;
+            }
+        } else if (arg == "--segment-seconds" && hasValue) {
+            if (!ParseList(argv[++i], options.segmentSeconds, toUint)) {
+                return false;
+            }
+        } else if (arg == "--out-dir" && hasValue) {
+            options.outDir = std::filesystem::path(argv[++i]);
+        } else if (arg == "--keep") {
+            options.keep = true;
+        } else if (arg == "--json") {
+            options.json = true;
+        } else if (arg == "--min-realtime" && hasValue) {
+            options.minRealtime = std::strtod(argv[++i], nullptr);
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Read/write-family system calls of the process so far (/proc/self/io syscr + syscw on
+// Linux; read, write and other I/O operations on Windows).
+uint64_t IoSyscalls() {
+#if defined(_WIN32)
+    IO_COUNTERS counters{};
+    if (!GetProcessIoCounters(GetCurrentProcess(), &counters)) {
+        return 0;
+    }
+    return counters.ReadOperationCount + counters.WriteOperationCount + counters.OtherOperationCount;
+#else
+    std::ifstream io("/proc/self/io");
+    std::string key;
+    uint64_t value = 0;
+    uint64_t total = 0;
+    while (io >> key >> value) {
+        if (key == "syscr:" || key == "syscw:") {
+            total += value;
+        }
+    }
+    return total;
+#endif
+}
+
+struct Counters {
+    std::chrono::steady_clock::time_point time;
+    uint64_t allocations = 0;
+    uint64_t allocatedBytes = 0;
+    uint64_t syscalls = 0;
+
+    static Counters Now() {
+        Counters counters;
+        counters.allocations = AllocationCounter::ProcessAllocations();
+        counters.allocatedBytes = AllocationCounter::ProcessAllocatedBytes();
+        counters.syscalls = IoSyscalls();
+        counters.time = std::chrono::steady_clock::now();
+        return counters;
+    }
+};
+
+struct CaseSpec {
+    std::string format;
+    uint32_t channels = 2;
+    uint32_t chunkMs = 10;
+    uint32_t segmentSeconds = 0;
+
+    std::string Name() const {
+        return format + " " + std::to_string(channels) + "ch " + std::to_string(chunkMs) + "ms seg=" +
+               (segmentSeconds ? std::to_string(segmentSeconds) + "s" : std::string("off"));
+    }
+};
+
+struct StageResult {
+    std::string stage;
+    uint64_t frames = 0;
+    double seconds = 0.0;
+    uint64_t allocations = 0;
+    uint64_t allocatedBytes = 0;
+    uint64_t syscalls = 0;
+    std::string error;   // the stage could not run (e.g. LAME missing)
+    std::string detail;
+
+    double FramesPerSecond() const { return seconds > 0.0 ? static_cast<double>(frames) / seconds : 0.0; }
+};
+
+// Brackets one stage from construction to End(). The clock is read after the counters at the
+// start and before them at the end, so reading /proc is never timed.
+class StageTimer {
+public:
+    explicit StageTimer(StageResult& result) : result_(result), start_(Counters::Now()) {}
+    void End(uint64_t frames) {
+        const auto endTime = std::chrono::steady_clock::now();
+        const Counters end = Counters::Now();
+        result_.frames = frames;
+        result_.seconds = std::chrono::duration<double>(endTime - start_.time).count();
+        result_.allocations = end.allocations - start_.allocations;
+        result_.allocatedBytes = end.allocatedBytes - start_.allocatedBytes;
+        result_.syscalls = end.syscalls - start_.syscalls;
+    }
+
+private:
+    StageResult& result_;
+    Counters start_;
+};
+
+SyntheticSourceOptions SourceOptions(const BenchOptions& options, const CaseSpec& spec) {
+    SyntheticSourceOptions source;
+    source.sampleRate = options.sampleRate;
+    source.channels = static_cast<uint16_t>(spec.channels);
+    source.floatSamples = true;   // the shared-mode mix format WASAPI hands out
+    source.period = std::chrono::milliseconds(spec.chunkMs);
+    source.realTime = false;
+    source.totalFrames = static_cast<uint64_t>(options.seconds) * options.sampleRate;
+    return source;
+}
+
+StageResult RunSourceStage(const BenchOptions& options, const CaseSpec& spec) {
+    StageResult result;
+    result.stage = "source";
+    SyntheticSource source(SourceOptions(options, spec));
+    source.Start();
+    uint64_t frames = 0;
+    uint64_t checksum = 0;
+    StageTimer timer(result);
+    for (;;) {
+        SourcePacket packet;
+        if (source.Read(packet) != SourceReadResult::Packet) {
+            break;
+        }
+        checksum += packet.data[0];
+        frames += packet.frames;
+        source.Release(packet);
+    }
+    timer.End(frames);
+    source.Stop();
+    result.detail = "checksum=" + std::to_string(checksum & 0xff);
+    return result;
+}
+
+StageResult RunRingStage(const BenchOptions& options, const CaseSpec& spec) {
+    StageResult result;
+    result.stage = "ring";
+    SyntheticSource source(SourceOptions(options, spec));
+    const uint32_t bytesPerFrame = source.Format().BytesPerFrame();
+    const size_t packetBytes = static_cast<size_t>(options.sampleRate) * spec.chunkMs / 1000 * bytesPerFrame;
+    const uint64_t totalBytes = *SourceOptions(options, spec).totalFrames * bytesPerFrame;
+    // Same sizing as a recording: 2 s of ring, writer chunks of at least 16 KiB.
+    SpscByteRingBuffer ring(static_cast<size_t>(options.sampleRate) * 2 * bytesPerFrame);
+    std::vector<uint8_t> packet(packetBytes, 1);
+    std::vector<uint8_t> chunk(std::max<size_t>(static_cast<size_t>(bytesPerFrame) * 512, 16384));
+
+    StageTimer timer(result);
+    std::thread writer([&]() {
+        uint64_t popped = 0;
+        while (popped < totalBytes) {
+            const size_t bytes = ring.Read(chunk.data(), chunk.size());
+            if (bytes == 0) {
+                std::this_thread::yield();
+            }
+            popped += bytes;
+        }
+    });
+    uint64_t pushed = 0;
+    while (pushed < totalBytes) {
+        const size_t want = static_cast<size_t>(std::min<uint64_t>(packetBytes, totalBytes - pushed));
+        size_t offset = 0;
+        while (offset < want) {
+            const size_t wrote = ring.Write(packet.data() + offset, want - offset);
+            if (wrote == 0) {
+                std::this_thread::yield();
+            }
+            offset += wrote;
+        }
+        pushed += want;
+    }
+    writer.join();
+    timer.End(totalBytes / bytesPerFrame);
+    return result;
+}
+
+// Each case writes into its own directory, removed afterwards unless --keep.
+std::filesystem::path CaseDirectory(const BenchOptions& options, const CaseSpec& spec) {
+    return options.outDir / (spec.format + "_" + std::to_string(spec.channels) + "ch_" + std::to_string(spec.chunkMs) +
+                             "ms_seg" + std::to_string(spec.segmentSeconds));
+}
+
+std::filesystem::path CaseOutputPath(const BenchOptions& options, const CaseSpec& spec, const char* stage) {
+    return CaseDirectory(options, spec) / (std::string(stage) + "." + spec.format);
+}
+
+StageResult RunWriterStage(const BenchOptions& options, const CaseSpec& spec, Logger& logger) {
+    StageResult result;
+    result.stage = "writer";
+    SyntheticSource source(SourceOptions(options, spec));
+    const AudioFormat& format = source.Format();
+    std::vector<uint8_t> audio;
+    source.Start();
+    for (;;) {
+        SourcePacket packet;
+        if (source.Read(packet) != SourceReadResult::Packet) {
+            break;
+        }
+        audio.insert(audio.end(), packet.data, packet.data + static_cast<size_t>(packet.frames) * format.BytesPerFrame());
+        source.Release(packet);
+    }
+    source.Stop();
+
+    SegmentedOutputOptions outputOptions;
+    outputOptions.basePath = CaseOutputPath(options, spec, "writer");
+    outputOptions.mp3Output = spec.format == "mp3";
+    outputOptions.segmentationEnabled = spec.segmentSeconds > 0;
+    if (spec.segmentSeconds) {
+        outputOptions.segmentFrameTarget = static_cast<uint64_t>(spec.segmentSeconds) * options.sampleRate;
+    }
+    outputOptions.diskGuard.reset();
+    const size_t chunkBytes = std::max<size_t>(static_cast<size_t>(format.BytesPerFrame()) * 512, 16384);
+    try {
+        SegmentedOutput output(std::move(outputOptions), format, logger);
+        StageTimer timer(result);
+        output.Start();
+        for (size_t offset = 0; offset < audio.size(); offset += chunkBytes) {
+            output.Write(audio.data() + offset, std::min(chunkBytes, audio.size() - offset));
+        }
+        output.Finish();
+        timer.End(audio.size() / format.BytesPerFrame());
+        result.detail = "segments=" + std::to_string(output.SegmentsOpened());
+    } catch (const std::exception& ex) {
+        result.error = ex.what();
+    }
+    return result;
+}
+
+StageResult RunPipelineStage(const BenchOptions& options, const CaseSpec& spec, Logger& logger) {
+    StageResult result;
+    result.stage = "pipeline";
+    SyntheticSource source(SourceOptions(options, spec));
+    RecorderConfig config;
+    config.outputPath = CaseOutputPath(options, spec, "pipeline");
+    config.quietStatusUpdates = true;
+    config.diskGuard.reset();
+    if (spec.segmentSeconds) {
+        config.segmentDuration = std::chrono::seconds(spec.segmentSeconds);
+    }
+    RecorderMetrics metrics;
+    RecorderControls controls;
+    controls.metrics = &metrics;
+    try {
+        CapturePipeline pipeline(logger);
+        pipeline.Prepare(source.Format(), config);
+        StageTimer timer(result);
+        const RecorderStats stats = pipeline.Run(source, config, controls);
+        timer.End(stats.framesCaptured);
+        const uint64_t writerBusy = metrics.writerBusyNanos.load();
+        const double writerFps = writerBusy ? static_cast<double>(metrics.framesWritten.load()) * 1e9 / static_cast<double>(writerBusy) : 0.0;
+        char detail[160];
+        std::snprintf(detail, sizeof(detail), "dropped=%llu ring_waits=%u writer_busy_fps=%.0f capture_cpu=%.2fs writer_cpu=%.2fs",
+                      static_cast<unsigned long long>(stats.framesDropped), stats.ringBufferWaits, writerFps,
+                      static_cast<double>(stats.captureThread.CpuNanos()) / 1e9,
+                      static_cast<double>(stats.writerThread.CpuNanos()) / 1e9);
+        result.detail = detail;
+        if (stats.framesDropped > 0) {
+            result.error = "dropped frames";
+        }
+    } catch (const std::exception& ex) {
+        result.error = ex.what();
+    }
+    return result;
+}
+
+void Report(const BenchOptions& options, const CaseSpec& spec, const StageResult& stage) {
+    const double realtime = stage.FramesPerSecond() / options.sampleRate;
+    if (options.json) {
+        JsonObjectBuilder line;
+        line.Add("case", spec.Name()).Add("format", spec.format).Add("channels", spec.channels)
+            .Add("chunk_ms", spec.chunkMs).Add("segment_seconds", spec.segmentSeconds).Add("stage", stage.stage);
+        if (!stage.error.empty()) {
+            line.Add("error", stage.error);
+        }
+        line.Add("frames", stage.frames).Add("seconds", stage.seconds).Add("frames_per_sec", stage.FramesPerSecond())
+            .Add("realtime", realtime).Add("allocations", stage.allocations).Add("allocated_bytes", stage.allocatedBytes)
+            .Add("syscalls", stage.syscalls);
+        if (!stage.detail.empty()) {
+            line.Add("detail", stage.detail);
+        }
+        std::printf("%s\n", line.Str().c_str());
+        return;
+    }
+    if (!stage.error.empty() && stage.frames == 0) {
+        std::printf("  %-9s skipped: %s\n", stage.stage.c_str(), stage.error.c_str());
+        return;
+    }
+    std::printf("  %-9s %12.0f fr/s %9.1fx  allocs=%-8llu (%llu B)  syscalls=%-7llu %s%s%s\n", stage.stage.c_str(),
+                stage.FramesPerSecond(), realtime, static_cast<unsigned long long>(stage.allocations),
+                static_cast<unsigned long long>(stage.allocatedBytes), static_cast<unsigned long long>(stage.syscalls),
+                stage.detail.c_str(), stage.error.empty() ? "" : "  ERROR: ", stage.error.c_str());
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    BenchOptions options;
+    if (!ParseArgs(argc, argv, options)) {
+        PrintUsage();
+        return 1;
+    }
+    std::error_code ec;
+
+    Logger logger;
+    logger.SetConsoleOutput(false);
+    if (!options.json) {
+        std::printf("%u s of %u Hz float audio per case, output in %s\n", options.seconds, options.sampleRate,
+                    options.outDir.string().c_str());
+    }
+
+    bool belowGate = false;
+    for (const auto& format : options.formats) {
+        for (const uint32_t channels : options.channels) {
+            for (const uint32_t chunkMs : options.chunkMs) {
+                for (const uint32_t segmentSeconds : options.segmentSeconds) {
+                    const CaseSpec spec{format, channels, chunkMs, segmentSeconds};
+                    if (!options.json) {
+                        std::printf("%s\n", spec.Name().c_str());
+                    }
+                    std::filesystem::create_directories(CaseDirectory(options, spec), ec);
+                    if (ec) {
+                        std::fprintf(stderr, "cannot create %s: %s\n", CaseDirectory(options, spec).string().c_str(),
+                                     ec.message().c_str());
+                        return 1;
+                    }
+                    const StageResult stages[] = {
+                        RunSourceStage(options, spec),
+                        RunRingStage(options, spec),
+                        RunWriterStage(options, spec, logger),
+                        RunPipelineStage(options, spec, logger),
+                    };
+                    for (const auto& stage : stages) {
+                        Report(options, spec, stage);
+                    }
+                    const StageResult& pipeline = stages[3];
+                    if (options.minRealtime &&
+                        (!pipeline.error.empty() || pipeline.FramesPerSecond() / options.sampleRate < *options.minRealtime)) {
+                        belowGate = true;
+                    }
+                    if (!options.keep) {
+                        std::filesystem::remove_all(CaseDirectory(options, spec), ec);
+                    }
+                }
+            }
+        }
+    }
+    logger.Flush();
+    if (belowGate) {
+        std::fprintf(stderr, "pipeline below --min-realtime %.1fx\n", *options.minRealtime);
+        return 2;
+    }
+    return 0;
+}
@@ -0,0 +1,446 @@
+// Soak test for the drop and overflow paths of the recording pipeline.
+//
+// Each scenario records a real-time synthetic source with packet jitter, burst delivery and a
+// bounded "device buffer", through a sink that injects latency spikes, a long stall or a
+// write error on a schedule. Afterwards it checks:
+//   - frame accounting: every frame the source delivered was either captured or dropped
+//   - the gap map: per-segment drops and gaps in the manifest add up to the session counters,
+//     and segments tile the session timeline without holes
+//   - file validity: RIFF/data sizes match the files, manifest checksums verify, and the
+//     audio frames on disk equal the captured frames
+//   - the scenario's own expectation (no loss, loss, early stop or writer failure)
+// Exit code 0 when every scenario passes, 1 otherwise.
+
+#include "CapturePipeline.h"
+#include "Logger.h"
+#include "SegmentManifest.h"
+#include "SegmentedOutput.h"
+#include "SyntheticSource.h"
+#include "WavWriter.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+using std::chrono::milliseconds;
+
+struct SoakOptions {
+    uint32_t seconds = 30;                 // recorded per scenario
+    std::vector<std::string> scenarios{"clean", "gaps", "slow-disk", "fail-on-glitch", "write-error"};
+    std::optional<milliseconds> ringMs;     // override the scenarios' ring size
+    std::optional<milliseconds> watchdogMs; // override the scenarios' watchdog
+    std::filesystem::path outDir = std::filesystem::temp_directory_path() / "recorder_soak";
+    std::optional<std::filesystem::path> logFile;
+    uint32_t seed = 1;
+    bool keep = false;
+};
+
+void PrintUsage() {
+    std::printf("Usage: recorder_soak [--seconds N] [--scenario clean,gaps,slow-disk,fail-on-glitch,write-error]\n"
+                "                     [--ring-ms N] [--watchdog-ms N] [--seed N] [--out-dir path] [--keep] [--log path]\n");
+}
+
+bool ParseArgs(int argc, char** argv, SoakOptions& options) {
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        const bool hasValue = i + 1 < argc;
+        if (arg == "--seconds" && hasValue) {
+            options.seconds = std::max(6, std::atoi(argv[++i]));
+        } else if (arg == "--scenario" && hasValue) {
+            options.scenarios.clear();
+            std::stringstream items(argv[++i]);
+            std::string item;
+            while (std::getline(items, item, ',')) {
+                options.scenarios.push_back(item);
+            }
+        } else if (arg == "--ring-ms" && hasValue) {
+            options.ringMs = milliseconds(std::max(1, std::atoi(argv[++i])));
+        } else if (arg == "--watchdog-ms" && hasValue) {
+            options.watchdogMs = milliseconds(std::max(1, std::atoi(argv[++i])));
+        } else if (arg == "--seed" && hasValue) {
+            options.seed = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        } else if (arg == "--out-dir" && hasValue) {
+            options.outDir = std::filesystem::path(argv[++i]);
+        } else if (arg == "--log" && hasValue) {
+            options.logFile = std::filesystem::path(argv[++i]);
+        } else if (arg == "--keep") {
+            options.keep = true;
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+// When the sink misbehaves, measured from Arm() (just before the session starts).
+struct FaultSchedule {
+    milliseconds spikeEvery{0};              // a latency spike in Write this often
+    milliseconds spikeLength{0};
+    std::optional<milliseconds> stallAt;     // one long stall
+    milliseconds stallLength{0};
+    std::optional<milliseconds> failAt;      // every Write throws from here on
+};
+
+// Shared by the writers of all segments, so the schedule runs across rolls.
+class FaultInjector {
+public:
+    explicit FaultInjector(FaultSchedule schedule) : schedule_(schedule) {}
+
+    void Arm() {
+        start_ = Clock::now();
+        nextSpike_ = start_ + schedule_.spikeEvery;
+        stalled_ = false;
+    }
+
+    // Writer thread, before every write.
+    void BeforeWrite() {
+        const auto now = Clock::now();
+        if (schedule_.failAt && now - start_ >= *schedule_.failAt) {
+            ++failures_;
+            throw std::runtime_error("injected write error");
+        }
+        if (schedule_.stallAt && !stalled_ && now - start_ >= *schedule_.stallAt) {
+            stalled_ = true;
+            ++stalls_;
+            std::this_thread::sleep_for(schedule_.stallLength);
+            return;
+        }
+        if (schedule_.spikeEvery.count() > 0 && now >= nextSpike_) {
+            ++spikes_;
+            std::this_thread::sleep_for(schedule_.spikeLength);
+            nextSpike_ = Clock::now() + schedule_.spikeEvery;
+        }
+    }
+
+    std::unique_ptr<IAudioWriter> Wrap(std::unique_ptr<IAudioWriter> inner);
+
+    uint32_t Spikes() const { return spikes_.load(); }
+    uint32_t Stalls() const { return stalls_.load(); }
+    uint32_t Failures() const { return failures_.load(); }
+
+private:
+    FaultSchedule schedule_;
+    Clock::time_point start_{};
+    Clock::time_point nextSpike_{};
+    bool stalled_ = false;
+    std::atomic<uint32_t> spikes_{0};
+    std::atomic<uint32_t> stalls_{0};
+    std::atomic<uint32_t> failures_{0};
+};
+
+class FaultInjectingWriter final : public IAudioWriter {
+public:
+    FaultInjectingWriter(std::unique_ptr<IAudioWriter> inner, FaultInjector& injector)
+        : inner_(std::move(inner)), injector_(injector) {}
+    void Write(const uint8_t* data, size_t byteCount) override {
+        injector_.BeforeWrite();
+        inner_->Write(data, byteCount);
+    }
+    void Flush() override { inner_->Flush(); }
+    void Close() override { inner_->Close(); }
+    uint64_t FileBytes() const override { return inner_->FileBytes(); }
+    SegmentChecksum Checksum() const override { return inner_->Checksum(); }
+    uint64_t RenditionBytes() const override { return inner_->RenditionBytes(); }
+
+private:
+    std::unique_ptr<IAudioWriter> inner_;
+    FaultInjector& injector_;
+};
+
+std::unique_ptr<IAudioWriter> FaultInjector::Wrap(std::unique_ptr<IAudioWriter> inner) {
+    return std::make_unique<FaultInjectingWriter>(std::move(inner), *this);
+}
+
+enum class Expectation {
+    NoLoss,        // nothing dropped, lost or cut short
+    Loss,          // the stall outlasts the buffers: frames are dropped or lost, the session goes on
+    EarlyStop,     // --fail-on-glitch ends the session at the first overflow
+    WriterError,   // Run() throws; everything written up to the error is a valid file
+};
+
+struct Scenario {
+    std::string name;
+    SyntheticSourceOptions source;
+    FaultSchedule faults;
+    RecorderConfig config;
+    Expectation expectation = Expectation::NoLoss;
+};
+
+std::optional<Scenario> MakeScenario(const std::string& name, const SoakOptions& options) {
+    const milliseconds duration(static_cast<int64_t>(options.seconds) * 1000);
+    Scenario scenario;
+    scenario.name = name;
+    scenario.source.realTime = true;
+    scenario.source.floatSamples = false;
+    scenario.source.jitter = std::chrono::microseconds(4000);
+    scenario.source.burstEvery = milliseconds(3000);
+    scenario.source.burstLength = milliseconds(120);
+    scenario.source.deviceBuffer = milliseconds(1000);
+    scenario.source.seed = options.seed;
+    scenario.faults.spikeEvery = milliseconds(1000);
+    scenario.faults.spikeLength = milliseconds(30);
+    scenario.config.quietStatusUpdates = true;
+    scenario.config.diskGuard.reset();
+    scenario.config.maxDuration = std::chrono::duration_cast<std::chrono::seconds>(duration);
+    scenario.config.segmentDuration = std::chrono::seconds(std::max<uint32_t>(options.seconds / 5, 1));
+    scenario.config.ringBufferSize = milliseconds(1000);
+    scenario.config.watchdogTimeout = milliseconds(1000);
+
+    if (name == "clean") {
+        // Spikes and bursts that the ring absorbs.
+    } else if (name == "gaps") {
+        scenario.source.discontinuityEvery = 250;
+    } else if (name == "slow-disk" || name == "fail-on-glitch") {
+        scenario.source.deviceBuffer = milliseconds(200);
+        scenario.config.watchdogTimeout = milliseconds(300);
+        scenario.faults.stallAt = duration / 3;
+        scenario.faults.stallLength = milliseconds(3000);
+        scenario.expectation = name == "slow-disk" ? Expectation::Loss : Expectation::EarlyStop;
+        scenario.config.failOnGlitch = name == "fail-on-glitch";
+    } else if (name == "write-error") {
+        scenario.faults.failAt = duration / 2;
+        scenario.expectation = Expectation::WriterError;
+    } else {
+        return std::nullopt;
+    }
+    if (options.ringMs) {
+        scenario.config.ringBufferSize = *options.ringMs;
+    }
+    if (options.watchdogMs) {
+        scenario.config.watchdogTimeout = *options.watchdogMs;
+    }
+    return scenario;
+}
+
+class Checker {
+public:
+
+    void Expect(bool condition, const std::string& what) {
+        if (!condition) {
+            ++failures_;
+            std::printf("  FAIL %s\n", what.c_str());
+        }
+    }
+    bool Passed() const { return failures_ == 0; }
+
+private:
+    uint32_t failures_ = 0;
+};
+
+uint32_t ReadUint32(std::ifstream& stream, uint64_t offset) {
+    uint32_t value = 0;
+    stream.seekg(static_cast<std::streamoff>(offset));
+    stream.read(reinterpret_cast<char*>(&value), sizeof(value));
+    return stream ? value : 0;
+}
+
+// Frames in a finished WAV file, after checking that both size fields were patched.
+std::optional<uint64_t> CheckWavFile(const std::filesystem::path& path, Checker& checker) {
+    try {
+        const WavFileLayout layout = ReadWavFileLayout(path);
+        const uint64_t fileBytes = std::filesystem::file_size(path);
+        std::ifstream stream(path, std::ios::binary);
+        const uint32_t riffSize = ReadUint32(stream, 4);
+        const uint32_t dataSize = ReadUint32(stream, layout.dataOffset - 4);
+        checker.Expect(riffSize == fileBytes - 8, path.filename().string() + ": RIFF size " + std::to_string(riffSize) +
+                                                      " != file size - 8 (" + std::to_string(fileBytes - 8) + ")");
+        checker.Expect(dataSize == fileBytes - layout.dataOffset,
+                       path.filename().string() + ": data chunk size not patched");
+        checker.Expect(dataSize % layout.format.BytesPerFrame() == 0, path.filename().string() + ": partial frame");
+        return dataSize / layout.format.BytesPerFrame();
+    } catch (const std::exception& ex) {
+        checker.Expect(false, path.filename().string() + ": " + ex.what());
+        return std::nullopt;
+    }
+}
+
+bool RunScenario(const Scenario& scenario, const SoakOptions& options, Logger& logger) {
+    std::printf("%s: %u s, ring %lld ms, watchdog %lld ms%s\n", scenario.name.c_str(), options.seconds,
+                static_cast<long long>(scenario.config.ringBufferSize.count()),
+                static_cast<long long>(scenario.config.watchdogTimeout.count()),
+                scenario.config.failOnGlitch ? ", fail-on-glitch" : "");
+    const std::filesystem::path directory = options.outDir / scenario.name;
+    std::error_code ec;
+    std::filesystem::remove_all(directory, ec);
+    std::filesystem::create_directories(directory);
+
+    RecorderConfig config = scenario.config;
+    config.outputPath = directory / "soak.wav";
+    SyntheticSource source(scenario.source);
+    FaultInjector injector(scenario.faults);
+    RecorderControls controls;
+    controls.wrapWriter = [&injector](std::unique_ptr<IAudioWriter> inner) { return injector.Wrap(std::move(inner)); };
+
+    CapturePipeline pipeline(logger);
+    RecorderStats stats;
+    std::optional<std::string> runError;
+    injector.Arm();
+    const auto started = Clock::now();
+    try {
+        stats = pipeline.Run(source, config, controls);
+    } catch (const std::exception& ex) {
+        runError = ex.what();
+    }
+    const double elapsed = std::chrono::duration<double>(Clock::now() - started).count();
+    logger.Flush();
+
+    Checker checker;
+    const uint32_t sampleRate = scenario.source.sampleRate;
+    const uint64_t plannedFrames = static_cast<uint64_t>(options.seconds) * sampleRate;
+    const uint64_t packetFrames = static_cast<uint64_t>(sampleRate) * scenario.source.period.count() / 1000;
+    std::printf("  %.1f s: captured=%llu dropped=%llu lost-in-source=%llu gaps=%u ring-timeouts=%u writer-timeouts=%u "
+                "spikes=%u stalls=%u%s%s\n",
+                elapsed, static_cast<unsigned long long>(stats.framesCaptured),
+                static_cast<unsigned long long>(stats.framesDropped), static_cast<unsigned long long>(source.FramesLost()),
+                stats.glitchCount, stats.ringBufferTimeouts, stats.writerWaitTimeouts, injector.Spikes(),
+                injector.Stalls(), runError ? ", error: " : "", runError ? runError->c_str() : "");
+
+    // Frame accounting. A discontinuity under --fail-on-glitch ends the session with its
+    // packet unaccounted for, so allow one packet there.
+    const uint64_t delivered = source.FramesProduced();
+    const uint64_t accounted = stats.framesCaptured + stats.framesDropped;
+    if (scenario.expectation == Expectation::NoLoss || scenario.expectation == Expectation::Loss) {
+        checker.Expect(delivered == accounted, "delivered " + std::to_string(delivered) + " != captured + dropped " +
+                                                   std::to_string(accounted));
+        checker.Expect(stats.glitchCount == source.DiscontinuitiesFlagged(),
+                       "gaps " + std::to_string(stats.glitchCount) + " != flagged " +
+                           std::to_string(source.DiscontinuitiesFlagged()));
+    } else if (scenario.expectation == Expectation::EarlyStop) {
+        checker.Expect(delivered >= accounted && delivered - accounted <= packetFrames,
+                       "delivered " + std::to_string(delivered) + " vs captured + dropped " + std::to_string(accounted));
+    }
+
+    // Gap map from the manifest.
+    const auto manifestPath = BuildManifestPath(config.outputPath);
+    std::vector<SegmentManifestEntry> entries;
+    try {
+        entries = ReadSegmentManifest(manifestPath);
+    } catch (const std::exception& ex) {
+        checker.Expect(false, std::string("manifest: ") + ex.what());
+    }
+    uint64_t manifestDropped = 0;
+    uint64_t manifestGaps = 0;
+    uint64_t manifestFrames = 0;
+    for (size_t i = 0; i < entries.size(); ++i) {
+        const auto& entry = entries[i];
+        std::printf("    #%u frames %llu-%llu dropped=%llu gaps=%u\n", entry.segmentNumber,
+                    static_cast<unsigned long long>(entry.startFrame), static_cast<unsigned long long>(entry.endFrame),
+                    static_cast<unsigned long long>(entry.droppedFrames), entry.gaps);
+        if (i > 0) {
+            checker.Expect(entry.startFrame == entries[i - 1].endFrame,
+                           "segment #" + std::to_string(entry.segmentNumber) + " does not start where #" +
+                               std::to_string(entries[i - 1].segmentNumber) + " ended");
+        }
+        manifestDropped += entry.droppedFrames;
+        manifestGaps += entry.gaps;
+        manifestFrames += entry.endFrame - entry.startFrame;
+    }
+    if (scenario.expectation != Expectation::WriterError) {
+        checker.Expect(manifestDropped == stats.framesDropped, "manifest drops " + std::to_string(manifestDropped) +
+                                                                   " != session drops " + std::to_string(stats.framesDropped));
+        checker.Expect(manifestGaps == stats.glitchCount,
+                       "manifest gaps " + std::to_string(manifestGaps) + " != session gaps " + std::to_string(stats.glitchCount));
+        checker.Expect(manifestFrames == stats.framesCaptured, "manifest frames " + std::to_string(manifestFrames) +
+                                                                   " != captured " + std::to_string(stats.framesCaptured));
+    }
+
+    // Files: every WAV on disk is complete, listed ones verify against their checksums.
+    uint64_t framesOnDisk = 0;
+    size_t files = 0;
+    for (const auto& item : std::filesystem::directory_iterator(directory)) {
+        if (item.path().extension() == ".wav") {
+            ++files;
+            framesOnDisk += CheckWavFile(item.path(), checker).value_or(0);
+        }
+    }
+    if (!entries.empty()) {
+        const ManifestVerifyResult verify = VerifySegmentManifest(manifestPath, 0, logger);
+        checker.Expect(verify.Ok(), "manifest verification: " + std::to_string(verify.passed) + "/" +
+                                        std::to_string(verify.checked) + " segments passed");
+    }
+    if (scenario.expectation != Expectation::WriterError) {
+        checker.Expect(files == entries.size(), std::to_string(files) + " files but " + std::to_string(entries.size()) +
+                                                    " manifest entries");
+        checker.Expect(framesOnDisk == stats.framesCaptured, "frames on disk " + std::to_string(framesOnDisk) +
+                                                                 " != captured " + std::to_string(stats.framesCaptured));
+    }
+
+    switch (scenario.expectation) {
+    case Expectation::NoLoss:
+        checker.Expect(!runError, "unexpected error");
+        checker.Expect(stats.framesDropped == 0 && source.FramesLost() == 0, "frames were dropped or lost");
+        checker.Expect(stats.framesCaptured == plannedFrames, "captured " + std::to_string(stats.framesCaptured) +
+                                                                  " of " + std::to_string(plannedFrames) + " frames");
+        break;
+    case Expectation::Loss:
+        checker.Expect(!runError, "unexpected error");
+        checker.Expect(stats.framesDropped + source.FramesLost() > 0, "the stall lost nothing; raise it or shrink the ring");
+        // The duration limit counts captured frames and is checked per packet.
+        checker.Expect(stats.framesCaptured >= plannedFrames && stats.framesCaptured < plannedFrames + packetFrames,
+                       "captured " + std::to_string(stats.framesCaptured) + " frames for a limit of " +
+                           std::to_string(plannedFrames));
+        break;
+    case Expectation::EarlyStop:
+        checker.Expect(!runError, "unexpected error");
+        checker.Expect(stats.framesCaptured < plannedFrames, "the session was not stopped by the overflow");
+        break;
+    case Expectation::WriterError:
+        checker.Expect(runError.has_value(), "the injected write error did not fail the session");
+        checker.Expect(injector.Failures() > 0, "no write error was injected");
+        checker.Expect(framesOnDisk <= stats.framesCaptured || stats.framesCaptured == 0,
+                       "more frames on disk than captured");
+        checker.Expect(files >= 1 && files <= entries.size() + 1, "unexpected number of files");
+        break;
+    }
+
+    std::printf("  %s\n", checker.Passed() ? "PASS" : "FAILED");
+    if (!options.keep && checker.Passed()) {
+        std::filesystem::remove_all(directory, ec);
+    }
+    return checker.Passed();
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    SoakOptions options;
+    if (!ParseArgs(argc, argv, options)) {
+        PrintUsage();
+        return 1;
+    }
+    Logger logger;
+    logger.SetConsoleOutput(false);
+    if (options.logFile) {
+        logger.EnableFileLogging(*options.logFile);
+    }
+
+    bool allPassed = true;
+    for (const auto& name : options.scenarios) {
+        const auto scenario = MakeScenario(name, options);
+        if (!scenario) {
+            std::fprintf(stderr, "unknown scenario: %s\n", name.c_str());
+            PrintUsage();
+            return 1;
+        }
+        allPassed = RunScenario(*scenario, options, logger) && allPassed;
+    }
+    logger.Flush();
+    std::printf("%s\n", allPassed ? "all scenarios passed" : "some scenarios FAILED");
+    return allPassed ? 0 : 1;
+}
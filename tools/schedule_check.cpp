@@ -0,0 +1,285 @@
+// Checks the recording schedule: CronExpression::Next() against fixed answers, and a
+// RecorderDaemon run on the real clock. POSIX only (TZ rules, mkfifo).
+//
+//   - cron: `*`, lists, ranges, steps, day-of-month/day-of-week OR semantics, 7 as Sunday,
+//     the DST spring-forward gap and fall-back repeat, and the four-year horizon, all in
+//     the EST5EDT time zone with the expected instants given in UTC.
+//   - daemon: three sessions on consecutive minutes. A synthetic tone runs 65 s, so the PCM
+//     pipe session on the next minute starts 5 s late (inside the 10 s tolerance) and must
+//     stop at its scheduled end, 75 s in. That one runs 80 s, so the synthetic session on
+//     the third minute is 20 s late and must be skipped. The sessions counted, the file
+//     names expanded from the strftime template and the frames in each WAV are checked.
+//     Takes three to four minutes; --cron-only skips it.
+// Exit code 0 when every check passes.
+
+#include "Logger.h"
+#include "RecorderDaemon.h"
+#include "RecordingSchedule.h"
+#include "WavWriter.h"
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <fcntl.h>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+using std::chrono::seconds;
+using TimePoint = std::chrono::system_clock::time_point;
+
+constexpr uint32_t kSampleRate = 8000;
+
+class Checker {
+public:
+    void Expect(bool condition, const std::string& what) {
+        if (!condition) {
+            failures_.push_back(what);
+        }
+    }
+    bool Report(const char* name) const {
+        std::printf("%s: %s\n", name, failures_.empty() ? "ok" : "FAILED");
+        for (const auto& failure : failures_) {
+            std::printf("  %s\n", failure.c_str());
+        }
+        return failures_.empty();
+    }
+
+private:
+    std::vector<std::string> failures_;
+};
+
+TimePoint Utc(int year, int month, int day, int hour, int minute) {
+    std::tm tm{};
+    tm.tm_year = year - 1900;
+    tm.tm_mon = month - 1;
+    tm.tm_mday = day;
+    tm.tm_hour = hour;
+    tm.tm_min = minute;
+    return std::chrono::system_clock::from_time_t(timegm(&tm));
+}
+
+std::string FormatUtc(const std::optional<TimePoint>& time) {
+    if (!time) {
+        return "none";
+    }
+    const std::time_t timeT = std::chrono::system_clock::to_time_t(*time);
+    std::tm tm{};
+    gmtime_r(&timeT, &tm);
+    char buffer[32];
+    std::strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%MZ", &tm);
+    return buffer;
+}
+
+std::string LocalMinute(TimePoint time, const char* format) {
+    const std::time_t timeT = std::chrono::system_clock::to_time_t(time);
+    std::tm tm{};
+    localtime_r(&timeT, &tm);
+    char buffer[32];
+    std::strftime(buffer, sizeof(buffer), format, &tm);
+    return buffer;
+}
+
+bool CheckCron() {
+    Checker checker;
+    auto expectNext = [&](const char* cron, TimePoint after, std::optional<TimePoint> expected) {
+        const auto next = CronExpression::Parse(cron).Next(after);
+        checker.Expect(next == expected, std::string("'") + cron + "' after " + FormatUtc(after) + ": got " +
+                                             FormatUtc(next) + ", expected " + FormatUtc(expected));
+    };
+
+    // October 2026 is EDT (UTC-4); 2026-10-18 is a Sunday.
+    expectNext("* * * * *", Utc(2026, 10, 18, 14, 7) + seconds(30), Utc(2026, 10, 18, 14, 8));
+    expectNext("* * * * *", Utc(2026, 10, 18, 14, 7), Utc(2026, 10, 18, 14, 8));
+    expectNext("0,30 9 * * *", Utc(2026, 10, 18, 13, 0), Utc(2026, 10, 18, 13, 30));
+    expectNext("0 9-11 * * *", Utc(2026, 10, 18, 15, 0), Utc(2026, 10, 19, 13, 0));
+    expectNext("*/15 * * * *", Utc(2026, 10, 18, 14, 7), Utc(2026, 10, 18, 14, 15));
+    expectNext("5/20 * * * *", Utc(2026, 10, 18, 14, 30), Utc(2026, 10, 18, 14, 45));
+    expectNext("0 0 1 */6 *", Utc(2026, 10, 18, 14, 0), Utc(2027, 1, 1, 5, 0));
+
+    // Both day fields restricted: either one matching is enough (13th, a Tuesday; then Wednesday).
+    expectNext("0 12 13 * 3", Utc(2026, 10, 10, 16, 0), Utc(2026, 10, 13, 16, 0));
+    expectNext("0 12 13 * 3", Utc(2026, 10, 13, 16, 0), Utc(2026, 10, 14, 16, 0));
+    // A day-of-month starting with '*' does not restrict, so both must match: the 1st, 11th,
+    // 21st or 31st that is a Monday.
+    expectNext("0 12 */10 * 1", Utc(2026, 10, 18, 16, 0), Utc(2026, 12, 21, 17, 0));
+
+    expectNext("0 8 * * 7", Utc(2026, 10, 18, 13, 0), Utc(2026, 10, 25, 12, 0));
+    expectNext("0 8 * * 0", Utc(2026, 10, 18, 13, 0), Utc(2026, 10, 25, 12, 0));
+    expectNext("0 8 * * 6-7", Utc(2026, 10, 18, 13, 0), Utc(2026, 10, 24, 12, 0));
+
+    // 2026-03-08 02:00 EST jumps to 03:00 EDT: the hour after 01:30 is 03:00, and a time in
+    // the gap is skipped for that day.
+    expectNext("0 * * * *", Utc(2026, 3, 8, 6, 30), Utc(2026, 3, 8, 7, 0));
+    expectNext("30 2 * * *", Utc(2026, 3, 8, 5, 0), Utc(2026, 3, 9, 6, 30));
+    // 2026-11-01 02:00 EDT falls back to 01:00 EST: the repeated 01:30 runs once.
+    expectNext("30 1 * * *", Utc(2026, 11, 1, 4, 0), Utc(2026, 11, 1, 5, 30));
+    expectNext("30 1 * * *", Utc(2026, 11, 1, 5, 30), Utc(2026, 11, 2, 6, 30));
+    expectNext("0 * * * *", Utc(2026, 11, 1, 5, 30), Utc(2026, 11, 1, 7, 0));
+
+    // Leap day is within four years; impossible dates give up at the horizon.
+    expectNext("0 0 29 2 *", Utc(2026, 3, 1, 5, 0), Utc(2028, 2, 29, 5, 0));
+    expectNext("0 0 30 2 *", Utc(2026, 3, 1, 5, 0), std::nullopt);
+    expectNext("0 0 31 4 *", Utc(2026, 3, 1, 5, 0), std::nullopt);
+    return checker.Report("cron");
+}
+
+// Writes real-time s16 mono silence into a FIFO once a reader opens it, until the reader
+// goes away or `stop` is set.
+void FeedPipe(const std::filesystem::path& fifo, const std::atomic<bool>& stop, std::atomic<uint64_t>& bytesFed) {
+    int fd = -1;
+    while (fd < 0 && !stop.load()) {
+        fd = open(fifo.c_str(), O_WRONLY | O_NONBLOCK);
+        if (fd < 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));   // ENXIO until a reader opens
+        }
+    }
+    if (fd < 0) {
+        return;
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_NONBLOCK);
+    const std::vector<char> chunk(kSampleRate / 10 * sizeof(int16_t), 0);
+    auto due = std::chrono::steady_clock::now();
+    while (!stop.load()) {
+        const ssize_t written = write(fd, chunk.data(), chunk.size());
+        if (written <= 0 && errno != EINTR) {
+            break;   // EPIPE: the session ended
+        }
+        bytesFed.fetch_add(written > 0 ? static_cast<uint64_t>(written) : 0);
+        due += std::chrono::milliseconds(100);
+        std::this_thread::sleep_until(due);
+    }
+    close(fd);
+}
+
+uint64_t WavFrames(const std::filesystem::path& path) {
+    try {
+        const WavFileLayout layout = ReadWavFileLayout(path);
+        return layout.dataBytes / layout.format.BytesPerFrame();
+    } catch (const std::exception&) {
+        return 0;
+    }
+}
+
+bool CheckDaemon(const std::filesystem::path& outDir, Logger& logger) {
+    Checker checker;
+    const std::filesystem::path fifo = outDir / "pcm.fifo";
+    if (mkfifo(fifo.c_str(), 0600) != 0) {
+        checker.Expect(false, "mkfifo failed");
+        return checker.Report("daemon");
+    }
+
+    // First minute with time left for the two-second pre-warm.
+    const auto now = std::chrono::system_clock::now();
+    const auto first = std::chrono::floor<std::chrono::minutes>(now + seconds(10)) + std::chrono::minutes(1);
+    auto minuteOf = [](TimePoint time) { return std::stoi(LocalMinute(time, "%M")); };
+    const std::string format = " rate=" + std::to_string(kSampleRate) + " channels=1 sample=s16\n";
+    const std::string dir = outDir.string() + "/%Y%m%d/";
+    const std::string scheduleText =
+        std::to_string(minuteOf(first)) + " * * * *  65s  " + dir + "%H%M-tone.wav source=synthetic" + format +
+        std::to_string(minuteOf(first + std::chrono::minutes(1))) + " * * * *  80s  " + dir + "%H%M-pipe.wav source=pipe:" +
+        fifo.string() + format +
+        std::to_string(minuteOf(first + std::chrono::minutes(2))) + " * * * *  30s  " + dir + "%H%M-late.wav source=synthetic" + format;
+
+    RecorderDaemonOptions options;
+    options.baseConfig.quietStatusUpdates = true;
+    options.baseConfig.writeManifest = false;
+    options.baseConfig.writeIndex = false;
+    options.lateStartTolerance = seconds(10);
+    RecorderDaemon daemon(RecordingSchedule::Parse(scheduleText), options, logger);
+
+    std::atomic<bool> stopFeeding{false};
+    std::atomic<uint64_t> bytesFed{0};
+    std::thread feeder([&]() { FeedPipe(fifo, stopFeeding, bytesFed); });
+    const auto deadline = first + std::chrono::minutes(3) + seconds(30);
+    std::printf("daemon: sessions at %s, %s and %s local; about %lld s\n", LocalMinute(first, "%H:%M").c_str(),
+                LocalMinute(first + std::chrono::minutes(1), "%H:%M").c_str(),
+                LocalMinute(first + std::chrono::minutes(2), "%H:%M").c_str(),
+                static_cast<long long>(std::chrono::duration_cast<seconds>(first - now).count() + 150));
+    std::fflush(stdout);
+    daemon.Run([&]() {
+        return (daemon.SessionsRecorded() == 2 && daemon.SessionsSkipped() == 1) ||
+               std::chrono::system_clock::now() > deadline;
+    });
+    stopFeeding.store(true);
+    feeder.join();
+
+    checker.Expect(daemon.SessionsRecorded() == 2, "sessions recorded " + std::to_string(daemon.SessionsRecorded()) + ", expected 2");
+    checker.Expect(daemon.SessionsSkipped() == 1, "sessions skipped " + std::to_string(daemon.SessionsSkipped()) + ", expected 1");
+
+    const std::filesystem::path day = outDir / LocalMinute(first, "%Y%m%d");
+    const auto tone = day / (LocalMinute(first, "%H%M") + "-tone_001.wav");
+    const auto pipe = outDir / LocalMinute(first + std::chrono::minutes(1), "%Y%m%d") /
+                      (LocalMinute(first + std::chrono::minutes(1), "%H%M") + "-pipe_001.wav");
+    std::vector<std::string> files;
+    for (const auto& entry : std::filesystem::recursive_directory_iterator(outDir)) {
+        if (entry.path().extension() == ".wav") {
+            files.push_back(entry.path().lexically_relative(outDir).string());
+        }
+    }
+    std::string listing;
+    for (const auto& file : files) {
+        listing += " " + file;
+    }
+    checker.Expect(files.size() == 2, "expected two WAV files, found:" + listing);
+    checker.Expect(std::filesystem::exists(tone), "missing " + tone.string() + "; found:" + listing);
+    checker.Expect(std::filesystem::exists(pipe), "missing " + pipe.string() + "; found:" + listing);
+
+    const uint64_t toneFrames = WavFrames(tone);
+    checker.Expect(toneFrames == uint64_t{65} * kSampleRate,
+                   "synthetic session has " + std::to_string(toneFrames) + " frames, expected the full 65 s");
+    // Started about 5 s late, so maxDuration is what is left until next->end: whole seconds,
+    // short of the 80 s entry duration.
+    const uint64_t pipeFrames = WavFrames(pipe);
+    checker.Expect(pipeFrames % kSampleRate == 0 && pipeFrames >= uint64_t{72} * kSampleRate &&
+                       pipeFrames <= uint64_t{76} * kSampleRate,
+                   "pipe session has " + std::to_string(pipeFrames) + " frames, expected 72-76 s (cut at the scheduled end)");
+    checker.Expect(bytesFed.load() >= pipeFrames * sizeof(int16_t), "pipe session recorded more than was fed");
+    return checker.Report("daemon");
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::filesystem::path outDir = std::filesystem::temp_directory_path() / "schedule_check";
+    bool cronOnly = false;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--out-dir" && i + 1 < argc) {
+            outDir = argv[++i];
+        } else if (arg == "--cron-only") {
+            cronOnly = true;
+        } else {
+            std::printf("Usage: schedule_check [--out-dir path] [--cron-only]\n");
+            return 1;
+        }
+    }
+    setenv("TZ", "EST5EDT,M3.2.0,M11.1.0", 1);
+    tzset();
+    std::signal(SIGPIPE, SIG_IGN);
+
+    bool passed = CheckCron();
+    if (!cronOnly) {
+        std::error_code ec;
+        std::filesystem::remove_all(outDir, ec);
+        std::filesystem::create_directories(outDir);
+        Logger logger;
+        logger.SetConsoleOutput(false);
+        passed = CheckDaemon(outDir, logger) && passed;
+        logger.Flush();
+        std::filesystem::remove_all(outDir, ec);
+    }
+    std::printf("%s\n", passed ? "all checks passed" : "checks FAILED");
+    return passed ? 0 : 1;
+}